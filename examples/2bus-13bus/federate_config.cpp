@@ -0,0 +1,265 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   federate_config.cpp
+ *
+ * @brief  Settings for the HELICS-GridPACK federate
+ *
+ */
+// -------------------------------------------------------------
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "boost/property_tree/ptree.hpp"
+#include "boost/property_tree/json_parser.hpp"
+#include "gridpack/include/gridpack.hpp"
+#include "federate_config.hpp"
+
+namespace gridpack {
+namespace powerflow {
+
+/**
+ * Read the Configuration.Federate block of the input file, which must
+ * already be open, and the JSON mapping file it names
+ * @param comm communicator of processes running the federate
+ * @param settings (output) federate settings
+ * @return false if the mapping file could not be read or does not define
+ *         any boundaries or ties
+ */
+bool readFederateSettings(const gridpack::parallel::Communicator &comm,
+    FederateSettings &settings)
+{
+  // Run control parameters. Defaults correspond to a 10 s co-simulation
+  // with 1 s steps
+  //   endTime: end of the co-simulation (s)
+  //   period: HELICS time period (s)
+  //   uninterruptible: only return from time requests at the requested time
+  //   variableStep: request up to maxStep ahead and let HELICS grant an
+  //     earlier time when new loads arrive, instead of stepping every period.
+  //     Ignored if uninterruptible is true
+  //   asyncTimeRequest: request the next time step with requestTimeAsync
+  //     as soon as voltages are published, so that logging and output
+  //     overlap the round trip to the broker
+  //   iterativeCoupling: after publishing voltages, ask HELICS to iterate
+  //     at the same time (ITERATE_IF_NEEDED) and re-solve until the
+  //     boundary loads and voltages change by less than couplingTolerance
+  //     (per unit) or maxCouplingIterations is reached
+  //   changeDetection: only solve a case if one of its loads has been
+  //     updated and differs from the load of the last solve by more than
+  //     loadDeadband (per unit). Otherwise the last voltages are reused and
+  //     not republished
+  //   signalFile, signalFormat, signalFlushInterval: boundary signal
+  //     recorder output
+  //   telemetryRing, telemetrySlots: name of a shared memory ring buffer
+  //     that receives the boundary state and convergence of every step,
+  //     holding the last telemetrySlots steps. Empty disables the ring
+  //   perturbationFile: JSON batch of scheduled perturbations applied
+  //     from the start of the run
+  //   tieTolerance, maxTieIterations: the areas coupled by ties are solved
+  //     again each step until the voltages at the tie ends change by less
+  //     than tieTolerance (per unit) or maxTieIterations is reached
+  //   mapping: JSON file describing the boundaries
+  settings.end_time = 10.0;
+  settings.period = 1.0;
+  settings.uninterruptible = false;
+  settings.variable_step = false;
+  settings.max_step = 0.0;
+  settings.async_request = false;
+  settings.iterative = false;
+  settings.coupling_tolerance = 1.0e-6;
+  settings.max_coupling = 10;
+  settings.change_detection = true;
+  settings.deadband = 0.0;
+  settings.signal_file = "gpk.csv";
+  settings.signal_format = "csv";
+  settings.flush_interval = 4096;
+  settings.telemetry_ring = "";
+  settings.telemetry_slots = 1024;
+  settings.perturbation_file = "";
+  settings.tie_tolerance = 1.0e-6;
+  settings.max_tie_iterations = 20;
+  std::string mapping = "gpk-mapping.json";
+  gridpack::utility::Configuration::CursorPtr cursor;
+  cursor = gridpack::utility::Configuration::configuration()->getCursor(
+      "Configuration.Federate");
+  if (cursor) {
+    settings.end_time = cursor->get("endTime",settings.end_time);
+    settings.period = cursor->get("period",settings.period);
+    settings.uninterruptible = cursor->get("uninterruptible",
+        settings.uninterruptible);
+    settings.variable_step = cursor->get("variableStep",
+        settings.variable_step);
+    settings.max_step = cursor->get("maxStep",settings.max_step);
+    settings.async_request = cursor->get("asyncTimeRequest",
+        settings.async_request);
+    settings.iterative = cursor->get("iterativeCoupling",settings.iterative);
+    settings.coupling_tolerance = cursor->get("couplingTolerance",
+        settings.coupling_tolerance);
+    settings.max_coupling = cursor->get("maxCouplingIterations",
+        settings.max_coupling);
+    settings.change_detection = cursor->get("changeDetection",
+        settings.change_detection);
+    settings.deadband = cursor->get("loadDeadband",settings.deadband);
+    cursor->get("signalFile",&settings.signal_file);
+    cursor->get("signalFormat",&settings.signal_format);
+    settings.flush_interval = cursor->get("signalFlushInterval",
+        settings.flush_interval);
+    cursor->get("telemetryRing",&settings.telemetry_ring);
+    settings.telemetry_slots = cursor->get("telemetrySlots",
+        settings.telemetry_slots);
+    cursor->get("perturbationFile",&settings.perturbation_file);
+    settings.tie_tolerance = cursor->get("tieTolerance",
+        settings.tie_tolerance);
+    settings.max_tie_iterations = cursor->get("maxTieIterations",
+        settings.max_tie_iterations);
+    cursor->get("mapping",&mapping);
+  }
+  if (settings.uninterruptible) settings.variable_step = false;
+  // Without an explicit limit, a variable step may extend to the end time
+  if (settings.max_step <= 0.0) settings.max_step = settings.end_time;
+
+  // Read the mapping file. The file is small, so every process reads it
+  boost::property_tree::ptree tree;
+  try {
+    boost::property_tree::read_json(mapping, tree);
+  } catch (boost::property_tree::json_parser_error &e) {
+    if (comm.rank() == 0) {
+      printf("Unable to read federate mapping file (%s): %s\n",
+          mapping.c_str(),e.what());
+    }
+    return false;
+  }
+  settings.name = tree.get<std::string>("name","gridpack");
+  settings.core_type = tree.get<std::string>("coreType","zmq");
+  settings.core_init = tree.get<std::string>("coreInit","--federates=1");
+  settings.broker_address = tree.get<std::string>("brokerAddress","");
+  settings.log_level = tree.get<std::string>("logLevel","debug");
+  settings.vector_publication = tree.get<std::string>("vectorPublication","");
+  settings.vector_subscription =
+    tree.get<std::string>("vectorSubscription","");
+  settings.perturbation_endpoint =
+    tree.get<std::string>("perturbationEndpoint","");
+
+  settings.cases.clear();
+  settings.boundaries.clear();
+  settings.ties.clear();
+  boost::optional<boost::property_tree::ptree&> cases
+    = tree.get_child_optional("cases");
+  if (cases) {
+    boost::property_tree::ptree::iterator cit;
+    for (cit = cases->begin(); cit != cases->end(); cit++) {
+      boost::property_tree::ptree &cnode = cit->second;
+      FederateCase fcase;
+      int icase = settings.cases.size();
+      char buf[32];
+      sprintf(buf,"%d",icase);
+      fcase.name = cnode.get<std::string>("name",buf);
+      fcase.network = cnode.get<std::string>("network","");
+      fcase.format = cnode.get<std::string>("format","PTI23");
+      double angle = cnode.get<double>("angle",0.0)*M_PI/180.0;
+      fcase.rotation = std::polar(1.0,angle);
+      boost::optional<boost::property_tree::ptree&> bnds
+        = cnode.get_child_optional("boundaries");
+      if (bnds) {
+        boost::property_tree::ptree::iterator bit;
+        for (bit = bnds->begin(); bit != bnds->end(); bit++) {
+          boost::property_tree::ptree &bnode = bit->second;
+          FederateBoundary bnd;
+          bnd.icase = icase;
+          bnd.bus = bnode.get<int>("bus",-1);
+          sprintf(buf,"%d",bnd.bus);
+          bnd.name = bnode.get<std::string>("name",
+              fcase.name+"_"+std::string(buf));
+          bnd.subscription = bnode.get<std::string>("subscription","");
+          bnd.load_unit = bnode.get<std::string>("loadUnit","VA");
+          bnd.publication = bnode.get<std::string>("publication","");
+          bnd.voltage_unit = bnode.get<std::string>("voltageUnit","V");
+          bnd.power_scale = bnode.get<double>("powerScale",1.0);
+          bnd.voltage_base = bnode.get<double>("voltageBase",1.0);
+          bnd.initial_voltage_base = bnode.get<double>("initialVoltageBase",
+              bnd.voltage_base);
+          bnd.rotation = std::polar(1.0,angle);
+          if (bnd.bus < 0) {
+            if (comm.rank() == 0) {
+              printf("Boundary (%s) in case (%s) has no bus\n",
+                  bnd.name.c_str(),fcase.name.c_str());
+            }
+            return false;
+          }
+          fcase.boundaries.push_back(settings.boundaries.size());
+          settings.boundaries.push_back(bnd);
+        }
+      }
+      settings.cases.push_back(fcase);
+    }
+  }
+
+  // Ties between the cases
+  boost::optional<boost::property_tree::ptree&> ties
+    = tree.get_child_optional("ties");
+  if (ties) {
+    boost::property_tree::ptree::iterator tit;
+    for (tit = ties->begin(); tit != ties->end(); tit++) {
+      boost::property_tree::ptree &tnode = tit->second;
+      FederateTie tie;
+      int itie = settings.ties.size();
+      char buf[32];
+      sprintf(buf,"%d",itie);
+      tie.name = tnode.get<std::string>("name",buf);
+      std::string from = tnode.get<std::string>("from","");
+      std::string to = tnode.get<std::string>("to","");
+      tie.from_bus = tnode.get<int>("fromBus",-1);
+      tie.to_bus = tnode.get<int>("toBus",-1);
+      tie.z = std::complex<double>(tnode.get<double>("r",0.0),
+          tnode.get<double>("x",0.0));
+      tie.base_mva = tnode.get<double>("baseMVA",100.0);
+      tie.from_case = -1;
+      tie.to_case = -1;
+      int i;
+      for (i=0; i<settings.cases.size(); i++) {
+        if (settings.cases[i].name == from) tie.from_case = i;
+        if (settings.cases[i].name == to) tie.to_case = i;
+      }
+      bool ok = (tie.from_case >= 0 && tie.to_case >= 0 &&
+          tie.from_bus >= 0 && tie.to_bus >= 0 && std::abs(tie.z) > 0.0 &&
+          (tie.from_case != tie.to_case || tie.from_bus != tie.to_bus));
+      // Tie ends replace the original loads only through the tie flows, so
+      // they cannot also be boundaries of the same case
+      for (i=0; ok && i<settings.boundaries.size(); i++) {
+        const FederateBoundary &bnd = settings.boundaries[i];
+        if ((bnd.icase == tie.from_case && bnd.bus == tie.from_bus) ||
+            (bnd.icase == tie.to_case && bnd.bus == tie.to_bus)) {
+          ok = false;
+        }
+      }
+      if (!ok) {
+        if (comm.rank() == 0) {
+          printf("Tie (%s) from (%s) bus %d to (%s) bus %d is not valid\n",
+              tie.name.c_str(),from.c_str(),tie.from_bus,to.c_str(),
+              tie.to_bus);
+        }
+        return false;
+      }
+      settings.cases[tie.from_case].tie_ends.push_back(2*itie);
+      settings.cases[tie.to_case].tie_ends.push_back(2*itie+1);
+      settings.ties.push_back(tie);
+    }
+  }
+  if (settings.boundaries.size() == 0 && settings.ties.size() == 0) {
+    if (comm.rank() == 0) {
+      printf("No boundaries or ties defined in federate mapping file (%s)\n",
+          mapping.c_str());
+    }
+    return false;
+  }
+  return true;
+}
+
+} // powerflow
+} // gridpack
@@ -0,0 +1,184 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   federate_config.hpp
+ *
+ * @brief  Settings for the HELICS-GridPACK federate. Run control parameters
+ *         come from the Configuration.Federate block of the input file and
+ *         the coupling between the transmission network and other federates
+ *         (boundary buses, publication and subscription keys, units and
+ *         scaling) comes from a JSON mapping file named in that block.
+ *
+ *         The mapping file has the form
+ *
+ *         {
+ *           "name" : "gridpack",
+ *           "coreType" : "zmq",
+ *           "coreInit" : "--federates=1",
+ *           "brokerAddress" : "tcp://helics-broker:23405",
+ *           "logLevel" : "debug",
+ *           "vectorPublication" : "",
+ *           "vectorSubscription" : "",
+ *           "cases" : [
+ *             { "name" : "A", "angle" : 0.0,
+ *               "boundaries" : [
+ *                 { "name" : "a", "bus" : 2,
+ *                   "subscription" : "gld_hlc_conn/Sa", "loadUnit" : "VA",
+ *                   "publication" : "Va", "voltageUnit" : "V",
+ *                   "powerScale" : 1.0e8, "voltageBase" : 2400.0,
+ *                   "initialVoltageBase" : 2401.78 } ] } ]
+ *         }
+ *
+ *         coreType is zmq, tcp or ipc. The ipc core exchanges values
+ *         through shared memory, so the broker and all other federates must
+ *         run on the same host with the same core type.
+ *
+ *         Each case is a separate power flow solve of the network with its
+ *         own boundary loads (e.g. one case per phase) and angle is a
+ *         rotation in degrees applied to its published voltages. If
+ *         vectorPublication is set, the voltages of all boundaries are
+ *         published as a single complex vector instead of one value per
+ *         boundary, and if vectorSubscription is set the loads are read from
+ *         a single complex vector in the same order.
+ *
+ *         A case can also be a separate area network, named by its
+ *         "network" and "format" (PTI23 or PTI33) fields, instead of the
+ *         network of the Configuration.Powerflow block. Areas solved by
+ *         the same federate are coupled by tie lines
+ *
+ *           "ties" : [
+ *             { "name" : "t1", "from" : "14", "fromBus" : 14,
+ *               "to" : "118", "toBus" : 2, "r" : 0.02, "x" : 0.4,
+ *               "baseMVA" : 100.0 } ]
+ *
+ *         where from and to are case names. The flow on a tie is added to
+ *         the original load of each end bus, so the areas exchange
+ *         boundary values inside the federate instead of through HELICS.
+ *         Tie end buses must have a load and must not be boundaries of
+ *         the same case. The angle of a case is the angle of its swing bus
+ *         in the common reference of the ties.
+ *
+ *         If "perturbationEndpoint" is set, the federate registers an
+ *         endpoint of that name that accepts batches of scheduled load and
+ *         voltage perturbations (see perturbation_schedule.hpp). Messages
+ *         are queued by HELICS, so every batch sent between two steps is
+ *         applied.
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _federate_config_h_
+#define _federate_config_h_
+
+#include <complex>
+#include <string>
+#include <vector>
+#include "gridpack/include/gridpack.hpp"
+
+namespace gridpack {
+namespace powerflow {
+
+// Coupling of one boundary bus to another federate
+struct FederateBoundary {
+  // Label used in output and original index of the bus
+  std::string name;
+  int bus;
+  // Case the boundary belongs to
+  int icase;
+  // Subscription for the load and publication for the voltage
+  std::string subscription;
+  std::string load_unit;
+  std::string publication;
+  std::string voltage_unit;
+  // Loads are divided by power_scale, per unit voltages are multiplied by
+  // voltage_base (initial_voltage_base for the first publication)
+  double power_scale;
+  double voltage_base;
+  double initial_voltage_base;
+  // Rotation applied to published voltages
+  std::complex<double> rotation;
+};
+
+// Power flow problem solved by one application
+struct FederateCase {
+  std::string name;
+  // Network configuration file of an area and its format. If network is
+  // empty the case solves the network of the Configuration.Powerflow block
+  std::string network;
+  std::string format;
+  // Rotation applied to the voltages of the case
+  std::complex<double> rotation;
+  // Indices of the boundaries of this case in FederateSettings::boundaries
+  std::vector<int> boundaries;
+  // Tie ends at buses of this case, as 2*tie for the from end and 2*tie+1
+  // for the to end of FederateSettings::ties
+  std::vector<int> tie_ends;
+};
+
+// Line between buses of two cases solved by this federate
+struct FederateTie {
+  std::string name;
+  // Cases and original bus indices of the from and to ends
+  int from_case;
+  int from_bus;
+  int to_case;
+  int to_bus;
+  // Series impedance in per unit on base_mva
+  std::complex<double> z;
+  double base_mva;
+};
+
+struct FederateSettings {
+  // HELICS federate parameters from the mapping file
+  std::string name;
+  std::string core_type;
+  std::string core_init;
+  std::string broker_address;
+  std::string log_level;
+  std::string vector_publication;
+  std::string vector_subscription;
+  std::string perturbation_endpoint;
+  std::vector<FederateCase> cases;
+  std::vector<FederateBoundary> boundaries;
+  std::vector<FederateTie> ties;
+
+  // Run control parameters from the Configuration.Federate block
+  double end_time;
+  double period;
+  bool uninterruptible;
+  bool variable_step;
+  double max_step;
+  bool async_request;
+  bool iterative;
+  double coupling_tolerance;
+  int max_coupling;
+  bool change_detection;
+  double deadband;
+  std::string signal_file;
+  std::string signal_format;
+  int flush_interval;
+  std::string telemetry_ring;
+  int telemetry_slots;
+  std::string perturbation_file;
+  double tie_tolerance;
+  int max_tie_iterations;
+};
+
+/**
+ * Read the Configuration.Federate block of the input file, which must
+ * already be open, and the JSON mapping file it names
+ * @param comm communicator of processes running the federate
+ * @param settings (output) federate settings
+ * @return false if the mapping file could not be read or does not define
+ *         any boundaries or ties
+ */
+bool readFederateSettings(const gridpack::parallel::Communicator &comm,
+    FederateSettings &settings);
+
+} // powerflow
+} // gridpack
+#endif
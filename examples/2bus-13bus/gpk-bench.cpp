@@ -0,0 +1,430 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <complex>
+#include <string>
+#include <thread>
+#include <helics/application_api/ValueFederate.hpp>
+#include <helics/application_api/BrokerApp.hpp>
+#include "boost/smart_ptr/shared_ptr.hpp"
+
+// GridPACK inludes
+#include "mpi.h"
+#include "gridpack/include/gridpack.hpp"
+#include "gridpack_runtime.hpp"
+#include "pf_app.hpp"
+#include "federate_config.hpp"
+#include "signal_recorder.hpp"
+#include "step_profile.hpp"
+
+// Step latency benchmark for the co-simulation examples. Each scenario runs
+// a broker and a synthetic peer federate in the same process on an inproc
+// core, so the measured broker wait is the cost of HELICS itself and not of
+// the network or of another simulator. Every step is split into broker
+// wait, input decode, solve, output publish and logging, and the
+// distribution of each phase is written to a JSON file. The benchmark is
+// configured by the Configuration.Benchmark block of the input file; the
+// 2bus-13bus scenario also uses the Powerflow and Federate blocks and the
+// federate mapping file.
+
+enum BenchPhase {BROKER_WAIT, INPUT_DECODE, SOLVE, OUTPUT_PUBLISH, LOGGING};
+
+/**
+ * Return the names of the phases of a benchmark step
+ * @return names of phases, in BenchPhase order
+ */
+std::vector<std::string> benchPhases(void)
+{
+  std::vector<std::string> phases;
+  phases.push_back("broker_wait");
+  phases.push_back("input_decode");
+  phases.push_back("solve");
+  phases.push_back("output_publish");
+  phases.push_back("logging");
+  return phases;
+}
+
+/**
+ * Synthetic distribution federate for the 2bus-13bus scenario. It
+ * publishes a slowly varying load on every boundary at each step and reads
+ * the voltages published by GridPACK
+ * @param fed federate settings of the GridPACK federate
+ * @param broker name of the inproc broker
+ * @param nsteps number of steps
+ * @param S0 load on each boundary (VA)
+ * @param variation relative amplitude of the load variation
+ */
+void runLoadPeer(const gridpack::powerflow::FederateSettings &fed,
+    const std::string &broker, int nsteps, std::complex<double> S0,
+    double variation)
+{
+  int i, k;
+  int nbnd = fed.boundaries.size();
+  helics::FederateInfo fi;
+  fi.coreType = helics::CoreType::INPROC;
+  fi.coreInitString = std::string("--federates=1 --broker=")+broker;
+  fi.setProperty(HELICS_PROPERTY_INT_LOG_LEVEL,HELICS_LOG_LEVEL_WARNING);
+  fi.setProperty(HELICS_PROPERTY_TIME_PERIOD,1.0);
+  helics::ValueFederate peer("bench_load_peer",fi);
+  std::vector<helics::Publication> S_id;
+  std::vector<helics::Input> V_id;
+  for (i=0; i<nbnd; i++) {
+    S_id.push_back(peer.registerGlobalPublication(
+          fed.boundaries[i].subscription,"complex",
+          fed.boundaries[i].load_unit));
+    V_id.push_back(peer.registerSubscription(fed.name+"/"
+          +fed.boundaries[i].publication,fed.boundaries[i].voltage_unit));
+  }
+  peer.enterExecutingMode();
+  for (k=1; k<=nsteps; k++) {
+    // Loads for step k are published before requesting time k, so the
+    // GridPACK federate sees them when it is granted time k
+    double scale = 1.0+variation*sin(2.0*M_PI*static_cast<double>(k)/50.0);
+    for (i=0; i<nbnd; i++) {
+      S_id[i].publish(S0*scale);
+    }
+    peer.requestTime(static_cast<double>(k));
+    for (i=0; i<nbnd; i++) {
+      V_id[i].getValue<std::complex<double> >();
+    }
+  }
+  peer.finalize();
+}
+
+/**
+ * Run the 2bus-13bus scenario: the GridPACK federate solving one power
+ * flow per case at each step against a synthetic load federate
+ * @param settings power flow settings
+ * @param fed federate settings
+ * @param world communicator of all processes
+ * @param nsteps number of steps
+ * @param S0 load on each boundary (VA)
+ * @param variation relative amplitude of the load variation
+ * @param profile step profile, filled in on process 0
+ * @return false if the power flow could not be initialized
+ */
+bool run2Bus13Bus(const gridpack::powerflow::PFSettings &settings,
+    const gridpack::powerflow::FederateSettings &fed,
+    const gridpack::parallel::Communicator &world, int nsteps,
+    std::complex<double> S0, double variation,
+    gridpack::powerflow::StepProfile &profile)
+{
+  int i, j, k;
+  int ncase = fed.cases.size();
+  int nbnd = fed.boundaries.size();
+
+  // All cases are solved on all processes, one after another
+  std::vector<boost::shared_ptr<gridpack::powerflow::PFApp> > apps(ncase);
+  bool ok = true;
+  for (i=0; ok && i<ncase; i++) {
+    apps[i].reset(new gridpack::powerflow::PFApp);
+    ok = apps[i]->initialize(settings, world);
+    if (!ok) break;
+    apps[i]->setOutputPolicy(gridpack::powerflow::OUTPUT_NONE);
+    std::vector<int> buses;
+    for (j=0; j<fed.cases[i].boundaries.size(); j++) {
+      buses.push_back(fed.boundaries[fed.cases[i].boundaries[j]].bus);
+    }
+    apps[i]->setBoundaryBuses(buses);
+  }
+  int nfail = ok ? 0 : 1;
+  world.sum(&nfail,1);
+  if (nfail > 0) return false;
+
+  bool io_rank = (world.rank() == 0);
+  std::string broker_name = "gpk_bench_2bus";
+  boost::shared_ptr<helics::BrokerApp> broker;
+  boost::shared_ptr<helics::ValueFederate> gpk_fed;
+  std::vector<helics::Publication> V_id;
+  std::vector<helics::Input> S_id;
+  std::thread peer;
+  if (io_rank) {
+    broker.reset(new helics::BrokerApp(helics::CoreType::INPROC,
+          std::string("--federates=2 --name=")+broker_name));
+    peer = std::thread(runLoadPeer,fed,broker_name,nsteps,S0,variation);
+    helics::FederateInfo fi;
+    fi.coreType = helics::CoreType::INPROC;
+    fi.coreInitString = std::string("--federates=1 --broker=")+broker_name;
+    fi.setProperty(HELICS_PROPERTY_INT_LOG_LEVEL,HELICS_LOG_LEVEL_WARNING);
+    fi.setProperty(HELICS_PROPERTY_TIME_PERIOD,1.0);
+    gpk_fed.reset(new helics::ValueFederate(fed.name,fi));
+    for (i=0; i<nbnd; i++) {
+      V_id.push_back(gpk_fed->registerPublication(
+            fed.boundaries[i].publication, "complex",
+            fed.boundaries[i].voltage_unit));
+      S_id.push_back(gpk_fed->registerSubscription(
+            fed.boundaries[i].subscription, fed.boundaries[i].load_unit));
+    }
+    gpk_fed->enterExecutingMode();
+  }
+
+  // Boundary signals are logged the same way as in the federate
+  std::vector<std::string> columns;
+  columns.push_back("time");
+  for (i=0; i<nbnd; i++) {
+    columns.push_back(std::string("S")+fed.boundaries[i].name+"_re");
+    columns.push_back(std::string("S")+fed.boundaries[i].name+"_im");
+    columns.push_back(std::string("V")+fed.boundaries[i].name+"_re");
+    columns.push_back(std::string("V")+fed.boundaries[i].name+"_im");
+  }
+  gridpack::powerflow::SignalRecorder recorder(columns,fed.flush_interval,
+      fed.signal_format == "binary");
+  if (io_rank) recorder.open("gpk-bench-2bus.csv");
+  std::vector<double> signals(columns.size());
+
+  std::vector<std::complex<double> > S(nbnd);
+  std::vector<std::complex<double> > V(nbnd);
+  std::vector<std::complex<double> > vcase;
+  std::vector<double> sbuf(2*nbnd+1);
+  double grantedtime = 0.0;
+  for (k=1; k<=nsteps; k++) {
+    profile.startStep();
+    for (i=0; i<sbuf.size(); i++) sbuf[i] = 0.0;
+    if (io_rank) {
+      grantedtime = gpk_fed->requestTime(static_cast<double>(k));
+      profile.mark(BROKER_WAIT);
+      for (i=0; i<nbnd; i++) {
+        std::complex<double> s = S_id[i].getValue<std::complex<double> >()
+          /fed.boundaries[i].power_scale;
+        sbuf[2*i] = s.real();
+        sbuf[2*i+1] = s.imag();
+      }
+      sbuf[2*nbnd] = grantedtime;
+    }
+    world.sum(&sbuf[0],sbuf.size());
+    for (i=0; i<nbnd; i++) {
+      S[i] = std::complex<double>(sbuf[2*i],sbuf[2*i+1]);
+    }
+    grantedtime = sbuf[2*nbnd];
+    profile.mark(INPUT_DECODE);
+
+    for (i=0; i<ncase; i++) {
+      const std::vector<int> &cbnd = fed.cases[i].boundaries;
+      for (j=0; j<cbnd.size(); j++) {
+        apps[i]->setLoad(fed.boundaries[cbnd[j]].bus, S[cbnd[j]]);
+      }
+      apps[i]->solve();
+      apps[i]->getBoundaryVoltages(vcase);
+      for (j=0; j<cbnd.size(); j++) {
+        V[cbnd[j]] = vcase[j]*fed.boundaries[cbnd[j]].rotation;
+      }
+    }
+    profile.mark(SOLVE);
+
+    if (io_rank) {
+      for (i=0; i<nbnd; i++) {
+        V_id[i].publish(V[i]*fed.boundaries[i].voltage_base);
+      }
+      profile.mark(OUTPUT_PUBLISH);
+      signals[0] = grantedtime;
+      for (i=0; i<nbnd; i++) {
+        signals[1+4*i] = S[i].real();
+        signals[2+4*i] = S[i].imag();
+        signals[3+4*i] = V[i].real();
+        signals[4+4*i] = V[i].imag();
+      }
+      recorder.record(&signals[0]);
+      profile.mark(LOGGING);
+    }
+    profile.endStep();
+  }
+  recorder.close();
+  if (io_rank && nbnd > 0) {
+    printf("Benchmark steps %d final |V| %f\n",nsteps,std::abs(V[0]));
+  }
+  apps.clear();
+
+  if (io_rank) {
+    gpk_fed->finalize();
+    peer.join();
+    broker->waitForDisconnect();
+  }
+  return true;
+}
+
+/**
+ * Inductor federate of the lc-tank scenario, stepping with the same
+ * period and forward Euler update as the lc-tank example
+ * @param broker name of the inproc broker
+ * @param nsteps number of steps
+ * @param period time step (s)
+ */
+void runInductorPeer(const std::string &broker, int nsteps, double period)
+{
+  int k;
+  helics::FederateInfo fi;
+  fi.coreType = helics::CoreType::INPROC;
+  fi.coreInitString = std::string("--federates=1 --broker=")+broker;
+  fi.setProperty(HELICS_PROPERTY_INT_LOG_LEVEL,HELICS_LOG_LEVEL_WARNING);
+  fi.setProperty(HELICS_PROPERTY_TIME_PERIOD,period);
+  helics::ValueFederate peer("Inductor",fi);
+  helics::Publication Il_id = peer.registerPublication("Il", "double", "A");
+  helics::Input Vc_id = peer.registerSubscription("Capacitor/Vc", "V");
+  peer.enterExecutingMode();
+  double l_value = 0.159;
+  double current = 1.0;
+  double grantedtime = 0.0;
+  Il_id.publish(current);
+  for (k=1; k<=nsteps; k++) {
+    grantedtime = peer.requestTime(grantedtime+period);
+    current += (1.0/l_value)*Vc_id.getDouble()*period;
+    Il_id.publish(current);
+  }
+  peer.finalize();
+}
+
+/**
+ * Run the lc-tank scenario: the capacitor federate of the lc-tank example
+ * against an inductor federate, on process 0 only
+ * @param nsteps number of steps
+ * @param profile step profile
+ */
+void runLcTank(int nsteps, gridpack::powerflow::StepProfile &profile)
+{
+  int k;
+  double period = 100e-6;
+  std::string broker_name = "gpk_bench_lc";
+  helics::BrokerApp broker(helics::CoreType::INPROC,
+      std::string("--federates=2 --name=")+broker_name);
+  std::thread peer(runInductorPeer,broker_name,nsteps,period);
+
+  helics::FederateInfo fi;
+  fi.coreType = helics::CoreType::INPROC;
+  fi.coreInitString = std::string("--federates=1 --broker=")+broker_name;
+  fi.setProperty(HELICS_PROPERTY_INT_LOG_LEVEL,HELICS_LOG_LEVEL_WARNING);
+  fi.setProperty(HELICS_PROPERTY_TIME_PERIOD,period);
+  fi.setFlagOption(HELICS_FLAG_WAIT_FOR_CURRENT_TIME_UPDATE,true);
+  helics::ValueFederate cap("Capacitor",fi);
+  helics::Publication Vc_id = cap.registerPublication("Vc", "double", "V");
+  helics::Input Il_id = cap.registerSubscription("Inductor/Il", "A");
+  cap.enterExecutingMode();
+
+  std::vector<std::string> columns;
+  columns.push_back("time");
+  columns.push_back("Vc");
+  gridpack::powerflow::SignalRecorder recorder(columns,4096,false);
+  recorder.open("gpk-bench-lc.csv");
+  double signals[2];
+
+  double c_value = 0.159;
+  double voltage = 0.0;
+  double grantedtime = 0.0;
+  Vc_id.publish(voltage);
+  for (k=1; k<=nsteps; k++) {
+    profile.startStep();
+    grantedtime = cap.requestTime(grantedtime+period);
+    profile.mark(BROKER_WAIT);
+    double current = Il_id.getDouble();
+    profile.mark(INPUT_DECODE);
+    voltage += (-1.0/c_value)*current*period;
+    profile.mark(SOLVE);
+    Vc_id.publish(voltage);
+    profile.mark(OUTPUT_PUBLISH);
+    signals[0] = grantedtime;
+    signals[1] = voltage;
+    recorder.record(signals);
+    profile.mark(LOGGING);
+    profile.endStep();
+  }
+  recorder.close();
+  cap.finalize();
+  peer.join();
+  broker.waitForDisconnect();
+}
+
+int main(int argc, char **argv) {
+  // Prepare GridPACK runtime. MA is sized from the network once the input
+  // has been read
+  gridpack::Runtime runtime(argc, argv);
+  gridpack::parallel::Communicator world;
+  bool io_rank = (world.rank() == 0);
+
+  gridpack::powerflow::PFSettings settings;
+  gridpack::powerflow::FederateSettings fed;
+  bool ok = gridpack::powerflow::PFApp::readSettings(argc, argv, world,
+      settings);
+  if (ok) ok = runtime.setMemory(
+      gridpack::utility::Configuration::configuration(),
+      "Configuration.Powerflow");
+  if (ok) ok = gridpack::powerflow::readFederateSettings(world, fed);
+  if (!ok) {
+    if (io_rank) {
+      std::cerr << "Unable to read GridPACK federate settings" << std::endl;
+    }
+    return 1;
+  }
+  runtime.startMath();
+  runtime.report("GridPACK benchmark");
+
+  // Benchmark parameters
+  //   steps: number of steps of each scenario
+  //   scenarios: space separated list of 2bus-13bus and lc-tank
+  //   output: JSON report
+  //   loadReal, loadReactive: load on each boundary (VA) of the 2bus-13bus
+  //     scenario, varied sinusoidally by loadVariation
+  int nsteps = 1000;
+  std::string scenarios = "2bus-13bus lc-tank";
+  std::string output = "gpk-bench.json";
+  double load_real = 1.0e6;
+  double load_reactive = 5.0e5;
+  double variation = 0.1;
+  gridpack::utility::Configuration::CursorPtr cursor;
+  cursor = gridpack::utility::Configuration::configuration()->getCursor(
+      "Configuration.Benchmark");
+  if (cursor) {
+    nsteps = cursor->get("steps",nsteps);
+    cursor->get("scenarios",&scenarios);
+    cursor->get("output",&output);
+    load_real = cursor->get("loadReal",load_real);
+    load_reactive = cursor->get("loadReactive",load_reactive);
+    variation = cursor->get("loadVariation",variation);
+  }
+  std::vector<std::string> phases = benchPhases();
+  std::vector<boost::shared_ptr<gridpack::powerflow::StepProfile> > profiles;
+
+  if (scenarios.find("2bus-13bus") != std::string::npos) {
+    boost::shared_ptr<gridpack::powerflow::StepProfile>
+      profile(new gridpack::powerflow::StepProfile("2bus-13bus",phases,
+            nsteps));
+    if (run2Bus13Bus(settings,fed,world,nsteps,
+          std::complex<double>(load_real,load_reactive),variation,
+          *profile)) {
+      profiles.push_back(profile);
+    } else if (io_rank) {
+      std::cerr << "Unable to initialize GridPACK power flow" << std::endl;
+    }
+  }
+  if (scenarios.find("lc-tank") != std::string::npos) {
+    boost::shared_ptr<gridpack::powerflow::StepProfile>
+      profile(new gridpack::powerflow::StepProfile("lc-tank",phases,nsteps));
+    if (io_rank) runLcTank(nsteps,*profile);
+    profiles.push_back(profile);
+  }
+  world.barrier();
+
+  // Write the report. Only process 0 runs the HELICS federates, so its
+  // profile is reported
+  if (io_rank) {
+    FILE *fp = fopen(output.c_str(),"w");
+    if (fp == NULL) {
+      std::cerr << "Unable to open benchmark report " << output << std::endl;
+    } else {
+      fprintf(fp,"{\n");
+      fprintf(fp,"  \"benchmark\" : \"gpk-bench\",\n");
+      fprintf(fp,"  \"processes\" : %d,\n",world.size());
+      fprintf(fp,"  \"units\" : \"us\",\n");
+      fprintf(fp,"  \"scenarios\" : [\n");
+      int i;
+      for (i=0; i<profiles.size(); i++) {
+        profiles[i]->writeJSON(fp,4);
+        fprintf(fp,"%s\n",i<profiles.size()-1 ? "," : "");
+      }
+      fprintf(fp,"  ]\n");
+      fprintf(fp,"}\n");
+      fclose(fp);
+      std::cout << "Benchmark report written to " << output << std::endl;
+    }
+  }
+
+  return 0;
+}
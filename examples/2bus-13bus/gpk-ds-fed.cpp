@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <complex>
+#include <helics/application_api/ValueFederate.hpp>
+#include "boost/smart_ptr/shared_ptr.hpp"
+
+// GridPACK inludes
+#include "mpi.h"
+#include "gridpack/include/gridpack.hpp"
+#include "gridpack_runtime.hpp"
+#include "gridpack/applications/modules/powerflow/pf_app_module.hpp"
+#include "gridpack/applications/modules/dynamic_simulation_full_y/dsf_app_module.hpp"
+#include "federate_config.hpp"
+#include "signal_recorder.hpp"
+#include "network_state.hpp"
+
+// HELICS federate for GridPACK dynamic simulation. The network is
+// initialized from a power flow and then integrated one step at a time with
+// DSFullApp::executeOneSimuStep. Every exchangeInterval integration steps
+// the federate is granted the next HELICS time, reads the boundary loads
+// from the other federates, applies them as injections on the boundary
+// buses without rebuilding the network and publishes the boundary voltages.
+// Boundaries are read from the same JSON mapping file as the power flow
+// federate (see federate_config.hpp). The dynamic simulation is positive
+// sequence, so the loads of all boundaries on a bus (e.g. the three phases)
+// are added and the published voltage of each boundary is the bus voltage
+// rotated by the angle of its case
+
+/**
+ * Convert a log level name from the mapping file to a HELICS log level
+ * @param level name of log level
+ * @return HELICS log level
+ */
+int logLevel(const std::string &level)
+{
+  if (level == "none") return HELICS_LOG_LEVEL_NO_PRINT;
+  if (level == "error") return HELICS_LOG_LEVEL_ERROR;
+  if (level == "warning") return HELICS_LOG_LEVEL_WARNING;
+  if (level == "summary") return HELICS_LOG_LEVEL_SUMMARY;
+  if (level == "timing") return HELICS_LOG_LEVEL_TIMING;
+  if (level == "trace") return HELICS_LOG_LEVEL_TRACE;
+  return HELICS_LOG_LEVEL_DEBUG;
+}
+
+int main(int argc, char **argv) {
+  // Prepare GridPACK runtime. MA is sized from the network once the input
+  // has been read
+  gridpack::Runtime runtime(argc, argv);
+  gridpack::parallel::Communicator world;
+  int i, j;
+
+  gridpack::utility::Configuration *config =
+    gridpack::utility::Configuration::configuration();
+  if (argc >= 2 && argv[1] != NULL) {
+    config->open(argv[1],world);
+  } else {
+    config->open("gpk-ds-input.xml",world);
+  }
+  if (!runtime.setMemory(config,"Configuration.Powerflow")) return 1;
+  runtime.startMath();
+  runtime.report("GridPACK dynamic simulation federate");
+
+  // Boundaries and run control parameters from the Federate block and the
+  // mapping file. period is replaced by exchangeInterval integration steps
+  gridpack::powerflow::FederateSettings fed;
+  if (!gridpack::powerflow::readFederateSettings(world, fed)) {
+    if (world.rank() == 0) {
+      std::cerr << "Unable to read GridPACK federate settings" << std::endl;
+    }
+    return 1;
+  }
+  int nbnd = fed.boundaries.size();
+  gridpack::utility::Configuration::CursorPtr cursor;
+  int interval = 1;
+  cursor = config->getCursor("Configuration.Federate");
+  if (cursor) interval = cursor->get("exchangeInterval",interval);
+  if (interval < 1) interval = 1;
+  double dt = 0.005;
+  cursor = config->getCursor("Configuration.Dynamic_simulation");
+  if (cursor) dt = cursor->get("timeStep",dt);
+  double period = interval*dt;
+
+  // If stateFile names a saved state of the initialized network, the
+  // network is rebuilt from it. Otherwise the power flow is solved and
+  // used to initialize the dynamic simulation network, as in dsf_main.cpp,
+  // and the result is saved to stateFile for the next run
+  std::string state_file;
+  if (cursor) cursor->get("stateFile",&state_file);
+  std::string network_file;
+  gridpack::utility::Configuration::CursorPtr pf_cursor;
+  pf_cursor = config->getCursor("Configuration.Powerflow");
+  if (pf_cursor) pf_cursor->get("networkConfiguration",&network_file);
+  gridpack::utility::StringUtils util;
+  util.trim(network_file);
+  boost::shared_ptr<gridpack::dynamic_simulation::DSFullNetwork>
+    ds_network(new gridpack::dynamic_simulation::DSFullNetwork(world));
+  gridpack::dynamic_simulation::DSFullApp ds_app;
+  if (!state_file.empty() &&
+      gridpack::powerflow::NetworkState<gridpack::dynamic_simulation::
+      DSFullNetwork>::read(state_file,network_file,ds_network)) {
+    ds_network->partition();
+    ds_app.setNetwork(ds_network, config);
+  } else {
+    boost::shared_ptr<gridpack::powerflow::PFNetwork>
+      pf_network(new gridpack::powerflow::PFNetwork(world));
+    gridpack::powerflow::PFAppModule pf_app;
+    pf_app.readNetwork(pf_network, config);
+    pf_app.initialize();
+    pf_app.solve();
+    pf_app.saveData();
+
+    pf_network->clone<gridpack::dynamic_simulation::DSFullBus,
+      gridpack::dynamic_simulation::DSFullBranch>(ds_network);
+    ds_app.transferPFtoDS(pf_network, ds_network);
+    ds_app.setNetwork(ds_network, config);
+    ds_app.readGenerators();
+    ds_app.readSequenceData();
+    if (!state_file.empty()) {
+      gridpack::powerflow::NetworkState<gridpack::dynamic_simulation::
+        DSFullNetwork>::write(state_file,ds_network);
+    }
+  }
+  ds_app.initialize();
+  ds_app.setGeneratorWatch();
+
+  // The boundary voltages and generator speeds are taken from the
+  // observations listed in the Dynamic_simulation block, which must
+  // include every boundary bus
+  ds_app.setObservations(cursor);
+  std::vector<int> obs_gen_buses, obs_load_buses, obs_buses;
+  std::vector<std::string> obs_gen_ids, obs_load_ids;
+  ds_app.getObservationLists(obs_gen_buses, obs_gen_ids, obs_load_buses,
+      obs_load_ids, obs_buses);
+  std::vector<int> obs_index(nbnd,-1);
+  bool ok = true;
+  for (i=0; i<nbnd; i++) {
+    for (j=0; j<obs_buses.size(); j++) {
+      if (obs_buses[j] == fed.boundaries[i].bus) obs_index[i] = j;
+    }
+    if (obs_index[i] < 0) {
+      if (world.rank() == 0) {
+        std::cerr << "Boundary bus " << fed.boundaries[i].bus
+                  << " is not in the list of observations" << std::endl;
+      }
+      ok = false;
+    }
+  }
+
+  // Distinct boundary buses. Loads of all boundaries on a bus are added
+  // and applied as a single injection
+  std::vector<int> inj_buses;
+  std::vector<int> inj_index(nbnd);
+  for (i=0; i<nbnd; i++) {
+    for (j=0; j<inj_buses.size(); j++) {
+      if (inj_buses[j] == fed.boundaries[i].bus) break;
+    }
+    if (j == inj_buses.size()) inj_buses.push_back(fed.boundaries[i].bus);
+    inj_index[i] = j;
+  }
+  int ninj = inj_buses.size();
+
+  // The simulation starts from the first event. Without an event it is
+  // started from one that begins after the end of the simulation and
+  // therefore is never applied
+  if (!ok) return 1;
+  std::vector<gridpack::dynamic_simulation::Event> faults;
+  faults = ds_app.getEvents(cursor);
+  if (faults.size() == 0) {
+    double sim_time = 0.0;
+    if (cursor) sim_time = cursor->get("simulationTime",sim_time);
+    gridpack::dynamic_simulation::Event none;
+    none.start = std::max(sim_time,fed.end_time)+period;
+    none.end = none.start;
+    none.step = dt;
+    none.isGenerator = false;
+    none.isBus = false;
+    none.isLine = false;
+    faults.push_back(none);
+  }
+  ds_app.solvePreInitialize(faults[0]);
+
+  // Only process 0 joins the federation. Loads are broadcast to the other
+  // processes, observations are available on all processes
+  bool io_rank = (world.rank() == 0);
+
+  helics::FederateInfo fi;
+  if (fed.core_type == "tcp") {
+    fi.coreType = helics::CoreType::TCP;
+  } else if (fed.core_type == "ipc") {
+    fi.coreType = helics::CoreType::IPC;
+  } else {
+    fi.coreType = helics::CoreType::ZMQ;
+  }
+  fi.coreInitString = fed.core_init;
+  std::string broker_addr = fed.broker_address;
+  const char* env_addr = std::getenv("HELICS_BROKER_ADDRESS");
+  if (env_addr && strlen(env_addr) > 0) broker_addr = env_addr;
+  if (broker_addr.size() > 0) {
+    fi.coreInitString += std::string(" --broker_address=") + broker_addr;
+    if (io_rank) std::cout << "Using broker address: " << broker_addr << std::endl;
+  }
+  fi.setProperty(HELICS_PROPERTY_INT_LOG_LEVEL,logLevel(fed.log_level));
+
+  // The federate advances in multiples of the integration step
+  fi.setProperty(HELICS_PROPERTY_TIME_PERIOD,period);
+  fi.setFlagOption(HELICS_FLAG_UNINTERRUPTIBLE, true);
+  fi.setFlagOption(HELICS_FLAG_TERMINATE_ON_ERROR, true);
+  fi.setFlagOption(HELICS_FLAG_WAIT_FOR_CURRENT_TIME_UPDATE,true);
+
+  boost::shared_ptr<helics::ValueFederate> gpk_fed;
+  std::vector<helics::Publication> V_id;
+  std::vector<helics::Input> S_id;
+  if (io_rank) {
+    gpk_fed.reset(new helics::ValueFederate(fed.name,fi));
+    std::cout << "HELICS GridPACK dynamic simulation federate created, "
+              << "exchange every " << interval << " steps (" << period
+              << " s)" << std::endl;
+    for (i=0; i<nbnd; i++) {
+      V_id.push_back(gpk_fed->registerPublication(
+            fed.boundaries[i].publication, "complex",
+            fed.boundaries[i].voltage_unit));
+      S_id.push_back(gpk_fed->registerSubscription(
+            fed.boundaries[i].subscription, fed.boundaries[i].load_unit));
+    }
+  }
+
+  // Recorder for the boundary signals and the speed of the observed
+  // generators at every exchange
+  int ngen = obs_gen_buses.size();
+  std::vector<std::string> columns;
+  columns.push_back("time");
+  for (i=0; i<nbnd; i++) {
+    columns.push_back(std::string("S")+fed.boundaries[i].name+"_re");
+    columns.push_back(std::string("S")+fed.boundaries[i].name+"_im");
+  }
+  for (i=0; i<nbnd; i++) {
+    columns.push_back(std::string("V")+fed.boundaries[i].name+"_re");
+    columns.push_back(std::string("V")+fed.boundaries[i].name+"_im");
+  }
+  for (i=0; i<ngen; i++) {
+    char buf[128];
+    sprintf(buf,"spd_%d_%s",obs_gen_buses[i],obs_gen_ids[i].c_str());
+    columns.push_back(buf);
+  }
+  columns.push_back("t_blocked");
+  columns.push_back("t_compute");
+  gridpack::powerflow::SignalRecorder recorder(columns,fed.flush_interval,
+      fed.signal_format == "binary");
+  if (io_rank && !recorder.open(fed.signal_file)) {
+    std::cerr << "Unable to open signal file " << fed.signal_file << std::endl;
+  }
+  std::vector<double> signals(columns.size());
+
+  if (io_rank) {
+    gpk_fed->enterExecutingMode();
+    std::cout << "GridPACK Federate has entered execution mode." << std::endl;
+  }
+
+  // Loads received from the other federates (per unit), the loads last
+  // applied to each boundary bus and the published voltages
+  std::vector<std::complex<double> > S(nbnd,std::complex<double>(0.0,0.0));
+  std::vector<std::complex<double> > S_applied(nbnd,
+      std::complex<double>(0.0,0.0));
+  std::vector<std::complex<double> > V(nbnd);
+  std::vector<double> inj_p(ninj), inj_q(ninj);
+  std::vector<double> vmag, vang, rspd, rang, genp, genq, fonline;
+  std::vector<double> sbuf(2*nbnd+2);
+  bool first_step = true;
+
+  double grantedtime = 0.0;
+  double t_blocked = 0.0;
+  double t_compute = 0.0;
+  double total_blocked = 0.0;
+  double total_compute = 0.0;
+  int nexchange = 0;
+  int ninjection = 0;
+  int nsteps = 0;
+  bool done = ds_app.isDynSimuDone();
+  while (!done && grantedtime < fed.end_time) {
+    // Loads at the current HELICS time. The first exchange happens at time
+    // zero, before the first integration step
+    for (i=0; i<sbuf.size(); i++) sbuf[i] = 0.0;
+    if (io_rank) {
+      double t_start = MPI_Wtime();
+      if (!first_step) {
+        grantedtime = gpk_fed->requestTime(grantedtime+period);
+      }
+      t_blocked = MPI_Wtime()-t_start;
+      // Boundary loads are only replaced once another federate has
+      // published them, until then the loads of the power flow case are
+      // kept. With change detection, loads that differ from the applied
+      // loads by less than loadDeadband are not applied again
+      bool changed = false;
+      for (i=0; i<nbnd; i++) {
+        if (S_id[i].isUpdated()) {
+          S[i] = S_id[i].getValue<std::complex<double> >()
+            /fed.boundaries[i].power_scale;
+          if (!fed.change_detection ||
+              std::abs(S[i]-S_applied[i]) > fed.deadband) changed = true;
+        }
+        sbuf[2*i] = S[i].real();
+        sbuf[2*i+1] = S[i].imag();
+      }
+      sbuf[2*nbnd] = changed ? 1.0 : 0.0;
+      sbuf[2*nbnd+1] = grantedtime;
+    }
+    double t_start = MPI_Wtime();
+    world.sum(&sbuf[0],sbuf.size());
+    grantedtime = sbuf[2*nbnd+1];
+    first_step = false;
+
+    // Apply new loads as injections on the boundary buses. Only the bus
+    // injections change, the network and its admittance matrix are kept
+    if (sbuf[2*nbnd] > 0.5) {
+      for (j=0; j<ninj; j++) {
+        inj_p[j] = 0.0;
+        inj_q[j] = 0.0;
+      }
+      for (i=0; i<nbnd; i++) {
+        S[i] = std::complex<double>(sbuf[2*i],sbuf[2*i+1]);
+        S_applied[i] = S[i];
+        inj_p[inj_index[i]] += S[i].real();
+        inj_q[inj_index[i]] += S[i].imag();
+      }
+      ds_app.scatterInjectionLoad(inj_buses, inj_p, inj_q);
+      ninjection++;
+    }
+
+    // Integrate up to the next exchange
+    for (j=0; j<interval && !ds_app.isDynSimuDone(); j++) {
+      ds_app.executeOneSimuStep();
+      nsteps++;
+    }
+    done = ds_app.isDynSimuDone();
+
+    ds_app.getObservations(vmag, vang, rspd, rang, genp, genq, fonline);
+    for (i=0; i<nbnd; i++) {
+      int k = obs_index[i];
+      V[i] = std::polar(vmag[k],vang[k])*fed.boundaries[i].rotation;
+    }
+
+    if (io_rank) {
+      for (i=0; i<nbnd; i++) {
+        V_id[i].publish(V[i]*fed.boundaries[i].voltage_base);
+      }
+      t_compute = MPI_Wtime()-t_start;
+
+      signals[0] = grantedtime;
+      for (i=0; i<nbnd; i++) {
+        signals[1+2*i] = S[i].real();
+        signals[2+2*i] = S[i].imag();
+        signals[1+2*nbnd+2*i] = V[i].real();
+        signals[2+2*nbnd+2*i] = V[i].imag();
+      }
+      for (i=0; i<ngen; i++) signals[1+4*nbnd+i] = rspd[i];
+      signals[1+4*nbnd+ngen] = t_blocked;
+      signals[2+4*nbnd+ngen] = t_compute;
+      recorder.record(&signals[0]);
+      total_blocked += t_blocked;
+      total_compute += t_compute;
+    }
+    nexchange++;
+  }
+
+  if (io_rank) {
+    printf("Integration steps: %d exchanges: %d load updates: %d\n",
+        nsteps,nexchange,ninjection);
+    printf("Time blocked in HELICS: %f s computing: %f s\n",
+        total_blocked,total_compute);
+  }
+  recorder.close();
+  gridpack::utility::CoarseTimer::instance()->dump();
+
+  if (io_rank) {
+    gpk_fed->finalize();
+    std::cout << "Federate finalized." << std::endl;
+  }
+
+  return 0;
+}
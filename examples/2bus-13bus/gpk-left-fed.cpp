@@ -1,135 +1,811 @@
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include <vector>
 #include <cmath>
-#include <fstream>
 #include <cstdlib>
-#include <helics/application_api/ValueFederate.hpp>
+#include <cstring>
+#include <helics/application_api/CombinationFederate.hpp>
+#include "boost/smart_ptr/shared_ptr.hpp"
 
 // GridPACK inludes
 #include "mpi.h"
-#include <ga.h>
-#include <macdecls.h>
 #include "gridpack/include/gridpack.hpp"
-#include "pf_app.hpp" 
+#include "gridpack_runtime.hpp"
+#include "pf_app.hpp"
+#include "federate_config.hpp"
+#include "signal_recorder.hpp"
+#include "telemetry_ring.hpp"
+#include "perturbation_schedule.hpp"
+
+// Generic HELICS federate for GridPACK power flow. The boundary buses,
+// publication and subscription keys, units and scaling are read from the
+// JSON mapping file named in the Configuration.Federate block of the input
+// file (see federate_config.hpp), so the same executable is used by all of
+// the transmission-distribution examples. The cases can also be separate
+// transmission areas, coupled to each other by ties inside the federate.
+// Scheduled load and voltage perturbations are applied at the granted
+// times from batches read at startup or received on an endpoint
+
+/**
+ * Time to request from HELICS for the next step
+ * @param grantedtime current time
+ * @param period fixed step size
+ * @param variable_step if true, request up to max_step ahead
+ * @param max_step maximum step size for variable steps
+ * @param end_time end of co-simulation
+ * @return requested time
+ */
+double nextTime(double grantedtime, double period, bool variable_step,
+    double max_step, double end_time)
+{
+  if (!variable_step) return grantedtime+period;
+  double next_time = grantedtime+max_step;
+  if (next_time > end_time) next_time = end_time;
+  return next_time;
+}
+
+/**
+ * Convert a log level name from the mapping file to a HELICS log level
+ * @param level name of log level
+ * @return HELICS log level
+ */
+int logLevel(const std::string &level)
+{
+  if (level == "none") return HELICS_LOG_LEVEL_NO_PRINT;
+  if (level == "error") return HELICS_LOG_LEVEL_ERROR;
+  if (level == "warning") return HELICS_LOG_LEVEL_WARNING;
+  if (level == "summary") return HELICS_LOG_LEVEL_SUMMARY;
+  if (level == "timing") return HELICS_LOG_LEVEL_TIMING;
+  if (level == "trace") return HELICS_LOG_LEVEL_TRACE;
+  return HELICS_LOG_LEVEL_DEBUG;
+}
 
 int main(int argc, char **argv) {
+  // Prepare GridPACK runtime. MA is sized from the network once the input
+  // has been read
+  gridpack::Runtime runtime(argc, argv);
+  gridpack::parallel::Communicator world;
+  int i, j, k;
+
+  // Read the input file and the federate mapping once on all processes
+  gridpack::powerflow::PFSettings settings;
+  gridpack::powerflow::FederateSettings fed;
+  bool ok = gridpack::powerflow::PFApp::readSettings(argc, argv, world,
+      settings);
+  if (ok) ok = runtime.setMemory(
+      gridpack::utility::Configuration::configuration(),
+      "Configuration.Powerflow");
+  if (ok) ok = gridpack::powerflow::readFederateSettings(world, fed);
+  if (!ok) {
+    if (world.rank() == 0) {
+      std::cerr << "Unable to read GridPACK federate settings" << std::endl;
+    }
+    return 1;
+  }
+  runtime.startMath();
+  runtime.report("GridPACK federate");
+  int ncase = fed.cases.size();
+  int nbnd = fed.boundaries.size();
+
+  // Every process holds the perturbation schedule, so the perturbed loads
+  // of any bus can be set by the process that owns it
+  gridpack::powerflow::PerturbationSchedule schedule(fed);
+  if (!fed.perturbation_file.empty() &&
+      !schedule.read(fed.perturbation_file,world.rank() == 0)) {
+    return 1;
+  }
+
+  // Case and bus of each tie end. The from end of tie i is end 2*i and the
+  // to end is 2*i+1
+  int ntie = fed.ties.size();
+  int nend = 2*ntie;
+  std::vector<int> end_case(nend);
+  std::vector<int> end_bus(nend);
+  for (i=0; i<ntie; i++) {
+    end_case[2*i] = fed.ties[i].from_case;
+    end_bus[2*i] = fed.ties[i].from_bus;
+    end_case[2*i+1] = fed.ties[i].to_case;
+    end_bus[2*i+1] = fed.ties[i].to_bus;
+  }
+
+  // Each case is an independent power flow problem on the same network or
+  // on its own area network. If there are at least as many processes as
+  // cases, split them into one group per case so that the cases are solved
+  // concurrently. Otherwise every process solves all cases one after
+  // another. If the processes do not divide evenly, the first groups get
+  // one process more, so that no process is left idle
+  int ngroup = ncase;
+  if (world.size() < ncase) ngroup = 1;
+  int nper = world.size()/ngroup;
+  int nlarge = world.size()%ngroup;
+  int group;
+  if (world.rank() < nlarge*(nper+1)) {
+    group = world.rank()/(nper+1);
+  } else {
+    group = nlarge+(world.rank()-nlarge*(nper+1))/nper;
+  }
+  gridpack::parallel::Communicator case_comm = world.split(group);
+  std::vector<int> my_cases;
+  if (ngroup == 1) {
+    for (i=0; i<ncase; i++) my_cases.push_back(i);
+  } else {
+    my_cases.push_back(group);
+  }
+
+  std::vector<boost::shared_ptr<gridpack::powerflow::PFApp> > apps(ncase);
+  for (i=0; ok && i<my_cases.size(); i++) {
+    int c = my_cases[i];
+    const gridpack::powerflow::FederateCase &fcase = fed.cases[c];
+    apps[c].reset(new gridpack::powerflow::PFApp);
+    // An area network replaces the network of the Powerflow block. The
+    // saved state only applies to that network
+    gridpack::powerflow::PFSettings csettings = settings;
+    if (!fcase.network.empty()) {
+      csettings.filename = fcase.network;
+      csettings.filetype = (fcase.format == "PTI33") ?
+        gridpack::powerflow::PTI33 : gridpack::powerflow::PTI23;
+      csettings.state_file = "";
+    }
+    // Build the network, mappers and solvers once. Each time step only
+    // updates the boundary loads and reruns the Newton-Raphson iterations
+    if (!apps[c]->initialize(csettings, case_comm)) {
+      ok = false;
+      break;
+    }
+    // Voltages are collected at the boundaries followed by the tie ends
+    std::vector<int> buses;
+    for (j=0; j<fcase.boundaries.size(); j++) {
+      buses.push_back(fed.boundaries[fcase.boundaries[j]].bus);
+    }
+    for (j=0; j<fcase.tie_ends.size(); j++) {
+      buses.push_back(end_bus[fcase.tie_ends[j]]);
+    }
+    apps[c]->setBoundaryBuses(buses);
+  }
+  int nfail = ok ? 0 : 1;
+  world.sum(&nfail,1);
+  if (nfail > 0) {
+    if (world.rank() == 0) {
+      std::cerr << "Unable to initialize GridPACK power flow" << std::endl;
+    }
+    return 1;
+  }
+
+  // Original loads at the tie ends. The tie flows are added to these loads
+  std::vector<std::complex<double> > S_base(nend);
+  if (nend > 0) {
+    std::vector<double> lbuf(2*nend,0.0);
+    for (j=0; j<my_cases.size(); j++) {
+      int c = my_cases[j];
+      const std::vector<int> &cend = fed.cases[c].tie_ends;
+      for (k=0; k<cend.size(); k++) {
+        std::complex<double> load;
+        if (apps[c]->getLoad(end_bus[cend[k]],load)) {
+          lbuf[2*cend[k]] = load.real();
+          lbuf[2*cend[k]+1] = load.imag();
+        }
+      }
+    }
+    world.sum(&lbuf[0],2*nend);
+    for (i=0; i<nend; i++) {
+      S_base[i] = std::complex<double>(lbuf[2*i],lbuf[2*i+1]);
+    }
+  }
+
+  // Only process 0 joins the federation. Loads are broadcast to the other
+  // processes and voltages are gathered back before publishing
+  bool io_rank = (world.rank() == 0);
+
   // Create a FederateInfo object
   helics::FederateInfo fi;
 
-  // Select the core type, set one core per federate
-  fi.coreType = helics::CoreType::ZMQ;
-  
-  // Get broker address from environment variable or use default
-  const char* broker_addr = std::getenv("HELICS_BROKER_ADDRESS");
-  if (broker_addr && strlen(broker_addr) > 0) {
-    fi.coreInitString = std::string("--federates=1 --broker_address=") + broker_addr;
-    std::cout << "Using broker address: " << broker_addr << std::endl;
+  // Select the core type, set one core per federate. The ipc core uses
+  // shared memory and needs the broker and the other federates to be on
+  // the same host and use ipc as well
+  if (fed.core_type == "tcp") {
+    fi.coreType = helics::CoreType::TCP;
+  } else if (fed.core_type == "ipc") {
+    fi.coreType = helics::CoreType::IPC;
   } else {
-    // For Docker deployment, use fixed broker address
-    fi.coreInitString = "--federates=1 --broker_address=tcp://helics-broker:23405";
-    std::cout << "Using default Docker broker address: tcp://helics-broker:23405" << std::endl;
+    if (fed.core_type != "zmq" && io_rank) {
+      std::cout << "Unknown core type " << fed.core_type
+                << ", using zmq" << std::endl;
+    }
+    fi.coreType = helics::CoreType::ZMQ;
+  }
+
+  // Get broker address from environment variable or the mapping file
+  fi.coreInitString = fed.core_init;
+  std::string broker_addr = fed.broker_address;
+  const char* env_addr = std::getenv("HELICS_BROKER_ADDRESS");
+  if (env_addr && strlen(env_addr) > 0) broker_addr = env_addr;
+  if (broker_addr.size() > 0) {
+    fi.coreInitString += std::string(" --broker_address=") + broker_addr;
+    if (io_rank) std::cout << "Using broker address: " << broker_addr << std::endl;
   }
 
-  // Logging in debug mode
-  fi.setProperty(HELICS_PROPERTY_INT_LOG_LEVEL,HELICS_LOG_LEVEL_DEBUG);
+  // Logging level
+  fi.setProperty(HELICS_PROPERTY_INT_LOG_LEVEL,logLevel(fed.log_level));
 
   // Set Simulator resolution
-  double period = 1.0;
-  fi.setProperty(HELICS_PROPERTY_TIME_PERIOD,period);
+  fi.setProperty(HELICS_PROPERTY_TIME_PERIOD,fed.period);
 
   // Set some flags
-  fi.setFlagOption(HELICS_FLAG_UNINTERRUPTIBLE, false);
+  fi.setFlagOption(HELICS_FLAG_UNINTERRUPTIBLE, fed.uninterruptible);
   fi.setFlagOption(HELICS_FLAG_TERMINATE_ON_ERROR, true);
   fi.setFlagOption(HELICS_FLAG_WAIT_FOR_CURRENT_TIME_UPDATE,true);
 
-  // Create Value Federate
-  helics::ValueFederate gpk_left("gridpack",fi);
-  std::cout << "HELICS GridPAKC Federate created successfully." << std::endl;
-
-  // Registering Publications and subscriptions
-  auto Va_id = gpk_left.registerPublication("Va", "complex", "V");
-  auto Vb_id = gpk_left.registerPublication("Vb", "complex", "V");
-  auto Vc_id = gpk_left.registerPublication("Vc", "complex", "V");
+  // Create Combination Federate. Boundary voltages and loads are either exchanged
+  // as one value per boundary or as a single complex vector holding all
+  // boundaries, which keeps the number of messages per step constant as
+  // the number of boundaries grows
+  bool vector_pub = (fed.vector_publication.size() > 0 && nbnd > 0);
+  bool vector_sub = (fed.vector_subscription.size() > 0 && nbnd > 0);
+  boost::shared_ptr<helics::CombinationFederate> gpk_fed;
+  std::vector<helics::Publication> V_id;
+  std::vector<helics::Input> S_id;
+  helics::Endpoint *P_ep = NULL;
+  if (io_rank) {
+    gpk_fed.reset(new helics::CombinationFederate(fed.name,fi));
+    std::cout << "HELICS GridPACK Federate created successfully." << std::endl;
 
+    // Registering Publications and subscriptions
+    if (vector_pub) {
+      V_id.push_back(gpk_fed->registerPublication(fed.vector_publication,
+            "complex_vector", fed.boundaries[0].voltage_unit));
+    } else {
+      for (i=0; i<nbnd; i++) {
+        V_id.push_back(gpk_fed->registerPublication(
+              fed.boundaries[i].publication, "complex",
+              fed.boundaries[i].voltage_unit));
+      }
+    }
+    if (vector_sub) {
+      S_id.push_back(gpk_fed->registerSubscription(fed.vector_subscription,
+            fed.boundaries[0].load_unit));
+    } else {
+      for (i=0; i<nbnd; i++) {
+        S_id.push_back(gpk_fed->registerSubscription(
+              fed.boundaries[i].subscription, fed.boundaries[i].load_unit));
+      }
+    }
+  }
 
-  auto Sa_id = gpk_left.registerSubscription("gld_hlc_conn/Sa", "VA");
-  auto Sb_id = gpk_left.registerSubscription("gld_hlc_conn/Sb", "VA");
-  auto Sc_id = gpk_left.registerSubscription("gld_hlc_conn/Sc", "VA");
+  // Batches of scheduled perturbations are messages, so HELICS queues
+  // them instead of keeping only the last one
+  if (io_rank && !fed.perturbation_endpoint.empty()) {
+    P_ep = &gpk_fed->registerEndpoint(fed.perturbation_endpoint);
+  }
 
-  // File to store simulatio signals
-  std::ofstream outFile("gpk.csv");
+  // Recorder for the boundary signals. Steps are buffered in memory and
+  // written in blocks of signalFlushInterval steps, either as CSV text or
+  // as binary columns (signalFormat)
+  std::vector<std::string> columns;
+  columns.push_back("time");
+  for (i=0; i<nbnd; i++) {
+    columns.push_back(std::string("S")+fed.boundaries[i].name+"_re");
+    columns.push_back(std::string("S")+fed.boundaries[i].name+"_im");
+  }
+  for (i=0; i<nbnd; i++) {
+    columns.push_back(std::string("V")+fed.boundaries[i].name+"_re");
+    columns.push_back(std::string("V")+fed.boundaries[i].name+"_im");
+  }
+  // Flow into each tie at its from end
+  for (i=0; i<ntie; i++) {
+    columns.push_back(std::string("T")+fed.ties[i].name+"_p");
+    columns.push_back(std::string("T")+fed.ties[i].name+"_q");
+  }
+  // Wall clock time spent waiting for HELICS to grant the step and time
+  // spent computing the step (s)
+  columns.push_back("t_blocked");
+  columns.push_back("t_compute");
+  gridpack::powerflow::SignalRecorder recorder(columns,fed.flush_interval,
+      fed.signal_format == "binary");
+  if (io_rank && !recorder.open(fed.signal_file)) {
+    std::cerr << "Unable to open signal file " << fed.signal_file << std::endl;
+  }
+  std::vector<double> signals(4*nbnd+2*ntie+3);
 
-  // Prepare GridPACK Environement
-  gridpack::Environment env(argc,argv);
-  gridpack::math::Initialize(&argc,&argv);
+  // Telemetry for monitors outside the federation: the loads received
+  // (loadUnit) and voltages published (voltageUnit) at each boundary, the
+  // Newton-Raphson iterations and convergence of each case in the step,
+  // the coupling and tie iterations, the largest boundary voltage change
+  // (per unit) and the step timings
+  std::vector<std::string> tcolumns;
+  tcolumns.push_back("time");
+  for (i=0; i<nbnd; i++) {
+    tcolumns.push_back(std::string("S")+fed.boundaries[i].name+"_re");
+    tcolumns.push_back(std::string("S")+fed.boundaries[i].name+"_im");
+  }
+  for (i=0; i<nbnd; i++) {
+    tcolumns.push_back(std::string("V")+fed.boundaries[i].name+"_re");
+    tcolumns.push_back(std::string("V")+fed.boundaries[i].name+"_im");
+  }
+  for (i=0; i<ncase; i++) {
+    tcolumns.push_back(std::string("iterations_")+fed.cases[i].name);
+    tcolumns.push_back(std::string("converged_")+fed.cases[i].name);
+  }
+  tcolumns.push_back("coupling_iterations");
+  tcolumns.push_back("tie_iterations");
+  tcolumns.push_back("dv");
+  tcolumns.push_back("t_blocked");
+  tcolumns.push_back("t_compute");
+  gridpack::powerflow::TelemetryRing telemetry(tcolumns,fed.telemetry_slots);
+  if (io_rank && !fed.telemetry_ring.empty()) {
+    if (telemetry.open(fed.telemetry_ring)) {
+      std::cout << "Writing telemetry to shared memory ring "
+        << fed.telemetry_ring << std::endl;
+    } else {
+      std::cerr << "Unable to create telemetry ring " << fed.telemetry_ring
+        << std::endl;
+    }
+  }
+  std::vector<double> tvalues(tcolumns.size());
 
-  gridpack::powerflow::PFApp app_A;
-  gridpack::powerflow::PFApp app_B;
-  gridpack::powerflow::PFApp app_C;
-  
   // Enter execution mode (this transitions the federate from initialization to execution)
-  gpk_left.enterExecutingMode();
-  std::cout << "GridPACK Federate has entered execution mode." << std::endl;
+  if (io_rank) {
+    gpk_fed->enterExecutingMode();
+    std::cout << "GridPACK Federate has entered execution mode." << std::endl;
+  }
   // Simulation Initialization
-  double total_interval = 10.0;
   double grantedtime = 0.0;
 
-  auto Sa = std::complex<double>(0.0,0.0);
-  auto Sb = std::complex<double>(0.0,0.0);
-  auto Sc = std::complex<double>(0.0,0.0);
-  
-  auto Va = std::complex<double>(1.0,0.0);
-  auto Vb = std::complex<double>(-0.5,-0.866025);
-  auto Vc = std::complex<double>(-0.5,0.866025);
+  // Loads received from the other federates (per unit), the loads with
+  // the scheduled perturbations applied and published voltages
+  std::vector<std::complex<double> > S_in(nbnd,std::complex<double>(0.0,0.0));
+  std::vector<std::complex<double> > S(nbnd,std::complex<double>(0.0,0.0));
+  std::vector<std::complex<double> > V(nbnd);
+  std::vector<std::complex<double> > Vpub(nbnd);
+
+  // Publish Initial boundary voltages
+  if (io_rank) {
+    for (i=0; i<nbnd; i++) {
+      Vpub[i] = fed.boundaries[i].rotation*fed.boundaries[i].initial_voltage_base;
+    }
+    if (vector_pub) {
+      V_id[0].publish(Vpub);
+    } else {
+      for (i=0; i<nbnd; i++) V_id[i].publish(Vpub[i]);
+    }
+  }
+
+  // Loads used in the last solve of each boundary and the resulting
+  // voltages (before rotation). These are reused by cases whose loads have
+  // not changed
+  std::vector<std::complex<double> > S_solved(nbnd);
+  std::vector<std::complex<double> > V_solved(nbnd);
+  std::vector<int> solve_case(ncase,1);
+  std::vector<int> solved_case(ncase,0);
+  std::vector<int> skipped(ncase,0);
+  std::vector<int> iterations(ncase,0);
+  std::vector<int> converged_case(ncase,1);
+  std::vector<std::complex<double> > V_last(nbnd);
+
+  // Voltages at the tie ends, rotated to the common reference of the ties
+  // and starting flat, and the tie flows added to the end loads
+  std::vector<std::complex<double> > V_tie(nend);
+  std::vector<std::complex<double> > S_tie(nend,std::complex<double>(0.0,0.0));
+  std::vector<double> dv_tie(nend);
+  for (i=0; i<nend; i++) V_tie[i] = fed.cases[end_case[i]].rotation;
+  int tie_iter = 0;
+  int total_tie = 0;
+  bool first_step = true;
+  bool state_saved = false;
+
+  // Buffers used to broadcast the granted time, loads and cases to solve
+  // from process 0 and to collect voltages and iteration counts. The last
+  // entry of sbuf is the length of new perturbation batches
+  std::vector<double> sbuf(2*nbnd+ncase+2);
+  std::vector<double> vbuf(2*nbnd+2*nend);
+  std::vector<int> ibuf(2*ncase);
+  std::vector<std::complex<double> > vcase;
 
-  auto r120 = std::complex<double>(-0.5,-0.866025);
+  // Original loads of the buses with scheduled perturbations, by case, and
+  // the perturbation batches received in a step, separated by NULs
+  std::vector<std::map<int,std::complex<double> > > base_load(ncase);
+  std::vector<int> pbuses;
+  std::vector<int> dirty(ncase);
+  std::string ptext;
 
-  // Publish Initial center voltage
-  Va_id.publish(Va*2401.78);
-  Vb_id.publish(Vb*2401.78);
-  Vc_id.publish(Vc*2401.78);
+  // Time request made at the end of the previous step that has not been
+  // completed yet, and accumulated timings
+  bool pending = false;
+  double t_blocked = 0.0;
+  double t_compute = 0.0;
+  double total_blocked = 0.0;
+  double total_compute = 0.0;
+  int nsteps = 0;
 
-  // Setting up the GridPACK Environement
+  // Iterative coupling state. If repeat is true, HELICS has granted
+  // another iteration at the current time and the loop re-solves without
+  // advancing time
+  bool repeat = false;
+  int coupling_iter = 0;
+  int total_coupling = 0;
 
   // Entering simulation loop
-  while (grantedtime < total_interval) {
-    // Request time
-    grantedtime = gpk_left.requestTime(grantedtime+period);
+  while (grantedtime < fed.end_time || repeat) {
+    for (i=0; i<sbuf.size(); i++) sbuf[i] = 0.0;
+    if (io_rank) {
+      // Request time. With variable steps, HELICS returns as soon as new
+      // loads are published, so quiet intervals are skipped. In
+      // asynchronous mode the request has already been made and only
+      // needs to be completed. Iterations at the current time have already
+      // been granted
+      double t_start = MPI_Wtime();
+      if (repeat) {
+        coupling_iter++;
+        total_coupling++;
+      } else if (pending) {
+        grantedtime = gpk_fed->requestTimeComplete();
+        pending = false;
+      } else {
+        double t_next = nextTime(grantedtime,fed.period,fed.variable_step,
+            fed.max_step,fed.end_time);
+        // Variable steps stop at the start and end of perturbations
+        if (fed.variable_step && schedule.nextEvent(grantedtime) < t_next) {
+          t_next = schedule.nextEvent(grantedtime);
+        }
+        grantedtime = gpk_fed->requestTime(t_next);
+      }
+      if (!repeat) coupling_iter = 0;
+      t_blocked = MPI_Wtime()-t_start;
 
-    // Get Sa from gridlab-d
-    Sa = Sa_id.getValue<std::complex<double>>()/100000000.0;
-    Sb = Sb_id.getValue<std::complex<double>>()/100000000.0;
-    Sc = Sc_id.getValue<std::complex<double>>()/100000000.0;
+      // Get the loads from the other federates. Coupling iterations only
+      // re-solve cases whose loads have not converged and, with change
+      // detection, a case is only solved if one of its loads has changed
+      // since the last solve
+      bool gated = (repeat || (fed.change_detection && !first_step));
+      double tol = fed.deadband;
+      if (repeat && fed.coupling_tolerance > tol) tol = fed.coupling_tolerance;
+      std::vector<int> changed(nbnd,gated ? 0 : 1);
+      if (vector_sub) {
+        if (!gated || S_id[0].isUpdated()) {
+          std::vector<std::complex<double> > Svec
+            = S_id[0].getValue<std::vector<std::complex<double> > >();
+          for (i=0; i<nbnd && i<Svec.size(); i++) {
+            S_in[i] = Svec[i]/fed.boundaries[i].power_scale;
+          }
+        }
+      } else {
+        for (i=0; i<nbnd; i++) {
+          if (!gated || S_id[i].isUpdated()) {
+            S_in[i] = S_id[i].getValue<std::complex<double> >()
+              /fed.boundaries[i].power_scale;
+          }
+        }
+      }
 
-    // pass S's to GridPACK and get back V's
-    app_A.execute(argc, argv, Va, Sa);
-    app_B.execute(argc, argv, Vb, Sb);
-    app_C.execute(argc, argv, Vc, Sc);
+      // New perturbation batches take effect from this step. A boundary
+      // load has changed if the received load or its perturbation changed
+      ptext.clear();
+      while (P_ep && P_ep->hasMessage()) {
+        std::string batch = P_ep->getMessage()->to_string();
+        if (schedule.parse(batch,true)) {
+          ptext += batch;
+          ptext.push_back('\0');
+        }
+      }
+      S = S_in;
+      schedule.applyLoads(grantedtime,S);
+      for (i=0; i<nbnd; i++) {
+        if (gated) changed[i] = (std::abs(S[i]-S_solved[i]) > tol);
+      }
+      for (i=0; i<nbnd; i++) {
+        sbuf[2*i] = S[i].real();
+        sbuf[2*i+1] = S[i].imag();
+        if (changed[i]) sbuf[2*nbnd+fed.boundaries[i].icase] = 1.0;
+      }
+      sbuf[2*nbnd+ncase] = grantedtime;
+      sbuf[2*nbnd+ncase+1] = ptext.size();
+    }
+    double t_start = MPI_Wtime();
+    world.sum(&sbuf[0],sbuf.size());
+    for (i=0; i<nbnd; i++) {
+      S[i] = std::complex<double>(sbuf[2*i],sbuf[2*i+1]);
+    }
+    for (i=0; i<ncase; i++) {
+      solve_case[i] = (sbuf[2*nbnd+i] > 0.5) ? 1 : 0;
+    }
+    grantedtime = sbuf[2*nbnd+ncase];
+    first_step = false;
 
-    // Rotate Phase A and B Voltages
-    Vb = Vb * r120;
-    Vc = Vc * r120 * r120;
+    // Send new perturbation batches to the other processes, then solve the
+    // cases whose active perturbations changed and set the perturbed loads
+    // of buses that are not boundaries
+    int plen = static_cast<int>(sbuf[2*nbnd+ncase+1]+0.5);
+    if (plen > 0) {
+      std::vector<int> cbuf(plen,0);
+      if (io_rank) {
+        for (i=0; i<plen; i++) cbuf[i] = static_cast<unsigned char>(ptext[i]);
+      }
+      world.sum(&cbuf[0],plen);
+      if (!io_rank) {
+        std::string batch;
+        for (i=0; i<plen; i++) {
+          if (cbuf[i] == 0) {
+            schedule.parse(batch,false);
+            batch.clear();
+          } else {
+            batch.push_back(static_cast<char>(cbuf[i]));
+          }
+        }
+      }
+    }
+    for (i=0; i<ncase; i++) dirty[i] = 0;
+    schedule.update(grantedtime,dirty);
+    for (j=0; j<my_cases.size(); j++) {
+      int c = my_cases[j];
+      if (!dirty[c]) continue;
+      schedule.getBuses(c,pbuses);
+      for (k=0; k<pbuses.size(); k++) {
+        std::complex<double> load;
+        if (base_load[c].find(pbuses[k]) == base_load[c].end() &&
+            apps[c]->getLoad(pbuses[k],load)) {
+          base_load[c][pbuses[k]] = load;
+        }
+      }
+      // Buses of replaced batches return to their original loads
+      std::map<int,std::complex<double> >::iterator it;
+      for (it = base_load[c].begin(); it != base_load[c].end(); it++) {
+        apps[c]->setLoad(it->first,
+            schedule.busLoad(grantedtime,c,it->first,it->second));
+      }
+    }
+    for (i=0; i<ncase; i++) {
+      if (dirty[i]) solve_case[i] = 1;
+    }
 
-    // Log boundary signals
-    outFile << "Time (s): "<< grantedtime << "\n";
-    outFile << "S received from Gridlab-D, Sa: " << Sa << " Sb: " << Sb << " Sc: " << Sc <<"\n";
-    outFile << "Updated Vv by GridPACK, Va: " << Va << " Vb: " << Vb << " Vc: " << Vc << "\n\n"; 
-    
-    // Publish new Center Bus Voltage
-    Va_id.publish(Va*2400.0);
-    Vb_id.publish(Vb*2400.0);
-    Vc_id.publish(Vc*2400.0);
+    // pass S's to GridPACK and get back V's. Each case group contributes
+    // its own voltages once (from the first process in the group). Cases
+    // coupled by ties are then solved again with the tie flows from the
+    // new voltages, without going through HELICS, until the voltages at
+    // the tie ends settle. Only the cases at both ends of a tie whose
+    // voltages changed are solved again
+    for (i=0; i<ncase; i++) {
+      solved_case[i] = 0;
+      iterations[i] = 0;
+    }
+    V_last = V_solved;
+    tie_iter = 0;
+    while (true) {
+      for (i=0; i<vbuf.size(); i++) vbuf[i] = 0.0;
+      for (i=0; i<ibuf.size(); i++) ibuf[i] = 0;
+      for (j=0; j<my_cases.size(); j++) {
+        int c = my_cases[j];
+        if (!solve_case[c]) continue;
+        const std::vector<int> &cbnd = fed.cases[c].boundaries;
+        const std::vector<int> &cend = fed.cases[c].tie_ends;
+        for (k=0; k<cbnd.size(); k++) {
+          apps[c]->setLoad(fed.boundaries[cbnd[k]].bus, S[cbnd[k]]);
+        }
+        for (k=0; k<cend.size(); k++) {
+          apps[c]->setLoad(end_bus[cend[k]], S_base[cend[k]]+S_tie[cend[k]]);
+        }
+        bool converged = apps[c]->solve();
+        // Save the first converged solution of the first case so that a
+        // restarted federate starts from it instead of the raw file
+        if (c == 0 && converged && !state_saved &&
+            !settings.state_file.empty() && fed.cases[c].network.empty() &&
+            !apps[c]->restoredState()) {
+          apps[c]->saveState(settings.state_file);
+          state_saved = true;
+        }
+        apps[c]->getBoundaryVoltages(vcase);
+        if (case_comm.rank() == 0) {
+          for (k=0; k<cbnd.size(); k++) {
+            vbuf[2*cbnd[k]] = vcase[k].real();
+            vbuf[2*cbnd[k]+1] = vcase[k].imag();
+          }
+          for (k=0; k<cend.size(); k++) {
+            vbuf[2*nbnd+2*cend[k]] = vcase[cbnd.size()+k].real();
+            vbuf[2*nbnd+2*cend[k]+1] = vcase[cbnd.size()+k].imag();
+          }
+          ibuf[c] = apps[c]->getIterationCount();
+          ibuf[ncase+c] = converged ? 1 : 0;
+        }
+      }
+      world.sum(&vbuf[0],vbuf.size());
+      world.sum(&ibuf[0],ibuf.size());
+      for (i=0; i<nbnd; i++) {
+        if (solve_case[fed.boundaries[i].icase]) {
+          V_solved[i] = std::complex<double>(vbuf[2*i],vbuf[2*i+1]);
+          S_solved[i] = S[i];
+        }
+      }
+      for (i=0; i<nend; i++) {
+        dv_tie[i] = 0.0;
+        if (solve_case[end_case[i]]) {
+          std::complex<double> v(vbuf[2*nbnd+2*i],vbuf[2*nbnd+2*i+1]);
+          v *= fed.cases[end_case[i]].rotation;
+          dv_tie[i] = std::abs(v-V_tie[i]);
+          V_tie[i] = v;
+        }
+      }
+      for (i=0; i<ncase; i++) {
+        if (solve_case[i]) {
+          solved_case[i] = 1;
+          iterations[i] += ibuf[i];
+          converged_case[i] = ibuf[ncase+i];
+        }
+        solve_case[i] = 0;
+      }
+      // Tie flows from the new voltages, as loads at both ends (MW, MVAr)
+      bool again = false;
+      for (i=0; i<ntie; i++) {
+        const gridpack::powerflow::FederateTie &tie = fed.ties[i];
+        std::complex<double> current = (V_tie[2*i]-V_tie[2*i+1])/tie.z;
+        S_tie[2*i] = tie.base_mva*V_tie[2*i]*std::conj(current);
+        S_tie[2*i+1] = -tie.base_mva*V_tie[2*i+1]*std::conj(current);
+        if (dv_tie[2*i] > fed.tie_tolerance ||
+            dv_tie[2*i+1] > fed.tie_tolerance) {
+          solve_case[tie.from_case] = 1;
+          solve_case[tie.to_case] = 1;
+          again = true;
+        }
+      }
+      if (!again || tie_iter >= fed.max_tie_iterations) break;
+      tie_iter++;
+    }
+    total_tie += tie_iter;
+
+    // Largest change in boundary voltage of the cases that were solved
+    double dv = 0.0;
+    bool solved = false;
+    for (i=0; i<ncase; i++) {
+      if (!solved_case[i]) skipped[i]++;
+    }
+    for (i=0; i<nbnd; i++) {
+      if (solved_case[fed.boundaries[i].icase]) {
+        if (std::abs(V_solved[i]-V_last[i]) > dv) {
+          dv = std::abs(V_solved[i]-V_last[i]);
+        }
+        solved = true;
+      }
+      V[i] = V_solved[i]*fed.boundaries[i].rotation;
+    }
+
+    if (io_rank) {
+      // Publish new boundary voltages for the cases that were solved
+      for (i=0; i<nbnd; i++) {
+        Vpub[i] = V[i]*fed.boundaries[i].voltage_base;
+      }
+      schedule.applyVoltages(grantedtime,Vpub);
+      if (vector_pub) {
+        if (solved) V_id[0].publish(Vpub);
+      } else {
+        for (i=0; i<nbnd; i++) {
+          if (solved_case[fed.boundaries[i].icase]) V_id[i].publish(Vpub[i]);
+        }
+      }
+      t_compute = MPI_Wtime()-t_start;
+
+      // If the boundary has not converged, ask HELICS to iterate at the
+      // current time. The other federates see the new voltages and HELICS
+      // only grants another iteration if they publish new loads
+      repeat = false;
+      if (fed.iterative && solved && dv > fed.coupling_tolerance &&
+          coupling_iter < fed.max_coupling) {
+        double t_iter = MPI_Wtime();
+        helics::iteration_time it = gpk_fed->requestTimeIterative(
+            grantedtime,helics::IterationRequest::ITERATE_IF_NEEDED);
+        t_blocked += MPI_Wtime()-t_iter;
+        repeat = (it.state == helics::IterationResult::ITERATING);
+      }
+
+      // Ask for the next step now so that the broker round trip overlaps
+      // the output below
+      if (!repeat && fed.async_request && grantedtime < fed.end_time) {
+        double t_next = nextTime(grantedtime,fed.period,fed.variable_step,
+            fed.max_step,fed.end_time);
+        if (fed.variable_step && schedule.nextEvent(grantedtime) < t_next) {
+          t_next = schedule.nextEvent(grantedtime);
+        }
+        gpk_fed->requestTimeAsync(t_next);
+        pending = true;
+      }
+
+      // Iteration counts are reported on the steps the power flow writes
+      // its full output, following the outputPolicy of the input file
+      if (settings.output_policy == gridpack::powerflow::OUTPUT_FULL ||
+          (settings.output_policy == gridpack::powerflow::OUTPUT_INTERVAL &&
+           nsteps%std::max(settings.output_interval,1) == 0)) {
+        std::cout << "Power flow iterations at " << grantedtime << " s,";
+        for (i=0; i<ncase; i++) {
+          std::cout << " " << fed.cases[i].name << ": " << iterations[i];
+        }
+        if (ntie > 0) std::cout << ", tie iterations: " << tie_iter;
+        std::cout << std::endl;
+      }
+
+      // Record boundary signals
+      signals[0] = grantedtime;
+      for (i=0; i<nbnd; i++) {
+        signals[1+2*i] = S[i].real();
+        signals[2+2*i] = S[i].imag();
+        signals[1+2*nbnd+2*i] = V[i].real();
+        signals[2+2*nbnd+2*i] = V[i].imag();
+      }
+      for (i=0; i<ntie; i++) {
+        signals[1+4*nbnd+2*i] = S_tie[2*i].real();
+        signals[2+4*nbnd+2*i] = S_tie[2*i].imag();
+      }
+      signals[4*nbnd+2*ntie+1] = t_blocked;
+      signals[4*nbnd+2*ntie+2] = t_compute;
+      recorder.record(&signals[0]);
+
+      // Telemetry for the step
+      k = 0;
+      tvalues[k++] = grantedtime;
+      for (i=0; i<nbnd; i++) {
+        std::complex<double> load = S[i]*fed.boundaries[i].power_scale;
+        tvalues[k++] = load.real();
+        tvalues[k++] = load.imag();
+      }
+      for (i=0; i<nbnd; i++) {
+        tvalues[k++] = Vpub[i].real();
+        tvalues[k++] = Vpub[i].imag();
+      }
+      for (i=0; i<ncase; i++) {
+        tvalues[k++] = iterations[i];
+        tvalues[k++] = converged_case[i];
+      }
+      tvalues[k++] = coupling_iter;
+      tvalues[k++] = tie_iter;
+      tvalues[k++] = dv;
+      tvalues[k++] = t_blocked;
+      tvalues[k++] = t_compute;
+      telemetry.write(&tvalues[0]);
+      total_blocked += t_blocked;
+      total_compute += t_compute;
+      nsteps++;
+    }
+    // All processes need to know whether the current time is solved again
+    if (fed.iterative) {
+      int rflag = repeat ? 1 : 0;
+      world.sum(&rflag,1);
+      repeat = (rflag > 0);
+    }
   }
 
-  outFile << "End of Cosimulation.";
-  outFile.close();
+  for (j=0; j<my_cases.size(); j++) {
+    int c = my_cases[j];
+    if (case_comm.rank() == 0) {
+      printf("Case %s Jacobian factorizations/linear solves: %d/%d\n",
+          fed.cases[c].name.c_str(),apps[c]->getFactorizationCount(),
+          apps[c]->getLinearSolveCount());
+    }
+  }
+
+  if (io_rank) {
+    printf("Steps: %d time blocked in HELICS: %f s computing: %f s\n",
+        nsteps,total_blocked,total_compute);
+    if (fed.iterative) printf("Coupling iterations: %d\n",total_coupling);
+    if (ntie > 0) printf("Tie iterations: %d\n",total_tie);
+    std::cout << "Skipped power flow solves,";
+    for (i=0; i<ncase; i++) {
+      std::cout << " " << fed.cases[i].name << ": " << skipped[i];
+    }
+    std::cout << std::endl;
+  }
 
-  // Terminate GridPACK Math Libraries
-  gridpack::math::Finalize();
+  recorder.close();
+  telemetry.close();
+
+  // Cumulative time spent in each stage of the power flow over all steps
+  // and cases
+  gridpack::utility::CoarseTimer::instance()->dump();
+
+  // Release power flow applications. The math libraries are terminated
+  // when the runtime goes out of scope
+  apps.clear();
 
   // Finalize the federate to clean up and disconnect from the HELICS core
-  gpk_left.finalize();
-  std::cout << "Federate finalized." << std::endl;
+  if (io_rank) {
+    gpk_fed->finalize();
+    std::cout << "Federate finalized." << std::endl;
+  }
 
   return 0;
 }
@@ -0,0 +1,272 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   network_state.hpp
+ *
+ * @brief  Binary save and restore of the state of an initialized network.
+ *         The bus and branch DataCollections hold everything the power flow
+ *         and dynamic simulation components are loaded from, including the
+ *         results written back by saveData, so a network rebuilt from a
+ *         saved state starts from the converged solution without parsing
+ *         the network configuration file or solving the base case again.
+ *
+ *         The state is written as one file per process,
+ *         <filename>.<rank>, holding the buses and branches owned by that
+ *         process, and a manifest <filename> with the number of process
+ *         files. The manifest is written last, so a state that was only
+ *         partially written is never read. A state can be restored on any
+ *         number of processes.
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _network_state_h_
+#define _network_state_h_
+
+#include <map>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <cstdio>
+#include <sys/stat.h>
+#include "boost/smart_ptr/shared_ptr.hpp"
+#include "boost/archive/binary_oarchive.hpp"
+#include "boost/archive/binary_iarchive.hpp"
+#include "gridpack/include/gridpack.hpp"
+
+// Identifies a saved network state. Change the version if the layout is
+// modified so that old states are ignored
+#define NETWORK_STATE_MAGIC 0x47504b53
+#define NETWORK_STATE_VERSION 1
+
+namespace gridpack {
+namespace powerflow {
+
+template <class _network>
+class NetworkState {
+  public:
+    typedef boost::shared_ptr<_network> NetworkPtr;
+
+    /**
+     * Write the state of a partitioned network. This is a collective
+     * operation on the network communicator
+     * @param filename: name of the manifest
+     * @param network: network to save
+     * @return false if any process could not write its file
+     */
+    static bool write(const std::string &filename, NetworkPtr network)
+    {
+      const gridpack::parallel::Communicator &comm = network->communicator();
+      char buf[32];
+      sprintf(buf,".%d",comm.rank());
+      std::string part = filename + buf;
+      int nfail = 0;
+      {
+        std::ofstream out(part.c_str(), std::ios::out | std::ios::binary);
+        try {
+          boost::archive::binary_oarchive ar(out);
+          int magic = NETWORK_STATE_MAGIC;
+          int version = NETWORK_STATE_VERSION;
+          ar & magic & version;
+          // Only active buses and branches are saved, so every bus and
+          // branch is written by exactly one process
+          int i;
+          int nbus = network->numBuses();
+          int nactive = 0;
+          for (i=0; i<nbus; i++) {
+            if (network->getActiveBus(i)) nactive++;
+          }
+          ar & nactive;
+          for (i=0; i<nbus; i++) {
+            if (!network->getActiveBus(i)) continue;
+            int idx = network->getOriginalBusIndex(i);
+            int gidx = network->getGlobalBusIndex(i);
+            ar & idx & gidx;
+            ar & *(network->getBusData(i));
+          }
+          int nbranch = network->numBranches();
+          nactive = 0;
+          for (i=0; i<nbranch; i++) {
+            if (network->getActiveBranch(i)) nactive++;
+          }
+          ar & nactive;
+          for (i=0; i<nbranch; i++) {
+            if (!network->getActiveBranch(i)) continue;
+            int idx1, idx2;
+            network->getOriginalBranchEndpoints(i,&idx1,&idx2);
+            int gidx = network->getGlobalBranchIndex(i);
+            ar & idx1 & idx2 & gidx;
+            ar & *(network->getBranchData(i));
+          }
+        } catch (std::exception &e) {
+          nfail = 1;
+        }
+        out.close();
+        if (out.fail()) nfail = 1;
+      }
+      comm.sum(&nfail,1);
+      if (comm.rank() == 0) {
+        if (nfail == 0) {
+          // Write to a temporary file and rename it so that a process
+          // reading the state never sees a partial manifest
+          std::string tmp = filename + ".tmp";
+          FILE *fp = fopen(tmp.c_str(),"w");
+          if (fp) {
+            fprintf(fp,"%d %d %d\n",NETWORK_STATE_MAGIC,NETWORK_STATE_VERSION,
+                comm.size());
+            if (fclose(fp) != 0 || rename(tmp.c_str(),filename.c_str()) != 0) {
+              nfail = 1;
+            }
+          } else {
+            nfail = 1;
+          }
+        }
+        if (nfail == 0) {
+          printf("Network state written to %s\n",filename.c_str());
+        } else {
+          printf("Unable to write network state: (%s)\n",filename.c_str());
+        }
+      }
+      comm.sum(&nfail,1);
+      return (nfail == 0);
+    }
+
+    /**
+     * Fill an empty, unpartitioned network from a saved state. The network
+     * still needs to be partitioned. This is a collective operation on the
+     * network communicator
+     * @param filename: name of the manifest
+     * @param source: network configuration file the state was created
+     *        from. The state is not used if source has been modified since
+     *        the state was written. Ignored if empty
+     * @param network: network to fill
+     * @return true if the network was filled from the saved state
+     */
+    static bool read(const std::string &filename, const std::string &source,
+        NetworkPtr network)
+    {
+      const gridpack::parallel::Communicator &comm = network->communicator();
+      // As with the parsers, process 0 holds the complete network until it
+      // is partitioned
+      int found = 0;
+      if (comm.rank() == 0) {
+        if (readParts(filename, source, network)) {
+          found = 1;
+          printf("Network restored from state: (%s)\n",filename.c_str());
+        }
+      }
+      comm.sum(&found,1);
+      return (found > 0);
+    }
+
+  private:
+
+    /**
+     * Read the manifest and all process files on process 0
+     * @param filename: name of the manifest
+     * @param source: network configuration file, checked if not empty
+     * @param network: empty network to fill
+     * @return false if the state does not exist, is out of date or could
+     *         not be read
+     */
+    static bool readParts(const std::string &filename,
+        const std::string &source, NetworkPtr network)
+    {
+      struct stat state_stat, source_stat;
+      if (stat(filename.c_str(), &state_stat) != 0) return false;
+      if (!source.empty()) {
+        if (stat(source.c_str(), &source_stat) != 0) return false;
+        if (state_stat.st_mtime < source_stat.st_mtime) return false;
+      }
+      int magic, version, nparts;
+      FILE *fp = fopen(filename.c_str(),"r");
+      if (!fp) return false;
+      int nread = fscanf(fp,"%d %d %d",&magic,&version,&nparts);
+      fclose(fp);
+      if (nread != 3 || magic != NETWORK_STATE_MAGIC ||
+          version != NETWORK_STATE_VERSION || nparts < 1) {
+        return false;
+      }
+      // All buses have to be added before the branches that refer to them,
+      // so the branch records of each file are kept until all files have
+      // been read
+      int i, p;
+      std::map<int,int> local;
+      std::vector<std::string> parts(nparts);
+      std::vector<int> idx1, idx2, gidx;
+      std::vector<boost::shared_ptr<gridpack::component::DataCollection> >
+        data;
+      int nbus = 0;
+      try {
+        for (p=0; p<nparts; p++) {
+          char buf[32];
+          sprintf(buf,".%d",p);
+          std::string part = filename + buf;
+          std::ifstream in(part.c_str(), std::ios::in | std::ios::binary);
+          if (!in.is_open()) return false;
+          std::stringstream contents;
+          contents << in.rdbuf();
+          in.close();
+          parts[p] = contents.str();
+        }
+        for (p=0; p<nparts; p++) {
+          std::istringstream is(parts[p], std::ios::in | std::ios::binary);
+          boost::archive::binary_iarchive ar(is);
+          ar & magic & version;
+          if (magic != NETWORK_STATE_MAGIC || version != NETWORK_STATE_VERSION) {
+            network->clear();
+            return false;
+          }
+          int n;
+          ar & n;
+          for (i=0; i<n; i++) {
+            int idx, g;
+            ar & idx & g;
+            network->addBus(idx);
+            network->setGlobalBusIndex(nbus,g);
+            ar & *(network->getBusData(nbus));
+            local.insert(std::pair<int,int>(idx,nbus));
+            nbus++;
+          }
+          ar & n;
+          for (i=0; i<n; i++) {
+            int i1, i2, g;
+            ar & i1 & i2 & g;
+            idx1.push_back(i1);
+            idx2.push_back(i2);
+            gidx.push_back(g);
+            data.push_back(boost::shared_ptr<gridpack::component::DataCollection>(
+                  new gridpack::component::DataCollection));
+            ar & *(data.back());
+          }
+        }
+      } catch (std::exception &e) {
+        printf("Unable to read network state: %s\n",e.what());
+        network->clear();
+        return false;
+      }
+      // Branches are added in the same way as in the PTI parsers. Neighbor
+      // lists are constructed when the network is partitioned
+      for (i=0; i<gidx.size(); i++) {
+        int l_idx1 = local[idx1[i]];
+        int l_idx2 = local[idx2[i]];
+        network->addBranch(idx1[i],idx2[i]);
+        network->setGlobalBranchIndex(i,gidx[i]);
+        network->setLocalBusIndex1(i,l_idx1);
+        network->setLocalBusIndex2(i,l_idx2);
+        network->setGlobalBusIndex1(i,network->getGlobalBusIndex(l_idx1));
+        network->setGlobalBusIndex2(i,network->getGlobalBusIndex(l_idx2));
+        *(network->getBranchData(i)) = *(data[i]);
+      }
+      return true;
+    }
+};
+
+} // powerflow
+} // gridpack
+#endif
@@ -0,0 +1,337 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   perturbation_schedule.cpp
+ *
+ * @brief  Time-indexed load and voltage perturbations for the GridPACK
+ *         federate
+ *
+ */
+// -------------------------------------------------------------
+
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "boost/property_tree/ptree.hpp"
+#include "boost/property_tree/json_parser.hpp"
+#include "perturbation_schedule.hpp"
+
+namespace gridpack {
+namespace powerflow {
+
+/**
+ * Basic constructor
+ * @param fed federate settings with the cases, boundaries and ties
+ */
+PerturbationSchedule::PerturbationSchedule(const FederateSettings &fed)
+  : p_fed(fed)
+{
+  p_dirty.assign(p_fed.cases.size(),0);
+}
+
+/**
+ * Basic destructor
+ */
+PerturbationSchedule::~PerturbationSchedule(void)
+{
+}
+
+/**
+ * Add a batch of perturbations. Nothing is added if any entry of the
+ * batch is not valid
+ * @param text JSON batch
+ * @param verbose print the reason a batch is rejected
+ * @return false if the batch was rejected
+ */
+bool PerturbationSchedule::parse(const std::string &text, bool verbose)
+{
+  boost::property_tree::ptree tree;
+  std::istringstream in(text);
+  try {
+    boost::property_tree::read_json(in, tree);
+  } catch (boost::property_tree::json_parser_error &e) {
+    if (verbose) printf("Unable to parse perturbations: %s\n",e.what());
+    return false;
+  }
+  bool replace = tree.get<bool>("replace",false);
+  int ncase = p_fed.cases.size();
+  int nbnd = p_fed.boundaries.size();
+  int i;
+  std::vector<Perturbation> list;
+  boost::optional<boost::property_tree::ptree&> entries
+    = tree.get_child_optional("perturbations");
+  if (entries) {
+    boost::property_tree::ptree::iterator pit;
+    for (pit = entries->begin(); pit != entries->end(); pit++) {
+      boost::property_tree::ptree &pnode = pit->second;
+      Perturbation p;
+      int n = list.size();
+      p.start = pnode.get<double>("time",0.0);
+      double duration = pnode.get<double>("duration",0.0);
+      p.end = std::numeric_limits<double>::max();
+      if (duration > 0.0) p.end = p.start+duration;
+
+      std::string type = pnode.get<std::string>("type","load");
+      std::string mode = pnode.get<std::string>("mode","add");
+      if (type == "load") {
+        p.type = PERTURB_LOAD;
+      } else if (type == "voltage") {
+        p.type = PERTURB_VOLTAGE;
+      } else {
+        if (verbose) printf("Perturbation %d has unknown type (%s)\n",
+            n,type.c_str());
+        return false;
+      }
+      if (mode == "add") {
+        p.mode = PERTURB_ADD;
+      } else if (mode == "set") {
+        p.mode = PERTURB_SET;
+      } else if (mode == "scale") {
+        p.mode = PERTURB_SCALE;
+      } else {
+        if (verbose) printf("Perturbation %d has unknown mode (%s)\n",
+            n,mode.c_str());
+        return false;
+      }
+
+      // The value is either a number or a [real, imaginary] pair
+      p.value = std::complex<double>(0.0,0.0);
+      boost::optional<boost::property_tree::ptree&> value
+        = pnode.get_child_optional("value");
+      if (value && value->empty()) {
+        p.value = std::complex<double>(value->get_value<double>(),0.0);
+      } else if (value) {
+        double v[2] = {0.0, 0.0};
+        int k = 0;
+        boost::property_tree::ptree::iterator vit;
+        for (vit = value->begin(); vit != value->end() && k<2; vit++) {
+          v[k++] = vit->second.get_value<double>();
+        }
+        p.value = std::complex<double>(v[0],v[1]);
+      }
+
+      // Target is a boundary or a bus of a case
+      std::string bname = pnode.get<std::string>("boundary","");
+      std::string cname = pnode.get<std::string>("case","");
+      p.boundary = -1;
+      p.icase = -1;
+      p.bus = pnode.get<int>("bus",-1);
+      if (!bname.empty()) {
+        for (i=0; i<nbnd; i++) {
+          if (p_fed.boundaries[i].name == bname) p.boundary = i;
+        }
+        if (p.boundary < 0) {
+          if (verbose) printf("Perturbation %d has unknown boundary (%s)\n",
+              n,bname.c_str());
+          return false;
+        }
+        p.icase = p_fed.boundaries[p.boundary].icase;
+        p.bus = p_fed.boundaries[p.boundary].bus;
+      } else {
+        if (cname.empty() && ncase == 1) p.icase = 0;
+        for (i=0; i<ncase; i++) {
+          if (p_fed.cases[i].name == cname) p.icase = i;
+        }
+        bool ok = (p.type == PERTURB_LOAD && p.icase >= 0 && p.bus >= 0);
+        // Boundary and tie end loads are set by the federate every step,
+        // so they can only be perturbed through their boundary
+        for (i=0; ok && i<nbnd; i++) {
+          if (p_fed.boundaries[i].icase == p.icase &&
+              p_fed.boundaries[i].bus == p.bus) ok = false;
+        }
+        for (i=0; ok && i<p_fed.ties.size(); i++) {
+          const FederateTie &tie = p_fed.ties[i];
+          if ((tie.from_case == p.icase && tie.from_bus == p.bus) ||
+              (tie.to_case == p.icase && tie.to_bus == p.bus)) ok = false;
+        }
+        if (!ok) {
+          if (verbose) printf("Perturbation %d of case (%s) bus %d is not"
+              " valid\n",n,cname.c_str(),p.bus);
+          return false;
+        }
+      }
+      list.push_back(p);
+    }
+  }
+
+  if (replace) {
+    for (i=0; i<p_list.size(); i++) {
+      if (p_active[i]) p_dirty[p_list[i].icase] = 1;
+    }
+    p_list.clear();
+    p_active.clear();
+  }
+  for (i=0; i<list.size(); i++) {
+    p_list.push_back(list[i]);
+    p_active.push_back(0);
+  }
+  return true;
+}
+
+/**
+ * Add a batch of perturbations from a file
+ * @param filename name of JSON file
+ * @param verbose print the reason a batch is rejected
+ * @return false if the file could not be read or was rejected
+ */
+bool PerturbationSchedule::read(const std::string &filename, bool verbose)
+{
+  std::ifstream in(filename.c_str());
+  if (!in.is_open()) {
+    if (verbose) printf("Unable to open perturbation file %s\n",
+        filename.c_str());
+    return false;
+  }
+  std::stringstream text;
+  text << in.rdbuf();
+  return parse(text.str(),verbose);
+}
+
+/**
+ * Find the perturbations that are active at a time and flag the cases
+ * whose active perturbations changed since the last call
+ * @param time current time
+ * @param dirty one flag per case, set to 1 for changed cases
+ */
+void PerturbationSchedule::update(double time, std::vector<int> &dirty)
+{
+  int i;
+  for (i=0; i<p_dirty.size(); i++) {
+    if (p_dirty[i]) dirty[i] = 1;
+    p_dirty[i] = 0;
+  }
+  for (i=0; i<p_list.size(); i++) {
+    int active = (p_list[i].start <= time && time < p_list[i].end) ? 1 : 0;
+    if (active != p_active[i]) dirty[p_list[i].icase] = 1;
+    p_active[i] = active;
+  }
+}
+
+/**
+ * Apply one perturbation to a value
+ * @param p perturbation
+ * @param value original value
+ * @param scale divisor of the perturbation value for add and set
+ * @return perturbed value
+ */
+std::complex<double> PerturbationSchedule::apply(const Perturbation &p,
+    const std::complex<double> &value, double scale) const
+{
+  if (p.mode == PERTURB_SET) return p.value/scale;
+  if (p.mode == PERTURB_SCALE) return value*p.value;
+  return value+p.value/scale;
+}
+
+/**
+ * Apply the load perturbations at the boundaries
+ * @param time current time
+ * @param S (input/output) per unit loads received at the boundaries
+ */
+void PerturbationSchedule::applyLoads(double time,
+    std::vector<std::complex<double> > &S) const
+{
+  int i;
+  for (i=0; i<p_list.size(); i++) {
+    const Perturbation &p = p_list[i];
+    if (p.type != PERTURB_LOAD || p.boundary < 0) continue;
+    if (p.start <= time && time < p.end) {
+      S[p.boundary] = apply(p,S[p.boundary],
+          p_fed.boundaries[p.boundary].power_scale);
+    }
+  }
+}
+
+/**
+ * Apply the voltage perturbations at the boundaries
+ * @param time current time
+ * @param V (input/output) voltages published at the boundaries
+ */
+void PerturbationSchedule::applyVoltages(double time,
+    std::vector<std::complex<double> > &V) const
+{
+  int i;
+  for (i=0; i<p_list.size(); i++) {
+    const Perturbation &p = p_list[i];
+    if (p.type != PERTURB_VOLTAGE) continue;
+    if (p.start <= time && time < p.end) {
+      V[p.boundary] = apply(p,V[p.boundary],1.0);
+    }
+  }
+}
+
+/**
+ * Buses of a case, other than boundaries, that have load perturbations
+ * @param icase index of case
+ * @param buses (output) original bus indices
+ */
+void PerturbationSchedule::getBuses(int icase, std::vector<int> &buses) const
+{
+  buses.clear();
+  int i, j;
+  for (i=0; i<p_list.size(); i++) {
+    const Perturbation &p = p_list[i];
+    if (p.boundary >= 0 || p.icase != icase) continue;
+    bool found = false;
+    for (j=0; j<buses.size(); j++) {
+      if (buses[j] == p.bus) found = true;
+    }
+    if (!found) buses.push_back(p.bus);
+  }
+}
+
+/**
+ * Perturbed load of a bus that is not a boundary
+ * @param time current time
+ * @param icase index of case
+ * @param bus original bus index
+ * @param base original load (MW, MVAr)
+ * @return load with the active perturbations applied
+ */
+std::complex<double> PerturbationSchedule::busLoad(double time, int icase,
+    int bus, const std::complex<double> &base) const
+{
+  std::complex<double> load = base;
+  int i;
+  for (i=0; i<p_list.size(); i++) {
+    const Perturbation &p = p_list[i];
+    if (p.boundary >= 0 || p.icase != icase || p.bus != bus) continue;
+    if (p.start <= time && time < p.end) load = apply(p,load,1.0);
+  }
+  return load;
+}
+
+/**
+ * First time after the given time at which a perturbation starts or
+ * ends
+ * @param time current time
+ * @return time of next change, or a very large value if there is none
+ */
+double PerturbationSchedule::nextEvent(double time) const
+{
+  double next = std::numeric_limits<double>::max();
+  int i;
+  for (i=0; i<p_list.size(); i++) {
+    const Perturbation &p = p_list[i];
+    if (p.start > time && p.start < next) next = p.start;
+    if (p.end > time && p.end < next) next = p.end;
+  }
+  return next;
+}
+
+/**
+ * Number of perturbations in the schedule
+ */
+int PerturbationSchedule::size(void) const
+{
+  return p_list.size();
+}
+
+} // powerflow
+} // gridpack
@@ -0,0 +1,175 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   perturbation_schedule.hpp
+ *
+ * @brief  Time-indexed load and voltage perturbations applied by the
+ *         GridPACK federate at the granted times, so that a scenario can
+ *         send a whole batch of changes to many buses in one message.
+ *
+ *         A batch is a JSON document
+ *
+ *         {
+ *           "replace" : false,
+ *           "perturbations" : [
+ *             { "time" : 5.0, "duration" : 10.0, "type" : "load",
+ *               "boundary" : "a", "mode" : "add", "value" : [2.0e5, 1.0e5] },
+ *             { "time" : 5.0, "type" : "load", "case" : "A", "bus" : 7,
+ *               "mode" : "scale", "value" : 1.5 },
+ *             { "time" : 8.0, "type" : "voltage", "boundary" : "b",
+ *               "mode" : "set", "value" : [2280.0, 0.0] } ]
+ *         }
+ *
+ *         A perturbation is active from time for duration seconds, or until
+ *         the end of the run if duration is missing or zero. Load
+ *         perturbations apply either to the load received at a boundary, in
+ *         its loadUnit, or to the original load of any other bus of a case,
+ *         in MW and MVAr. The case can be left out if there is only one.
+ *         Voltage perturbations apply to the voltage published at a
+ *         boundary, in its voltageUnit. The mode is add, set or scale
+ *         (a complex factor) and value is a number or a [real, imaginary]
+ *         pair. Active perturbations of the same target are applied in the
+ *         order they were received. If replace is true the batch replaces
+ *         all earlier perturbations, otherwise it is added to them.
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _perturbation_schedule_h_
+#define _perturbation_schedule_h_
+
+#include <complex>
+#include <string>
+#include <vector>
+#include "federate_config.hpp"
+
+namespace gridpack {
+namespace powerflow {
+
+enum PerturbationType{PERTURB_LOAD, PERTURB_VOLTAGE};
+enum PerturbationMode{PERTURB_ADD, PERTURB_SET, PERTURB_SCALE};
+
+struct Perturbation {
+  // Active for start <= t < end
+  double start;
+  double end;
+  int type;
+  int mode;
+  // Index of the boundary, or -1 for the load on bus of case icase
+  int boundary;
+  int icase;
+  int bus;
+  std::complex<double> value;
+};
+
+class PerturbationSchedule {
+  public:
+    /**
+     * Basic constructor
+     * @param fed federate settings with the cases, boundaries and ties
+     */
+    PerturbationSchedule(const FederateSettings &fed);
+
+    /**
+     * Basic destructor
+     */
+    ~PerturbationSchedule(void);
+
+    /**
+     * Add a batch of perturbations. Nothing is added if any entry of the
+     * batch is not valid
+     * @param text JSON batch
+     * @param verbose print the reason a batch is rejected
+     * @return false if the batch was rejected
+     */
+    bool parse(const std::string &text, bool verbose);
+
+    /**
+     * Add a batch of perturbations from a file
+     * @param filename name of JSON file
+     * @param verbose print the reason a batch is rejected
+     * @return false if the file could not be read or was rejected
+     */
+    bool read(const std::string &filename, bool verbose);
+
+    /**
+     * Find the perturbations that are active at a time and flag the cases
+     * whose active perturbations changed since the last call
+     * @param time current time
+     * @param dirty one flag per case, set to 1 for changed cases
+     */
+    void update(double time, std::vector<int> &dirty);
+
+    /**
+     * Apply the load perturbations at the boundaries
+     * @param time current time
+     * @param S (input/output) per unit loads received at the boundaries
+     */
+    void applyLoads(double time, std::vector<std::complex<double> > &S) const;
+
+    /**
+     * Apply the voltage perturbations at the boundaries
+     * @param time current time
+     * @param V (input/output) voltages published at the boundaries
+     */
+    void applyVoltages(double time,
+        std::vector<std::complex<double> > &V) const;
+
+    /**
+     * Buses of a case, other than boundaries, that have load perturbations
+     * @param icase index of case
+     * @param buses (output) original bus indices
+     */
+    void getBuses(int icase, std::vector<int> &buses) const;
+
+    /**
+     * Perturbed load of a bus that is not a boundary
+     * @param time current time
+     * @param icase index of case
+     * @param bus original bus index
+     * @param base original load (MW, MVAr)
+     * @return load with the active perturbations applied
+     */
+    std::complex<double> busLoad(double time, int icase, int bus,
+        const std::complex<double> &base) const;
+
+    /**
+     * First time after the given time at which a perturbation starts or
+     * ends
+     * @param time current time
+     * @return time of next change, or a very large value if there is none
+     */
+    double nextEvent(double time) const;
+
+    /**
+     * Number of perturbations in the schedule
+     */
+    int size(void) const;
+
+  private:
+
+    /**
+     * Apply one perturbation to a value
+     * @param p perturbation
+     * @param value original value
+     * @param scale divisor of the perturbation value for add and set
+     * @return perturbed value
+     */
+    std::complex<double> apply(const Perturbation &p,
+        const std::complex<double> &value, double scale) const;
+
+    FederateSettings p_fed;
+    std::vector<Perturbation> p_list;
+    // Activity of each perturbation at the last update and cases changed
+    // by replaced batches since then
+    std::vector<int> p_active;
+    std::vector<int> p_dirty;
+};
+
+} // powerflow
+} // gridpack
+#endif
@@ -18,7 +18,11 @@
 #include "gridpack/include/gridpack.hpp"
 #include "pf_app.hpp"
 #include "pf_factory.hpp"
+#include "pf_network_cache.hpp"
+#include "network_state.hpp"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
 // Calling program for powerflow application
 
@@ -27,6 +31,31 @@
  */
 gridpack::powerflow::PFApp::PFApp(void)
 {
+  p_initialized = false;
+  p_restored = false;
+  p_tolerance = 1.0e-6;
+  p_max_iteration = 50;
+  p_warm_start = false;
+  p_converged = false;
+  p_iterations = 0;
+  p_jacobian_reuse = 0;
+  p_reuse_ratio = 0.5;
+  p_packed = false;
+  p_factorizations = 0;
+  p_linear_solves = 0;
+  p_boundary_ids.push_back(2);
+  p_output_policy = OUTPUT_FULL;
+  p_output_interval = 1;
+  p_solves = 0;
+  p_timer = gridpack::utility::CoarseTimer::instance();
+  p_t_parse = p_timer->createCategory("Powerflow: Parse Network");
+  p_t_partition = p_timer->createCategory("Powerflow: Partition");
+  p_t_factory = p_timer->createCategory("Powerflow: Factory Setup");
+  p_t_ybus = p_timer->createCategory("Powerflow: Build Y-bus");
+  p_t_rhs = p_timer->createCategory("Powerflow: Map PQ Vector");
+  p_t_jacobian = p_timer->createCategory("Powerflow: Map Jacobian");
+  p_t_solve = p_timer->createCategory("Powerflow: Linear Solve");
+  p_t_output = p_timer->createCategory("Powerflow: Output");
 }
 
 /**
@@ -37,26 +66,39 @@ gridpack::powerflow::PFApp::~PFApp(void)
 }
 
 /**
- * Enumerated type to distinguish between different configuration file
- * formats. PSS/E version 23 and 33 formats are currently supported.
+ * Read the input file, parse and partition the network and set up the
+ * factory, mappers, Jacobian and linear solver. This only needs to be
+ * called once; the objects are reused by every subsequent call to solve
+ * @param argc number of arguments
+ * @param argv list of character strings
+ * @return false if the input or network configuration file could not
+ *         be found
  */
-enum Parser{PTI23, PTI33};
+bool gridpack::powerflow::PFApp::initialize(int argc, char** argv)
+{
+  // Define a communicator on the group of all processors (the world group)
+  gridpack::parallel::Communicator world;
+  return initialize(argc, argv, world);
+}
 
 /**
- * Execute application. The name of XML-formatted input can be used
- * as an argument to the executable
+ * Read the Configuration.Powerflow block of the input file. The input
+ * file is opened and echoed to standard out once, so this should be
+ * called at start-up and not on every time step
  * @param argc number of arguments
  * @param argv list of character strings
+ * @param comm communicator that reads the input file
+ * @param settings (output) parameters from the input file
+ * @return false if the input file could not be found or does not
+ *         specify a network configuration file
  */
-void gridpack::powerflow::PFApp::execute(int argc,
-					 char** argv,
-					 std::complex<double>& Vc,
-					 std::complex<double>& Sa)
+bool gridpack::powerflow::PFApp::readSettings(int argc, char** argv,
+    const gridpack::parallel::Communicator &comm, PFSettings &settings)
 {
-  // Define a communicator on the group of all processors (the world group)
-  // and create and instance of a power flow network
-  gridpack::parallel::Communicator world;
-  boost::shared_ptr<PFNetwork> network(new PFNetwork(world));
+  gridpack::utility::CoarseTimer *timer =
+    gridpack::utility::CoarseTimer::instance();
+  int t_config = timer->createCategory("Powerflow: Read Configuration");
+  timer->start(t_config);
 
   // Read configuration file. If file is not specified when invoking the
   // executable, assume the input file is called "input.xml"
@@ -68,245 +110,790 @@ void gridpack::powerflow::PFApp::execute(int argc,
   if (argc >= 2 && argv[1] != NULL) {
     char inputfile[256];
     sprintf(inputfile,"%s",argv[1]);
-    opened = config->open(inputfile,world);
+    opened = config->open(inputfile,comm);
   } else {
-    opened = config->open("input.xml",world);
+    opened = config->open("input.xml",comm);
   }
   // If no input file found, return
-  if (!opened) return;
+  if (!opened) {
+    timer->stop(t_config);
+    return false;
+  }
 
   // Find the Configuration.Powerflow block within the input file
   // and set cursor pointer to that block
   gridpack::utility::Configuration::CursorPtr cursor;
   cursor = config->getCursor("Configuration.Powerflow");
-  std::string filename;
-  int filetype = PTI23;
+  settings.cursor = cursor;
+  settings.filetype = PTI23;
   // If networkConfiguration field found in input, assume that file
   // is PSS/E version 23 format, otherwise if networkConfiguation_v33
   // field found in input, assume file is version 33 format. If neither
   // field is found, then no configuration file is specified so return
-  if (!cursor->get("networkConfiguration",&filename)) {
-    if (cursor->get("networkConfiguration_v33",&filename)) {
-      filetype = PTI33;
+  if (!cursor->get("networkConfiguration",&settings.filename)) {
+    if (cursor->get("networkConfiguration_v33",&settings.filename)) {
+      settings.filetype = PTI33;
     } else {
       printf("No network configuration file specified\n");
-      return;
+      timer->stop(t_config);
+      return false;
     }
   }
   // Set convergence and iteration parameters from input file. If
   // tolerance and maxIteration fields not found, then use defaults
-  double tolerance = cursor->get("tolerance",1.0e-6);
-  int max_iteration = cursor->get("maxIteration",50);
-  ComplexType tol;
+  settings.tolerance = cursor->get("tolerance",1.0e-6);
+  settings.max_iteration = cursor->get("maxIteration",50);
+  // Start each solve from the previous solution if warmStart is true
+  settings.warm_start = cursor->get("warmStart",false);
+  // Number of consecutive Newton-Raphson iterations that may reuse the
+  // Jacobian (and its factorization) before it is refreshed. Zero gives the
+  // standard Newton-Raphson method. The Jacobian is also refreshed if the
+  // residual does not drop by at least jacobianReuseRatio
+  settings.jacobian_reuse = cursor->get("jacobianReuse",0);
+  settings.reuse_ratio = cursor->get("jacobianReuseRatio",0.5);
+  // Optionally assemble the PQ vector and Jacobian from arrays packed once
+  // at initialization instead of calling the network components in every
+  // iteration. The packed PQ vector and Jacobian are compared with the
+  // mapped ones at perturbed voltages first and the mappers are used if
+  // they do not agree. Off unless packedAssembly is set
+  settings.packed_assembly = cursor->get("packedAssembly",false);
   // Different files use different conventions for the phase shift sign.
   // Allow users to change sign to correspond to the convention used
   // in this application.
-  double phaseShiftSign = cursor->get("phaseShiftSign",1.0);
+  settings.phase_shift_sign = cursor->get("phaseShiftSign",1.0);
+  // Original index of the bus that is coupled to the distribution
+  // federate
+  settings.boundary_id = cursor->get("boundaryBus",2);
+  // Parsed networks are cached in memory so that other applications in
+  // this process do not parse the same file again. If networkSnapshot is
+  // true, the parsed network is also written to a binary snapshot next to
+  // the network configuration file and read from there by later runs
+  settings.network_cache = cursor->get("networkCache",true);
+  settings.network_snapshot = cursor->get("networkSnapshot",false);
+  // A state saved with PFApp::saveState replaces the network configuration
+  // file if it exists and is newer than the configuration file. The
+  // network then starts from the saved, converged voltages
+  settings.state_file = "";
+  cursor->get("stateFile",&settings.state_file);
+  // Amount of output written by each solve: "full" writes the iteration
+  // history and bus and branch tables every step, "interval" only does so
+  // every outputInterval steps, "boundary" writes a single line with the
+  // boundary voltage and "none" writes nothing
+  std::string policy = "full";
+  cursor->get("outputPolicy",&policy);
+  gridpack::utility::StringUtils util;
+  util.toLower(policy);
+  util.trim(policy);
+  if (policy == "none") {
+    settings.output_policy = OUTPUT_NONE;
+  } else if (policy == "boundary") {
+    settings.output_policy = OUTPUT_BOUNDARY;
+  } else if (policy == "interval") {
+    settings.output_policy = OUTPUT_INTERVAL;
+  } else {
+    if (policy != "full" && comm.rank() == 0) {
+      printf("Unknown outputPolicy (%s), using full\n",policy.c_str());
+    }
+    settings.output_policy = OUTPUT_FULL;
+  }
+  settings.output_interval = cursor->get("outputInterval",1);
+  timer->stop(t_config);
+  return true;
+}
+
+/**
+ * Initialize the application on a subset of processes. This allows
+ * several independent power flow problems to be solved concurrently
+ * on different communicators
+ * @param argc number of arguments
+ * @param argv list of character strings
+ * @param comm communicator the network is distributed over
+ * @return false if the input or network configuration file could not
+ *         be found
+ */
+bool gridpack::powerflow::PFApp::initialize(int argc, char** argv,
+    const gridpack::parallel::Communicator &comm)
+{
+  PFSettings settings;
+  if (!readSettings(argc, argv, comm, settings)) return false;
+  return initialize(settings, comm);
+}
+
+/**
+ * Initialize the application from settings that have already been read
+ * from the input file
+ * @param settings parameters from the input file
+ * @param comm communicator the network is distributed over
+ * @return false if the network could not be set up
+ */
+bool gridpack::powerflow::PFApp::initialize(const PFSettings &settings,
+    const gridpack::parallel::Communicator &comm)
+{
+  // Create an instance of a power flow network on the communicator. All
+  // collective operations below only involve processes in comm
+  p_network.reset(new PFNetwork(comm));
+
+  std::string filename = settings.filename;
+  int filetype = settings.filetype;
+  double phaseShiftSign = settings.phase_shift_sign;
+  p_tolerance = settings.tolerance;
+  p_max_iteration = settings.max_iteration;
+  p_warm_start = settings.warm_start;
+  p_jacobian_reuse = settings.jacobian_reuse;
+  p_reuse_ratio = settings.reuse_ratio;
+  p_boundary_ids.clear();
+  p_boundary_ids.push_back(settings.boundary_id);
+  setOutputPolicy(settings.output_policy, settings.output_interval);
+
+  gridpack::powerflow::PFNetworkCache cache(settings.network_snapshot);
+  bool use_cache = settings.network_cache;
 
   // Echo network file name to standard out and create appropriate parser.
   // Parse the file and change the phase shift sign, if necessary. The
   // rank() function on the communicator is used to determine the processor ID
-  if (world.rank() == 0) printf("Network filename: (%s)\n",filename.c_str());
-  if (filetype == PTI23) {
-    if (world.rank() == 0) printf("Using V23 parser\n");
-    gridpack::parser::PTI23_parser<PFNetwork> parser(network);
-    parser.parse(filename.c_str());
-    if (phaseShiftSign == -1.0) {
-      parser.changePhaseShiftSign();
-    }
-  } else if (filetype == PTI33) {
-    if (world.rank() == 0) printf("Using V33 parser\n");
-    gridpack::parser::PTI33_parser<PFNetwork> parser(network);
-    parser.parse(filename.c_str());
-    if (phaseShiftSign == -1.0) {
-      parser.changePhaseShiftSign();
+  if (comm.rank() == 0) printf("Network filename: (%s)\n",filename.c_str());
+  p_timer->start(p_t_parse);
+  p_restored = !settings.state_file.empty() &&
+    NetworkState<PFNetwork>::read(settings.state_file,filename,p_network);
+  if (p_restored) {
+    // Network has been rebuilt from a saved state
+  } else if (use_cache && cache.restore(filename,phaseShiftSign,p_network)) {
+    // Network has been rebuilt from the cache
+  } else {
+    if (filetype == PTI23) {
+      if (comm.rank() == 0) printf("Using V23 parser\n");
+      gridpack::parser::PTI23_parser<PFNetwork> parser(p_network);
+      parser.parse(filename.c_str());
+      if (phaseShiftSign == -1.0) {
+        parser.changePhaseShiftSign();
+      }
+    } else if (filetype == PTI33) {
+      if (comm.rank() == 0) printf("Using V33 parser\n");
+      gridpack::parser::PTI33_parser<PFNetwork> parser(p_network);
+      parser.parse(filename.c_str());
+      if (phaseShiftSign == -1.0) {
+        parser.changePhaseShiftSign();
+      }
     }
+    if (use_cache) cache.store(filename,phaseShiftSign,p_network);
   }
-
-  network->getBusData(1)->setValue(LOAD_PL,Sa.real(),0);
-  network->getBusData(1)->setValue(LOAD_QL,Sa.imag(),0);
+  p_timer->stop(p_t_parse);
 
   // Partition network between processors
-  network->partition();
+  p_timer->start(p_t_partition);
+  p_network->partition();
+  p_timer->stop(p_t_partition);
 
   // Echo number of buses and branches to standard out. This message prints from
   // each processor. These numbers may be different for different processors
-  printf("Process: %d NBUS: %d NBRANCH: %d\n",world.rank(),network->numBuses(),
-      network->numBranches());
+  printf("Process: %d NBUS: %d NBRANCH: %d\n",comm.rank(),p_network->numBuses(),
+      p_network->numBranches());
+
+  // Map original indices of buses owned by this process to local indices.
+  // Only the process that owns a bus modifies its load or reports its
+  // voltage
+  int nbus = p_network->numBuses();
+  int i;
+  p_bus_map.clear();
+  p_modified.clear();
+  for (i=0; i<nbus; i++) {
+    if (p_network->getActiveBus(i)) {
+      p_bus_map[p_network->getOriginalBusIndex(i)] = i;
+    }
+  }
+  setBoundaryBuses(p_boundary_ids);
 
   // Create serial IO object to export data from buses
-  gridpack::serial_io::SerialBusIO<PFNetwork> busIO(8192,network);
+  p_busIO.reset(new gridpack::serial_io::SerialBusIO<PFNetwork>(8192,p_network));
   char ioBuf[128];
 
   // Echo convergence parameters to standard out. The use of the header
   // method in the SerialBusIO class guarantees that the message is only
   // written once to standard out.
-  sprintf(ioBuf,"\nMaximum number of iterations: %d\n",max_iteration);
-  busIO.header(ioBuf);
-  sprintf(ioBuf,"\nConvergence tolerance: %f\n",tolerance);
-  busIO.header(ioBuf);
+  sprintf(ioBuf,"\nMaximum number of iterations: %d\n",p_max_iteration);
+  p_busIO->header(ioBuf);
+  sprintf(ioBuf,"\nConvergence tolerance: %f\n",p_tolerance);
+  p_busIO->header(ioBuf);
 
   // Create factory and call the load method to initialize network components
   // from information in configuration file
-  gridpack::powerflow::PFFactory factory(network);
-  factory.load();
+  p_timer->start(p_t_factory);
+  p_factory.reset(new gridpack::powerflow::PFFactory(p_network));
+  p_factory->load();
 
   // Set network components using factory. This includes defining internal
   // indices that are used in data exchanges and to manage IO
-  factory.setComponents();
+  p_factory->setComponents();
 
   // Set up bus data exchange buffers. The data to be exchanged is defined
   // in the network component classes
-  factory.setExchange();
+  p_factory->setExchange();
 
   // Create bus data exchange. Data exchanges between branches are not needed
   // for this calculation
-  network->initBusUpdate();
-
-  // Create components Y-matrix
-  factory.setYBus();
-
-  // Create components of S vector and print out first iteration count
-  // to standard output
-  factory.setSBus();
-  busIO.header("\nIteration 0\n");
-
-  factory.setMode(RHS); 
-  gridpack::mapper::BusVectorMap<PFNetwork> vMap(network);
-  boost::shared_ptr<gridpack::math::Vector> PQ = vMap.mapToVector();
-  // Create Jacobian matrix
-  factory.setMode(Jacobian);
-  gridpack::mapper::FullMatrixMap<PFNetwork> jMap(network);
-  boost::shared_ptr<gridpack::math::Matrix> J = jMap.mapToMatrix();
-
+  p_network->initBusUpdate();
+  p_timer->stop(p_t_factory);
+
+  // Create components Y-matrix. The Y-matrix only depends on the network
+  // topology and line parameters, so it does not change between solves
+  p_timer->start(p_t_ybus);
+  p_factory->setYBus();
+  p_timer->stop(p_t_ybus);
+
+  // Create components of S vector so that the mappers can be created
+  p_timer->start(p_t_rhs);
+  p_factory->setSBus();
+
+  // Create mappers, RHS vector and Jacobian matrix. The number and location
+  // of non-zero elements does not change between solves, so these objects
+  // are refilled in place by solve
+  p_factory->setMode(RHS); 
+  p_vMap.reset(new gridpack::mapper::BusVectorMap<PFNetwork>(p_network));
+  p_PQ = p_vMap->mapToVector();
   // Create X (solution) vector by cloning PQ
-  boost::shared_ptr<gridpack::math::Vector> X(PQ->clone());
+  p_X.reset(p_PQ->clone());
+  p_timer->stop(p_t_rhs);
+  p_timer->start(p_t_jacobian);
+  p_factory->setMode(Jacobian);
+  p_jMap.reset(new gridpack::mapper::FullMatrixMap<PFNetwork>(p_network));
+  p_J = p_jMap->mapToMatrix();
+
+  // Pack the Y-bus and check the packed assembly against the mappers
+  p_packed = false;
+  if (settings.packed_assembly) {
+    p_factory->setMode(YBus);
+    gridpack::mapper::FullMatrixMap<PFNetwork> yMap(p_network);
+    boost::shared_ptr<gridpack::math::Matrix> Y = yMap.mapToMatrix();
+    p_packed = p_factory->packNetwork(*Y,*p_J) && checkPacked();
+    if (!p_packed && comm.rank() == 0) {
+      printf("Packed assembly does not match the mappers, using the"
+          " network components\n");
+    }
+  }
+  p_timer->stop(p_t_jacobian);
 
   // <latex> The LinearSolver object solves equations of the form
   // $\overline{\overline{A}}\cdot\overline{X}=\overline{B}$ </latex>
   // Create linear solver and configure it with settings from the
   // input file (inside the LinearSolver block)
-  gridpack::math::LinearSolver solver(*J);
-  solver.configure(cursor);
+  p_timer->start(p_t_solve);
+  p_solver.reset(new gridpack::math::LinearSolver(*p_J));
+  p_solver->configure(settings.cursor);
+  p_timer->stop(p_t_solve);
+
+  p_initialized = true;
+  return true;
+}
+
+/**
+ * Change the load on a bus of an initialized network. Only the S vector
+ * entries of modified buses are recomputed by the next solve, so the
+ * cost does not grow with the size of the network
+ * @param bus_id original index of bus
+ * @param S new complex load on the bus
+ * @return false if the bus is not owned by this process
+ */
+bool gridpack::powerflow::PFApp::setLoad(int bus_id,
+    const std::complex<double>& S)
+{
+  std::map<int,int>::iterator it = p_bus_map.find(bus_id);
+  if (it == p_bus_map.end()) return false;
+  int idx = it->second;
+  // Keep the data collection consistent with the bus component so that
+  // later calls to saveData or IO see the same load
+  boost::shared_ptr<gridpack::component::DataCollection>
+    data = p_network->getBusData(idx);
+  data->setValue(LOAD_PL,S.real(),0);
+  data->setValue(LOAD_QL,S.imag(),0);
+  boost::shared_ptr<PFBus> bus = p_network->getBus(idx);
+  std::vector<std::string> load_ids = bus->getLoads();
+  if (load_ids.size() > 0) {
+    bus->setLoadRealPower(load_ids[0],S.real(),data.get());
+    bus->setLoadReactivePower(load_ids[0],S.imag(),data.get());
+  }
+  if (std::find(p_modified.begin(),p_modified.end(),idx) == p_modified.end()) {
+    p_modified.push_back(idx);
+  }
+  return true;
+}
+
+/**
+ * Return the load on a bus of an initialized network, as last set in the
+ * data collection of the bus
+ * @param bus_id original index of bus
+ * @param S (output) complex load on the bus
+ * @return false if the bus is not owned by this process
+ */
+bool gridpack::powerflow::PFApp::getLoad(int bus_id,
+    std::complex<double>& S) const
+{
+  std::map<int,int>::const_iterator it = p_bus_map.find(bus_id);
+  if (it == p_bus_map.end()) return false;
+  boost::shared_ptr<gridpack::component::DataCollection>
+    data = p_network->getBusData(it->second);
+  double pl = 0.0;
+  double ql = 0.0;
+  data->getValue(LOAD_PL,&pl,0);
+  data->getValue(LOAD_QL,&ql,0);
+  S = std::complex<double>(pl,ql);
+  return true;
+}
+
+/**
+ * Solve the power flow for a new load on the boundary bus using the
+ * network created in initialize
+ * @param Vc (output) complex voltage on the boundary bus
+ * @param Sa complex load on the boundary bus
+ * @return true if the Newton-Raphson iterations converged
+ */
+bool gridpack::powerflow::PFApp::solve(std::complex<double>& Vc,
+    const std::complex<double>& Sa)
+{
+  if (!p_initialized) return false;
+  setLoad(p_boundary_ids[0], Sa);
+  bool ret = solve();
+  Vc = p_boundary_v[0];
+  return ret;
+}
+
+/**
+ * Check the packed assembly against the mappers. The specified injections
+ * are packed from the mapped PQ vector at the current state of the
+ * network, and the packed PQ vector and Jacobian are then compared with
+ * the mapped ones at perturbed voltages. This also finds injections that
+ * depend on the voltage, which the packed assembly holds fixed. The
+ * voltages are restored afterwards. Collective
+ * @return true if the packed PQ vector and Jacobian agree with the
+ *         mapped ones
+ */
+bool gridpack::powerflow::PFApp::checkPacked(void)
+{
+  p_factory->packVoltages();
+  p_factory->packInjections(*p_PQ);
+
+  // Perturb the voltages by an amount that only depends on the global bus
+  // index, so that ghost buses agree with their owners
+  int nbus = p_network->numBuses();
+  std::vector<double> vm(nbus), va(nbus);
+  int i;
+  for (i=0; i<nbus; i++) {
+    boost::shared_ptr<PFBus> bus = p_network->getBus(i);
+    vm[i] = bus->getVoltage();
+    va[i] = bus->getPhase();
+    double g = static_cast<double>(p_network->getGlobalBusIndex(i));
+    bus->setVoltage(vm[i]*(1.0+0.02*sin(g+1.0)));
+    bus->setPhase(va[i]+0.05*cos(g+1.0));
+  }
+  p_network->updateBuses();
+
+  // Mapped and packed PQ vectors at the perturbed voltages
+  boost::shared_ptr<gridpack::math::Vector> PQ_map(p_PQ->clone());
+  p_factory->setMode(RHS);
+  p_vMap->mapToVector(PQ_map);
+  p_factory->packVoltages();
+  boost::shared_ptr<gridpack::math::Vector> PQ(p_PQ->clone());
+  p_factory->packedMismatch(*PQ);
+  PQ->add(*PQ_map,-1.0);
+  double scale = std::max(1.0,abs(PQ_map->normInfinity()));
+  bool ok = abs(PQ->normInfinity()) <= 1.0e-8*scale;
+
+  // The Jacobians are compared through their product with a test vector,
+  // starting from a zeroed copy so that missing elements are found
+  boost::shared_ptr<gridpack::math::Matrix> J_map(p_J->clone());
+  p_factory->setMode(Jacobian);
+  p_jMap->mapToMatrix(J_map);
+  boost::shared_ptr<gridpack::math::Matrix> J(p_J->clone());
+  J->zero();
+  p_factory->packedJacobian(*J);
+  boost::shared_ptr<gridpack::math::Vector> x(p_PQ->clone());
+  int lo, hi;
+  x->localIndexRange(lo,hi);
+  for (i=lo; i<hi; i++) {
+    x->setElement(i,ComplexType(1.0+0.5*sin(static_cast<double>(i)),0.0));
+  }
+  x->ready();
+  boost::shared_ptr<gridpack::math::Vector>
+    y_map(gridpack::math::multiply(*J_map,*x));
+  boost::shared_ptr<gridpack::math::Vector>
+    y_packed(gridpack::math::multiply(*J,*x));
+  y_packed->add(*y_map,-1.0);
+  scale = std::max(1.0,abs(y_map->normInfinity()));
+  ok = ok && abs(y_packed->normInfinity()) <= 1.0e-8*scale;
+
+  // Restore the voltages
+  for (i=0; i<nbus; i++) {
+    boost::shared_ptr<PFBus> bus = p_network->getBus(i);
+    bus->setVoltage(vm[i]);
+    bus->setPhase(va[i]);
+  }
+  p_network->updateBuses();
+  return ok;
+}
+
+/**
+ * Refill the PQ vector from the current bus voltages
+ */
+void gridpack::powerflow::PFApp::mapMismatch(void)
+{
+  p_timer->start(p_t_rhs);
+  if (p_packed) {
+    p_factory->packVoltages();
+    p_factory->packedMismatch(*p_PQ);
+  } else {
+    p_factory->setMode(RHS);
+    p_vMap->mapToVector(p_PQ);
+  }
+  p_timer->stop(p_t_rhs);
+}
+
+/**
+ * Refill the Jacobian from the current bus voltages. Must follow
+ * mapMismatch
+ */
+void gridpack::powerflow::PFApp::mapJacobian(void)
+{
+  p_timer->start(p_t_jacobian);
+  if (p_packed) {
+    p_factory->packedJacobian(*p_J);
+  } else {
+    p_factory->setMode(Jacobian);
+    p_jMap->mapToMatrix(p_J);
+  }
+  p_timer->stop(p_t_jacobian);
+}
+
+/**
+ * Solve the power flow for the loads set with setLoad since the last
+ * solve. The voltages on the boundary buses are available from
+ * getBoundaryVoltages afterwards on all processes
+ * @return true if the Newton-Raphson iterations converged
+ */
+bool gridpack::powerflow::PFApp::solve(void)
+{
+  if (!p_initialized) return false;
+  char ioBuf[128];
+  ComplexType tol;
+
+  // Decide whether this step writes iteration history and the full bus and
+  // branch tables. Gathering the tables on process 0 and formatting them
+  // costs more than the solve itself for small networks
+  p_solves++;
+  bool full_output = (p_output_policy == OUTPUT_FULL ||
+      (p_output_policy == OUTPUT_INTERVAL &&
+       (p_solves-1)%p_output_interval == 0));
+
+  // Restart from the voltages in the network configuration file unless
+  // the last solve converged and warm starts are enabled. Consecutive
+  // time steps usually see nearly identical loads, so the previous
+  // solution is already close to the new one
+  p_timer->start(p_t_rhs);
+  if (!p_warm_start || !p_converged) {
+    int nbus = p_network->numBuses();
+    int i;
+    for (i=0; i<nbus; i++) {
+      p_network->getBus(i)->resetVoltage();
+    }
+    p_network->updateBuses();
+  }
+
+  // Recreate the components of the S vector for the buses whose loads
+  // have changed. Print out first iteration count to standard output
+  p_factory->setSBus(p_modified);
+  p_modified.clear();
+  p_timer->stop(p_t_rhs);
+  if (full_output) {
+    p_timer->start(p_t_output);
+    p_busIO->header("\nIteration 0\n");
+    p_timer->stop(p_t_output);
+  }
+
+  // Refill PQ vector and Jacobian matrix for the current state of the
+  // network. If the Jacobian can be reused and this solve starts from the
+  // last converged solution, keep the Jacobian (and factorization) from
+  // the end of the previous solve
+  // The packed assembly takes the specified injections, which setSBus
+  // may have changed, from the mapped PQ vector
+  p_timer->start(p_t_rhs);
+  p_factory->setMode(RHS); 
+  p_vMap->mapToVector(p_PQ);
+  if (p_packed) {
+    p_factory->packVoltages();
+    p_factory->packInjections(*p_PQ);
+  }
+  p_timer->stop(p_t_rhs);
+  int reuse = 0;
+  if (p_jacobian_reuse > 0 && p_warm_start && p_converged) {
+    reuse = 1;
+  } else {
+    mapJacobian();
+    p_factorizations++;
+  }
 
   // Set initial value of the tolerance
-  tol = 2.0*tolerance;
+  tol = 2.0*p_tolerance;
   int iter = 0;
 
   // First iteration of the solver to initialize Newton-Raphson loop
-  X->zero(); //might not need to do this
-  busIO.header("\nCalling solver\n");
-  solver.solve(*PQ, *X);
+  p_X->zero(); //might not need to do this
+  if (full_output) {
+    p_timer->start(p_t_output);
+    p_busIO->header("\nCalling solver\n");
+    p_timer->stop(p_t_output);
+  }
+  p_timer->start(p_t_solve);
+  p_solver->solve(*p_PQ, *p_X);
+  p_timer->stop(p_t_solve);
+  p_linear_solves++;
   // <latex> normInfinity evaluates the norm $N=\max_{i}|X_i|$</latex>
   // The Newton-Raphson algorithm evaluates incremental changes to the solution
   // vector. When the algorithm is done, the RHS vector is zero
-  tol = PQ->normInfinity();
-
+  tol = p_PQ->normInfinity();
 
-  while (real(tol) > tolerance && iter < max_iteration) {
+  while (real(tol) > p_tolerance && iter < p_max_iteration) {
     // Push current values in X vector back into network components
     // This uses setValues method in PFBus class in order to work
-    factory.setMode(RHS);
-    vMap.mapToBus(X);
+    p_timer->start(p_t_rhs);
+    p_factory->setMode(RHS);
+    p_vMap->mapToBus(p_X);
 
     // Exchange data between ghost buses (We don't need to exchange data
     // between branches)
-    network->updateBuses();
-
-    // Update Jacobian and PQ vector with new values
-    vMap.mapToVector(PQ);
-    factory.setMode(Jacobian);
-    jMap.mapToMatrix(J);
+    p_network->updateBuses();
+    p_timer->stop(p_t_rhs);
+
+    // Update PQ vector with new values
+    mapMismatch();
+
+    // Update the Jacobian unless it can be reused. The linear solver only
+    // refactors the matrix when its values change, so iterations that reuse
+    // the Jacobian only cost a forward and back substitution. Refresh it
+    // once the reuse limit is reached or the residual stalls
+    if (reuse < p_jacobian_reuse &&
+        real(p_PQ->normInfinity()) < p_reuse_ratio*real(tol)) {
+      reuse++;
+    } else {
+      mapJacobian();
+      p_factorizations++;
+      reuse = 0;
+    }
 
     // Resolve equations (the solver can be reused since the number and
     // location of non-zero elements is the same)
-    X->zero(); //might not need to do this
-    solver.solve(*PQ, *X);
+    p_X->zero(); //might not need to do this
+    p_timer->start(p_t_solve);
+    p_solver->solve(*p_PQ, *p_X);
+    p_timer->stop(p_t_solve);
+    p_linear_solves++;
 
     // Evaluate norm of residual and print out current iteration to standard
     // out
-    tol = PQ->normInfinity();
-    sprintf(ioBuf,"\nIteration %d Tol: %12.6e\n",iter+1,real(tol));
-    busIO.header(ioBuf);
+    tol = p_PQ->normInfinity();
+    if (full_output) {
+      p_timer->start(p_t_output);
+      sprintf(ioBuf,"\nIteration %d Tol: %12.6e\n",iter+1,real(tol));
+      p_busIO->header(ioBuf);
+      p_timer->stop(p_t_output);
+    }
     iter++;
   }
 
   // Push final result back onto buses so we get the right values printed out to
   // output
-  factory.setMode(RHS);
-  vMap.mapToBus(X);
+  p_timer->start(p_t_rhs);
+  p_factory->setMode(RHS);
+  p_vMap->mapToBus(p_X);
 
   // Make sure that ghost buses have up-to-date values before printing out
   // final results (evaluating power flow on branches requires correct values
   // of voltages on all buses)
-  network->updateBuses();
-
-  // Write out headers and power flow values for all branches
-  gridpack::serial_io::SerialBranchIO<PFNetwork> branchIO(512,network);
-  branchIO.header("\n   Branch Power Flow\n");
-  branchIO.header("\n        Bus 1       Bus 2   CKT         P"
-                  "                    Q\n");
-  // Write branch values
-  branchIO.write();
-
-  // Write out headers and voltage values for all buses
-  busIO.header("\n   Bus Voltages and Phase Angles\n");
-  busIO.header("\n   Bus Number      Phase Angle      Voltage Magnitude\n");
-  // Write bus values values
-  busIO.write();
-
-  Vc = std::polar(network->getBus(1)->getVoltage(),
-		  network->getBus(1)->getPhase());
-
-  // std::cout << "Read Center Bus Voltage: " << network->getBus(0)->getVoltage()<<" pu" << std::endl;
-  //std::cout << "Read Center Bus Phase: " << network->getBus(1)->getPhase() << " deg"<<std::endl;
-
-  /*std::vector<double> pl;
-  std::vector<double> ql;
-  std::vector<int> status;
-  std::vector<std::string> load_ids = network->getBus(2)->getLoads(); 
-  network->getBus(2)->getLoadPower(load_ids, pl, ql, status);
-
-  // Load Values
-  std::cout << "Real Powers Vector : ";
-  for (const double& element : pl) {
-    std::cout << element << " ";
+  p_network->updateBuses();
+  p_timer->stop(p_t_rhs);
+
+  p_timer->start(p_t_output);
+  if (full_output) {
+    // Write out headers and power flow values for all branches
+    gridpack::serial_io::SerialBranchIO<PFNetwork> branchIO(512,p_network);
+    branchIO.header("\n   Branch Power Flow\n");
+    branchIO.header("\n        Bus 1       Bus 2   CKT         P"
+        "                    Q\n");
+    // Write branch values
+    branchIO.write();
+
+    // Write out headers and voltage values for all buses
+    p_busIO->header("\n   Bus Voltages and Phase Angles\n");
+    p_busIO->header("\n   Bus Number      Phase Angle      Voltage Magnitude\n");
+    // Write bus values values
+    p_busIO->write();
   }
-  std::cout << std::endl;
 
-  std::cout << "Reactive Powers Vector : ";
-  for (const double& element : ql) {
-    std::cout << element << " ";
+  // Only the process that owns a boundary bus has its voltage. Sum over
+  // all processes so that every process returns the same values. All
+  // boundary buses are collected in a single reduction
+  int nbnd = p_boundary_ids.size();
+  std::vector<double> vbuf(2*nbnd,0.0);
+  int i;
+  for (i=0; i<nbnd; i++) {
+    if (p_boundary_buses[i] >= 0) {
+      vbuf[2*i] = p_network->getBus(p_boundary_buses[i])->getVoltage();
+      vbuf[2*i+1] = p_network->getBus(p_boundary_buses[i])->getPhase();
+    }
+  }
+  if (nbnd > 0) p_network->communicator().sum(&vbuf[0],2*nbnd);
+  for (i=0; i<nbnd; i++) {
+    p_boundary_v[i] = std::polar(vbuf[2*i],vbuf[2*i+1]);
   }
-  std::cout << std::endl;
 
-  std::cout << "Loads Status : ";
-  for (const double& element : status) {
-    std::cout << element << " ";
+  p_iterations = iter+1;
+  p_converged = real(tol) <= p_tolerance;
+
+  // The boundary voltages are already known on every process, so a short
+  // summary does not need any serial IO
+  if (p_output_policy == OUTPUT_BOUNDARY &&
+      p_network->communicator().rank() == 0) {
+    for (i=0; i<nbnd; i++) {
+      printf("Boundary bus %d voltage: %f angle: %f iterations: %d%s\n",
+          p_boundary_ids[i],vbuf[2*i],vbuf[2*i+1],p_iterations,
+          p_converged ? "" : " (not converged)");
+    }
   }
-  std::cout << std::endl;
+  p_timer->stop(p_t_output);
+  return p_converged;
+}
 
-  double pll = 0.0;
-  double qll = 0.0;
-  network->getBusData(2)->getValue(LOAD_PL,&pll,0);
-  network->getBusData(2)->getValue(LOAD_QL,&qll,0);
+/**
+ * Save the state of the network after a converged solve. The solved
+ * voltages replace the starting voltages in the bus data collections
+ * and the results are written to the data collections with saveData,
+ * so an application initialized from the state starts from the
+ * converged solution. This is a collective operation on the network
+ * communicator
+ * @param filename name of state file
+ * @return false if the last solve did not converge or the state could
+ *         not be written
+ */
+bool gridpack::powerflow::PFApp::saveState(const std::string &filename)
+{
+  if (!p_initialized || !p_converged) return false;
+  int nbus = p_network->numBuses();
+  int nbranch = p_network->numBranches();
+  int i;
+  for (i=0; i<nbus; i++) {
+    boost::shared_ptr<PFBus> bus = p_network->getBus(i);
+    boost::shared_ptr<gridpack::component::DataCollection>
+      data = p_network->getBusData(i);
+    bus->saveData(data);
+    data->setValue(BUS_VOLTAGE_MAG,bus->getVoltage());
+    data->setValue(BUS_VOLTAGE_ANG,bus->getPhase()*180.0/M_PI);
+  }
+  for (i=0; i<nbranch; i++) {
+    p_network->getBranch(i)->saveData(p_network->getBranchData(i));
+  }
+  return NetworkState<PFNetwork>::write(filename,p_network);
+}
 
-  std::cout << "PL: "<< pll << std::endl;
-  std::cout << "QL: "<< qll << std::endl;
+/**
+ * Check if the network was restored from a saved state in initialize
+ * @return true if the network configuration file was not parsed
+ */
+bool gridpack::powerflow::PFApp::restoredState(void) const
+{
+  return p_restored;
+}
 
-  network->getBusData(2)->setValue(LOAD_PL,3.0,0);
-  network->getBusData(2)->setValue(LOAD_QL,6.0,0);
+/**
+ * Set the buses whose voltages are collected after every solve
+ * @param bus_ids original indices of boundary buses
+ */
+void gridpack::powerflow::PFApp::setBoundaryBuses(
+    const std::vector<int> &bus_ids)
+{
+  p_boundary_ids = bus_ids;
+  int nbnd = p_boundary_ids.size();
+  p_boundary_buses.assign(nbnd,-1);
+  p_boundary_v.assign(nbnd,std::complex<double>(0.0,0.0));
+  int i;
+  for (i=0; i<nbnd; i++) {
+    std::map<int,int>::iterator it = p_bus_map.find(p_boundary_ids[i]);
+    if (it != p_bus_map.end()) p_boundary_buses[i] = it->second;
+  }
+}
 
-  network->getBusData(2)->getValue(LOAD_PL,&pll,0);
-  network->getBusData(2)->getValue(LOAD_QL,&qll,0);
+/**
+ * Return the voltages on the boundary buses from the last solve, in the
+ * order the buses were given to setBoundaryBuses
+ * @param V (output) complex voltages on boundary buses
+ */
+void gridpack::powerflow::PFApp::getBoundaryVoltages(
+    std::vector<std::complex<double> > &V) const
+{
+  V = p_boundary_v;
+}
 
-  std::cout << "PL: "<< pll << std::endl;
-  std::cout << "QL: "<< qll << std::endl;
-  */ 
-     
-  
+/**
+ * Set the amount of output written by each call to solve
+ * @param policy one of OUTPUT_NONE, OUTPUT_BOUNDARY, OUTPUT_INTERVAL or
+ *        OUTPUT_FULL
+ * @param interval number of steps between full output if policy is
+ *        OUTPUT_INTERVAL
+ */
+void gridpack::powerflow::PFApp::setOutputPolicy(int policy, int interval)
+{
+  p_output_policy = policy;
+  p_output_interval = interval;
+  if (p_output_interval < 1) p_output_interval = 1;
+}
 
+/**
+ * Return the number of Newton-Raphson iterations (linear solves) used
+ * in the last call to solve
+ * @return number of iterations
+ */
+int gridpack::powerflow::PFApp::getIterationCount(void) const
+{
+  return p_iterations;
+}
 
-  
+/**
+ * Return the number of times the Jacobian has been refilled, and therefore
+ * numerically refactored by the linear solver, since initialize
+ * @return number of factorizations
+ */
+int gridpack::powerflow::PFApp::getFactorizationCount(void) const
+{
+  return p_factorizations;
+}
 
+/**
+ * Return the number of linear solves performed since initialize
+ * @return number of linear solves
+ */
+int gridpack::powerflow::PFApp::getLinearSolveCount(void) const
+{
+  return p_linear_solves;
+}
+
+/**
+ * Start each solve from the last converged solution instead of the
+ * voltages in the network configuration file
+ * @param flag true if solves should be warm-started
+ */
+void gridpack::powerflow::PFApp::setWarmStart(bool flag)
+{
+  p_warm_start = flag;
+}
+
+/**
+ * Execute application. The name of XML-formatted input can be used
+ * as an argument to the executable. The network is initialized on the
+ * first call and reused afterwards
+ * @param argc number of arguments
+ * @param argv list of character strings
+ */
+void gridpack::powerflow::PFApp::execute(int argc,
+					 char** argv,
+					 std::complex<double>& Vc,
+					 std::complex<double>& Sa)
+{
+  if (!p_initialized && !initialize(argc, argv)) return;
+  solve(Vc, Sa);
 }
@@ -18,12 +18,60 @@
 #ifndef _pf_app_h_
 #define _pf_app_h_
 
+#include <map>
+#include <string>
+#include <vector>
 #include "boost/smart_ptr/shared_ptr.hpp"
 #include "pf_factory.hpp"
 
 namespace gridpack {
 namespace powerflow {
 
+/**
+ * Enumerated type to distinguish between different configuration file
+ * formats. PSS/E version 23 and 33 formats are currently supported.
+ */
+enum Parser{PTI23, PTI33};
+
+// Amount of output written by each call to PFApp::solve
+enum PFOutputPolicy{OUTPUT_NONE, OUTPUT_BOUNDARY, OUTPUT_INTERVAL, OUTPUT_FULL};
+
+// Parameters read from the Configuration.Powerflow block of the input file.
+// The input file is read once and the same settings can be used to
+// initialize any number of applications
+struct PFSettings {
+  // Network configuration file and its format (PTI23 or PTI33)
+  std::string filename;
+  int filetype;
+  // Convergence parameters
+  double tolerance;
+  int max_iteration;
+  // Seed each solve with the previous converged voltages
+  bool warm_start;
+  // Jacobian reuse limit and required residual reduction
+  int jacobian_reuse;
+  double reuse_ratio;
+  // Assemble the PQ vector and Jacobian from packed arrays instead of the
+  // mappers, if the packed Jacobian matches the mapped one
+  bool packed_assembly;
+  // Phase shift sign convention of the network configuration file
+  double phase_shift_sign;
+  // Original index of the bus coupled to the distribution federate
+  int boundary_id;
+  // Keep parsed networks in memory and write binary snapshots
+  bool network_cache;
+  bool network_snapshot;
+  // Saved state of a converged network that is used instead of parsing the
+  // network configuration file, if it exists
+  std::string state_file;
+  // Output written by each solve (PFOutputPolicy) and number of steps
+  // between full output for OUTPUT_INTERVAL
+  int output_policy;
+  int output_interval;
+  // Cursor on the Powerflow block. Used to configure the linear solver
+  gridpack::utility::Configuration::CursorPtr cursor;
+};
+
 // Calling program for powerflow application. This file has class definition
 // and methods. 
 
@@ -41,7 +89,124 @@ class PFApp
     ~PFApp(void);
 
     /**
-     * Execute application
+     * Read the Configuration.Powerflow block of the input file. The input
+     * file is opened and echoed to standard out once, so this should be
+     * called at start-up and not on every time step
+     * @param argc number of arguments
+     * @param argv list of character strings
+     * @param comm communicator that reads the input file
+     * @param settings (output) parameters from the input file
+     * @return false if the input file could not be found or does not
+     *         specify a network configuration file
+     */
+    static bool readSettings(int argc, char** argv,
+        const gridpack::parallel::Communicator &comm, PFSettings &settings);
+
+    /**
+     * Read the input file, parse and partition the network and set up the
+     * factory, mappers, Jacobian and linear solver. This only needs to be
+     * called once; the objects are reused by every subsequent call to solve
+     * @param argc number of arguments
+     * @param argv list of character strings
+     * @return false if the input or network configuration file could not
+     *         be found
+     */
+    bool initialize(int argc, char** argv);
+
+    /**
+     * Initialize the application on a subset of processes. This allows
+     * several independent power flow problems to be solved concurrently
+     * on different communicators
+     * @param argc number of arguments
+     * @param argv list of character strings
+     * @param comm communicator the network is distributed over
+     * @return false if the input or network configuration file could not
+     *         be found
+     */
+    bool initialize(int argc, char** argv,
+        const gridpack::parallel::Communicator &comm);
+
+    /**
+     * Initialize the application from settings that have already been read
+     * from the input file
+     * @param settings parameters from the input file
+     * @param comm communicator the network is distributed over
+     * @return false if the network could not be set up
+     */
+    bool initialize(const PFSettings &settings,
+        const gridpack::parallel::Communicator &comm);
+
+    /**
+     * Solve the power flow for a new load on the boundary bus using the
+     * network created in initialize
+     * @param Vc (output) complex voltage on the boundary bus
+     * @param Sa complex load on the boundary bus
+     * @return true if the Newton-Raphson iterations converged
+     */
+    bool solve(std::complex<double>& Vc, const std::complex<double>& Sa);
+
+    /**
+     * Solve the power flow for the loads set with setLoad since the last
+     * solve. The voltages on the boundary buses are available from
+     * getBoundaryVoltages afterwards on all processes
+     * @return true if the Newton-Raphson iterations converged
+     */
+    bool solve(void);
+
+    /**
+     * Set the buses whose voltages are collected after every solve. The
+     * first bus is the one used by solve(Vc, Sa)
+     * @param bus_ids original indices of boundary buses
+     */
+    void setBoundaryBuses(const std::vector<int> &bus_ids);
+
+    /**
+     * Return the voltages on the boundary buses from the last solve, in the
+     * order the buses were given to setBoundaryBuses
+     * @param V (output) complex voltages on boundary buses
+     */
+    void getBoundaryVoltages(std::vector<std::complex<double> > &V) const;
+
+    /**
+     * Return the number of Newton-Raphson iterations (linear solves) used
+     * in the last call to solve
+     * @return number of iterations
+     */
+    int getIterationCount(void) const;
+
+    /**
+     * Return the number of times the Jacobian has been refilled, and
+     * therefore numerically refactored by the linear solver, since
+     * initialize
+     * @return number of factorizations
+     */
+    int getFactorizationCount(void) const;
+
+    /**
+     * Return the number of linear solves performed since initialize
+     * @return number of linear solves
+     */
+    int getLinearSolveCount(void) const;
+
+    /**
+     * Set the amount of output written by each call to solve
+     * @param policy one of OUTPUT_NONE, OUTPUT_BOUNDARY, OUTPUT_INTERVAL or
+     *        OUTPUT_FULL
+     * @param interval number of steps between full output if policy is
+     *        OUTPUT_INTERVAL
+     */
+    void setOutputPolicy(int policy, int interval = 1);
+
+    /**
+     * Start each solve from the last converged solution instead of the
+     * voltages in the network configuration file
+     * @param flag true if solves should be warm-started
+     */
+    void setWarmStart(bool flag);
+
+    /**
+     * Execute application. The network is initialized on the first call
+     * and reused afterwards
      * @param argc number of arguments
      * @param argv list of character strings
      */
@@ -50,7 +215,136 @@ class PFApp
 	       std::complex<double>& Vc,
 	       std::complex<double>& Sa);
 
+    /**
+     * Change the load on a bus of an initialized network. Only the S vector
+     * entries of modified buses are recomputed by the next solve, so the
+     * cost does not grow with the size of the network
+     * @param bus_id original index of bus
+     * @param S new complex load on the bus
+     * @return false if the bus is not owned by this process
+     */
+    bool setLoad(int bus_id, const std::complex<double>& S);
+
+    /**
+     * Return the load on a bus of an initialized network, as last set in
+     * the data collection of the bus
+     * @param bus_id original index of bus
+     * @param S (output) complex load on the bus
+     * @return false if the bus is not owned by this process
+     */
+    bool getLoad(int bus_id, std::complex<double>& S) const;
+
+    /**
+     * Save the state of the network after a converged solve. The solved
+     * voltages replace the starting voltages in the bus data collections
+     * and the results are written to the data collections with saveData,
+     * so an application initialized from the state starts from the
+     * converged solution. This is a collective operation on the network
+     * communicator
+     * @param filename name of state file
+     * @return false if the last solve did not converge or the state could
+     *         not be written
+     */
+    bool saveState(const std::string &filename);
+
+    /**
+     * Check if the network was restored from a saved state in initialize
+     * @return true if the network configuration file was not parsed
+     */
+    bool restoredState(void) const;
+
   private:
+
+    /**
+     * Check the packed assembly against the mappers. The specified
+     * injections are packed from the mapped PQ vector at the current state
+     * of the network, and the packed PQ vector and Jacobian are then
+     * compared with the mapped ones at perturbed voltages. This also finds
+     * injections that depend on the voltage, which the packed assembly
+     * holds fixed. The voltages are restored afterwards. Collective
+     * @return true if the packed PQ vector and Jacobian agree with the
+     *         mapped ones
+     */
+    bool checkPacked(void);
+
+    /**
+     * Refill the PQ vector from the current bus voltages
+     */
+    void mapMismatch(void);
+
+    /**
+     * Refill the Jacobian from the current bus voltages. Must follow
+     * mapMismatch
+     */
+    void mapJacobian(void);
+
+    bool p_initialized;
+
+    // Network was built from a saved state
+    bool p_restored;
+
+    // Convergence parameters from the Powerflow block
+    double p_tolerance;
+    int p_max_iteration;
+
+    // Seed each solve with the previous converged voltages
+    bool p_warm_start;
+
+    // Convergence status and iteration count of the last solve
+    bool p_converged;
+    int p_iterations;
+
+    // Jacobian reuse limit and the residual reduction required to keep
+    // reusing it
+    int p_jacobian_reuse;
+    double p_reuse_ratio;
+
+    // PQ vector and Jacobian are assembled by PFFactory from packed arrays
+    bool p_packed;
+
+    // Cumulative counts of Jacobian refreshes and linear solves
+    int p_factorizations;
+    int p_linear_solves;
+
+    // Original indices of the boundary buses, their local indices on this
+    // process (-1 if the bus is not active on this process) and their
+    // voltages from the last solve
+    std::vector<int> p_boundary_ids;
+    std::vector<int> p_boundary_buses;
+    std::vector<std::complex<double> > p_boundary_v;
+
+    // Map from original bus index to local index for buses owned by this
+    // process and local indices of buses modified since the last solve
+    std::map<int,int> p_bus_map;
+    std::vector<int> p_modified;
+
+    // Output policy, steps between full output and number of solves
+    int p_output_policy;
+    int p_output_interval;
+    int p_solves;
+
+    // Timer categories for the stages of initialize and solve. Categories
+    // are shared by all applications in the process, so the cumulative
+    // times cover every case a federate solves
+    gridpack::utility::CoarseTimer *p_timer;
+    int p_t_parse;
+    int p_t_partition;
+    int p_t_factory;
+    int p_t_ybus;
+    int p_t_rhs;
+    int p_t_jacobian;
+    int p_t_solve;
+    int p_t_output;
+
+    boost::shared_ptr<PFNetwork> p_network;
+    boost::shared_ptr<PFFactory> p_factory;
+    boost::shared_ptr<gridpack::mapper::BusVectorMap<PFNetwork> > p_vMap;
+    boost::shared_ptr<gridpack::mapper::FullMatrixMap<PFNetwork> > p_jMap;
+    boost::shared_ptr<gridpack::math::Vector> p_PQ;
+    boost::shared_ptr<gridpack::math::Vector> p_X;
+    boost::shared_ptr<gridpack::math::Matrix> p_J;
+    boost::shared_ptr<gridpack::math::LinearSolver> p_solver;
+    boost::shared_ptr<gridpack::serial_io::SerialBusIO<PFNetwork> > p_busIO;
 };
 
 } // powerflow
@@ -15,6 +15,8 @@
  */
 // -------------------------------------------------------------
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include "boost/smart_ptr/shared_ptr.hpp"
 #include "gridpack/include/gridpack.hpp"
@@ -34,6 +36,7 @@ PFFactory::PFFactory(PFFactory::NetworkPtr network)
   : gridpack::factory::BaseFactory<PFNetwork>(network)
 {
   p_network = network;
+  p_npack = 0;
 }
 
 /**
@@ -82,5 +85,337 @@ void gridpack::powerflow::PFFactory::setSBus(void)
   }
 }
 
+/**
+ * Update SBus vector components for a subset of buses whose loads or
+ * generation have changed
+ * @param buses local indices of modified buses
+ */
+void gridpack::powerflow::PFFactory::setSBus(const std::vector<int> &buses)
+{
+  int nmod = buses.size();
+  int i;
+
+  // Invoke setSBus method only on modified bus objects
+  for (i=0; i<nmod; i++) {
+    p_network->getBus(buses[i])->setSBus();
+  }
+}
+
+// The packed assembly evaluates the same power flow equations as the
+// components. For bus i with voltage V_i at angle a_i and Y_ij = G_ij+jB_ij
+//   P_i = V_i sum_j V_j (G_ij cos(a_i-a_j) + B_ij sin(a_i-a_j))
+//   Q_i = V_i sum_j V_j (G_ij sin(a_i-a_j) - B_ij cos(a_i-a_j))
+// Each bus has a P row and a Q row and an angle and a magnitude column, in
+// that order, starting at twice its global index. The Q row and magnitude
+// column of PV buses and all rows and columns of fixed buses are replaced
+// by the identity.
+
+/**
+ * Pack the admittances and bus types of the buses owned by this process
+ * into contiguous arrays, so that the PQ vector and Jacobian can be
+ * assembled without calling the network components. Must be called
+ * after setYBus. Collective
+ * @param Y admittance matrix mapped in YBus mode
+ * @param J Jacobian mapped in Jacobian mode
+ * @return false if the rows of an owned bus are not on this process in
+ *         either matrix
+ */
+bool gridpack::powerflow::PFFactory::packNetwork(
+    const gridpack::math::Matrix &Y, const gridpack::math::Matrix &J)
+{
+  int numBus = p_network->numBuses();
+  int numBranch = p_network->numBranches();
+  int i, j, k;
+
+  // Types of all local buses. Reference and isolated buses have fixed
+  // voltages and type 2 buses are only PV buses if a generator is active
+  p_type.assign(numBus,PACKED_PQ);
+  for (i=0; i<numBus; i++) {
+    PFBus *bus = p_network->getBus(i).get();
+    if (bus->getReferenceBus() || bus->isIsolated()) {
+      p_type[i] = PACKED_FIXED;
+      continue;
+    }
+    gridpack::component::DataCollection *data = p_network->getBusData(i).get();
+    int type = 1;
+    data->getValue(BUS_TYPE,&type);
+    if (type != 2) continue;
+    int ngen = 0;
+    data->getValue(GENERATOR_NUMBER,&ngen);
+    for (j=0; j<ngen; j++) {
+      int status = 0;
+      data->getValue(GENERATOR_STAT,&status,j);
+      if (status == 1) {
+        p_type[i] = PACKED_PV;
+        break;
+      }
+    }
+  }
+
+  // Owned buses and the local indices of their neighbors
+  std::vector<int> index(numBus,-1);
+  p_pk_bus.clear();
+  for (i=0; i<numBus; i++) {
+    if (p_network->getActiveBus(i)) {
+      index[i] = p_pk_bus.size();
+      p_pk_bus.push_back(i);
+    }
+  }
+  p_npack = p_pk_bus.size();
+  std::vector<std::vector<int> > nbrs(p_npack);
+  for (i=0; i<numBranch; i++) {
+    int l1, l2;
+    p_network->getBranchEndpoints(i,&l1,&l2);
+    if (index[l1] >= 0) nbrs[index[l1]].push_back(l2);
+    if (index[l2] >= 0) nbrs[index[l2]].push_back(l1);
+  }
+
+  // The Y-bus elements of an owned bus can only be read, and its Jacobian
+  // rows only set, on the process that owns its matrix rows
+  int ylo, yhi, jlo, jhi;
+  Y.localRowRange(ylo,yhi);
+  J.localRowRange(jlo,jhi);
+  p_pk_row.resize(p_npack);
+  int ok = 1;
+  for (k=0; k<p_npack; k++) {
+    int g = p_network->getGlobalBusIndex(p_pk_bus[k]);
+    p_pk_row[k] = 2*g;
+    if (g < ylo || g >= yhi || 2*g < jlo || 2*g+1 >= jhi) ok = 0;
+  }
+  gridpack::parallel::Communicator comm = p_network->communicator();
+  comm.sum(&ok,1);
+  if (ok != comm.size()) {
+    p_npack = 0;
+    return false;
+  }
+
+  // Diagonal and non-zero off-diagonal Y-bus elements. Parallel branches
+  // are already combined in the Y-bus
+  p_pk_g.resize(p_npack);
+  p_pk_b.resize(p_npack);
+  p_pk_start.assign(p_npack+1,0);
+  p_pk_nbr.clear();
+  p_pk_eg.clear();
+  p_pk_eb.clear();
+  ComplexType zero(0.0,0.0);
+  for (k=0; k<p_npack; k++) {
+    int g = p_pk_row[k]/2;
+    ComplexType y;
+    Y.getElement(g,g,y);
+    p_pk_g[k] = real(y);
+    p_pk_b[k] = imag(y);
+    std::sort(nbrs[k].begin(),nbrs[k].end());
+    nbrs[k].erase(std::unique(nbrs[k].begin(),nbrs[k].end()),nbrs[k].end());
+    for (j=0; j<nbrs[k].size(); j++) {
+      int l = nbrs[k][j];
+      Y.getElement(g,p_network->getGlobalBusIndex(l),y);
+      if (y == zero) continue;
+      p_pk_nbr.push_back(l);
+      p_pk_eg.push_back(real(y));
+      p_pk_eb.push_back(imag(y));
+    }
+    p_pk_start[k+1] = p_pk_nbr.size();
+  }
+  int nedge = p_pk_nbr.size();
+  p_pk_vj.resize(nedge);
+  p_pk_dt.resize(nedge);
+  p_pk_ec.resize(nedge);
+  p_pk_es.resize(nedge);
+  p_pk_p.assign(p_npack,0.0);
+  p_pk_q.assign(p_npack,0.0);
+  p_pk_pcal.assign(p_npack,0.0);
+  p_pk_qcal.assign(p_npack,0.0);
+
+  // Vector and matrix locations, in the order the values are assembled.
+  // Within each 2x2 block the order is (P,a), (Q,a), (P,V), (Q,V).
+  // Blocks coupling to a fixed bus are zero and are not set
+  p_pk_vidx.resize(2*p_npack);
+  p_pk_jrow.clear();
+  p_pk_jcol.clear();
+  std::vector<int> cols;
+  for (k=0; k<p_npack; k++) {
+    int row = p_pk_row[k];
+    p_pk_vidx[2*k] = row;
+    p_pk_vidx[2*k+1] = row+1;
+    cols.assign(1,row);
+    if (p_type[p_pk_bus[k]] != PACKED_FIXED) {
+      int p;
+      for (p=p_pk_start[k]; p<p_pk_start[k+1]; p++) {
+        int l = p_pk_nbr[p];
+        if (p_type[l] != PACKED_FIXED) {
+          cols.push_back(2*p_network->getGlobalBusIndex(l));
+        }
+      }
+    }
+    for (j=0; j<cols.size(); j++) {
+      p_pk_jrow.push_back(row);
+      p_pk_jcol.push_back(cols[j]);
+      p_pk_jrow.push_back(row+1);
+      p_pk_jcol.push_back(cols[j]);
+      p_pk_jrow.push_back(row);
+      p_pk_jcol.push_back(cols[j]+1);
+      p_pk_jrow.push_back(row+1);
+      p_pk_jcol.push_back(cols[j]+1);
+    }
+  }
+  p_pk_vval.resize(p_pk_vidx.size());
+  p_pk_jval.resize(p_pk_jrow.size());
+  p_vm.assign(numBus,1.0);
+  p_va.assign(numBus,0.0);
+  return true;
+}
+
+/**
+ * Copy the voltage magnitudes and phase angles of all local buses into
+ * the packed arrays. Ghost buses must be up to date
+ */
+void gridpack::powerflow::PFFactory::packVoltages(void)
+{
+  int numBus = p_network->numBuses();
+  int i;
+  for (i=0; i<numBus; i++) {
+    PFBus *bus = p_network->getBus(i).get();
+    p_vm[i] = bus->getVoltage();
+    p_va[i] = bus->getPhase();
+  }
+}
+
+/**
+ * Compute the power flowing out of every packed bus and the branch terms
+ * of the Jacobian at the packed voltages
+ */
+void gridpack::powerflow::PFFactory::packedInjections(void)
+{
+  int nedge = p_pk_nbr.size();
+  int k, p;
+
+  // Gather the neighbor voltages so the kernel below only works on
+  // contiguous arrays
+  for (k=0; k<p_npack; k++) {
+    double ai = p_va[p_pk_bus[k]];
+    for (p=p_pk_start[k]; p<p_pk_start[k+1]; p++) {
+      int l = p_pk_nbr[p];
+      p_pk_vj[p] = p_vm[l];
+      p_pk_dt[p] = ai-p_va[l];
+    }
+  }
+
+  // Branch terms V_j (G_ij cos + B_ij sin) and V_j (G_ij sin - B_ij cos)
+  const double *eg = nedge > 0 ? &p_pk_eg[0] : 0;
+  const double *eb = nedge > 0 ? &p_pk_eb[0] : 0;
+  const double *vj = nedge > 0 ? &p_pk_vj[0] : 0;
+  const double *dt = nedge > 0 ? &p_pk_dt[0] : 0;
+  double *ec = nedge > 0 ? &p_pk_ec[0] : 0;
+  double *es = nedge > 0 ? &p_pk_es[0] : 0;
+  for (p=0; p<nedge; p++) {
+    double c = cos(dt[p]);
+    double s = sin(dt[p]);
+    ec[p] = vj[p]*(eg[p]*c+eb[p]*s);
+    es[p] = vj[p]*(eg[p]*s-eb[p]*c);
+  }
+
+  // Sum the branch terms of each bus
+  for (k=0; k<p_npack; k++) {
+    double vi = p_vm[p_pk_bus[k]];
+    double sp = p_pk_g[k]*vi;
+    double sq = -p_pk_b[k]*vi;
+    for (p=p_pk_start[k]; p<p_pk_start[k+1]; p++) {
+      sp += ec[p];
+      sq += es[p];
+    }
+    p_pk_pcal[k] = vi*sp;
+    p_pk_qcal[k] = vi*sq;
+  }
+}
+
+/**
+ * Set the specified injections of the packed buses from a PQ vector
+ * mapped from the components at the voltages of the last call to
+ * packVoltages
+ * @param PQ PQ vector from the mapper
+ */
+void gridpack::powerflow::PFFactory::packInjections(
+    const gridpack::math::Vector &PQ)
+{
+  packedInjections();
+  int k;
+  for (k=0; k<p_npack; k++) {
+    ComplexType f;
+    PQ.getElement(p_pk_row[k],f);
+    p_pk_p[k] = p_pk_pcal[k]-real(f);
+    PQ.getElement(p_pk_row[k]+1,f);
+    p_pk_q[k] = p_pk_qcal[k]-real(f);
+  }
+}
+
+/**
+ * Assemble the PQ vector from the packed arrays at the voltages of the
+ * last call to packVoltages
+ * @param PQ vector created by the mapper
+ */
+void gridpack::powerflow::PFFactory::packedMismatch(gridpack::math::Vector &PQ)
+{
+  packedInjections();
+  int k;
+  for (k=0; k<p_npack; k++) {
+    int type = p_type[p_pk_bus[k]];
+    double dp = 0.0;
+    double dq = 0.0;
+    if (type != PACKED_FIXED) dp = p_pk_pcal[k]-p_pk_p[k];
+    if (type == PACKED_PQ) dq = p_pk_qcal[k]-p_pk_q[k];
+    p_pk_vval[2*k] = ComplexType(dp,0.0);
+    p_pk_vval[2*k+1] = ComplexType(dq,0.0);
+  }
+  if (p_npack > 0) {
+    PQ.setElements(2*p_npack,&p_pk_vidx[0],&p_pk_vval[0]);
+  }
+  PQ.ready();
+}
+
+/**
+ * Assemble the Jacobian from the packed arrays. Uses the injections
+ * computed by the last call to packedMismatch or packInjections
+ * @param J matrix created by the mapper
+ */
+void gridpack::powerflow::PFFactory::packedJacobian(gridpack::math::Matrix &J)
+{
+  int n = 0;
+  int k, p;
+  for (k=0; k<p_npack; k++) {
+    int type = p_type[p_pk_bus[k]];
+    if (type == PACKED_FIXED) {
+      p_pk_jval[n++] = ComplexType(1.0,0.0);
+      p_pk_jval[n++] = ComplexType(0.0,0.0);
+      p_pk_jval[n++] = ComplexType(0.0,0.0);
+      p_pk_jval[n++] = ComplexType(1.0,0.0);
+      continue;
+    }
+    bool pq = (type == PACKED_PQ);
+    double vi = p_vm[p_pk_bus[k]];
+    double pi = p_pk_pcal[k];
+    double qi = p_pk_qcal[k];
+    double g = p_pk_g[k];
+    double b = p_pk_b[k];
+    p_pk_jval[n++] = ComplexType(-qi-b*vi*vi,0.0);
+    p_pk_jval[n++] = ComplexType(pq ? pi-g*vi*vi : 0.0,0.0);
+    p_pk_jval[n++] = ComplexType(pq ? pi/vi+g*vi : 0.0,0.0);
+    p_pk_jval[n++] = ComplexType(pq ? qi/vi-b*vi : 1.0,0.0);
+    for (p=p_pk_start[k]; p<p_pk_start[k+1]; p++) {
+      int jtype = p_type[p_pk_nbr[p]];
+      if (jtype == PACKED_FIXED) continue;
+      bool jpq = (jtype == PACKED_PQ);
+      double ec = p_pk_ec[p];
+      double es = p_pk_es[p];
+      double vj = p_pk_vj[p];
+      p_pk_jval[n++] = ComplexType(vi*es,0.0);
+      p_pk_jval[n++] = ComplexType(pq ? -vi*ec : 0.0,0.0);
+      p_pk_jval[n++] = ComplexType(jpq ? vi*ec/vj : 0.0,0.0);
+      p_pk_jval[n++] = ComplexType(pq && jpq ? vi*es/vj : 0.0,0.0);
+    }
+  }
+  if (n > 0) J.setElements(n,&p_pk_jrow[0],&p_pk_jcol[0],&p_pk_jval[0]);
+  J.ready();
+}
+
 } // namespace powerflow
 } // namespace gridpack
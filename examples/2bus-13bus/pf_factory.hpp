@@ -18,6 +18,7 @@
 #ifndef _pf_factory_h_
 #define _pf_factory_h_
 
+#include <vector>
 #include "boost/smart_ptr/shared_ptr.hpp"
 #include "gridpack/include/gridpack.hpp"
 #include "gridpack/applications/components/pf_matrix/pf_components.hpp"
@@ -52,9 +53,88 @@ class PFFactory
      */
     void setSBus(void);
 
+    /**
+     * Update SBus vector components for a subset of buses whose loads or
+     * generation have changed
+     * @param buses local indices of modified buses
+     */
+    void setSBus(const std::vector<int> &buses);
+
+    /**
+     * Pack the admittances and bus types of the buses owned by this process
+     * into contiguous arrays, so that the PQ vector and Jacobian can be
+     * assembled without calling the network components. Must be called
+     * after setYBus. Collective
+     * @param Y admittance matrix mapped in YBus mode
+     * @param J Jacobian mapped in Jacobian mode
+     * @return false if the rows of an owned bus are not on this process in
+     *         either matrix
+     */
+    bool packNetwork(const gridpack::math::Matrix &Y,
+        const gridpack::math::Matrix &J);
+
+    /**
+     * Copy the voltage magnitudes and phase angles of all local buses into
+     * the packed arrays. Ghost buses must be up to date
+     */
+    void packVoltages(void);
+
+    /**
+     * Set the specified injections of the packed buses from a PQ vector
+     * mapped from the components at the voltages of the last call to
+     * packVoltages
+     * @param PQ PQ vector from the mapper
+     */
+    void packInjections(const gridpack::math::Vector &PQ);
+
+    /**
+     * Assemble the PQ vector from the packed arrays at the voltages of the
+     * last call to packVoltages
+     * @param PQ vector created by the mapper
+     */
+    void packedMismatch(gridpack::math::Vector &PQ);
+
+    /**
+     * Assemble the Jacobian from the packed arrays. Uses the injections
+     * computed by the last call to packedMismatch or packInjections
+     * @param J matrix created by the mapper
+     */
+    void packedJacobian(gridpack::math::Matrix &J);
+
   private:
 
+    /**
+     * Compute the power flowing out of every packed bus and the branch
+     * terms of the Jacobian at the packed voltages
+     */
+    void packedInjections(void);
+
     NetworkPtr p_network;
+
+    // Packed assembly. Owned buses are numbered 0..p_npack-1 and their
+    // neighbors, one per non-zero off-diagonal Y-bus element, are stored
+    // in compressed rows starting at p_pk_start. Voltages and types are
+    // stored for all local buses, since neighbors may be ghost buses
+    enum PackedType{PACKED_PQ, PACKED_PV, PACKED_FIXED};
+    int p_npack;
+    std::vector<int> p_pk_bus;
+    std::vector<int> p_pk_row;
+    std::vector<double> p_pk_g, p_pk_b;
+    std::vector<double> p_pk_p, p_pk_q;
+    std::vector<double> p_pk_pcal, p_pk_qcal;
+    std::vector<int> p_pk_start;
+    std::vector<int> p_pk_nbr;
+    std::vector<double> p_pk_eg, p_pk_eb;
+    std::vector<double> p_pk_vj, p_pk_dt;
+    std::vector<double> p_pk_ec, p_pk_es;
+    std::vector<double> p_vm, p_va;
+    std::vector<int> p_type;
+    // Vector and matrix locations of the assembled values, fixed by
+    // packNetwork, and the values themselves
+    std::vector<int> p_pk_vidx;
+    std::vector<int> p_pk_jrow, p_pk_jcol;
+    std::vector<ComplexType> p_pk_vval;
+    std::vector<ComplexType> p_pk_jval;
 };
 
 } // powerflow
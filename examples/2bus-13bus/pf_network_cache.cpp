@@ -0,0 +1,282 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   pf_network_cache.cpp
+ *
+ * @brief  Cache of parsed network configuration files
+ *
+ */
+// -------------------------------------------------------------
+
+#include <map>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "boost/smart_ptr/shared_ptr.hpp"
+#include "boost/archive/binary_oarchive.hpp"
+#include "boost/archive/binary_iarchive.hpp"
+#include "boost/iostreams/device/array.hpp"
+#include "boost/iostreams/stream.hpp"
+#include "gridpack/include/gridpack.hpp"
+#include "pf_network_cache.hpp"
+
+// Identifies a serialized network and the layout of its records. Change
+// the version if the layout is modified so that old snapshots are ignored
+#define PF_CACHE_MAGIC 0x47504b4e
+#define PF_CACHE_VERSION 1
+
+namespace gridpack {
+namespace powerflow {
+
+/**
+ * Basic constructor
+ * @param snapshot: read and write binary snapshots of parsed networks
+ */
+PFNetworkCache::PFNetworkCache(bool snapshot)
+{
+  p_snapshot = snapshot;
+}
+
+/**
+ * Basic destructor
+ */
+PFNetworkCache::~PFNetworkCache()
+{
+}
+
+/**
+ * Serialized networks held by this process, indexed by snapshot name
+ */
+std::map<std::string, std::string> &PFNetworkCache::buffers()
+{
+  static std::map<std::string, std::string> cache;
+  return cache;
+}
+
+/**
+ * Name of the binary snapshot for a network configuration file
+ * @param filename: name of network configuration file
+ * @param phaseShiftSign: phase shift sign convention applied after parsing
+ * @return snapshot file name
+ */
+std::string PFNetworkCache::snapshotName(const std::string &filename,
+    double phaseShiftSign)
+{
+  // The phase shift sign is applied to the parsed data, so networks with
+  // different conventions are cached separately
+  if (phaseShiftSign == -1.0) {
+    return filename + ".neg.gpkbin";
+  }
+  return filename + ".gpkbin";
+}
+
+/**
+ * Fill an empty, unpartitioned network from the cache instead of
+ * parsing the network configuration file. The in-memory cache is
+ * checked first, followed by the binary snapshot if snapshots are
+ * enabled and the snapshot is newer than the configuration file. This
+ * is a collective operation on the network communicator
+ * @param filename: name of network configuration file
+ * @param phaseShiftSign: phase shift sign convention applied after parsing
+ * @param network: network to fill
+ * @return true if the network was filled from the cache
+ */
+bool PFNetworkCache::restore(const std::string &filename,
+    double phaseShiftSign, NetworkPtr network)
+{
+  const gridpack::parallel::Communicator &comm = network->communicator();
+  std::string name = snapshotName(filename, phaseShiftSign);
+  // The parsers read the whole file on process 0 and the network is
+  // distributed when it is partitioned, so only process 0 holds data
+  int found = 0;
+  if (comm.rank() == 0) {
+    std::map<std::string, std::string>::iterator it = buffers().find(name);
+    if (it != buffers().end()) {
+      if (deserialize(it->second.data(), it->second.size(), network)) {
+        found = 1;
+        printf("Network restored from memory: (%s)\n",filename.c_str());
+      }
+    } else if (p_snapshot) {
+      if (readSnapshot(name, filename, network)) {
+        found = 1;
+        printf("Network restored from snapshot: (%s)\n",name.c_str());
+      }
+    }
+  }
+  // The decision to parse the file is made on process 0 and must be the
+  // same on all processes
+  comm.sum(&found,1);
+  return (found > 0);
+}
+
+/**
+ * Add a network that has just been parsed to the cache. This must be
+ * called before the network is partitioned. If snapshots are enabled,
+ * the binary snapshot is also written to disk. This is a collective
+ * operation on the network communicator
+ * @param filename: name of network configuration file
+ * @param phaseShiftSign: phase shift sign convention applied after parsing
+ * @param network: parsed network
+ */
+void PFNetworkCache::store(const std::string &filename,
+    double phaseShiftSign, NetworkPtr network)
+{
+  const gridpack::parallel::Communicator &comm = network->communicator();
+  if (comm.rank() == 0) {
+    std::string name = snapshotName(filename, phaseShiftSign);
+    std::string &buffer = buffers()[name];
+    serialize(network, buffer);
+    if (p_snapshot) {
+      // Write to a temporary file and rename it so that a process reading
+      // the snapshot never sees a partial file. The temporary file is
+      // unique to the process, since the members of an ensemble may all
+      // write the same snapshot at once
+      std::ostringstream tmp_name;
+      tmp_name << name << "." << getpid() << ".tmp";
+      std::string tmp = tmp_name.str();
+      std::ofstream out(tmp.c_str(), std::ios::out | std::ios::binary);
+      out.write(buffer.data(), buffer.size());
+      out.close();
+      if (out.fail() || rename(tmp.c_str(), name.c_str()) != 0) {
+        printf("Unable to write network snapshot: (%s)\n",name.c_str());
+        remove(tmp.c_str());
+      }
+    }
+  }
+  comm.barrier();
+}
+
+/**
+ * Serialize the buses and branches held on this process
+ * @param network: parsed network
+ * @param buffer: serialized network
+ */
+void PFNetworkCache::serialize(NetworkPtr network, std::string &buffer)
+{
+  std::ostringstream os(std::ios::out | std::ios::binary);
+  {
+    boost::archive::binary_oarchive ar(os);
+    int magic = PF_CACHE_MAGIC;
+    int version = PF_CACHE_VERSION;
+    ar & magic & version;
+    int i;
+    int nbus = network->numBuses();
+    ar & nbus;
+    for (i=0; i<nbus; i++) {
+      int idx = network->getOriginalBusIndex(i);
+      int gidx = network->getGlobalBusIndex(i);
+      ar & idx & gidx;
+      ar & *(network->getBusData(i));
+    }
+    int nbranch = network->numBranches();
+    ar & nbranch;
+    for (i=0; i<nbranch; i++) {
+      int idx1, idx2;
+      network->getOriginalBranchEndpoints(i,&idx1,&idx2);
+      int gidx = network->getGlobalBranchIndex(i);
+      ar & idx1 & idx2 & gidx;
+      ar & *(network->getBranchData(i));
+    }
+  }
+  buffer = os.str();
+}
+
+/**
+ * Rebuild buses and branches from a serialized network
+ * @param buffer: start of serialized network
+ * @param size: length of serialized network in bytes
+ * @param network: empty network to fill
+ * @return false if the buffer could not be read
+ */
+bool PFNetworkCache::deserialize(const char *buffer, size_t size,
+    NetworkPtr network)
+{
+  boost::iostreams::stream<boost::iostreams::array_source> is(buffer, size);
+  try {
+    boost::archive::binary_iarchive ar(is);
+    int magic, version;
+    ar & magic & version;
+    if (magic != PF_CACHE_MAGIC || version != PF_CACHE_VERSION) {
+      return false;
+    }
+    // Buses and branches are added in the same way as in the PTI parsers.
+    // Neighbor lists are constructed when the network is partitioned
+    int i;
+    std::map<int,int> local;
+    int nbus;
+    ar & nbus;
+    for (i=0; i<nbus; i++) {
+      int idx, gidx;
+      ar & idx & gidx;
+      network->addBus(idx);
+      network->setGlobalBusIndex(i,gidx);
+      ar & *(network->getBusData(i));
+      local.insert(std::pair<int,int>(idx,i));
+    }
+    int nbranch;
+    ar & nbranch;
+    for (i=0; i<nbranch; i++) {
+      int idx1, idx2, gidx;
+      ar & idx1 & idx2 & gidx;
+      int l_idx1 = local[idx1];
+      int l_idx2 = local[idx2];
+      network->addBranch(idx1,idx2);
+      network->setGlobalBranchIndex(i,gidx);
+      network->setLocalBusIndex1(i,l_idx1);
+      network->setLocalBusIndex2(i,l_idx2);
+      network->setGlobalBusIndex1(i,network->getGlobalBusIndex(l_idx1));
+      network->setGlobalBusIndex2(i,network->getGlobalBusIndex(l_idx2));
+      ar & *(network->getBranchData(i));
+    }
+  } catch (std::exception &e) {
+    printf("Unable to read cached network: %s\n",e.what());
+    network->clear();
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Fill a network by memory-mapping its binary snapshot. The snapshot
+ * is also copied to the in-memory cache
+ * @param name: snapshot file name
+ * @param filename: network configuration file the snapshot came from
+ * @param network: empty network to fill
+ * @return false if snapshot does not exist, is older than filename or
+ *         could not be read
+ */
+bool PFNetworkCache::readSnapshot(const std::string &name,
+    const std::string &filename, NetworkPtr network)
+{
+  struct stat raw_stat, bin_stat;
+  if (stat(filename.c_str(), &raw_stat) != 0) return false;
+  if (stat(name.c_str(), &bin_stat) != 0) return false;
+  // Ignore snapshots of files that have been modified since the snapshot
+  // was written
+  if (bin_stat.st_mtime < raw_stat.st_mtime) return false;
+  if (bin_stat.st_size == 0) return false;
+
+  int fd = open(name.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  size_t size = bin_stat.st_size;
+  void *addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) return false;
+  const char *buffer = static_cast<const char*>(addr);
+  bool ok = deserialize(buffer, size, network);
+  if (ok) buffers()[name].assign(buffer, size);
+  munmap(addr, size);
+  return ok;
+}
+
+} // powerflow
+} // gridpack
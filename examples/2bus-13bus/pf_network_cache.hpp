@@ -0,0 +1,122 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   pf_network_cache.hpp
+ *
+ * @brief  Cache of parsed network configuration files. The bus and branch
+ *         DataCollections produced by the PTI parsers are kept in memory so
+ *         that later applications in the same process do not parse the file
+ *         again, and can optionally be written to a binary snapshot next to
+ *         the network configuration file so that a restarted process can
+ *         memory-map it instead of tokenizing the text file.
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _pf_network_cache_h_
+#define _pf_network_cache_h_
+
+#include <map>
+#include <string>
+#include "boost/smart_ptr/shared_ptr.hpp"
+#include "gridpack/include/gridpack.hpp"
+#include "pf_factory.hpp"
+
+namespace gridpack {
+namespace powerflow {
+
+class PFNetworkCache {
+  public:
+    typedef boost::shared_ptr<PFNetwork> NetworkPtr;
+
+    /**
+     * Basic constructor
+     * @param snapshot: read and write binary snapshots of parsed networks
+     */
+    PFNetworkCache(bool snapshot = false);
+
+    /**
+     * Basic destructor
+     */
+    ~PFNetworkCache();
+
+    /**
+     * Fill an empty, unpartitioned network from the cache instead of
+     * parsing the network configuration file. The in-memory cache is
+     * checked first, followed by the binary snapshot if snapshots are
+     * enabled and the snapshot is newer than the configuration file. This
+     * is a collective operation on the network communicator
+     * @param filename: name of network configuration file
+     * @param phaseShiftSign: phase shift sign convention applied after parsing
+     * @param network: network to fill
+     * @return true if the network was filled from the cache
+     */
+    bool restore(const std::string &filename, double phaseShiftSign,
+        NetworkPtr network);
+
+    /**
+     * Add a network that has just been parsed to the cache. This must be
+     * called before the network is partitioned. If snapshots are enabled,
+     * the binary snapshot is also written to disk. This is a collective
+     * operation on the network communicator
+     * @param filename: name of network configuration file
+     * @param phaseShiftSign: phase shift sign convention applied after parsing
+     * @param network: parsed network
+     */
+    void store(const std::string &filename, double phaseShiftSign,
+        NetworkPtr network);
+
+    /**
+     * Name of the binary snapshot for a network configuration file
+     * @param filename: name of network configuration file
+     * @param phaseShiftSign: phase shift sign convention applied after parsing
+     * @return snapshot file name
+     */
+    static std::string snapshotName(const std::string &filename,
+        double phaseShiftSign);
+
+  private:
+
+    /**
+     * Serialize the buses and branches held on this process
+     * @param network: parsed network
+     * @param buffer: serialized network
+     */
+    void serialize(NetworkPtr network, std::string &buffer);
+
+    /**
+     * Rebuild buses and branches from a serialized network
+     * @param buffer: start of serialized network
+     * @param size: length of serialized network in bytes
+     * @param network: empty network to fill
+     * @return false if the buffer could not be read
+     */
+    bool deserialize(const char *buffer, size_t size, NetworkPtr network);
+
+    /**
+     * Fill a network by memory-mapping its binary snapshot. The snapshot
+     * is also copied to the in-memory cache
+     * @param name: snapshot file name
+     * @param filename: network configuration file the snapshot came from
+     * @param network: empty network to fill
+     * @return false if snapshot does not exist, is older than filename or
+     *         could not be read
+     */
+    bool readSnapshot(const std::string &name, const std::string &filename,
+        NetworkPtr network);
+
+    /**
+     * Serialized networks held by this process, indexed by snapshot name
+     */
+    static std::map<std::string, std::string> &buffers();
+
+    bool p_snapshot;
+};
+
+} // powerflow
+} // gridpack
+#endif
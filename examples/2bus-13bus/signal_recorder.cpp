@@ -0,0 +1,150 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   signal_recorder.cpp
+ *
+ * @brief  Time-series recorder for co-simulation boundary signals
+ *
+ */
+// -------------------------------------------------------------
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "signal_recorder.hpp"
+
+// Maximum length of one formatted CSV value, including the separator
+#define SIGNAL_FIELD_LEN 32
+
+namespace gridpack {
+namespace powerflow {
+
+/**
+ * Basic constructor
+ * @param columns names of the recorded signals
+ * @param flush_rows number of steps held in memory between writes
+ * @param binary write binary blocks instead of CSV text
+ */
+SignalRecorder::SignalRecorder(const std::vector<std::string> &columns,
+    int flush_rows, bool binary)
+{
+  p_names = columns;
+  p_flush_rows = flush_rows;
+  if (p_flush_rows < 1) p_flush_rows = 1;
+  p_nrows = 0;
+  p_binary = binary;
+  p_file = NULL;
+  int i;
+  int ncol = p_names.size();
+  p_columns.resize(ncol);
+  for (i=0; i<ncol; i++) {
+    p_columns[i].resize(p_flush_rows);
+  }
+  if (!p_binary) {
+    p_text.resize(p_flush_rows*ncol*SIGNAL_FIELD_LEN+1);
+  }
+}
+
+/**
+ * Basic destructor. Any buffered steps are written out
+ */
+SignalRecorder::~SignalRecorder(void)
+{
+  close();
+}
+
+/**
+ * Open the output file and write the file header
+ * @param filename name of output file
+ * @return false if the file could not be opened
+ */
+bool SignalRecorder::open(const std::string &filename)
+{
+  close();
+  p_file = fopen(filename.c_str(), p_binary ? "wb" : "w");
+  if (p_file == NULL) return false;
+  int i;
+  int ncol = p_names.size();
+  if (p_binary) {
+    fwrite("GPKSIG01",1,8,p_file);
+    int len = ncol;
+    fwrite(&len,sizeof(int),1,p_file);
+    for (i=0; i<ncol; i++) {
+      len = p_names[i].size();
+      fwrite(&len,sizeof(int),1,p_file);
+      fwrite(p_names[i].data(),1,len,p_file);
+    }
+  } else {
+    for (i=0; i<ncol; i++) {
+      fprintf(p_file,"%s%s",p_names[i].c_str(),i<ncol-1 ? "," : "\n");
+    }
+  }
+  return true;
+}
+
+/**
+ * Record the signals for one step. Values are copied to the column
+ * buffers and only written once the buffers are full
+ * @param values one value for each column
+ */
+void SignalRecorder::record(const double *values)
+{
+  int i;
+  int ncol = p_columns.size();
+  for (i=0; i<ncol; i++) {
+    p_columns[i][p_nrows] = values[i];
+  }
+  p_nrows++;
+  if (p_nrows == p_flush_rows) flush();
+}
+
+/**
+ * Write all buffered steps to the output file
+ */
+void SignalRecorder::flush(void)
+{
+  if (p_file == NULL || p_nrows == 0) {
+    p_nrows = 0;
+    return;
+  }
+  int i, j;
+  int ncol = p_columns.size();
+  if (p_binary) {
+    fwrite(&p_nrows,sizeof(int),1,p_file);
+    for (i=0; i<ncol; i++) {
+      fwrite(&p_columns[i][0],sizeof(double),p_nrows,p_file);
+    }
+  } else {
+    // Format the whole block into one buffer so that it is written with a
+    // single call
+    char *ptr = &p_text[0];
+    for (j=0; j<p_nrows; j++) {
+      for (i=0; i<ncol; i++) {
+        ptr += snprintf(ptr,SIGNAL_FIELD_LEN,"%.10g%c",p_columns[i][j],
+            i<ncol-1 ? ',' : '\n');
+      }
+    }
+    fwrite(&p_text[0],1,ptr-&p_text[0],p_file);
+  }
+  fflush(p_file);
+  p_nrows = 0;
+}
+
+/**
+ * Flush buffered steps and close the output file
+ */
+void SignalRecorder::close(void)
+{
+  if (p_file == NULL) return;
+  flush();
+  fclose(p_file);
+  p_file = NULL;
+}
+
+} // powerflow
+} // gridpack
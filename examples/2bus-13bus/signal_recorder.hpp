@@ -0,0 +1,95 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   signal_recorder.hpp
+ *
+ * @brief  Time-series recorder for co-simulation boundary signals. Values
+ *         are accumulated in preallocated column buffers and written to
+ *         disk in large blocks, so the cost of recording a step does not
+ *         depend on the formatting or the number of steps.
+ *
+ *         Two file formats are supported. CSV files have a header line
+ *         with the column names followed by one line per step. Binary files
+ *         start with the 8 character tag "GPKSIG01", a 32 bit column count
+ *         and, for each column, a 32 bit name length followed by the name.
+ *         The rest of the file is a sequence of blocks, each holding a 32
+ *         bit row count followed by the values of each column in turn as
+ *         native doubles.
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _signal_recorder_h_
+#define _signal_recorder_h_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace gridpack {
+namespace powerflow {
+
+class SignalRecorder {
+  public:
+    /**
+     * Basic constructor
+     * @param columns names of the recorded signals
+     * @param flush_rows number of steps held in memory between writes
+     * @param binary write binary blocks instead of CSV text
+     */
+    SignalRecorder(const std::vector<std::string> &columns, int flush_rows,
+        bool binary);
+
+    /**
+     * Basic destructor. Any buffered steps are written out
+     */
+    ~SignalRecorder(void);
+
+    /**
+     * Open the output file and write the file header
+     * @param filename name of output file
+     * @return false if the file could not be opened
+     */
+    bool open(const std::string &filename);
+
+    /**
+     * Record the signals for one step. Values are copied to the column
+     * buffers and only written once the buffers are full
+     * @param values one value for each column
+     */
+    void record(const double *values);
+
+    /**
+     * Write all buffered steps to the output file
+     */
+    void flush(void);
+
+    /**
+     * Flush buffered steps and close the output file
+     */
+    void close(void);
+
+  private:
+
+    std::vector<std::string> p_names;
+
+    // Column buffers, each with room for p_flush_rows steps, and the
+    // number of steps currently buffered
+    std::vector<std::vector<double> > p_columns;
+    int p_flush_rows;
+    int p_nrows;
+
+    bool p_binary;
+    FILE *p_file;
+
+    // Scratch space used to format a block of CSV text
+    std::vector<char> p_text;
+};
+
+} // powerflow
+} // gridpack
+#endif
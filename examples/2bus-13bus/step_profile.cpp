@@ -0,0 +1,149 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   step_profile.cpp
+ *
+ * @brief  Per-step latency profile of a co-simulation loop
+ *
+ */
+// -------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "mpi.h"
+#include "step_profile.hpp"
+
+namespace gridpack {
+namespace powerflow {
+
+/**
+ * Basic constructor
+ * @param name label of the scenario in the report
+ * @param phases names of the phases of a step
+ * @param max_steps number of steps that can be recorded
+ */
+StepProfile::StepProfile(const std::string &name,
+    const std::vector<std::string> &phases, int max_steps)
+{
+  p_name = name;
+  p_phases = phases;
+  p_max_steps = max_steps;
+  if (p_max_steps < 0) p_max_steps = 0;
+  p_nsteps = 0;
+  p_times.assign(p_phases.size()*p_max_steps,0.0);
+  p_last = MPI_Wtime();
+}
+
+/**
+ * Basic destructor
+ */
+StepProfile::~StepProfile(void)
+{
+}
+
+/**
+ * Start timing a new step
+ */
+void StepProfile::startStep(void)
+{
+  p_last = MPI_Wtime();
+}
+
+/**
+ * Charge the time since the start of the step or the last call to
+ * mark to a phase
+ * @param phase index of phase
+ */
+void StepProfile::mark(int phase)
+{
+  double now = MPI_Wtime();
+  if (p_nsteps < p_max_steps) {
+    p_times[phase*p_max_steps+p_nsteps] += now-p_last;
+  }
+  p_last = now;
+}
+
+/**
+ * Finish the current step. Steps beyond max_steps are not recorded
+ */
+void StepProfile::endStep(void)
+{
+  if (p_nsteps < p_max_steps) p_nsteps++;
+}
+
+/**
+ * Return the number of recorded steps
+ * @return number of steps
+ */
+int StepProfile::getSteps(void) const
+{
+  return p_nsteps;
+}
+
+/**
+ * Write the profile as a JSON object with the mean, median, 99th
+ * percentile and maximum time (microseconds) of each phase and of the
+ * whole step
+ * @param file open output file
+ * @param indent number of spaces to indent the object by
+ */
+void StepProfile::writeJSON(FILE *file, int indent) const
+{
+  int i, j;
+  int nphase = p_phases.size();
+  std::string pad(indent,' ');
+  fprintf(file,"%s{\n",pad.c_str());
+  fprintf(file,"%s  \"name\" : \"%s\",\n",pad.c_str(),p_name.c_str());
+  fprintf(file,"%s  \"steps\" : %d,\n",pad.c_str(),p_nsteps);
+  fprintf(file,"%s  \"phases\" : {\n",pad.c_str());
+  std::vector<double> total(p_nsteps,0.0);
+  for (i=0; i<nphase; i++) {
+    std::vector<double> samples(p_times.begin()+i*p_max_steps,
+        p_times.begin()+i*p_max_steps+p_nsteps);
+    for (j=0; j<p_nsteps; j++) total[j] += samples[j];
+    writeStats(file,p_phases[i],samples,indent+4,i==nphase-1);
+  }
+  fprintf(file,"%s  },\n",pad.c_str());
+  writeStats(file,"step",total,indent+2,true);
+  fprintf(file,"%s}",pad.c_str());
+}
+
+/**
+ * Write the statistics of one set of samples
+ * @param file open output file
+ * @param name label of samples
+ * @param samples time of each step (s)
+ * @param indent number of spaces to indent by
+ * @param last true if this is the last entry of the enclosing object
+ */
+void StepProfile::writeStats(FILE *file, const std::string &name,
+    std::vector<double> samples, int indent, bool last) const
+{
+  int i;
+  int n = samples.size();
+  double mean = 0.0;
+  double p50 = 0.0;
+  double p99 = 0.0;
+  double max = 0.0;
+  if (n > 0) {
+    for (i=0; i<n; i++) mean += samples[i];
+    mean /= static_cast<double>(n);
+    std::sort(samples.begin(),samples.end());
+    p50 = samples[n/2];
+    p99 = samples[(n*99)/100];
+    max = samples[n-1];
+  }
+  std::string pad(indent,' ');
+  fprintf(file,"%s\"%s\" : { \"mean\" : %.3f, \"p50\" : %.3f,"
+      " \"p99\" : %.3f, \"max\" : %.3f }%s\n",pad.c_str(),name.c_str(),
+      1.0e6*mean,1.0e6*p50,1.0e6*p99,1.0e6*max,last ? "" : ",");
+}
+
+} // powerflow
+} // gridpack
@@ -0,0 +1,105 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   step_profile.hpp
+ *
+ * @brief  Per-step latency profile of a co-simulation loop. Each step is
+ *         split into phases (e.g. broker wait, input decode, solve, output
+ *         publish and logging) and the wall clock time of every phase is
+ *         kept for every step, so that percentiles can be reported at the
+ *         end of the run. Storage for all steps is allocated up front and
+ *         recording a phase only reads the clock.
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _step_profile_h_
+#define _step_profile_h_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace gridpack {
+namespace powerflow {
+
+class StepProfile {
+  public:
+    /**
+     * Basic constructor
+     * @param name label of the scenario in the report
+     * @param phases names of the phases of a step
+     * @param max_steps number of steps that can be recorded
+     */
+    StepProfile(const std::string &name,
+        const std::vector<std::string> &phases, int max_steps);
+
+    /**
+     * Basic destructor
+     */
+    ~StepProfile(void);
+
+    /**
+     * Start timing a new step
+     */
+    void startStep(void);
+
+    /**
+     * Charge the time since the start of the step or the last call to
+     * mark to a phase
+     * @param phase index of phase
+     */
+    void mark(int phase);
+
+    /**
+     * Finish the current step. Steps beyond max_steps are not recorded
+     */
+    void endStep(void);
+
+    /**
+     * Return the number of recorded steps
+     * @return number of steps
+     */
+    int getSteps(void) const;
+
+    /**
+     * Write the profile as a JSON object with the mean, median, 99th
+     * percentile and maximum time (microseconds) of each phase and of the
+     * whole step
+     * @param file open output file
+     * @param indent number of spaces to indent the object by
+     */
+    void writeJSON(FILE *file, int indent) const;
+
+  private:
+
+    /**
+     * Write the statistics of one set of samples
+     * @param file open output file
+     * @param name label of samples
+     * @param samples time of each step (s)
+     * @param indent number of spaces to indent by
+     * @param last true if this is the last entry of the enclosing object
+     */
+    void writeStats(FILE *file, const std::string &name,
+        std::vector<double> samples, int indent, bool last) const;
+
+    std::string p_name;
+    std::vector<std::string> p_phases;
+
+    // Time of each phase of each step (s), stored phase by phase
+    std::vector<double> p_times;
+    int p_max_steps;
+    int p_nsteps;
+
+    // Time of the last call to startStep or mark
+    double p_last;
+};
+
+} // powerflow
+} // gridpack
+#endif
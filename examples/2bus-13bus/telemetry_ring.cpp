@@ -0,0 +1,151 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   telemetry_ring.cpp
+ *
+ * @brief  Shared memory ring buffer for per-step federate telemetry
+ *
+ */
+// -------------------------------------------------------------
+
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "telemetry_ring.hpp"
+
+// Size of the fixed part of the header and alignment of the slots
+#define TELEMETRY_HEADER_BYTES 64
+
+namespace gridpack {
+namespace powerflow {
+
+/**
+ * Basic constructor
+ * @param columns names of the telemetry values
+ * @param slots number of records kept in the ring
+ */
+TelemetryRing::TelemetryRing(const std::vector<std::string> &columns,
+    int slots)
+{
+  p_names = columns;
+  p_slots = slots;
+  if (p_slots < 1) p_slots = 1;
+  p_base = NULL;
+  p_size = 0;
+  p_data = NULL;
+  p_slot_bytes = sizeof(std::uint64_t)+p_names.size()*sizeof(double);
+  p_head = NULL;
+  p_state = NULL;
+  p_count = 0;
+}
+
+/**
+ * Basic destructor. Closes the ring if it is open
+ */
+TelemetryRing::~TelemetryRing(void)
+{
+  close();
+}
+
+/**
+ * Create the shared memory segment and write the header. A segment of
+ * the same name is unlinked first, so readers that still map it keep
+ * the old run instead of seeing it resized under them
+ * @param name name of the segment, without the leading /
+ * @return false if the segment could not be created
+ */
+bool TelemetryRing::open(const std::string &name)
+{
+  close();
+  int i;
+  int ncol = p_names.size();
+  size_t names = 0;
+  for (i=0; i<ncol; i++) names += p_names[i].size()+1;
+  size_t offset = TELEMETRY_HEADER_BYTES+names;
+  offset = (offset+TELEMETRY_HEADER_BYTES-1)/TELEMETRY_HEADER_BYTES
+    *TELEMETRY_HEADER_BYTES;
+  p_size = offset+p_slots*p_slot_bytes;
+
+  std::string path = std::string("/")+name;
+  shm_unlink(path.c_str());
+  int fd = shm_open(path.c_str(),O_CREAT|O_EXCL|O_RDWR,0644);
+  if (fd < 0) return false;
+  if (ftruncate(fd,p_size) != 0) {
+    ::close(fd);
+    return false;
+  }
+  void *ptr = mmap(NULL,p_size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+  ::close(fd);
+  if (ptr == MAP_FAILED) return false;
+  p_base = static_cast<char*>(ptr);
+  p_data = p_base+offset;
+
+  // The segment is zero filled by ftruncate, so every slot starts with an
+  // even sequence that does not match any record
+  memcpy(p_base,"GPKTEL01",8);
+  std::uint32_t value = ncol;
+  memcpy(p_base+8,&value,sizeof(value));
+  value = p_slots;
+  memcpy(p_base+12,&value,sizeof(value));
+  value = offset;
+  memcpy(p_base+16,&value,sizeof(value));
+  value = p_slot_bytes;
+  memcpy(p_base+20,&value,sizeof(value));
+  p_head = new (p_base+24) std::atomic<std::uint64_t>(0);
+  char *ptr_name = p_base+TELEMETRY_HEADER_BYTES;
+  for (i=0; i<ncol; i++) {
+    memcpy(ptr_name,p_names[i].c_str(),p_names[i].size()+1);
+    ptr_name += p_names[i].size()+1;
+  }
+  int j;
+  for (j=0; j<p_slots; j++) {
+    new (p_data+j*p_slot_bytes) std::atomic<std::uint64_t>(0);
+  }
+  p_count = 0;
+  p_state = new (p_base+32) std::atomic<std::uint32_t>(0);
+  p_state->store(1,std::memory_order_release);
+  return true;
+}
+
+/**
+ * Write the telemetry for one step into the next slot. Does nothing
+ * if the ring is not open
+ * @param values one value for each column
+ */
+void TelemetryRing::write(const double *values)
+{
+  if (p_base == NULL) return;
+  char *slot = p_data+(p_count%p_slots)*p_slot_bytes;
+  std::atomic<std::uint64_t> *seq
+    = reinterpret_cast<std::atomic<std::uint64_t>*>(slot);
+  seq->store(2*p_count+1,std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(slot+sizeof(std::uint64_t),values,p_names.size()*sizeof(double));
+  seq->store(2*p_count+2,std::memory_order_release);
+  p_count++;
+  p_head->store(p_count,std::memory_order_release);
+}
+
+/**
+ * Mark the ring as finished and unmap it. The segment is left in place
+ * so that readers can still see the last records
+ */
+void TelemetryRing::close(void)
+{
+  if (p_base == NULL) return;
+  p_state->store(0,std::memory_order_release);
+  munmap(p_base,p_size);
+  p_base = NULL;
+  p_data = NULL;
+  p_head = NULL;
+  p_state = NULL;
+}
+
+} // powerflow
+} // gridpack
@@ -0,0 +1,105 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   telemetry_ring.hpp
+ *
+ * @brief  Per-step federate telemetry written to a POSIX shared memory
+ *         ring buffer, so that monitors on the same host can follow the
+ *         co-simulation without joining the HELICS federation. There is a
+ *         single writer and any number of readers, and neither side ever
+ *         takes a lock or waits for the other.
+ *
+ *         The segment (/dev/shm/<name> on Linux) starts with a 64 byte
+ *         header
+ *
+ *           0  8 character tag "GPKTEL01"
+ *           8  32 bit column count
+ *          12  32 bit slot count
+ *          16  32 bit offset of the first slot
+ *          20  32 bit size of a slot
+ *          24  64 bit number of records written
+ *          32  32 bit writer state, 1 while the federate runs and 0 after
+ *              it has finished
+ *
+ *         followed by the column names, each terminated by a NUL. Record n
+ *         is written to slot n modulo the slot count. A slot holds a 64 bit
+ *         sequence number followed by one native double per column. The
+ *         sequence is 2n+1 while record n is being written and 2n+2 once it
+ *         is complete, so a reader copies a slot and keeps the copy only if
+ *         the sequence was 2n+2 both before and after the copy.
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _telemetry_ring_h_
+#define _telemetry_ring_h_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gridpack {
+namespace powerflow {
+
+class TelemetryRing {
+  public:
+    /**
+     * Basic constructor
+     * @param columns names of the telemetry values
+     * @param slots number of records kept in the ring
+     */
+    TelemetryRing(const std::vector<std::string> &columns, int slots);
+
+    /**
+     * Basic destructor. Closes the ring if it is open
+     */
+    ~TelemetryRing(void);
+
+    /**
+     * Create the shared memory segment and write the header. A segment of
+     * the same name is unlinked first, so readers that still map it keep
+     * the old run instead of seeing it resized under them
+     * @param name name of the segment, without the leading /
+     * @return false if the segment could not be created
+     */
+    bool open(const std::string &name);
+
+    /**
+     * Write the telemetry for one step into the next slot. Does nothing
+     * if the ring is not open
+     * @param values one value for each column
+     */
+    void write(const double *values);
+
+    /**
+     * Mark the ring as finished and unmap it. The segment is left in place
+     * so that readers can still see the last records
+     */
+    void close(void);
+
+  private:
+
+    std::vector<std::string> p_names;
+    int p_slots;
+
+    // Mapped segment, its size, the first slot and the size of a slot
+    char *p_base;
+    size_t p_size;
+    char *p_data;
+    size_t p_slot_bytes;
+
+    // Record count in the header, writer state and records written
+    std::atomic<std::uint64_t> *p_head;
+    std::atomic<std::uint32_t> *p_state;
+    std::uint64_t p_count;
+};
+
+} // powerflow
+} // gridpack
+#endif
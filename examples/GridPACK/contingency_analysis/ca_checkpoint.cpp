@@ -0,0 +1,394 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_checkpoint.cpp
+ *
+ * @brief Checkpointing of completed contingencies so that an interrupted
+ *        contingency analysis can be restarted without repeating them.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#include <cstring>
+#include "ca_checkpoint.hpp"
+
+#define CA_CHECKPOINT_MAGIC "CACKPT01"
+
+/**
+ * Basic constructor
+ * @param world world communicator
+ * @param task_comm task communicator
+ * @param prefix prefix of the checkpoint files
+ * @param interval number of contingencies between flushes
+ * @param nmag number of voltage magnitude rows
+ * @param nbus number of bus rows
+ * @param ngen number of generator rows
+ * @param nbranch number of branch rows
+ * @param ntasks number of contingencies
+ */
+gridpack::contingency_analysis::CACheckpoint::CACheckpoint(
+    const gridpack::parallel::Communicator &world,
+    const gridpack::parallel::Communicator &task_comm,
+    std::string prefix, int interval, int nmag, int nbus, int ngen,
+    int nbranch, int ntasks)
+  : p_world(world), p_task_comm(task_comm)
+{
+  p_prefix = prefix;
+  p_interval = interval > 0 ? interval : 1;
+  p_sizes[0] = nmag;
+  p_sizes[1] = nbus;
+  p_sizes[2] = ngen;
+  p_sizes[3] = nbranch;
+  p_sizes[4] = ntasks;
+  p_generation = 0;
+  p_old_generation = -1;
+  p_old_nprocs = 0;
+  p_replay_nprocs = 0;
+  p_replay_rank = 0;
+  p_replay_file = NULL;
+  p_pending_commit = false;
+  p_unflushed = 0;
+  p_file = NULL;
+  p_values.resize(nmag+nbus+2*ngen+3*nbranch);
+  p_masks.resize(nmag+nbus+ngen+nbranch);
+}
+
+/**
+ * Basic destructor. Flushes and closes the checkpoint file
+ */
+gridpack::contingency_analysis::CACheckpoint::~CACheckpoint(void)
+{
+  if (p_replay_file) fclose(p_replay_file);
+  if (p_file) fclose(p_file);
+}
+
+/**
+ * Find the contingencies completed by a previous run and start a new
+ * generation of checkpoint files. Collective on world
+ * @param restart read the checkpoint of a previous run, if false all
+ *        contingencies are run again
+ * @param completed true for contingencies that have been restored
+ * @return number of restored contingencies
+ */
+int gridpack::contingency_analysis::CACheckpoint::start(bool restart,
+    std::vector<bool> &completed)
+{
+  int ntasks = p_sizes[4];
+  std::vector<int> done(ntasks,0);
+  std::vector<int> gen(3,0);
+  int i;
+  if (p_world.rank() == 0) {
+    std::string manifest = p_prefix+".ckpt";
+    FILE *fp = fopen(manifest.c_str(),"r");
+    if (fp) {
+      if (fscanf(fp,"%d %d",&p_old_generation,&p_old_nprocs) != 2) {
+        p_old_generation = -1;
+        p_old_nprocs = 0;
+      }
+      fclose(fp);
+    }
+    p_generation = p_old_generation+1;
+    if (restart && p_old_generation >= 0) {
+      p_replay_nprocs = p_old_nprocs;
+      int r;
+      for (r=0; r<p_old_nprocs; r++) {
+        FILE *in = openInput(fileName(p_old_generation,r));
+        if (!in) continue;
+        while (readRecord(in)) {
+          if (p_rec_ints[0] >= 0 && p_rec_ints[0] < ntasks) {
+            done[p_rec_ints[0]] = 1;
+          }
+        }
+        fclose(in);
+      }
+    } else if (restart) {
+      printf("No checkpoint %s found, running all contingencies\n",
+          manifest.c_str());
+    }
+    gen[0] = p_generation;
+    gen[1] = p_old_generation;
+    gen[2] = p_replay_nprocs;
+  }
+  p_world.sum(&gen[0],3);
+  if (ntasks > 0) p_world.sum(&done[0],ntasks);
+  p_generation = gen[0];
+  p_old_generation = gen[1];
+  p_replay_nprocs = gen[2];
+
+  int nrestored = 0;
+  completed.resize(ntasks);
+  for (i=0; i<ntasks; i++) {
+    completed[i] = (done[i] != 0);
+    if (completed[i]) nrestored++;
+  }
+  if (nrestored == 0) p_replay_nprocs = 0;
+
+  // Start the new generation
+  if (p_task_comm.rank() == 0) {
+    std::string name = fileName(p_generation,p_world.rank());
+    p_file = fopen(name.c_str(),"wb");
+    if (!p_file) {
+      printf("Unable to open checkpoint file %s\n",name.c_str());
+    } else {
+      fwrite(CA_CHECKPOINT_MAGIC,1,8,p_file);
+      fwrite(p_sizes,sizeof(int),5,p_file);
+      fflush(p_file);
+    }
+  }
+  // All processes must have opened their file before the manifest is
+  // updated
+  p_world.barrier();
+  if (p_world.rank() == 0) {
+    if (nrestored > 0) {
+      printf("Restored %d contingencies from checkpoint generation %d\n",
+          nrestored,p_old_generation);
+      p_pending_commit = true;
+    } else {
+      commit();
+    }
+  }
+  return nrestored;
+}
+
+/**
+ * Get the next restored contingency and copy it to the new checkpoint.
+ * Only called on process 0 of world, until it returns false
+ * @param task_id contingency index
+ * @param success true if the power flow calculation converged
+ * @param violation violation code, as in success.txt
+ * @param time solution time
+ * @param vmag voltage magnitudes
+ * @param mag_mask masks for voltage magnitudes
+ * @param vang voltage angles (degrees)
+ * @param mask masks for voltage angles
+ * @param pgen generator real power
+ * @param qgen generator reactive power
+ * @param gen_mask masks for generator values
+ * @param pflow real power flow on each branch element
+ * @param qflow reactive power flow on each branch element
+ * @param perf loading of each branch element
+ * @param flow_mask masks for branch values
+ * @return false if all restored contingencies have been returned
+ */
+bool gridpack::contingency_analysis::CACheckpoint::replay(int &task_id,
+    bool &success, int &violation, double &time,
+    std::vector<double> &vmag, std::vector<int> &mag_mask,
+    std::vector<double> &vang, std::vector<int> &mask,
+    std::vector<double> &pgen, std::vector<double> &qgen,
+    std::vector<int> &gen_mask, std::vector<double> &pflow,
+    std::vector<double> &qflow, std::vector<double> &perf,
+    std::vector<int> &flow_mask)
+{
+  while (p_replay_rank < p_replay_nprocs) {
+    if (!p_replay_file) {
+      p_replay_file = openInput(fileName(p_old_generation,p_replay_rank));
+      if (!p_replay_file) {
+        p_replay_rank++;
+        continue;
+      }
+    }
+    if (readRecord(p_replay_file)) {
+      if (p_rec_ints[0] < 0 || p_rec_ints[0] >= p_sizes[4]) continue;
+      task_id = p_rec_ints[0];
+      success = (p_rec_ints[1] != 0);
+      violation = p_rec_ints[2];
+      time = p_rec_time;
+      int nmag = p_sizes[0];
+      int nbus = p_sizes[1];
+      int ngen = p_sizes[2];
+      int nbranch = p_sizes[3];
+      const double *vptr = &p_values[0];
+      const char *mptr = &p_masks[0];
+      vmag.assign(vptr,vptr+nmag);
+      vptr += nmag;
+      vang.assign(vptr,vptr+nbus);
+      vptr += nbus;
+      pgen.assign(vptr,vptr+ngen);
+      vptr += ngen;
+      qgen.assign(vptr,vptr+ngen);
+      vptr += ngen;
+      pflow.assign(vptr,vptr+nbranch);
+      vptr += nbranch;
+      qflow.assign(vptr,vptr+nbranch);
+      vptr += nbranch;
+      perf.assign(vptr,vptr+nbranch);
+      mag_mask.assign(mptr,mptr+nmag);
+      mptr += nmag;
+      mask.assign(mptr,mptr+nbus);
+      mptr += nbus;
+      gen_mask.assign(mptr,mptr+ngen);
+      mptr += ngen;
+      flow_mask.assign(mptr,mptr+nbranch);
+      writeRecord();
+      return true;
+    }
+    fclose(p_replay_file);
+    p_replay_file = NULL;
+    p_replay_rank++;
+  }
+  if (p_pending_commit) {
+    if (p_file) fflush(p_file);
+    p_unflushed = 0;
+    commit();
+    p_pending_commit = false;
+  }
+  return false;
+}
+
+/**
+ * Save a completed contingency. Only called on process 0 of the task
+ * communicator
+ * @param task_id contingency index
+ * @param success true if the power flow calculation converged
+ * @param violation violation code, as in success.txt
+ * @param time solution time
+ * @param vmag voltage magnitudes
+ * @param mag_mask masks for voltage magnitudes
+ * @param vang voltage angles (degrees)
+ * @param mask masks for voltage angles
+ * @param pgen generator real power
+ * @param qgen generator reactive power
+ * @param gen_mask masks for generator values
+ * @param pflow real power flow on each branch element
+ * @param qflow reactive power flow on each branch element
+ * @param perf loading of each branch element
+ * @param flow_mask masks for branch values
+ */
+void gridpack::contingency_analysis::CACheckpoint::save(int task_id,
+    bool success, int violation, double time,
+    std::vector<double> &vmag, std::vector<int> &mag_mask,
+    std::vector<double> &vang, std::vector<int> &mask,
+    std::vector<double> &pgen, std::vector<double> &qgen,
+    std::vector<int> &gen_mask, std::vector<double> &pflow,
+    std::vector<double> &qflow, std::vector<double> &perf,
+    std::vector<int> &flow_mask)
+{
+  if (!p_file) return;
+  p_rec_ints[0] = task_id;
+  p_rec_ints[1] = success ? 1 : 0;
+  p_rec_ints[2] = violation;
+  p_rec_time = time;
+  int nmag = p_sizes[0];
+  int nbus = p_sizes[1];
+  int ngen = p_sizes[2];
+  int nbranch = p_sizes[3];
+  double *vptr = &p_values[0];
+  char *mptr = &p_masks[0];
+  int i;
+  for (i=0; i<nmag; i++) *vptr++ = vmag[i];
+  for (i=0; i<nbus; i++) *vptr++ = vang[i];
+  for (i=0; i<ngen; i++) *vptr++ = pgen[i];
+  for (i=0; i<ngen; i++) *vptr++ = qgen[i];
+  for (i=0; i<nbranch; i++) *vptr++ = pflow[i];
+  for (i=0; i<nbranch; i++) *vptr++ = qflow[i];
+  for (i=0; i<nbranch; i++) *vptr++ = perf[i];
+  for (i=0; i<nmag; i++) *mptr++ = static_cast<char>(mag_mask[i]);
+  for (i=0; i<nbus; i++) *mptr++ = static_cast<char>(mask[i]);
+  for (i=0; i<ngen; i++) *mptr++ = static_cast<char>(gen_mask[i]);
+  for (i=0; i<nbranch; i++) *mptr++ = static_cast<char>(flow_mask[i]);
+  writeRecord();
+}
+
+/**
+ * Name of a checkpoint file
+ * @param generation checkpoint generation
+ * @param rank rank of the process that writes the file
+ * @return file name
+ */
+std::string gridpack::contingency_analysis::CACheckpoint::fileName(
+    int generation, int rank) const
+{
+  char sbuf[32];
+  sprintf(sbuf,".%d.%d.ckpt",generation,rank);
+  return p_prefix+sbuf;
+}
+
+/**
+ * Open a checkpoint file for reading and check its header
+ * @param name file name
+ * @return file pointer, NULL if the file does not exist or was written
+ *         for a different network or contingency list
+ */
+FILE* gridpack::contingency_analysis::CACheckpoint::openInput(
+    const std::string &name)
+{
+  FILE *fp = fopen(name.c_str(),"rb");
+  if (!fp) return NULL;
+  char magic[8];
+  int sizes[5];
+  if (fread(magic,1,8,fp) != 8 || strncmp(magic,CA_CHECKPOINT_MAGIC,8) != 0
+      || fread(sizes,sizeof(int),5,fp) != 5
+      || memcmp(sizes,p_sizes,sizeof(sizes)) != 0) {
+    printf("Ignoring checkpoint file %s, it does not match this"
+        " calculation\n",name.c_str());
+    fclose(fp);
+    return NULL;
+  }
+  return fp;
+}
+
+/**
+ * Read one record
+ * @param fp checkpoint file
+ * @return false at the end of the file or if the record is incomplete
+ */
+bool gridpack::contingency_analysis::CACheckpoint::readRecord(FILE *fp)
+{
+  if (fread(p_rec_ints,sizeof(int),3,fp) != 3) return false;
+  if (fread(&p_rec_time,sizeof(double),1,fp) != 1) return false;
+  if (!p_values.empty() && fread(&p_values[0],sizeof(double),
+        p_values.size(),fp) != p_values.size()) return false;
+  if (!p_masks.empty() && fread(&p_masks[0],1,p_masks.size(),fp)
+      != p_masks.size()) return false;
+  return true;
+}
+
+/**
+ * Write the record in the buffers
+ */
+void gridpack::contingency_analysis::CACheckpoint::writeRecord(void)
+{
+  if (!p_file) return;
+  fwrite(p_rec_ints,sizeof(int),3,p_file);
+  fwrite(&p_rec_time,sizeof(double),1,p_file);
+  if (!p_values.empty()) {
+    fwrite(&p_values[0],sizeof(double),p_values.size(),p_file);
+  }
+  if (!p_masks.empty()) fwrite(&p_masks[0],1,p_masks.size(),p_file);
+  p_unflushed++;
+  if (p_unflushed >= p_interval) {
+    fflush(p_file);
+    p_unflushed = 0;
+  }
+}
+
+/**
+ * Write the manifest for the current generation and remove the files
+ * of the previous one. Called on process 0 of world
+ */
+void gridpack::contingency_analysis::CACheckpoint::commit(void)
+{
+  // The manifest is replaced with a rename so that it is never seen
+  // partially written
+  std::string manifest = p_prefix+".ckpt";
+  std::string tmp = manifest+".tmp";
+  FILE *fp = fopen(tmp.c_str(),"w");
+  if (!fp) {
+    printf("Unable to write checkpoint manifest %s\n",manifest.c_str());
+    return;
+  }
+  fprintf(fp,"%d %d\n",p_generation,p_world.size());
+  fclose(fp);
+  rename(tmp.c_str(),manifest.c_str());
+  if (p_old_generation >= 0) {
+    int r;
+    for (r=0; r<p_old_nprocs; r++) {
+      remove(fileName(p_old_generation,r).c_str());
+    }
+  }
+}
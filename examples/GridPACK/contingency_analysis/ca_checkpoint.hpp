@@ -0,0 +1,192 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_checkpoint.hpp
+ *
+ * @brief Checkpointing of completed contingencies so that an interrupted
+ *        contingency analysis can be restarted without repeating them.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _ca_checkpoint_h_
+#define _ca_checkpoint_h_
+
+#include <cstdio>
+#include "gridpack/include/gridpack.hpp"
+
+namespace gridpack {
+namespace contingency_analysis {
+
+// Process 0 of each task communicator appends a record for every
+// completed contingency (task ID, success and violation codes, solution
+// time and the values that go into the statistics) to its own checkpoint
+// file <prefix>.<generation>.<rank>.ckpt. The file is flushed every
+// interval contingencies. A record that was only partially written when
+// the run died is ignored on restart.
+//
+// The manifest <prefix>.ckpt holds the generation and the number of
+// processes of the run that wrote the checkpoint files. A restarted run
+// reads the files of the current generation on process 0 and writes a new
+// generation that starts with the restored records. The manifest points to
+// the new generation only after the restored records have been written, so
+// the checkpoint stays complete if the restarted run also fails. The
+// number of processes and group size may change between runs.
+class CACheckpoint
+{
+  public:
+    /**
+     * Basic constructor
+     * @param world world communicator
+     * @param task_comm task communicator
+     * @param prefix prefix of the checkpoint files
+     * @param interval number of contingencies between flushes
+     * @param nmag number of voltage magnitude rows
+     * @param nbus number of bus rows
+     * @param ngen number of generator rows
+     * @param nbranch number of branch rows
+     * @param ntasks number of contingencies
+     */
+    CACheckpoint(const gridpack::parallel::Communicator &world,
+        const gridpack::parallel::Communicator &task_comm,
+        std::string prefix, int interval, int nmag, int nbus, int ngen,
+        int nbranch, int ntasks);
+
+    /**
+     * Basic destructor. Flushes and closes the checkpoint file
+     */
+    ~CACheckpoint(void);
+
+    /**
+     * Find the contingencies completed by a previous run and start a new
+     * generation of checkpoint files. Collective on world
+     * @param restart read the checkpoint of a previous run, if false all
+     *        contingencies are run again
+     * @param completed true for contingencies that have been restored
+     * @return number of restored contingencies
+     */
+    int start(bool restart, std::vector<bool> &completed);
+
+    /**
+     * Get the next restored contingency and copy it to the new checkpoint.
+     * Only called on process 0 of world, until it returns false
+     * @param task_id contingency index
+     * @param success true if the power flow calculation converged
+     * @param violation violation code, as in success.txt
+     * @param time solution time
+     * @param vmag voltage magnitudes
+     * @param mag_mask masks for voltage magnitudes
+     * @param vang voltage angles (degrees)
+     * @param mask masks for voltage angles
+     * @param pgen generator real power
+     * @param qgen generator reactive power
+     * @param gen_mask masks for generator values
+     * @param pflow real power flow on each branch element
+     * @param qflow reactive power flow on each branch element
+     * @param perf loading of each branch element
+     * @param flow_mask masks for branch values
+     * @return false if all restored contingencies have been returned
+     */
+    bool replay(int &task_id, bool &success, int &violation, double &time,
+        std::vector<double> &vmag, std::vector<int> &mag_mask,
+        std::vector<double> &vang, std::vector<int> &mask,
+        std::vector<double> &pgen, std::vector<double> &qgen,
+        std::vector<int> &gen_mask, std::vector<double> &pflow,
+        std::vector<double> &qflow, std::vector<double> &perf,
+        std::vector<int> &flow_mask);
+
+    /**
+     * Save a completed contingency. Only called on process 0 of the task
+     * communicator
+     * @param task_id contingency index
+     * @param success true if the power flow calculation converged
+     * @param violation violation code, as in success.txt
+     * @param time solution time
+     * @param vmag voltage magnitudes
+     * @param mag_mask masks for voltage magnitudes
+     * @param vang voltage angles (degrees)
+     * @param mask masks for voltage angles
+     * @param pgen generator real power
+     * @param qgen generator reactive power
+     * @param gen_mask masks for generator values
+     * @param pflow real power flow on each branch element
+     * @param qflow reactive power flow on each branch element
+     * @param perf loading of each branch element
+     * @param flow_mask masks for branch values
+     */
+    void save(int task_id, bool success, int violation, double time,
+        std::vector<double> &vmag, std::vector<int> &mag_mask,
+        std::vector<double> &vang, std::vector<int> &mask,
+        std::vector<double> &pgen, std::vector<double> &qgen,
+        std::vector<int> &gen_mask, std::vector<double> &pflow,
+        std::vector<double> &qflow, std::vector<double> &perf,
+        std::vector<int> &flow_mask);
+
+  private:
+
+    /**
+     * Name of a checkpoint file
+     * @param generation checkpoint generation
+     * @param rank rank of the process that writes the file
+     * @return file name
+     */
+    std::string fileName(int generation, int rank) const;
+
+    /**
+     * Open a checkpoint file for reading and check its header
+     * @param name file name
+     * @return file pointer, NULL if the file does not exist or was written
+     *         for a different network or contingency list
+     */
+    FILE *openInput(const std::string &name);
+
+    /**
+     * Read one record
+     * @param fp checkpoint file
+     * @return false at the end of the file or if the record is incomplete
+     */
+    bool readRecord(FILE *fp);
+
+    /**
+     * Write the record in the buffers
+     */
+    void writeRecord(void);
+
+    /**
+     * Write the manifest for the current generation and remove the files
+     * of the previous one. Called on process 0 of world
+     */
+    void commit(void);
+
+    gridpack::parallel::Communicator p_world;
+    gridpack::parallel::Communicator p_task_comm;
+    std::string p_prefix;
+    int p_interval;
+    int p_sizes[5];
+    int p_generation;
+    int p_old_generation;
+    int p_old_nprocs;
+    bool p_pending_commit;
+    int p_unflushed;
+    FILE *p_file;
+
+    // Previous checkpoint files read by replay
+    int p_replay_nprocs;
+    int p_replay_rank;
+    FILE *p_replay_file;
+
+    // Packed record
+    int p_rec_ints[3];
+    double p_rec_time;
+    std::vector<double> p_values;
+    std::vector<char> p_masks;
+};
+
+} // contingency analysis
+} // gridpack
+#endif
@@ -0,0 +1,354 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_contingency_list.cpp
+ *
+ * @brief Contingency lists in CSV and binary format.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include "ca_driver.hpp"
+#include "ca_contingency_list.hpp"
+
+#define CA_CONTINGENCY_MAGIC "CACTG001"
+
+// Contingency types in the binary file
+#define CA_LINE_CODE 1
+#define CA_GENERATOR_CODE 2
+
+/**
+ * Basic constructor
+ * @param comm communicator on which the list is distributed
+ */
+gridpack::contingency_analysis::CAContingencyList::CAContingencyList(
+    const gridpack::parallel::Communicator &comm)
+  : p_comm(comm)
+{
+}
+
+/**
+ * Basic destructor
+ */
+gridpack::contingency_analysis::CAContingencyList::~CAContingencyList(void)
+{
+}
+
+/**
+ * Check if a contingency file is in one of the formats handled by this
+ * class
+ * @param filename name of contingency file
+ * @return true for CSV and binary files
+ */
+bool gridpack::contingency_analysis::CAContingencyList::isListFile(
+    const std::string &filename)
+{
+  size_t pos = filename.rfind('.');
+  if (pos == std::string::npos) return false;
+  std::string ext = filename.substr(pos);
+  gridpack::utility::StringUtils util;
+  util.toLower(ext);
+  return (ext == ".csv" || ext == ".bin");
+}
+
+/**
+ * Read a CSV or binary contingency file on process 0 and broadcast the
+ * contingencies to all processes
+ * @param filename name of contingency file
+ * @param events list of contingencies
+ * @return false if the file could not be read
+ */
+bool gridpack::contingency_analysis::CAContingencyList::read(
+    const std::string &filename,
+    std::vector<gridpack::powerflow::Contingency> &events)
+{
+  events.clear();
+  std::vector<int> buf;
+  // Size of the packed list, -1 if the file could not be read
+  int size = 0;
+  if (p_comm.rank() == 0) {
+    std::string ext = filename.substr(filename.rfind('.'));
+    gridpack::utility::StringUtils util;
+    util.toLower(ext);
+    bool ok;
+    if (ext == ".csv") {
+      ok = readCSV(filename, events);
+    } else {
+      ok = readBinary(filename, events);
+    }
+    if (ok) {
+      pack(events, buf);
+      size = buf.size();
+    } else {
+      size = -1;
+    }
+  }
+  // Broadcast the packed list from process 0. All other processes
+  // contribute zeros to the sum
+  p_comm.sum(&size,1);
+  if (size < 0) return false;
+  if (p_comm.rank() != 0) buf.resize(size,0);
+  if (size > 0) p_comm.sum(&buf[0],size);
+  if (p_comm.rank() != 0) unpack(buf, events);
+  return true;
+}
+
+/**
+ * Write contingencies to a binary file from process 0
+ * @param filename name of contingency file
+ * @param events list of contingencies
+ */
+void gridpack::contingency_analysis::CAContingencyList::write(
+    const std::string &filename,
+    const std::vector<gridpack::powerflow::Contingency> &events)
+{
+  if (p_comm.rank() != 0) return;
+  FILE *fp = fopen(filename.c_str(),"wb");
+  if (!fp) {
+    printf("Unable to open contingency file %s\n",filename.c_str());
+    return;
+  }
+  fwrite(CA_CONTINGENCY_MAGIC,1,8,fp);
+  int n = events.size();
+  fwrite(&n,sizeof(int),1,fp);
+  int idx, j;
+  for (idx=0; idx<n; idx++) {
+    const gridpack::powerflow::Contingency &event = events[idx];
+    int type = event.p_type == Branch ? CA_LINE_CODE : CA_GENERATOR_CODE;
+    int len = event.p_name.size();
+    int nelem = type == CA_LINE_CODE ? event.p_from.size()
+      : event.p_busid.size();
+    fwrite(&type,sizeof(int),1,fp);
+    fwrite(&len,sizeof(int),1,fp);
+    fwrite(event.p_name.c_str(),1,len,fp);
+    fwrite(&nelem,sizeof(int),1,fp);
+    for (j=0; j<nelem; j++) {
+      // Device IDs are stored as exactly 2 characters
+      std::string tag;
+      if (type == CA_LINE_CODE) {
+        fwrite(&event.p_from[j],sizeof(int),1,fp);
+        fwrite(&event.p_to[j],sizeof(int),1,fp);
+        tag = event.p_ckt[j];
+      } else {
+        fwrite(&event.p_busid[j],sizeof(int),1,fp);
+        tag = event.p_genid[j];
+      }
+      tag.resize(2,' ');
+      fwrite(tag.c_str(),1,2,fp);
+    }
+  }
+  fclose(fp);
+  printf("Wrote %d contingencies to %s\n",n,filename.c_str());
+}
+
+/**
+ * Parse a CSV contingency file
+ * @param filename name of contingency file
+ * @param events list of contingencies
+ * @return false if the file could not be opened
+ */
+bool gridpack::contingency_analysis::CAContingencyList::readCSV(
+    const std::string &filename,
+    std::vector<gridpack::powerflow::Contingency> &events)
+{
+  std::ifstream fin;
+  fin.open(filename.c_str());
+  if (!fin.is_open()) {
+    printf("Unable to open contingency file %s\n",filename.c_str());
+    return false;
+  }
+  gridpack::utility::StringUtils util;
+  std::string line;
+  int nline = 0;
+  int i;
+  while (std::getline(fin,line)) {
+    nline++;
+    util.trim(line);
+    if (line.empty() || line[0] == '#') continue;
+    std::vector<std::string> tokens = util.charTokenizer(line,",");
+    for (i=0; i<tokens.size(); i++) util.trim(tokens[i]);
+    bool ok = tokens.size() >= 2;
+    gridpack::powerflow::Contingency contingency;
+    if (ok) {
+      contingency.p_name = tokens[0];
+      std::string type = tokens[1];
+      util.toLower(type);
+      if (type == "line" && (tokens.size()-2)%3 == 0 && tokens.size() > 2) {
+        contingency.p_type = Branch;
+        for (i=2; i<tokens.size(); i+=3) {
+          contingency.p_from.push_back(atoi(tokens[i].c_str()));
+          contingency.p_to.push_back(atoi(tokens[i+1].c_str()));
+          contingency.p_ckt.push_back(util.clean2Char(tokens[i+2]));
+          contingency.p_saveLineStatus.push_back(true);
+        }
+      } else if (type == "generator" && (tokens.size()-2)%2 == 0
+          && tokens.size() > 2) {
+        contingency.p_type = Generator;
+        for (i=2; i<tokens.size(); i+=2) {
+          contingency.p_busid.push_back(atoi(tokens[i].c_str()));
+          contingency.p_genid.push_back(util.clean2Char(tokens[i+1]));
+          contingency.p_saveGenStatus.push_back(true);
+        }
+      } else {
+        ok = false;
+      }
+    }
+    if (ok) {
+      events.push_back(contingency);
+    } else {
+      printf("Skipping malformed contingency on line %d of %s\n",nline,
+          filename.c_str());
+    }
+  }
+  fin.close();
+  return true;
+}
+
+/**
+ * Read a binary contingency file
+ * @param filename name of contingency file
+ * @param events list of contingencies
+ * @return false if the file could not be opened or is damaged
+ */
+bool gridpack::contingency_analysis::CAContingencyList::readBinary(
+    const std::string &filename,
+    std::vector<gridpack::powerflow::Contingency> &events)
+{
+  FILE *fp = fopen(filename.c_str(),"rb");
+  if (!fp) {
+    printf("Unable to open contingency file %s\n",filename.c_str());
+    return false;
+  }
+  char magic[8];
+  int n;
+  bool ok = (fread(magic,1,8,fp) == 8
+      && strncmp(magic,CA_CONTINGENCY_MAGIC,8) == 0
+      && fread(&n,sizeof(int),1,fp) == 1 && n >= 0);
+  int idx, j;
+  if (ok) events.reserve(n);
+  for (idx=0; ok && idx<n; idx++) {
+    int header[2];
+    int nelem;
+    ok = (fread(header,sizeof(int),2,fp) == 2 && header[1] >= 0);
+    if (!ok) break;
+    gridpack::powerflow::Contingency contingency;
+    contingency.p_name.resize(header[1]);
+    if (header[1] > 0) {
+      ok = (fread(&contingency.p_name[0],1,header[1],fp) == header[1]);
+    }
+    ok = ok && fread(&nelem,sizeof(int),1,fp) == 1 && nelem >= 0;
+    ok = ok && (header[0] == CA_LINE_CODE || header[0] == CA_GENERATOR_CODE);
+    contingency.p_type = header[0] == CA_LINE_CODE ? Branch : Generator;
+    for (j=0; ok && j<nelem; j++) {
+      int ids[2];
+      char tag[2];
+      int nids = header[0] == CA_LINE_CODE ? 2 : 1;
+      ok = (fread(ids,sizeof(int),nids,fp) == nids
+          && fread(tag,1,2,fp) == 2);
+      if (!ok) break;
+      if (header[0] == CA_LINE_CODE) {
+        contingency.p_from.push_back(ids[0]);
+        contingency.p_to.push_back(ids[1]);
+        contingency.p_ckt.push_back(std::string(tag,2));
+        contingency.p_saveLineStatus.push_back(true);
+      } else {
+        contingency.p_busid.push_back(ids[0]);
+        contingency.p_genid.push_back(std::string(tag,2));
+        contingency.p_saveGenStatus.push_back(true);
+      }
+    }
+    if (ok) events.push_back(contingency);
+  }
+  fclose(fp);
+  if (!ok) {
+    printf("Contingency file %s is damaged\n",filename.c_str());
+  }
+  return ok;
+}
+
+/**
+ * Pack contingencies into a buffer of integers, one integer per
+ * character of the names and device IDs
+ * @param events list of contingencies
+ * @param buf packed contingencies
+ */
+void gridpack::contingency_analysis::CAContingencyList::pack(
+    const std::vector<gridpack::powerflow::Contingency> &events,
+    std::vector<int> &buf)
+{
+  buf.clear();
+  buf.push_back(events.size());
+  int idx, i, j;
+  for (idx=0; idx<events.size(); idx++) {
+    const gridpack::powerflow::Contingency &event = events[idx];
+    bool line = (event.p_type == Branch);
+    buf.push_back(line ? CA_LINE_CODE : CA_GENERATOR_CODE);
+    buf.push_back(event.p_name.size());
+    for (i=0; i<event.p_name.size(); i++) buf.push_back(event.p_name[i]);
+    int nelem = line ? event.p_from.size() : event.p_busid.size();
+    buf.push_back(nelem);
+    for (j=0; j<nelem; j++) {
+      const std::string &tag = line ? event.p_ckt[j] : event.p_genid[j];
+      if (line) {
+        buf.push_back(event.p_from[j]);
+        buf.push_back(event.p_to[j]);
+      } else {
+        buf.push_back(event.p_busid[j]);
+      }
+      buf.push_back(tag.size());
+      for (i=0; i<tag.size(); i++) buf.push_back(tag[i]);
+    }
+  }
+}
+
+/**
+ * Unpack contingencies from a buffer
+ * @param buf packed contingencies
+ * @param events list of contingencies
+ */
+void gridpack::contingency_analysis::CAContingencyList::unpack(
+    const std::vector<int> &buf,
+    std::vector<gridpack::powerflow::Contingency> &events)
+{
+  events.clear();
+  int pos = 0;
+  int n = buf[pos++];
+  events.resize(n);
+  int idx, i, j;
+  for (idx=0; idx<n; idx++) {
+    gridpack::powerflow::Contingency &event = events[idx];
+    bool line = (buf[pos++] == CA_LINE_CODE);
+    event.p_type = line ? Branch : Generator;
+    int len = buf[pos++];
+    event.p_name.resize(len);
+    for (i=0; i<len; i++) event.p_name[i] = static_cast<char>(buf[pos++]);
+    int nelem = buf[pos++];
+    for (j=0; j<nelem; j++) {
+      if (line) {
+        event.p_from.push_back(buf[pos++]);
+        event.p_to.push_back(buf[pos++]);
+      } else {
+        event.p_busid.push_back(buf[pos++]);
+      }
+      len = buf[pos++];
+      std::string tag(len,' ');
+      for (i=0; i<len; i++) tag[i] = static_cast<char>(buf[pos++]);
+      if (line) {
+        event.p_ckt.push_back(tag);
+        event.p_saveLineStatus.push_back(true);
+      } else {
+        event.p_genid.push_back(tag);
+        event.p_saveGenStatus.push_back(true);
+      }
+    }
+  }
+}
@@ -0,0 +1,123 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_contingency_list.hpp
+ *
+ * @brief Contingency lists in CSV and binary format. The list is read on
+ *        process 0 and broadcast to all other processes, instead of every
+ *        process parsing the XML contingency file.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _ca_contingency_list_h_
+#define _ca_contingency_list_h_
+
+#include "gridpack/include/gridpack.hpp"
+#include "gridpack/applications/modules/powerflow/pf_app_module.hpp"
+
+namespace gridpack {
+namespace contingency_analysis {
+
+// CSV files (extension .csv) have one contingency per line, with the name,
+// the type and the elements that are taken out:
+//   CTG1,Line,13,14,B1            from bus, to bus and circuit ID
+//   CTG7,Line,1,2,1,1,5,1         any number of lines for N-k
+//   CTG4,Generator,2,1            bus and generator ID for each generator
+// Blank lines and lines starting with # are skipped.
+//
+// Binary files (extension .bin) start with the tag "CACTG001" and the
+// number of contingencies (32 bit), followed for each contingency by its
+// type (1 for lines, 2 for generators), the length of the name and the
+// name, the number of elements and for each element the bus IDs (two for
+// lines, one for generators) and the 2 character device ID. All integers
+// are 32 bit in the native byte order. The write function converts a list
+// from any format into this one.
+class CAContingencyList
+{
+  public:
+    /**
+     * Basic constructor
+     * @param comm communicator on which the list is distributed
+     */
+    CAContingencyList(const gridpack::parallel::Communicator &comm);
+
+    /**
+     * Basic destructor
+     */
+    ~CAContingencyList(void);
+
+    /**
+     * Check if a contingency file is in one of the formats handled by this
+     * class
+     * @param filename name of contingency file
+     * @return true for CSV and binary files
+     */
+    static bool isListFile(const std::string &filename);
+
+    /**
+     * Read a CSV or binary contingency file on process 0 and broadcast the
+     * contingencies to all processes
+     * @param filename name of contingency file
+     * @param events list of contingencies
+     * @return false if the file could not be read
+     */
+    bool read(const std::string &filename,
+        std::vector<gridpack::powerflow::Contingency> &events);
+
+    /**
+     * Write contingencies to a binary file from process 0
+     * @param filename name of contingency file
+     * @param events list of contingencies
+     */
+    void write(const std::string &filename,
+        const std::vector<gridpack::powerflow::Contingency> &events);
+
+  private:
+
+    /**
+     * Parse a CSV contingency file
+     * @param filename name of contingency file
+     * @param events list of contingencies
+     * @return false if the file could not be opened
+     */
+    bool readCSV(const std::string &filename,
+        std::vector<gridpack::powerflow::Contingency> &events);
+
+    /**
+     * Read a binary contingency file
+     * @param filename name of contingency file
+     * @param events list of contingencies
+     * @return false if the file could not be opened or is damaged
+     */
+    bool readBinary(const std::string &filename,
+        std::vector<gridpack::powerflow::Contingency> &events);
+
+    /**
+     * Pack contingencies into a buffer of integers, one integer per
+     * character of the names and device IDs
+     * @param events list of contingencies
+     * @param buf packed contingencies
+     */
+    void pack(const std::vector<gridpack::powerflow::Contingency> &events,
+        std::vector<int> &buf);
+
+    /**
+     * Unpack contingencies from a buffer
+     * @param buf packed contingencies
+     * @param events list of contingencies
+     */
+    void unpack(const std::vector<int> &buf,
+        std::vector<gridpack::powerflow::Contingency> &events);
+
+    gridpack::parallel::Communicator p_comm;
+};
+
+} // contingency analysis
+} // gridpack
+#endif
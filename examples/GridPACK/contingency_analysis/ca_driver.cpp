@@ -18,9 +18,19 @@
  */
 // -------------------------------------------------------------
 
+#include <algorithm>
+#include <fstream>
+#include <map>
 #include "gridpack/include/gridpack.hpp"
 #include "gridpack/applications/modules/powerflow/pf_app_module.hpp"
+#include "ca_checkpoint.hpp"
+#include "ca_contingency_list.hpp"
 #include "ca_driver.hpp"
+#include "ca_output.hpp"
+#include "ca_results.hpp"
+#include "ca_screen.hpp"
+#include "ca_statistics.hpp"
+#include "ca_warm_start.hpp"
 
 #define USE_SUCCESS
 #define USE_STATBLOCK
@@ -32,6 +42,10 @@
  */
 gridpack::contingency_analysis::CADriver::CADriver(void)
 {
+  p_chunk_size = 1;
+  p_next = 0;
+  p_last = 0;
+  p_wait_time = 0.0;
 }
 
 /**
@@ -141,10 +155,148 @@ std::vector<gridpack::powerflow::Contingency>
   return ret;
 }
 
+/**
+ * Set the order in which contingencies are handed out. In cost order
+ * the most expensive contingencies are run first, so that no group is
+ * left with a slow case at the end of the run. The estimated cost of a
+ * contingency is its solution time from a previous run, if the cost
+ * file has an entry for it, and otherwise the number of elements it
+ * removes times the mean solution time per element
+ * @param events list of contingencies
+ * @param selected contingencies to schedule, others are skipped
+ * @param cost_order true to order by estimated cost, false to keep
+ *        input order
+ * @param cost_file file with solution times from a previous run (may be
+ *        empty)
+ * @param chunk_size number of contingencies handed out at a time
+ * @param comm world communicator
+ * @return number of chunks to be handed out by the task manager
+ */
+int gridpack::contingency_analysis::CADriver::scheduleTasks(
+    std::vector<gridpack::powerflow::Contingency> &events,
+    std::vector<bool> &selected, bool cost_order, std::string cost_file, int chunk_size,
+    const gridpack::parallel::Communicator &comm)
+{
+  int ntasks = events.size();
+  int i;
+  p_chunk_size = chunk_size > 0 ? chunk_size : 1;
+  p_next = 0;
+  p_last = 0;
+  p_wait_time = 0.0;
+  p_order.clear();
+  for (i=0; i<ntasks; i++) {
+    if (selected[i]) p_order.push_back(i);
+  }
+  int norder = p_order.size();
+  if (!cost_order || norder == 0) {
+    return (norder+p_chunk_size-1)/p_chunk_size;
+  }
+
+  // Read solution times from a previous run on process 0. Entries are
+  // matched to contingencies by name, so the list may have changed since
+  // the cost file was written
+  std::vector<double> cost(ntasks,0.0);
+  if (comm.rank() == 0 && !cost_file.empty()) {
+    std::map<std::string,int> index;
+    for (i=0; i<ntasks; i++) index[events[i].p_name] = i;
+    std::ifstream fin(cost_file.c_str());
+    std::string name;
+    double time;
+    while (fin >> name >> time) {
+      std::map<std::string,int>::iterator it = index.find(name);
+      if (it != index.end() && time > 0.0) cost[it->second] = time;
+    }
+  }
+  comm.sum(&cost[0],ntasks);
+
+  // Contingencies without a history are estimated from the number of lines
+  // or generators they take out of service
+  double known_time = 0.0;
+  int known_elems = 0;
+  for (i=0; i<ntasks; i++) {
+    int nelems = events[i].p_from.size()+events[i].p_busid.size();
+    if (cost[i] > 0.0) {
+      known_time += cost[i];
+      known_elems += nelems;
+    }
+  }
+  double elem_cost = known_elems > 0 ? known_time/known_elems : 1.0;
+  std::vector<std::pair<double,int> > ranked;
+  for (i=0; i<ntasks; i++) {
+    if (!selected[i]) continue;
+    int nelems = events[i].p_from.size()+events[i].p_busid.size();
+    if (cost[i] <= 0.0) cost[i] = (nelems > 0 ? nelems : 1)*elem_cost;
+    // Sort on the negative cost so that expensive contingencies come first
+    // and ties keep input order
+    ranked.push_back(std::pair<double,int>(-cost[i],i));
+  }
+  std::sort(ranked.begin(),ranked.end());
+  for (i=0; i<norder; i++) p_order[i] = ranked[i].second;
+  return (norder+p_chunk_size-1)/p_chunk_size;
+}
+
+/**
+ * Get the next contingency for this task communicator. A new chunk of
+ * contingencies is requested from the task manager when the current one
+ * is used up, and the time spent waiting for it is accumulated
+ * @param taskmgr task manager distributing chunks of contingencies
+ * @param task_comm task communicator
+ * @param task_id index of next contingency
+ * @return false if there are no contingencies left
+ */
+bool gridpack::contingency_analysis::CADriver::nextTask(
+    gridpack::parallel::TaskManager &taskmgr,
+    gridpack::parallel::Communicator &task_comm, int *task_id)
+{
+  if (p_next >= p_last) {
+    gridpack::utility::CoarseTimer *timer =
+      gridpack::utility::CoarseTimer::instance();
+    double t_start = timer->currentTime();
+    int chunk;
+    bool ok = taskmgr.nextTask(task_comm, &chunk);
+    p_wait_time += timer->currentTime()-t_start;
+    if (!ok) return false;
+    p_next = chunk*p_chunk_size;
+    p_last = p_next+p_chunk_size;
+    if (p_last > p_order.size()) p_last = p_order.size();
+  }
+  *task_id = p_order[p_next];
+  p_next++;
+  return true;
+}
+
+/**
+ * Write solution time of each contingency so that later runs can use
+ * them as cost estimates
+ * @param cost_file name of cost file
+ * @param events list of contingencies
+ * @param times solution time of each contingency, summed over all
+ *        processors
+ * @param comm world communicator
+ */
+void gridpack::contingency_analysis::CADriver::writeTaskCosts(
+    std::string cost_file,
+    std::vector<gridpack::powerflow::Contingency> &events,
+    std::vector<double> &times,
+    const gridpack::parallel::Communicator &comm)
+{
+  if (comm.rank() != 0 || cost_file.empty()) return;
+  std::ofstream fout;
+  fout.open(cost_file.c_str());
+  int i;
+  for (i=0; i<events.size(); i++) {
+    fout << events[i].p_name << " " << times[i] << std::endl;
+  }
+  fout.close();
+}
+
 /**
  * Execute application. argc and argv are standard runtime parameters
+ * @param runtime runtime of the application. MA is sized from the network
+ *        and the math libraries are started once the input has been read
  */
-void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
+void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv,
+    gridpack::Runtime &runtime)
 {
   // Create world communicator for entire simulation
   gridpack::parallel::Communicator world;
@@ -166,6 +318,12 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
   } else {
     config->open("input.xml",world);
   }
+  if (!runtime.setMemory(config,"Configuration.Powerflow")) {
+    timer->stop(t_total);
+    return;
+  }
+  runtime.startMath();
+  runtime.report("Contingency analysis");
 
   // Get size of group (communicator) that individual contingency calculations
   // will run on and create a task communicator. Each process is part of only
@@ -190,6 +348,16 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
       print_calcs = true;
     }
   }
+  // Results of individual calculations are written either as text files
+  // for each contingency ("text") or to one binary file per task group
+  // ("binary") that can be converted to text with ca_render.x
+  std::string calc_output;
+  if (!cursor->get("calcOutput",&calc_output)) {
+    calc_output = "text";
+  }
+  util.toLower(calc_output);
+  bool binary_calcs = print_calcs && calc_output == "binary";
+  if (binary_calcs) print_calcs = false;
   if (!cursor->get("groupSize",&grp_size)) {
     grp_size = 1;
   }
@@ -204,6 +372,120 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
   if (!cursor->get("checkQLimit",&check_Qlim)) {
     check_Qlim = false;
   }
+  // Order in which contingencies are handed out ("input" or "cost"), the
+  // number of contingencies handed out at a time and a file of solution
+  // times used as cost estimates. The cost file is rewritten with the
+  // solution times of this run
+  std::string schedule;
+  if (!cursor->get("schedule",&schedule)) {
+    schedule = "input";
+  }
+  util.toLower(schedule);
+  int chunk_size;
+  if (!cursor->get("chunkSize",&chunk_size)) {
+    chunk_size = 1;
+  }
+  std::string cost_file;
+  if (!cursor->get("costFile",&cost_file)) {
+    cost_file = "";
+  }
+  // Screen contingencies with a linearized (DC) model of the base case and
+  // only run AC power flows for the contingencies that are likely to cause
+  // violations. Contingencies are selected if their estimated severity
+  // (largest post contingency loading relative to the rating plus
+  // screenVoltageWeight times the removed reactive power in MVAR) is at
+  // least screenThreshold, or if they are among the screenTopK most severe
+  bool screening;
+  if (!cursor->get("screening",&tmp_bool)) {
+    screening = false;
+  } else {
+    util.toLower(tmp_bool);
+    screening = (tmp_bool == "true");
+  }
+  double screen_threshold;
+  if (!cursor->get("screenThreshold",&screen_threshold)) {
+    screen_threshold = 0.9;
+  }
+  int screen_top_k;
+  if (!cursor->get("screenTopK",&screen_top_k)) {
+    screen_top_k = 0;
+  }
+  double screen_q_weight;
+  if (!cursor->get("screenVoltageWeight",&screen_q_weight)) {
+    screen_q_weight = 0.01;
+  }
+  // Starting point of the contingency solves: "none" restarts from the
+  // voltages in the network configuration file, "base" starts from the base
+  // case solution and "similar" starts from the most recent solved
+  // contingency that removes one of the same elements (or the base case).
+  // Warm started contingencies are first solved with up to chordIterations
+  // iterations on the factored base case Jacobian, which stop when the
+  // mismatch is not reduced by chordRatio, before falling back to a full
+  // Newton solve. The chord iterations correct the base case Jacobian for
+  // the entries changed by the contingency if at most chordRank rows change
+  // (0 disables the correction)
+  std::string warm_start;
+  if (!cursor->get("warmStart",&warm_start)) {
+    warm_start = "none";
+  }
+  util.toLower(warm_start);
+  int chord_iterations;
+  if (!cursor->get("chordIterations",&chord_iterations)) {
+    chord_iterations = 10;
+  }
+  double chord_ratio;
+  if (!cursor->get("chordRatio",&chord_ratio)) {
+    chord_ratio = 0.5;
+  }
+  int warm_cache;
+  if (!cursor->get("warmStartCache",&warm_cache)) {
+    warm_cache = 8;
+  }
+  int chord_rank;
+  if (!cursor->get("chordRank",&chord_rank)) {
+    chord_rank = 16;
+  }
+  // Statistics on the contingencies are either kept for every contingency
+  // in StatBlock objects ("statblock") or folded into running statistics as
+  // the contingencies finish ("stream"). Streaming keeps the per-element
+  // statistics independent of the number of contingencies; only the column
+  // sums of each contingency, three doubles per contingency on every
+  // process, grow with it. In streaming mode the values of each
+  // contingency can also be written to binary files with the prefix
+  // rawStatistics, statisticsBlock contingencies at a time
+  std::string statistics;
+  if (!cursor->get("statistics",&statistics)) {
+    statistics = "statblock";
+  }
+  util.toLower(statistics);
+  bool streaming = (statistics == "stream");
+  std::string raw_stats;
+  if (!cursor->get("rawStatistics",&raw_stats)) {
+    raw_stats = "";
+  }
+  int stats_block;
+  if (!cursor->get("statisticsBlock",&stats_block)) {
+    stats_block = 64;
+  }
+  // Completed contingencies are appended to checkpoint files with the
+  // prefix checkpoint, flushed every checkpointInterval contingencies. With
+  // restart set to true, the contingencies in the checkpoint are restored
+  // instead of being run again
+  std::string ckpt_file;
+  if (!cursor->get("checkpoint",&ckpt_file)) {
+    ckpt_file = "";
+  }
+  int ckpt_interval;
+  if (!cursor->get("checkpointInterval",&ckpt_interval)) {
+    ckpt_interval = 10;
+  }
+  bool restart;
+  if (!cursor->get("restart",&tmp_bool)) {
+    restart = false;
+  } else {
+    util.toLower(tmp_bool);
+    restart = (tmp_bool == "true");
+  }
   gridpack::parallel::Communicator task_comm = world.divide(grp_size);
 
   // Keep track of failed calculations
@@ -243,21 +525,60 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
   if (!cursor->get("contingencyList",&contingencyfile)) {
     contingencyfile = "contingencies.xml";
   }
+  // Echo the contingencies to standard output
+  bool print_list;
+  if (!cursor->get("printContingencies",&tmp_bool)) {
+    print_list = true;
+  } else {
+    util.toLower(tmp_bool);
+    print_list = (tmp_bool != "false");
+  }
+  // Write the contingency list in binary format, so that later runs do not
+  // need to parse the XML file
+  std::string save_list;
+  if (!cursor->get("saveContingencyList",&save_list)) {
+    save_list = "";
+  }
   if (world.rank() == 0) printf("Contingency List: %s\n",contingencyfile.c_str());
-  // Open contingency file
-  bool ok = config->open(contingencyfile,world);
-
-  // Get a list of contingencies. Set cursor so that it points to the
-  // Contingencies block in the contingency file
-  cursor = config->getCursor(
-      "ContingencyList.Contingency_analysis.Contingencies");
-  gridpack::utility::Configuration::ChildCursors contingencies;
-  if (cursor) cursor->children(contingencies);
-  std::vector<gridpack::powerflow::Contingency>
+  std::vector<gridpack::powerflow::Contingency> events;
+  gridpack::contingency_analysis::CAContingencyList ctg_list(world);
+  if (gridpack::contingency_analysis::CAContingencyList::isListFile(
+        contingencyfile)) {
+    // CSV and binary lists are read on process 0 and broadcast
+    if (!ctg_list.read(contingencyfile, events)) {
+      if (world.rank() == 0) {
+        printf("Unable to read contingency list %s\n",
+            contingencyfile.c_str());
+      }
+      timer->stop(t_total);
+      return;
+    }
+  } else {
+    // Open contingency file
+    if (!config->open(contingencyfile,world)) {
+      if (world.rank() == 0) {
+        printf("Unable to open contingency file %s\n",
+            contingencyfile.c_str());
+      }
+      timer->stop(t_total);
+      return;
+    }
+
+    // Get a list of contingencies. Set cursor so that it points to the
+    // Contingencies block in the contingency file
+    cursor = config->getCursor(
+        "ContingencyList.Contingency_analysis.Contingencies");
+    gridpack::utility::Configuration::ChildCursors contingencies;
+    if (cursor) cursor->children(contingencies);
     events = getContingencies(contingencies);
+  }
+  if (!save_list.empty()) ctg_list.write(save_list, events);
+  if (world.rank() == 0) {
+    printf("Number of contingencies: %d\n",static_cast<int>(events.size()));
+  }
   // Contingencies are now available. Print out a list of contingencies from
   // process 0 (the list is replicated on all processors)
-  if (world.rank() == 0) {
+  if (print_list && world.rank() == 0) {
     int idx;
     for (idx = 0; idx < events.size(); idx++) {
       printf("Name: %s\n",events[idx].p_name.c_str());
@@ -281,23 +602,82 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
   }
 
 
-  // Set up task manager on the world communicator. The number of tasks is
-  // equal to the number of contingencies
-  gridpack::parallel::TaskManager taskmgr(world);
+  // Exporter for power flow results, set up from the base case
+  pf_app.saveData();
+  gridpack::contingency_analysis::CAResults results(pf_network,Vmin,Vmax);
+
+  // Aggregated output of the individual calculations, written by process 0
+  // of each task communicator
+  boost::shared_ptr<gridpack::contingency_analysis::CAOutput> output;
+  if (binary_calcs) {
+    char sbuf[128];
+    sprintf(sbuf,"ca_results.%d.bin",world.rank());
+    output.reset(new gridpack::contingency_analysis::CAOutput(task_comm,
+          sbuf,results,Vmin,Vmax));
+  }
+
+  // Keep the base case solution and Jacobian for warm starts
+  boost::shared_ptr<gridpack::contingency_analysis::CAWarmStart> warm;
+  if (warm_start == "base" || warm_start == "similar") {
+    warm.reset(new gridpack::contingency_analysis::CAWarmStart(pf_network,
+          config->getCursor("Configuration.Powerflow"),
+          warm_start == "similar",chord_iterations,chord_ratio,warm_cache,
+          chord_rank));
+  }
+
+  // Select the contingencies that need an AC solution
   int ntasks = events.size();
-  taskmgr.set(ntasks);
+  std::vector<bool> selected(ntasks,true);
+  if (screening) {
+    int t_screen = timer->createCategory("Contingency Screening");
+    timer->start(t_screen);
+    gridpack::contingency_analysis::CAScreen screen(world);
+    screen.setup(results);
+    screen.screen(events, screen_threshold, screen_top_k, screen_q_weight,
+        selected);
+    screen.write("screening.txt", events);
+    timer->stop(t_screen);
+  }
+
+  // Find contingencies completed by a previous run. Only the remaining
+  // contingencies that need an AC solution are scheduled
+  int i;
+  std::vector<bool> completed(ntasks,false);
+  boost::shared_ptr<gridpack::contingency_analysis::CACheckpoint> ckpt;
+#ifdef USE_STATBLOCK
+  if (!ckpt_file.empty()) {
+    ckpt.reset(new gridpack::contingency_analysis::CACheckpoint(world,
+          task_comm,ckpt_file,ckpt_interval,results.numVoltageMagnitudes(),
+          results.numBuses(),results.numGenerators(),
+          results.numBranchElements(),ntasks));
+    ckpt->start(restart,completed);
+  }
+#endif
+  std::vector<bool> todo(selected);
+  for (i=0; i<ntasks; i++) {
+    if (completed[i]) todo[i] = false;
+  }
+
+  // Set up task manager on the world communicator. Each task is a chunk of
+  // contingencies, in input order or ordered by estimated cost
+  gridpack::parallel::TaskManager taskmgr(world);
+  int nchunks = scheduleTasks(events, todo, schedule == "cost",
+      cost_file, chunk_size, world);
+  taskmgr.set(nchunks);
+  if (world.rank() == 0) {
+    printf("Scheduling %d contingencies in %s order, %d per task\n",
+        static_cast<int>(p_order.size()),schedule == "cost" ? "cost" : "input",p_chunk_size);
+  }
 
   int nbus = pf_network->totalBuses();
-  // Get bus voltage information for base case
-  int i, j;
 #ifdef USE_STATBLOCK
+  // Get bus, generator and branch information for base case. The values are
+  // exported directly into numerical buffers that are reused for every
+  // contingency
   int t_store = timer->createCategory("Store Statistics");
   timer->start(t_store);
-  std::vector<std::string> v_vals = pf_app.writeBusString("vr_str");
-  int nsize = v_vals.size();
   std::vector<int> mag_ids;
   std::vector<int> ids;
-  std::vector<int> branch_ids;
   std::vector<std::string> mag_tags;
   std::vector<std::string> tags;
   std::vector<double> vmag;
@@ -306,33 +686,18 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
   std::vector<int> mask;
   // Find bus IDs and create a dummy tag label and get voltage magnitude
   // and angle for base case
-  for (i=0; i<nsize; i++) {
-    std::vector<std::string> tokens = util.blankTokenizer(v_vals[i]);
-    int not_isolated = atoi(tokens[3].c_str());
-    if (not_isolated == 1) {
-      mag_ids.push_back(atoi(tokens[0].c_str()));
-      mag_tags.push_back("1 ");
-      vmag.push_back(atof(tokens[2].c_str()));
-      if (atoi(tokens[4].c_str()) != 0) {
-        mag_mask.push_back(2);
-      } else {
-        mag_mask.push_back(1);
-      }
-    }
-    ids.push_back(atoi(tokens[0].c_str()));
-    tags.push_back("1 ");
-    vang.push_back(atof(tokens[1].c_str()));
-    mask.push_back(1);
-  }
-  int nmags = vmag.size();
-  world.max(&nmags,1);
-  world.max(&nbus,1);
+  results.getBusLabels(mag_ids, mag_tags, ids, tags);
+  results.exportBuses(vmag, mag_mask, vang, mask, true);
+  int nmags = results.numVoltageMagnitudes();
+  nbus = results.numBuses();
 #endif
-  // Create StatBlock objects for voltage magnitude and angles and add
+  // Create statistics objects for voltage magnitude and angles and add
   // bus IDs to it
 #ifdef USE_STATBLOCK
-  gridpack::analysis::StatBlock vmag_stats(world,nmags,ntasks+1);
-  gridpack::analysis::StatBlock vang_stats(world,nbus,ntasks+1);
+  gridpack::contingency_analysis::CAStatistics vmag_stats(world,nmags,ntasks+1,
+      streaming,raw_stats.empty() ? "" : raw_stats+"_vmag",stats_block);
+  gridpack::contingency_analysis::CAStatistics vang_stats(world,nbus,ntasks+1,
+      streaming,raw_stats.empty() ? "" : raw_stats+"_vang",stats_block);
 #endif
   // Add bus IDs and tags to StatBlock objects as well as base case values of
   // voltage magnitude and angle
@@ -346,101 +711,62 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
 #endif
   // Get generator power information
 #ifdef USE_STATBLOCK
-  v_vals.clear();
-  ids.clear();
-  tags.clear();
-  mask.clear();
   std::vector<double> pgen;
   std::vector<double> qgen;
-  v_vals = pf_app.writeBusString("power");
-  nsize = v_vals.size();
+  std::vector<int> gen_mask;
   // Find bus IDs and tags for generators and eveluate Pg and Qg for base case
-  for (i=0; i<nsize; i++) {
-    std::vector<std::string> tokens = util.blankTokenizer(v_vals[i]);
-    if (tokens.size()%4 != 0) {
-      printf("Incorrect generator listing\n");
-      continue;
-    }
-    int ngen = tokens.size()/4;
-    for (j=0; j<ngen; j++) {
-      ids.push_back(atoi(tokens[j*4].c_str()));
-      tags.push_back(tokens[j*4+1]);
-      pgen.push_back(atof(tokens[j*4+2].c_str()));
-      qgen.push_back(atof(tokens[j*4+3].c_str()));
-      mask.push_back(1);
-    }
-  }
-  nsize = pgen.size();
-  world.max(&nsize,1);
+  results.getGeneratorLabels(ids, tags);
+  results.exportGenerators(pgen, qgen, gen_mask, true);
+  int nsize = results.numGenerators();
 #endif
   // Create StatBlock objects for Pg and Qg and add labels as well as values for
   // base case
 #ifdef USE_STATBLOCK
-  gridpack::analysis::StatBlock pgen_stats(world,nsize,ntasks+1);
-  gridpack::analysis::StatBlock qgen_stats(world,nsize,ntasks+1);
+  gridpack::contingency_analysis::CAStatistics pgen_stats(world,nsize,ntasks+1,
+      streaming,raw_stats.empty() ? "" : raw_stats+"_pgen",stats_block);
+  gridpack::contingency_analysis::CAStatistics qgen_stats(world,nsize,ntasks+1,
+      streaming,raw_stats.empty() ? "" : raw_stats+"_qgen",stats_block);
   if (world.rank() == 0) {
     pgen_stats.addRowLabels(ids, tags);
     qgen_stats.addRowLabels(ids, tags);
-    pgen_stats.addColumnValues(0,pgen,mask);
-    qgen_stats.addColumnValues(0,qgen,mask);
+    pgen_stats.addColumnValues(0,pgen,gen_mask);
+    qgen_stats.addColumnValues(0,qgen,gen_mask);
   }
 #endif
 
   // Find flow parameters for all branch lines
 #ifdef USE_STATBLOCK
-  v_vals.clear();
-  ids.clear();
-  tags.clear();
-  mask.clear();
   std::vector<int> id1;
   std::vector<int> id2;
   std::vector<double> pmin, pmax;
   std::vector<double> pflow;
   std::vector<double> qflow;
   std::vector<double> perf;
-  v_vals = pf_app.writeBranchString("flow_str");
-  nsize = v_vals.size();
-  // Parse branch line endpoints as well as line IDs and values of P and Q for
+  std::vector<int> flow_mask;
+  // Get branch line endpoints as well as line IDs and values of P and Q for
   // base case
-  for (i=0; i<nsize; i++) {
-    std::vector<std::string> tokens = util.blankTokenizer(v_vals[i]);
-    if (tokens.size()%8 != 0) {
-      printf("Incorrect branch power flow listing\n");
-      continue;
-    }
-    int nline = tokens.size()/8;
-    for (j=0; j<nline; j++) {
-      id1.push_back(atoi(tokens[j*8].c_str()));
-      id2.push_back(atoi(tokens[j*8+1].c_str()));
-      tags.push_back(tokens[j*8+2]);
-      pflow.push_back(atof(tokens[j*8+3].c_str()));
-      qflow.push_back(atof(tokens[j*8+4].c_str()));
-      perf.push_back(atof(tokens[j*8+5].c_str()));
-      pmin.push_back(-atof(tokens[j*8+6].c_str()));
-      pmax.push_back(atof(tokens[j*8+6].c_str()));
-      if (atoi(tokens[j*8+7].c_str()) == 0) {
-        mask.push_back(1);
-      } else {
-        mask.push_back(2);
-      }
-    }
-  }
-  nsize = pflow.size();
-  world.max(&nsize,1);
+  results.getBranchLabels(id1, id2, tags, pmax);
+  pmin.resize(pmax.size());
+  for (i=0; i<pmax.size(); i++) pmin[i] = -pmax[i];
+  results.exportBranches(pflow, qflow, perf, flow_mask, true);
+  nsize = results.numBranchElements();
 #endif
   // Create StatBlock objects for flow parameters and add labels and base case
   // values
 #ifdef USE_STATBLOCK
-  gridpack::analysis::StatBlock pflow_stats(world,nsize,ntasks+1);
-  gridpack::analysis::StatBlock qflow_stats(world,nsize,ntasks+1);
-  gridpack::analysis::StatBlock perf_stats(world,nsize,ntasks+1);
+  gridpack::contingency_analysis::CAStatistics pflow_stats(world,nsize,ntasks+1,
+      streaming,raw_stats.empty() ? "" : raw_stats+"_pflow",stats_block);
+  gridpack::contingency_analysis::CAStatistics qflow_stats(world,nsize,ntasks+1,
+      streaming,raw_stats.empty() ? "" : raw_stats+"_qflow",stats_block);
+  gridpack::contingency_analysis::CAStatistics perf_stats(world,nsize,ntasks+1,
+      streaming,raw_stats.empty() ? "" : raw_stats+"_perf",stats_block);
   if (world.rank() == 0) {
     pflow_stats.addRowLabels(id1, id2, tags);
     qflow_stats.addRowLabels(id1, id2, tags);
     perf_stats.addRowLabels(id1, id2, tags);
-    pflow_stats.addColumnValues(0,pflow,mask);
-    qflow_stats.addColumnValues(0,qflow,mask);
-    perf_stats.addColumnValues(0,perf,mask);
+    pflow_stats.addColumnValues(0,pflow,flow_mask);
+    qflow_stats.addColumnValues(0,qflow,flow_mask);
+    perf_stats.addColumnValues(0,perf,flow_mask);
     pflow_stats.addRowMinValue(pmin);
     qflow_stats.addRowMinValue(pmin);
     pflow_stats.addRowMaxValue(pmax);
@@ -456,7 +782,38 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
   char sbuf[128];
   // nextTask returns the same task_id on all processors in task_comm. When the
   // calculation runs out of task, nextTask will return false.
-  while (taskmgr.nextTask(task_comm, &task_id)) {
+  std::vector<double> task_time(ntasks,0.0);
+  // Add the contingencies restored from the checkpoint to the statistics
+  // from process 0
+#ifdef USE_STATBLOCK
+  if (ckpt && world.rank() == 0) {
+    timer->start(t_store);
+    bool rsuccess;
+    int rviolation;
+    double rtime;
+    while (ckpt->replay(task_id, rsuccess, rviolation, rtime, vmag,
+          mag_mask, vang, mask, pgen, qgen, gen_mask, pflow, qflow, perf,
+          flow_mask)) {
+#ifdef USE_SUCCESS
+      contingency_idx.push_back(task_id);
+      contingency_success.push_back(rsuccess);
+      contingency_violation.push_back(rviolation);
+#endif
+      vmag_stats.addColumnValues(task_id+1,vmag,mag_mask);
+      vang_stats.addColumnValues(task_id+1,vang,mask);
+      pgen_stats.addColumnValues(task_id+1,pgen,gen_mask);
+      qgen_stats.addColumnValues(task_id+1,qgen,gen_mask);
+      pflow_stats.addColumnValues(task_id+1,pflow,flow_mask);
+      qflow_stats.addColumnValues(task_id+1,qflow,flow_mask);
+      perf_stats.addColumnValues(task_id+1,perf,flow_mask);
+      task_time[task_id] = rtime;
+    }
+    timer->stop(t_store);
+  }
+#endif
+  int group_tasks = 0;
+  double t_loop = timer->currentTime();
+  while (nextTask(taskmgr, task_comm, &task_id)) {
     printf("Executing task %d on process %d\n",task_id,world.rank());
     sprintf(sbuf,"%s.out",events[task_id].p_name.c_str());
     // Open a new file, based on the contingency name, to store results from
@@ -473,10 +830,12 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
         sprintf(sbuf," Line: (from) %d (to) %d (line) \'%s\'\n",
             events[task_id].p_from[j],events[task_id].p_to[j],
             events[task_id].p_ckt[j].c_str());
-        printf("p[%d] Line: (from) %d (to) %d (line) \'%s\'\n",
-            pf_network->communicator().rank(),
-            events[task_id].p_from[j],events[task_id].p_to[j],
-            events[task_id].p_ckt[j].c_str());
+        if (print_list) {
+          printf("p[%d] Line: (from) %d (to) %d (line) \'%s\'\n",
+              pf_network->communicator().rank(),
+              events[task_id].p_from[j],events[task_id].p_to[j],
+              events[task_id].p_ckt[j].c_str());
+        }
       }
     } else if (events[task_id].p_type == Generator) {
       int nbus = events[task_id].p_busid.size();
@@ -484,27 +843,42 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
       for (j=0; j<nbus; j++) {
         sprintf(sbuf," Generator: (bus) %d (generator ID) \'%s\'\n",
             events[task_id].p_busid[j],events[task_id].p_genid[j].c_str());
-        printf("p[%d] Generator: (bus) %d (generator ID) \'%s\'\n",
-            pf_network->communicator().rank(),
-            events[task_id].p_busid[j],events[task_id].p_genid[j].c_str());
+        if (print_list) {
+          printf("p[%d] Generator: (bus) %d (generator ID) \'%s\'\n",
+              pf_network->communicator().rank(),
+              events[task_id].p_busid[j],events[task_id].p_genid[j].c_str());
+        }
       }
     }
     if (print_calcs) pf_app.writeHeader(sbuf);
-    // Reset all voltages back to their original values
-    pf_app.resetVoltages();
+    // Reset all voltages back to their original values, or to the warm
+    // start point
+    if (warm) {
+      warm->seed(events[task_id]);
+    } else {
+      pf_app.resetVoltages();
+    }
     // Set contingency
     pf_app.setContingency(events[task_id]);
     // Solve power flow equations for this system
 #ifdef USE_SUCCESS
     contingency_idx.push_back(task_id);
 #endif
-    if (pf_app.solve()) {
+    double t_solve = timer->currentTime();
+    bool solved = false;
+    if (warm) solved = warm->solve();
+    if (!solved) solved = pf_app.solve();
+    if (solved && check_Qlim && !pf_app.checkQlimViolations()) {
+      pf_app.solve();
+    }
+    t_solve = timer->currentTime()-t_solve;
+    if (solved && warm) warm->save(events[task_id]);
+    if (task_comm.rank() == 0) task_time[task_id] = t_solve;
+    group_tasks++;
+    if (solved) {
 #ifdef USE_SUCCESS
       contingency_success.push_back(true);
 #endif
-      if (check_Qlim && !pf_app.checkQlimViolations()) {
-        pf_app.solve();
-      }
       // If power flow solution is successful, write out voltages and currents
       if (print_calcs) pf_app.write();
       // Check for violations
@@ -542,98 +916,36 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
         
       if (print_calcs) pf_app.print(sbuf);
       if (print_calcs) pf_app.writeCABranch();
-      // Get strings of data from power flow calculation and parse them to
-      // extract numerical values. Store these values in vectors and then
-      // add them to StatBlock objects
+      // Export numerical values from the power flow calculation into the
+      // buffers and add them to StatBlock objects
 #ifdef USE_STATBLOCK
       timer->start(t_store);
-      vmag.clear();
-      vang.clear();
-      mask.clear();
-      mag_mask.clear();
-      v_vals.clear();
-      v_vals = pf_app.writeBusString("vr_str");
-      nsize = v_vals.size();
-      for (i=0; i<nsize; i++) {
-        std::vector<std::string> tokens = util.blankTokenizer(v_vals[i]);
-        int not_isolated = atoi(tokens[3].c_str());
-        if (not_isolated == 1) {
-          vmag.push_back(atof(tokens[2].c_str()));
-          if (atoi(tokens[4].c_str()) != 0) {
-            mag_mask.push_back(2);
-          } else {
-            mag_mask.push_back(1);
-          }
-        }
-        vang.push_back(atof(tokens[1].c_str()));
-        mask.push_back(1);
-      }
-#endif
-#ifdef USE_STATBLOCK
+      results.exportBuses(vmag, mag_mask, vang, mask, true);
       if (task_comm.rank() == 0) {
         vmag_stats.addColumnValues(task_id+1,vmag,mag_mask);
         vang_stats.addColumnValues(task_id+1,vang,mask);
       }
-#endif
-#ifdef USE_STATBLOCK
-      pgen.clear();
-      qgen.clear();
-      mask.clear();
-      v_vals.clear();
-      v_vals = pf_app.writeBusString("power");
-      nsize = v_vals.size();
-      for (i=0; i<nsize; i++) {
-        std::vector<std::string> tokens = util.blankTokenizer(v_vals[i]);
-        if (tokens.size()%4 != 0) {
-          printf("Incorrect generator listing\n");
-          continue;
-        }
-        int ngen = tokens.size()/4;
-        for (j=0; j<ngen; j++) {
-          pgen.push_back(atof(tokens[j*4+2].c_str()));
-          qgen.push_back(atof(tokens[j*4+3].c_str()));
-          mask.push_back(1);
-        }
+      pf_app.saveData();
+      results.exportGenerators(pgen, qgen, gen_mask, true);
+      if (task_comm.rank() == 0) {
+        pgen_stats.addColumnValues(task_id+1,pgen,gen_mask);
+        qgen_stats.addColumnValues(task_id+1,qgen,gen_mask);
       }
-#endif
-#ifdef USE_STATBLOCK
+      results.exportBranches(pflow, qflow, perf, flow_mask, true);
       if (task_comm.rank() == 0) {
-        pgen_stats.addColumnValues(task_id+1,pgen,mask);
-        qgen_stats.addColumnValues(task_id+1,qgen,mask);
+        pflow_stats.addColumnValues(task_id+1,pflow,flow_mask);
+        qflow_stats.addColumnValues(task_id+1,qflow,flow_mask);
+        perf_stats.addColumnValues(task_id+1,perf,flow_mask);
       }
-#endif
-#ifdef USE_STATBLOCK
-      pflow.clear();
-      qflow.clear();
-      perf.clear();
-      mask.clear();
-      v_vals.clear();
-      v_vals = pf_app.writeBranchString("flow_str");
-      nsize = v_vals.size();
-      for (i=0; i<nsize; i++) {
-        std::vector<std::string> tokens = util.blankTokenizer(v_vals[i]);
-        if (tokens.size()%8 != 0) {
-          printf("Incorrect branch power flow listing\n");
-          continue;
-        }
-        int nline = tokens.size()/8;
-        for (j=0; j<nline; j++) {
-          pflow.push_back(atof(tokens[j*8+3].c_str()));
-          qflow.push_back(atof(tokens[j*8+4].c_str()));
-          perf.push_back(atof(tokens[j*8+5].c_str()));
-          if (atoi(tokens[j*8+7].c_str()) == 0) {
-            mask.push_back(1);
-          } else {
-            mask.push_back(2);
-          }
-        }
+      int violation = ok ? 1 : (!ok1 && !ok2 ? 4 : (!ok1 ? 2 : 3));
+      if (output) {
+        output->addRecord(events[task_id].p_name, true, violation, vmag,
+            mag_mask, vang, mask, pgen, qgen, gen_mask, pflow, qflow, perf,
+            flow_mask);
       }
-#endif
-#ifdef USE_STATBLOCK
-      if (task_comm.rank() == 0) {
-        pflow_stats.addColumnValues(task_id+1,pflow,mask);
-        qflow_stats.addColumnValues(task_id+1,qflow,mask);
-        perf_stats.addColumnValues(task_id+1,perf,mask);
+      if (ckpt && task_comm.rank() == 0) {
+        ckpt->save(task_id, true, violation, t_solve, vmag, mag_mask, vang,
+            mask, pgen, qgen, gen_mask, pflow, qflow, perf, flow_mask);
       }
       timer->stop(t_store);
 #endif
@@ -650,85 +962,25 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
       // network elements to indicate calculation failure
 #ifdef USE_STATBLOCK
       timer->start(t_store);
-      vmag.clear();
-      vang.clear();
-      mask.clear();
-      mag_mask.clear();
-      v_vals.clear();
-      v_vals = pf_app.writeBusString("vfail_str");
-      nsize = v_vals.size();
-      for (i=0; i<nsize; i++) {
-        std::vector<std::string> tokens = util.blankTokenizer(v_vals[i]);
-        int not_isolated = atoi(tokens[3].c_str());
-        if (not_isolated == 1) {
-          vmag.push_back(0.0);
-          mag_mask.push_back(0);
-        }
-        vang.push_back(0.0);
-        mask.push_back(0);
-      }
-#endif
-#ifdef USE_STATBLOCK
+      results.exportBuses(vmag, mag_mask, vang, mask, false);
+      results.exportGenerators(pgen, qgen, gen_mask, false);
+      results.exportBranches(pflow, qflow, perf, flow_mask, false);
       if (task_comm.rank() == 0) {
         vmag_stats.addColumnValues(task_id+1,vmag,mag_mask);
         vang_stats.addColumnValues(task_id+1,vang,mask);
+        pgen_stats.addColumnValues(task_id+1,pgen,gen_mask);
+        qgen_stats.addColumnValues(task_id+1,qgen,gen_mask);
+        pflow_stats.addColumnValues(task_id+1,pflow,flow_mask);
+        qflow_stats.addColumnValues(task_id+1,qflow,flow_mask);
+        perf_stats.addColumnValues(task_id+1,perf,flow_mask);
       }
-#endif
-#ifdef USE_STATBLOCK
-      pgen.clear();
-      qgen.clear();
-      mask.clear();
-      v_vals.clear();
-      v_vals = pf_app.writeBusString("pfail_str");
-      nsize = v_vals.size();
-      for (i=0; i<nsize; i++) {
-        std::vector<std::string> tokens = util.blankTokenizer(v_vals[i]);
-        if (tokens.size()%4 != 0) {
-          printf("Incorrect generator listing\n");
-          continue;
-        }
-        int ngen = tokens.size()/4;
-        for (j=0; j<ngen; j++) {
-          pgen.push_back(0.0);
-          qgen.push_back(0.0);
-          mask.push_back(0);
-        }
-      }
-#endif
-#ifdef USE_STATBLOCK
-      if (task_comm.rank() == 0) {
-        pgen_stats.addColumnValues(task_id+1,pgen,mask);
-        qgen_stats.addColumnValues(task_id+1,qgen,mask);
-      }
-#endif
-#ifdef USE_STATBLOCK
-      pflow.clear();
-      qflow.clear();
-      perf.clear();
-      mask.clear();
-      v_vals.clear();
-      v_vals = pf_app.writeBranchString("fail_str");
-      nsize = v_vals.size();
-      for (i=0; i<nsize; i++) {
-        std::vector<std::string> tokens = util.blankTokenizer(v_vals[i]);
-        if (tokens.size()%8 != 0) {
-          printf("Incorrect branch power flow listing\n");
-          continue;
-        }
-        int nline = tokens.size()/8;
-        for (j=0; j<nline; j++) {
-          pflow.push_back(0.0);
-          qflow.push_back(0.0);
-          perf.push_back(0.0);
-          mask.push_back(0);
-        }
+      if (output) {
+        output->addRecord(events[task_id].p_name, false, 0, vmag, mag_mask,
+            vang, mask, pgen, qgen, gen_mask, pflow, qflow, perf, flow_mask);
       }
-#endif
-#ifdef USE_STATBLOCK
-      if (task_comm.rank() == 0) {
-        pflow_stats.addColumnValues(task_id+1,pflow,mask);
-        qflow_stats.addColumnValues(task_id+1,qflow,mask);
-        perf_stats.addColumnValues(task_id+1,perf,mask);
+      if (ckpt && task_comm.rank() == 0) {
+        ckpt->save(task_id, false, 0, t_solve, vmag, mag_mask, vang, mask,
+            pgen, qgen, gen_mask, pflow, qflow, perf, flow_mask);
       }
       timer->stop(t_store);
 #endif
@@ -738,9 +990,71 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
     // Close output file for this contingency
     if (print_calcs) pf_app.close();
   }
+  if (output) output->close();
+  // Contingencies removed by screening are recorded from process 0 as
+  // successful without violations. They are added to the statistics with
+  // mask 0, like failed calculations, so they do not enter the statistics
+#ifdef USE_STATBLOCK
+  timer->start(t_store);
+#endif
+  for (task_id=0; task_id<ntasks; task_id++) {
+    if (selected[task_id] || world.rank() != 0) continue;
+#ifdef USE_SUCCESS
+    contingency_idx.push_back(task_id);
+    contingency_success.push_back(true);
+    contingency_violation.push_back(5);
+#endif
+#ifdef USE_STATBLOCK
+    results.exportBuses(vmag, mag_mask, vang, mask, false);
+    results.exportGenerators(pgen, qgen, gen_mask, false);
+    results.exportBranches(pflow, qflow, perf, flow_mask, false);
+    vmag_stats.addColumnValues(task_id+1,vmag,mag_mask);
+    vang_stats.addColumnValues(task_id+1,vang,mask);
+    pgen_stats.addColumnValues(task_id+1,pgen,gen_mask);
+    qgen_stats.addColumnValues(task_id+1,qgen,gen_mask);
+    pflow_stats.addColumnValues(task_id+1,pflow,flow_mask);
+    qflow_stats.addColumnValues(task_id+1,qflow,flow_mask);
+    perf_stats.addColumnValues(task_id+1,perf,flow_mask);
+#endif
+  }
+#ifdef USE_STATBLOCK
+  timer->stop(t_store);
+#endif
+
+  // Time spent by this group on contingencies, waiting for the task manager
+  // and waiting for the other groups to finish
+  double t_busy = timer->currentTime()-t_loop-p_wait_time;
+  double t_tail = timer->currentTime();
+  world.barrier();
+  t_tail = timer->currentTime()-t_tail;
   // Print statistics from task manager describing the number of tasks performed
   // per processor
   taskmgr.printStats();
+  if (warm) warm->printStats(world);
+  // Report load balance of the task communicators from the first process in
+  // each group
+  std::vector<double> group_stats(5*world.size(),0.0);
+  if (task_comm.rank() == 0) {
+    group_stats[5*world.rank()] = 1.0;
+    group_stats[5*world.rank()+1] = group_tasks;
+    group_stats[5*world.rank()+2] = t_busy;
+    group_stats[5*world.rank()+3] = p_wait_time;
+    group_stats[5*world.rank()+4] = t_tail;
+  }
+  world.sum(&group_stats[0],group_stats.size());
+  if (world.rank() == 0) {
+    printf("\nGroup load balance (process, contingencies, busy (s),"
+        " task manager wait (s), idle at end (s))\n");
+    for (i=0; i<world.size(); i++) {
+      if (group_stats[5*i] == 0.0) continue;
+      printf("  %6d %8d %12.4f %12.4f %12.4f\n",i,
+          static_cast<int>(group_stats[5*i+1]),group_stats[5*i+2],
+          group_stats[5*i+3],group_stats[5*i+4]);
+    }
+  }
+  // Save solution times as cost estimates for the next run
+  if (ntasks > 0) world.sum(&task_time[0],ntasks);
+  writeTaskCosts(cost_file, events, task_time, world);
 
   // Gather stats on successful contingency calculations
 #ifdef USE_SUCCESS
@@ -772,6 +1086,8 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
           fout << " violation: branch" << std::endl;
         } else if (contingency_violation[i] == 4) {
           fout << " violation: bus and branch" << std::endl;
+        } else if (contingency_violation[i] == 5) {
+          fout << " violation: none (screened)" << std::endl;
         }
       } else {
         fout << "contingency: " << i+1 << " success: false" << std::endl;
@@ -788,6 +1104,7 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
   vmag_stats.writeMeanAndRMS("vmag.txt",1,false);
   vmag_stats.writeMinAndMax("vmag_mm.txt",1,false);
   if (check_Qlim) vmag_stats.writeMaskValueCount("pq_change_cnt.txt",2,false);
+  vmag_stats.writeMaskValueCount("vmag_viol_cnt.txt",3,false);
   vang_stats.writeMeanAndRMS("vang.txt",1,false);
   vang_stats.writeMinAndMax("vang_mm.txt",1,false);
   pgen_stats.writeMeanAndRMS("pgen.txt",1);
@@ -807,7 +1124,7 @@ void gridpack::contingency_analysis::CADriver::execute(int argc, char** argv)
   // If all processors executed at least one task, then print out timing
   // statistics (this printout does not work if some processors do not define
   // all timing variables)
-  if (contingencies.size()*grp_size >= world.size()) {
+  if (events.size()*grp_size >= world.size()) {
     timer->dump();
   }
 }
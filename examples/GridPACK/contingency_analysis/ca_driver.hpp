@@ -20,6 +20,7 @@
 
 #include "gridpack/include/gridpack.hpp"
 #include "gridpack/applications/modules/powerflow/pf_app_module.hpp"
+#include "gridpack_runtime.hpp"
 
 namespace gridpack {
 namespace contingency_analysis {
@@ -71,10 +72,72 @@ class CADriver
      * Execute application
      * @param argc number of arguments
      * @param argv list of character strings
+     * @param runtime runtime of the application. MA is sized from the
+     *        network and the math libraries are started once the input has
+     *        been read
      */
-    void execute(int argc, char** argv);
+    void execute(int argc, char** argv, gridpack::Runtime &runtime);
 
     private:
+
+    /**
+     * Set the order in which contingencies are handed out. In cost order
+     * the most expensive contingencies are run first, so that no group is
+     * left with a slow case at the end of the run. The estimated cost of a
+     * contingency is its solution time from a previous run, if the cost
+     * file has an entry for it, and otherwise the number of elements it
+     * removes times the mean solution time per element
+     * @param events list of contingencies
+     * @param selected contingencies to schedule, others are skipped
+     * @param cost_order true to order by estimated cost, false to keep
+     *        input order
+     * @param cost_file file with solution times from a previous run (may be
+     *        empty)
+     * @param chunk_size number of contingencies handed out at a time
+     * @param comm world communicator
+     * @return number of chunks to be handed out by the task manager
+     */
+    int scheduleTasks(std::vector<gridpack::powerflow::Contingency> &events,
+        std::vector<bool> &selected, bool cost_order, std::string cost_file, int chunk_size,
+        const gridpack::parallel::Communicator &comm);
+
+    /**
+     * Get the next contingency for this task communicator. A new chunk of
+     * contingencies is requested from the task manager when the current one
+     * is used up, and the time spent waiting for it is accumulated
+     * @param taskmgr task manager distributing chunks of contingencies
+     * @param task_comm task communicator
+     * @param task_id index of next contingency
+     * @return false if there are no contingencies left
+     */
+    bool nextTask(gridpack::parallel::TaskManager &taskmgr,
+        gridpack::parallel::Communicator &task_comm, int *task_id);
+
+    /**
+     * Write solution time of each contingency so that later runs can use
+     * them as cost estimates
+     * @param cost_file name of cost file
+     * @param events list of contingencies
+     * @param times solution time of each contingency, summed over all
+     *        processors
+     * @param comm world communicator
+     */
+    void writeTaskCosts(std::string cost_file,
+        std::vector<gridpack::powerflow::Contingency> &events,
+        std::vector<double> &times,
+        const gridpack::parallel::Communicator &comm);
+
+    // Contingencies in the order they are handed out
+    std::vector<int> p_order;
+
+    // Number of contingencies in a chunk and range of contingencies left in
+    // the current chunk
+    int p_chunk_size;
+    int p_next;
+    int p_last;
+
+    // Time spent waiting for the task manager
+    double p_wait_time;
 };
 
 } // contingency analysis 
@@ -14,9 +14,8 @@
 // -------------------------------------------------------------
 
 #include "mpi.h"
-#include <ga.h>
-#include <macdecls.h>
-#include "gridpack/math/math.hpp"
+#include "gridpack/include/gridpack.hpp"
+#include "gridpack_runtime.hpp"
 #include "ca_driver.hpp"
 
 // Calling program for the contingency_analysis applications
@@ -24,25 +23,17 @@
 int
 main(int argc, char **argv)
 {
-  // Initialize MPI libraries
-  int ierr = MPI_Init(&argc, &argv);
-
-  GA_Initialize();
-  int stack = 200000, heap = 200000;
-  MA_init(C_DBL, stack, heap);
-
-  // Intialize Math libraries
-  gridpack::math::Initialize(&argc,&argv);
-
-  gridpack::contingency_analysis::CADriver driver;
-  driver.execute(argc, argv);
-
-  GA_Terminate();
-
-  // Terminate Math libraries
-  gridpack::math::Finalize();
-  // Clean up MPI libraries
-  ierr = MPI_Finalize();
-  //return ierr;
+  // Initialize MPI and GA libraries. The driver sizes MA from the network
+  // and starts the math libraries once it has read the input
+  gridpack::Runtime runtime(argc, argv);
+
+  {
+    gridpack::contingency_analysis::CADriver driver;
+    driver.execute(argc, argv, runtime);
+  }
+
+  // The math libraries, GA and MPI are terminated when the runtime goes
+  // out of scope
+  return 0;
 }
 
@@ -0,0 +1,250 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_output.cpp
+ *
+ * @brief Aggregated binary output of the individual contingency
+ *        calculations.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#include <cstring>
+#include "ca_output.hpp"
+#include "ca_output_format.hpp"
+
+/**
+ * Basic constructor. Writes the file header with the labels of all
+ * network elements
+ * @param comm task communicator
+ * @param filename name of the output file
+ * @param results exporter of the power flow results
+ * @param Vmin minimum allowed bus voltage magnitude
+ * @param Vmax maximum allowed bus voltage magnitude
+ * @param async write records from a background thread
+ */
+gridpack::contingency_analysis::CAOutput::CAOutput(
+    const gridpack::parallel::Communicator &comm, std::string filename,
+    CAResults &results, double Vmin, double Vmax, bool async)
+{
+  p_file = NULL;
+  p_async = async;
+  p_offset = 0;
+  p_done = false;
+  if (comm.rank() != 0) return;
+  p_file = fopen(filename.c_str(),"wb");
+  if (!p_file) {
+    printf("Unable to open contingency output file %s\n",filename.c_str());
+    return;
+  }
+
+  std::vector<int> mag_ids, ids, gen_ids, id1, id2;
+  std::vector<std::string> mag_tags, tags, gen_tags, ckt_tags;
+  std::vector<double> rating;
+  results.getBusLabels(mag_ids, mag_tags, ids, tags);
+  results.getGeneratorLabels(gen_ids, gen_tags);
+  results.getBranchLabels(id1, id2, ckt_tags, rating);
+
+  std::vector<char> buf;
+  buf.insert(buf.end(),CA_OUTPUT_MAGIC,CA_OUTPUT_MAGIC+CA_MAGIC_LENGTH);
+  pack(buf,static_cast<int>(mag_ids.size()));
+  pack(buf,static_cast<int>(ids.size()));
+  pack(buf,static_cast<int>(gen_ids.size()));
+  pack(buf,static_cast<int>(id1.size()));
+  std::vector<double> limits(2);
+  limits[0] = Vmin;
+  limits[1] = Vmax;
+  pack(buf,limits);
+  pack(buf,mag_ids);
+  pack(buf,ids);
+  pack(buf,gen_ids);
+  int i;
+  for (i=0; i<gen_tags.size(); i++) pack(buf,gen_tags[i]);
+  pack(buf,id1);
+  pack(buf,id2);
+  for (i=0; i<ckt_tags.size(); i++) pack(buf,ckt_tags[i]);
+  pack(buf,rating);
+  fwrite(&buf[0],1,buf.size(),p_file);
+  p_offset = buf.size();
+
+  if (p_async) p_thread = std::thread(&CAOutput::run,this);
+}
+
+/**
+ * Basic destructor. Closes the file if close has not been called
+ */
+gridpack::contingency_analysis::CAOutput::~CAOutput(void)
+{
+  close();
+}
+
+/**
+ * Add the results of one contingency. The buffers are the ones filled
+ * by CAResults
+ * @param name contingency name
+ * @param success true if the power flow calculation converged
+ * @param violation violation code, as in success.txt
+ * @param vmag voltage magnitudes
+ * @param mag_mask masks for voltage magnitudes
+ * @param vang voltage angles (degrees)
+ * @param mask masks for voltage angles
+ * @param pgen generator real power
+ * @param qgen generator reactive power
+ * @param gen_mask masks for generator values
+ * @param pflow real power flow on each branch element
+ * @param qflow reactive power flow on each branch element
+ * @param perf loading of each branch element
+ * @param flow_mask masks for branch values
+ */
+void gridpack::contingency_analysis::CAOutput::addRecord(
+    const std::string &name, bool success, int violation,
+    std::vector<double> &vmag, std::vector<int> &mag_mask,
+    std::vector<double> &vang, std::vector<int> &mask,
+    std::vector<double> &pgen, std::vector<double> &qgen,
+    std::vector<int> &gen_mask, std::vector<double> &pflow,
+    std::vector<double> &qflow, std::vector<double> &perf,
+    std::vector<int> &flow_mask)
+{
+  if (!p_file) return;
+  std::vector<char> buf;
+  buf.reserve(9*(vmag.size()+vang.size())+17*pgen.size()
+      +25*pflow.size()+name.size()+16);
+  pack(buf,name);
+  pack(buf,static_cast<int>(success));
+  pack(buf,violation);
+  pack(buf,vmag);
+  packMask(buf,mag_mask);
+  pack(buf,vang);
+  packMask(buf,mask);
+  pack(buf,pgen);
+  pack(buf,qgen);
+  packMask(buf,gen_mask);
+  pack(buf,pflow);
+  pack(buf,qflow);
+  pack(buf,perf);
+  packMask(buf,flow_mask);
+  if (!p_async) {
+    write(name,buf);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(p_mutex);
+  p_queue.push_back(std::make_pair(name,std::vector<char>()));
+  p_queue.back().second.swap(buf);
+  p_cond.notify_one();
+}
+
+/**
+ * Wait for all records to be written, then write the index and close
+ * the file
+ */
+void gridpack::contingency_analysis::CAOutput::close(void)
+{
+  if (!p_file) return;
+  if (p_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(p_mutex);
+      p_done = true;
+    }
+    p_cond.notify_one();
+    p_thread.join();
+  }
+  std::vector<char> buf;
+  pack(buf,static_cast<int>(p_names.size()));
+  int i;
+  for (i=0; i<p_names.size(); i++) {
+    pack(buf,p_names[i]);
+    pack(buf,p_offsets[i]);
+    pack(buf,p_lengths[i]);
+  }
+  pack(buf,p_offset);
+  buf.insert(buf.end(),CA_INDEX_MAGIC,CA_INDEX_MAGIC+CA_MAGIC_LENGTH);
+  fwrite(&buf[0],1,buf.size(),p_file);
+  fclose(p_file);
+  p_file = NULL;
+}
+
+/**
+ * Pack values into a buffer
+ */
+void gridpack::contingency_analysis::CAOutput::pack(std::vector<char> &buf,
+    int value)
+{
+  const char *ptr = reinterpret_cast<const char*>(&value);
+  buf.insert(buf.end(),ptr,ptr+sizeof(int));
+}
+
+void gridpack::contingency_analysis::CAOutput::pack(std::vector<char> &buf,
+    long long value)
+{
+  const char *ptr = reinterpret_cast<const char*>(&value);
+  buf.insert(buf.end(),ptr,ptr+sizeof(long long));
+}
+
+void gridpack::contingency_analysis::CAOutput::pack(std::vector<char> &buf,
+    const std::string &value)
+{
+  pack(buf,static_cast<int>(value.size()));
+  buf.insert(buf.end(),value.begin(),value.end());
+}
+
+void gridpack::contingency_analysis::CAOutput::pack(std::vector<char> &buf,
+    const std::vector<int> &values)
+{
+  if (values.empty()) return;
+  const char *ptr = reinterpret_cast<const char*>(&values[0]);
+  buf.insert(buf.end(),ptr,ptr+values.size()*sizeof(int));
+}
+
+void gridpack::contingency_analysis::CAOutput::pack(std::vector<char> &buf,
+    const std::vector<double> &values)
+{
+  if (values.empty()) return;
+  const char *ptr = reinterpret_cast<const char*>(&values[0]);
+  buf.insert(buf.end(),ptr,ptr+values.size()*sizeof(double));
+}
+
+void gridpack::contingency_analysis::CAOutput::packMask(
+    std::vector<char> &buf, const std::vector<int> &mask)
+{
+  int i;
+  for (i=0; i<mask.size(); i++) buf.push_back(static_cast<char>(mask[i]));
+}
+
+/**
+ * Write a packed record and add it to the index
+ * @param name contingency name
+ * @param buf packed record
+ */
+void gridpack::contingency_analysis::CAOutput::write(const std::string &name,
+    std::vector<char> &buf)
+{
+  fwrite(&buf[0],1,buf.size(),p_file);
+  p_names.push_back(name);
+  p_offsets.push_back(p_offset);
+  p_lengths.push_back(buf.size());
+  p_offset += buf.size();
+}
+
+/**
+ * Main loop of the writer thread
+ */
+void gridpack::contingency_analysis::CAOutput::run(void)
+{
+  std::pair<std::string, std::vector<char> > record;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(p_mutex);
+      while (p_queue.empty() && !p_done) p_cond.wait(lock);
+      if (p_queue.empty()) return;
+      record.first.swap(p_queue.front().first);
+      record.second.swap(p_queue.front().second);
+      p_queue.pop_front();
+    }
+    write(record.first,record.second);
+  }
+}
@@ -0,0 +1,136 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_output.hpp
+ *
+ * @brief Aggregated binary output of the individual contingency
+ *        calculations. Each task group writes all of its contingencies to a
+ *        single indexed file from a background thread.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _ca_output_h_
+#define _ca_output_h_
+
+#include <cstdio>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "gridpack/include/gridpack.hpp"
+#include "ca_results.hpp"
+
+namespace gridpack {
+namespace contingency_analysis {
+
+// Replaces the text files written by PFAppModule for every contingency
+// when printCalcFiles is set. Only process 0 of the task communicator
+// writes. Records are packed on the calling thread and handed to a writer
+// thread, so the contingency loop does not wait for the file system. The
+// writer thread does not make any MPI calls. The ca_render.x tool converts
+// records back into text reports. The file layout is described in
+// ca_output_format.hpp.
+class CAOutput
+{
+  public:
+    /**
+     * Basic constructor. Writes the file header with the labels of all
+     * network elements
+     * @param comm task communicator
+     * @param filename name of the output file
+     * @param results exporter of the power flow results
+     * @param Vmin minimum allowed bus voltage magnitude
+     * @param Vmax maximum allowed bus voltage magnitude
+     * @param async write records from a background thread
+     */
+    CAOutput(const gridpack::parallel::Communicator &comm,
+        std::string filename, CAResults &results, double Vmin, double Vmax,
+        bool async = true);
+
+    /**
+     * Basic destructor. Closes the file if close has not been called
+     */
+    ~CAOutput(void);
+
+    /**
+     * Add the results of one contingency. The buffers are the ones filled
+     * by CAResults
+     * @param name contingency name
+     * @param success true if the power flow calculation converged
+     * @param violation violation code, as in success.txt
+     * @param vmag voltage magnitudes
+     * @param mag_mask masks for voltage magnitudes
+     * @param vang voltage angles (degrees)
+     * @param mask masks for voltage angles
+     * @param pgen generator real power
+     * @param qgen generator reactive power
+     * @param gen_mask masks for generator values
+     * @param pflow real power flow on each branch element
+     * @param qflow reactive power flow on each branch element
+     * @param perf loading of each branch element
+     * @param flow_mask masks for branch values
+     */
+    void addRecord(const std::string &name, bool success, int violation,
+        std::vector<double> &vmag, std::vector<int> &mag_mask,
+        std::vector<double> &vang, std::vector<int> &mask,
+        std::vector<double> &pgen, std::vector<double> &qgen,
+        std::vector<int> &gen_mask, std::vector<double> &pflow,
+        std::vector<double> &qflow, std::vector<double> &perf,
+        std::vector<int> &flow_mask);
+
+    /**
+     * Wait for all records to be written, then write the index and close
+     * the file
+     */
+    void close(void);
+
+  private:
+
+    /**
+     * Pack values into a buffer
+     */
+    static void pack(std::vector<char> &buf, int value);
+    static void pack(std::vector<char> &buf, long long value);
+    static void pack(std::vector<char> &buf, const std::string &value);
+    static void pack(std::vector<char> &buf, const std::vector<int> &values);
+    static void pack(std::vector<char> &buf,
+        const std::vector<double> &values);
+    static void packMask(std::vector<char> &buf,
+        const std::vector<int> &mask);
+
+    /**
+     * Write a packed record and add it to the index
+     * @param name contingency name
+     * @param buf packed record
+     */
+    void write(const std::string &name, std::vector<char> &buf);
+
+    /**
+     * Main loop of the writer thread
+     */
+    void run(void);
+
+    FILE *p_file;
+    bool p_async;
+    long long p_offset;
+    std::vector<std::string> p_names;
+    std::vector<long long> p_offsets;
+    std::vector<long long> p_lengths;
+
+    // Records waiting for the writer thread
+    std::thread p_thread;
+    std::mutex p_mutex;
+    std::condition_variable p_cond;
+    std::deque<std::pair<std::string, std::vector<char> > > p_queue;
+    bool p_done;
+};
+
+} // contingency analysis
+} // gridpack
+#endif
@@ -0,0 +1,52 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_output_format.hpp
+ *
+ * @brief Layout of the binary containers that hold the results of the
+ *        individual contingency calculations. Shared by the contingency
+ *        analysis driver and the ca_render.x tool.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _ca_output_format_h_
+#define _ca_output_format_h_
+
+// Each task group writes one file. All integers are 32 bit, offsets are 64
+// bit, strings are stored as a 32 bit length followed by the characters and
+// masks are stored as single bytes. The file is written in the native byte
+// order of the machine.
+//
+// Header
+//   CA_OUTPUT_MAGIC (8 bytes)
+//   nmag nbus ngen nbranch
+//   Vmin Vmax (double)
+//   bus IDs of the voltage magnitude rows [nmag]
+//   bus IDs of the voltage angle rows [nbus]
+//   bus IDs of the generators [ngen], generator IDs (strings) [ngen]
+//   from bus IDs [nbranch], to bus IDs [nbranch], circuit IDs (strings)
+//   [nbranch], ratings (double) [nbranch]
+//
+// Record (one per contingency)
+//   name (string), success, violation (same codes as success.txt)
+//   vmag [nmag], vmag masks [nmag], vang (degrees) [nbus], vang masks [nbus]
+//   pgen [ngen], qgen [ngen], generator masks [ngen]
+//   pflow [nbranch], qflow [nbranch], perf [nbranch], branch masks [nbranch]
+//
+// Index (after the last record)
+//   nrec, then for each record name (string), offset, length
+//
+// Trailer
+//   offset of the index, CA_INDEX_MAGIC (8 bytes)
+
+#define CA_OUTPUT_MAGIC "CAOUT001"
+#define CA_INDEX_MAGIC "CAINDEX1"
+#define CA_MAGIC_LENGTH 8
+
+#endif
@@ -0,0 +1,288 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_render.cpp
+ *
+ * @brief Offline tool that renders text reports from the binary containers
+ *        written by the contingency analysis driver. Does not depend on
+ *        GridPACK.
+ *
+ *   ca_render.x -l file.bin            list the contingencies in a file
+ *   ca_render.x file.bin               write <name>.out for all contingencies
+ *   ca_render.x file.bin name1 name2   write reports for some contingencies
+ *   ca_render.x -c file.bin name       write the report to standard output
+ *
+ */
+// -------------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "ca_output_format.hpp"
+
+namespace {
+
+// Labels of the network elements, read from the file header
+struct Header {
+  int nmag, nbus, ngen, nbranch;
+  double Vmin, Vmax;
+  std::vector<int> mag_ids, bus_ids, gen_ids, id1, id2;
+  std::vector<std::string> gen_tags, ckt_tags;
+  std::vector<double> rating;
+};
+
+bool readInts(FILE *fp, std::vector<int> &values, int n)
+{
+  values.resize(n);
+  if (n == 0) return true;
+  return fread(&values[0],sizeof(int),n,fp) == n;
+}
+
+bool readDoubles(FILE *fp, std::vector<double> &values, int n)
+{
+  values.resize(n);
+  if (n == 0) return true;
+  return fread(&values[0],sizeof(double),n,fp) == n;
+}
+
+bool readMasks(FILE *fp, std::vector<char> &values, int n)
+{
+  values.resize(n);
+  if (n == 0) return true;
+  return fread(&values[0],1,n,fp) == n;
+}
+
+bool readString(FILE *fp, std::string &value)
+{
+  int len;
+  if (fread(&len,sizeof(int),1,fp) != 1 || len < 0) return false;
+  value.resize(len);
+  if (len == 0) return true;
+  return fread(&value[0],1,len,fp) == len;
+}
+
+bool readHeader(FILE *fp, Header &hdr)
+{
+  char magic[CA_MAGIC_LENGTH];
+  if (fread(magic,1,CA_MAGIC_LENGTH,fp) != CA_MAGIC_LENGTH ||
+      strncmp(magic,CA_OUTPUT_MAGIC,CA_MAGIC_LENGTH) != 0) return false;
+  std::vector<int> sizes;
+  std::vector<double> limits;
+  if (!readInts(fp,sizes,4) || !readDoubles(fp,limits,2)) return false;
+  hdr.nmag = sizes[0];
+  hdr.nbus = sizes[1];
+  hdr.ngen = sizes[2];
+  hdr.nbranch = sizes[3];
+  hdr.Vmin = limits[0];
+  hdr.Vmax = limits[1];
+  if (!readInts(fp,hdr.mag_ids,hdr.nmag)) return false;
+  if (!readInts(fp,hdr.bus_ids,hdr.nbus)) return false;
+  if (!readInts(fp,hdr.gen_ids,hdr.ngen)) return false;
+  hdr.gen_tags.resize(hdr.ngen);
+  int i;
+  for (i=0; i<hdr.ngen; i++) {
+    if (!readString(fp,hdr.gen_tags[i])) return false;
+  }
+  if (!readInts(fp,hdr.id1,hdr.nbranch)) return false;
+  if (!readInts(fp,hdr.id2,hdr.nbranch)) return false;
+  hdr.ckt_tags.resize(hdr.nbranch);
+  for (i=0; i<hdr.nbranch; i++) {
+    if (!readString(fp,hdr.ckt_tags[i])) return false;
+  }
+  return readDoubles(fp,hdr.rating,hdr.nbranch);
+}
+
+bool readIndex(FILE *fp, std::vector<std::string> &names,
+    std::vector<long long> &offsets)
+{
+  char magic[CA_MAGIC_LENGTH];
+  long long index;
+  if (fseek(fp,-static_cast<long>(CA_MAGIC_LENGTH+sizeof(long long)),
+        SEEK_END) != 0) return false;
+  if (fread(&index,sizeof(long long),1,fp) != 1) return false;
+  if (fread(magic,1,CA_MAGIC_LENGTH,fp) != CA_MAGIC_LENGTH ||
+      strncmp(magic,CA_INDEX_MAGIC,CA_MAGIC_LENGTH) != 0) return false;
+  if (fseek(fp,static_cast<long>(index),SEEK_SET) != 0) return false;
+  int nrec;
+  if (fread(&nrec,sizeof(int),1,fp) != 1) return false;
+  names.resize(nrec);
+  offsets.resize(nrec);
+  int i;
+  for (i=0; i<nrec; i++) {
+    long long length;
+    if (!readString(fp,names[i])) return false;
+    if (fread(&offsets[i],sizeof(long long),1,fp) != 1) return false;
+    if (fread(&length,sizeof(long long),1,fp) != 1) return false;
+  }
+  return true;
+}
+
+const char *violationString(int violation)
+{
+  switch (violation) {
+    case 1: return "none";
+    case 2: return "bus";
+    case 3: return "branch";
+    case 4: return "bus and branch";
+    default: return "unknown";
+  }
+}
+
+// Write the report of the record at offset
+bool render(FILE *fp, const Header &hdr, long long offset, FILE *fout)
+{
+  if (fseek(fp,static_cast<long>(offset),SEEK_SET) != 0) return false;
+  std::string name;
+  std::vector<int> flags;
+  std::vector<double> vmag, vang, pgen, qgen, pflow, qflow, perf;
+  std::vector<char> mag_mask, mask, gen_mask, flow_mask;
+  if (!readString(fp,name) || !readInts(fp,flags,2)) return false;
+  if (!readDoubles(fp,vmag,hdr.nmag) || !readMasks(fp,mag_mask,hdr.nmag) ||
+      !readDoubles(fp,vang,hdr.nbus) || !readMasks(fp,mask,hdr.nbus) ||
+      !readDoubles(fp,pgen,hdr.ngen) || !readDoubles(fp,qgen,hdr.ngen) ||
+      !readMasks(fp,gen_mask,hdr.ngen) ||
+      !readDoubles(fp,pflow,hdr.nbranch) ||
+      !readDoubles(fp,qflow,hdr.nbranch) ||
+      !readDoubles(fp,perf,hdr.nbranch) ||
+      !readMasks(fp,flow_mask,hdr.nbranch)) return false;
+
+  fprintf(fout,"Contingency: %s\n",name.c_str());
+  if (!flags[0]) {
+    fprintf(fout,"\nDivergent for contingency %s\n",name.c_str());
+    return true;
+  }
+  fprintf(fout,"Violation: %s\n",violationString(flags[1]));
+
+  int i;
+  fprintf(fout,"\n   Bus Voltages and Phase Angles\n\n");
+  fprintf(fout,"   Bus Number      Phase Angle      Voltage Magnitude\n\n");
+  int j = 0;
+  for (i=0; i<hdr.nbus; i++) {
+    // Voltage magnitude rows only exist for buses that are not isolated
+    if (j < hdr.nmag && hdr.mag_ids[j] == hdr.bus_ids[i]) {
+      fprintf(fout,"     %6d      %12.6f         %12.6f%s\n",hdr.bus_ids[i],
+          vang[i],vmag[j],mag_mask[j] == 2 ? "  PV to PQ" :
+          (mag_mask[j] == 3 ? "  violation" : ""));
+      j++;
+    } else {
+      fprintf(fout,"     %6d      %12.6f            isolated\n",
+          hdr.bus_ids[i],vang[i]);
+    }
+  }
+  fprintf(fout,"\n   Voltage limits: %8.4f %8.4f\n",hdr.Vmin,hdr.Vmax);
+
+  fprintf(fout,"\n   Generator Power\n\n");
+  fprintf(fout,"   Bus Number  Generator ID         Pgen            Qgen\n\n");
+  for (i=0; i<hdr.ngen; i++) {
+    if (gen_mask[i] == 0) {
+      fprintf(fout,"     %6d        %2s              out of service\n",
+          hdr.gen_ids[i],hdr.gen_tags[i].c_str());
+    } else {
+      fprintf(fout,"     %6d        %2s      %12.6f    %12.6f\n",
+          hdr.gen_ids[i],hdr.gen_tags[i].c_str(),pgen[i],qgen[i]);
+    }
+  }
+
+  fprintf(fout,"\n   Branch Power Flow\n\n");
+  fprintf(fout,"        Bus 1       Bus 2   CKT         P"
+      "                   Q             Rating   Overloading\n\n");
+  for (i=0; i<hdr.nbranch; i++) {
+    double load = perf[i] > 0.0 ? 100.0*sqrt(perf[i]) : 0.0;
+    fprintf(fout,"     %8d    %8d     %2s  %16.5f    %16.5f   %10.2f   %8.2f%%%s\n",
+        hdr.id1[i],hdr.id2[i],hdr.ckt_tags[i].c_str(),pflow[i],qflow[i],
+        hdr.rating[i],load,flow_mask[i] == 2 ? "  violation" : "");
+  }
+  return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+  bool list = false;
+  bool to_stdout = false;
+  int arg = 1;
+  while (arg < argc && argv[arg][0] == '-') {
+    if (strcmp(argv[arg],"-l") == 0) {
+      list = true;
+    } else if (strcmp(argv[arg],"-c") == 0) {
+      to_stdout = true;
+    } else {
+      break;
+    }
+    arg++;
+  }
+  if (arg >= argc) {
+    fprintf(stderr,"Usage: %s [-l] [-c] file.bin [contingency ...]\n",
+        argv[0]);
+    return 1;
+  }
+  const char *filename = argv[arg++];
+  FILE *fp = fopen(filename,"rb");
+  if (!fp) {
+    fprintf(stderr,"Unable to open %s\n",filename);
+    return 1;
+  }
+  Header hdr;
+  std::vector<std::string> names;
+  std::vector<long long> offsets;
+  if (!readHeader(fp,hdr) || !readIndex(fp,names,offsets)) {
+    fprintf(stderr,"%s is not a complete contingency output file\n",
+        filename);
+    fclose(fp);
+    return 1;
+  }
+
+  int i;
+  if (list) {
+    for (i=0; i<names.size(); i++) printf("%s\n",names[i].c_str());
+    fclose(fp);
+    return 0;
+  }
+
+  // Records to render, all of them if no names are given
+  std::vector<int> records;
+  if (arg >= argc) {
+    for (i=0; i<names.size(); i++) records.push_back(i);
+  }
+  for (; arg<argc; arg++) {
+    for (i=0; i<names.size(); i++) {
+      if (names[i] == argv[arg]) break;
+    }
+    if (i < names.size()) {
+      records.push_back(i);
+    } else {
+      fprintf(stderr,"Contingency %s not found in %s\n",argv[arg],filename);
+    }
+  }
+
+  int status = 0;
+  for (i=0; i<records.size(); i++) {
+    int idx = records[i];
+    FILE *fout = stdout;
+    if (!to_stdout) {
+      std::string outfile = names[idx]+".out";
+      fout = fopen(outfile.c_str(),"w");
+      if (!fout) {
+        fprintf(stderr,"Unable to open %s\n",outfile.c_str());
+        status = 1;
+        continue;
+      }
+    }
+    if (!render(fp,hdr,offsets[idx],fout)) {
+      fprintf(stderr,"Record %s in %s is damaged\n",names[idx].c_str(),
+          filename);
+      status = 1;
+    }
+    if (!to_stdout) fclose(fout);
+  }
+  fclose(fp);
+  return status;
+}
@@ -0,0 +1,493 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_results.cpp
+ *
+ * @brief Typed export of the power flow results used by the contingency
+ *        statistics.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "ca_results.hpp"
+
+/**
+ * Basic constructor. Called after the base case has been solved
+ * @param network power flow network of the task communicator
+ * @param Vmin minimum allowed bus voltage magnitude
+ * @param Vmax maximum allowed bus voltage magnitude
+ */
+gridpack::contingency_analysis::CAResults::CAResults(
+    boost::shared_ptr<gridpack::powerflow::PFNetwork> network,
+    double Vmin, double Vmax)
+{
+  p_network = network;
+  p_Vmin = Vmin;
+  p_Vmax = Vmax;
+  const gridpack::parallel::Communicator &comm = p_network->communicator();
+  int i, j;
+
+  // Bus IDs, connectivity and generator counts in global bus order. Each
+  // bus is only active on one process, so summing over processes assembles
+  // the complete arrays
+  p_nbus = p_network->totalBuses();
+  std::vector<int> bus_ids(p_nbus,0);
+  std::vector<int> connected(p_nbus,0);
+  std::vector<int> ngen(p_nbus,0);
+  p_bus_types.assign(p_nbus,0);
+  int nbus = p_network->numBuses();
+  for (i=0; i<nbus; i++) {
+    if (!p_network->getActiveBus(i)) continue;
+    int idx = p_network->getGlobalBusIndex(i);
+    bus_ids[idx] = p_network->getOriginalBusIndex(i);
+    if (!p_network->getBus(i)->isIsolated()) connected[idx] = 1;
+    int n;
+    if (p_network->getBusData(i)->getValue(GENERATOR_NUMBER,&n)) {
+      ngen[idx] = n;
+    }
+    p_network->getBusData(i)->getValue(BUS_TYPE,&p_bus_types[idx]);
+    p_bus_local.push_back(i);
+  }
+  if (p_nbus > 0 && comm.size() > 1) {
+    comm.sum(&bus_ids[0],p_nbus);
+    comm.sum(&connected[0],p_nbus);
+    comm.sum(&ngen[0],p_nbus);
+    comm.sum(&p_bus_types[0],p_nbus);
+  }
+
+  // Rows of each bus in the voltage magnitude and generator buffers
+  std::vector<int> mag_row(p_nbus,-1);
+  std::vector<int> gen_row(p_nbus,0);
+  p_nmag = 0;
+  p_ngen = 0;
+  for (i=0; i<p_nbus; i++) {
+    if (connected[i] == 1) {
+      mag_row[i] = p_nmag;
+      p_mag_ids.push_back(bus_ids[i]);
+      p_nmag++;
+    }
+    gen_row[i] = p_ngen;
+    for (j=0; j<ngen[i]; j++) p_gen_ids.push_back(bus_ids[i]);
+    p_ngen += ngen[i];
+  }
+  p_bus_ids = bus_ids;
+
+  // Generator IDs
+  p_gen_tags.assign(p_ngen,0);
+  for (i=0; i<p_bus_local.size(); i++) {
+    int idx = p_network->getGlobalBusIndex(p_bus_local[i]);
+    p_bus_row.push_back(idx);
+    p_mag_row.push_back(mag_row[idx]);
+    p_gen_row.push_back(gen_row[idx]);
+    boost::shared_ptr<gridpack::component::DataCollection>
+      data = p_network->getBusData(p_bus_local[i]);
+    for (j=0; j<ngen[idx]; j++) {
+      std::string tag;
+      data->getValue(GENERATOR_ID,&tag,j);
+      p_gen_tags[gen_row[idx]+j] = encodeTag(tag);
+    }
+  }
+  if (p_ngen > 0 && comm.size() > 1) comm.sum(&p_gen_tags[0],p_ngen);
+  for (i=0; i<p_ngen; i++) p_gen_names.push_back(decodeTag(p_gen_tags[i]));
+
+  // Branch endpoints and element counts in global branch order
+  int nbranch = p_network->totalBranches();
+  std::vector<int> id1(nbranch,0);
+  std::vector<int> id2(nbranch,0);
+  std::vector<int> nelem(nbranch,0);
+  int nlocal = p_network->numBranches();
+  for (i=0; i<nlocal; i++) {
+    if (!p_network->getActiveBranch(i)) continue;
+    int idx = p_network->getGlobalBranchIndex(i);
+    p_network->getOriginalBranchEndpoints(i,&id1[idx],&id2[idx]);
+    int n;
+    if (p_network->getBranchData(i)->getValue(BRANCH_NUM_ELEMENTS,&n)) {
+      nelem[idx] = n;
+    }
+    p_branch_local.push_back(i);
+  }
+  if (nbranch > 0 && comm.size() > 1) {
+    comm.sum(&id1[0],nbranch);
+    comm.sum(&id2[0],nbranch);
+    comm.sum(&nelem[0],nbranch);
+  }
+  std::vector<int> elem_row(nbranch,0);
+  p_nelem = 0;
+  for (i=0; i<nbranch; i++) {
+    elem_row[i] = p_nelem;
+    for (j=0; j<nelem[i]; j++) {
+      p_id1.push_back(id1[i]);
+      p_id2.push_back(id2[i]);
+    }
+    p_nelem += nelem[i];
+  }
+
+  // Circuit IDs, ratings, reactances and status of each element
+  p_ckt_tags.assign(p_nelem,0);
+  p_rating.assign(p_nelem,0.0);
+  p_reactance.assign(p_nelem,0.0);
+  p_status.assign(p_nelem,0);
+  for (i=0; i<p_branch_local.size(); i++) {
+    int idx = p_network->getGlobalBranchIndex(p_branch_local[i]);
+    p_branch_row.push_back(elem_row[idx]);
+    boost::shared_ptr<gridpack::component::DataCollection>
+      data = p_network->getBranchData(p_branch_local[i]);
+    for (j=0; j<nelem[idx]; j++) {
+      std::string tag;
+      data->getValue(BRANCH_CKT,&tag,j);
+      p_ckt_tags[elem_row[idx]+j] = encodeTag(tag);
+      double rating = 0.0;
+      data->getValue(BRANCH_RATING_A,&rating,j);
+      p_rating[elem_row[idx]+j] = rating;
+      double x = 0.0;
+      data->getValue(BRANCH_X,&x,j);
+      p_reactance[elem_row[idx]+j] = x;
+      bool status = true;
+      data->getValue(BRANCH_STATUS,&status,j);
+      p_status[elem_row[idx]+j] = status ? 1 : 0;
+    }
+  }
+  if (p_nelem > 0 && comm.size() > 1) {
+    comm.sum(&p_ckt_tags[0],p_nelem);
+    comm.sum(&p_rating[0],p_nelem);
+    comm.sum(&p_reactance[0],p_nelem);
+    comm.sum(&p_status[0],p_nelem);
+  }
+  for (i=0; i<p_nelem; i++) p_ckt_names.push_back(decodeTag(p_ckt_tags[i]));
+}
+
+/**
+ * Basic destructor
+ */
+gridpack::contingency_analysis::CAResults::~CAResults(void)
+{
+}
+
+/**
+ * Number of rows in the voltage magnitude buffers (buses that are not
+ * isolated in the base case)
+ * @return number of voltage magnitudes
+ */
+int gridpack::contingency_analysis::CAResults::numVoltageMagnitudes(void) const
+{
+  return p_nmag;
+}
+
+/**
+ * Number of rows in the voltage angle buffers (all buses)
+ * @return number of buses
+ */
+int gridpack::contingency_analysis::CAResults::numBuses(void) const
+{
+  return p_nbus;
+}
+
+/**
+ * Number of rows in the generator buffers
+ * @return number of generators
+ */
+int gridpack::contingency_analysis::CAResults::numGenerators(void) const
+{
+  return p_ngen;
+}
+
+/**
+ * Number of rows in the branch buffers (individual line elements)
+ * @return number of branch elements
+ */
+int gridpack::contingency_analysis::CAResults::numBranchElements(void) const
+{
+  return p_nelem;
+}
+
+/**
+ * Get the StatBlock row labels for buses
+ * @param mag_ids IDs of buses in the voltage magnitude rows
+ * @param mag_tags dummy tags for voltage magnitude rows
+ * @param ids IDs of buses in the voltage angle rows
+ * @param tags dummy tags for voltage angle rows
+ */
+void gridpack::contingency_analysis::CAResults::getBusLabels(
+    std::vector<int> &mag_ids, std::vector<std::string> &mag_tags,
+    std::vector<int> &ids, std::vector<std::string> &tags) const
+{
+  mag_ids = p_mag_ids;
+  mag_tags.assign(p_nmag,"1 ");
+  ids = p_bus_ids;
+  tags.assign(p_nbus,"1 ");
+}
+
+/**
+ * Get the StatBlock row labels for generators
+ * @param ids IDs of buses hosting the generators
+ * @param tags generator IDs
+ */
+void gridpack::contingency_analysis::CAResults::getGeneratorLabels(
+    std::vector<int> &ids, std::vector<std::string> &tags) const
+{
+  ids = p_gen_ids;
+  tags = p_gen_names;
+}
+
+/**
+ * Get the StatBlock row labels and flow limits for branch elements
+ * @param id1 IDs of the from buses
+ * @param id2 IDs of the to buses
+ * @param tags circuit IDs
+ * @param rating rating of each element (MVA)
+ */
+void gridpack::contingency_analysis::CAResults::getBranchLabels(
+    std::vector<int> &id1, std::vector<int> &id2,
+    std::vector<std::string> &tags, std::vector<double> &rating) const
+{
+  id1 = p_id1;
+  id2 = p_id2;
+  tags = p_ckt_names;
+  rating = p_rating;
+}
+
+/**
+ * Get the bus types of the base case (3 for the swing bus) in the order
+ * of the voltage angle rows
+ * @param types bus types
+ */
+void gridpack::contingency_analysis::CAResults::getBusTypes(
+    std::vector<int> &types) const
+{
+  types = p_bus_types;
+}
+
+/**
+ * Get the series reactance and base case status of each branch element,
+ * in the order of the branch rows
+ * @param x series reactance (p.u.)
+ * @param status 1 if the element is in service, 0 otherwise
+ */
+void gridpack::contingency_analysis::CAResults::getBranchParameters(
+    std::vector<double> &x, std::vector<int> &status) const
+{
+  x = p_reactance;
+  status = p_status;
+}
+
+/**
+ * Export bus voltages. The buffers are resized to numVoltageMagnitudes
+ * and numBuses, which only allocates on the first call. Voltage magnitudes
+ * of PV buses that were switched to PQ by the reactive power limits have
+ * mask 2 and other voltages outside Vmin and Vmax have mask 3
+ * @param vmag voltage magnitudes
+ * @param mag_mask masks for voltage magnitudes
+ * @param vang voltage angles (degrees)
+ * @param mask masks for voltage angles
+ * @param success false if the power flow calculation failed, in which
+ *        case all values and masks are set to zero
+ */
+void gridpack::contingency_analysis::CAResults::exportBuses(
+    std::vector<double> &vmag, std::vector<int> &mag_mask,
+    std::vector<double> &vang, std::vector<int> &mask, bool success)
+{
+  vmag.resize(p_nmag);
+  mag_mask.resize(p_nmag);
+  vang.resize(p_nbus);
+  mask.resize(p_nbus);
+  std::fill(vmag.begin(),vmag.end(),0.0);
+  std::fill(mag_mask.begin(),mag_mask.end(),0);
+  std::fill(vang.begin(),vang.end(),0.0);
+  std::fill(mask.begin(),mask.end(),0);
+  if (!success) return;
+  int i;
+  for (i=0; i<p_bus_local.size(); i++) {
+    boost::shared_ptr<gridpack::powerflow::PFBus>
+      bus = p_network->getBus(p_bus_local[i]);
+    int row = p_bus_row[i];
+    vang[row] = bus->getPhase()*180.0/M_PI;
+    mask[row] = 1;
+    // A bus that is isolated by the contingency keeps its row but is
+    // masked out
+    row = p_mag_row[i];
+    if (row < 0 || bus->isIsolated()) continue;
+    double v = bus->getVoltage();
+    vmag[row] = v;
+    if (p_bus_types[p_bus_row[i]] == 2 && switchedToPQ(bus)) {
+      mag_mask[row] = 2;
+    } else if (!bus->getIgnore() && (v < p_Vmin || v > p_Vmax)) {
+      mag_mask[row] = 3;
+    } else {
+      mag_mask[row] = 1;
+    }
+  }
+  reduce(vmag,mag_mask);
+  reduce(vang,mask);
+}
+
+/**
+ * Check if a PV bus was switched to PQ because its generators reached
+ * their reactive power limits. The flag is only available from the
+ * "vr_str" bus string, so it is only read for buses that are PV buses in
+ * the base case
+ * @param bus power flow bus
+ * @return true if the bus was switched to PQ
+ */
+bool gridpack::contingency_analysis::CAResults::switchedToPQ(
+    boost::shared_ptr<gridpack::powerflow::PFBus> bus)
+{
+  char string[128];
+  if (!bus->serialWrite(string,128,"vr_str")) return false;
+  int id, not_isolated, pq;
+  double angle, v;
+  if (sscanf(string,"%d %lf %lf %d %d",&id,&angle,&v,&not_isolated,&pq)
+      != 5) return false;
+  return pq != 0;
+}
+
+/**
+ * Export generator outputs. PFAppModule::saveData must have been called
+ * for the current solution
+ * @param pgen generator real power
+ * @param qgen generator reactive power
+ * @param mask masks for generator values
+ * @param success false if the power flow calculation failed
+ */
+void gridpack::contingency_analysis::CAResults::exportGenerators(
+    std::vector<double> &pgen, std::vector<double> &qgen,
+    std::vector<int> &mask, bool success)
+{
+  pgen.resize(p_ngen);
+  qgen.resize(p_ngen);
+  mask.resize(p_ngen);
+  std::fill(pgen.begin(),pgen.end(),0.0);
+  std::fill(qgen.begin(),qgen.end(),0.0);
+  std::fill(mask.begin(),mask.end(),0);
+  if (!success) return;
+  int i, j;
+  for (i=0; i<p_bus_local.size(); i++) {
+    int row = p_gen_row[i];
+    boost::shared_ptr<gridpack::powerflow::PFBus>
+      bus = p_network->getBus(p_bus_local[i]);
+    boost::shared_ptr<gridpack::component::DataCollection>
+      data = p_network->getBusData(p_bus_local[i]);
+    int ngen = 0;
+    data->getValue(GENERATOR_NUMBER,&ngen);
+    for (j=0; j<ngen; j++) {
+      mask[row+j] = 1;
+      // Generators switched off by the contingency report zero output
+      if (!bus->getGenStatus(p_gen_names[row+j])) continue;
+      data->getValue("GENERATOR_PF_PGEN",&pgen[row+j],j);
+      data->getValue("GENERATOR_PF_QGEN",&qgen[row+j],j);
+    }
+  }
+  reduce(pgen,mask);
+  // The mask has already been summed with the real power
+  if (p_ngen > 0 && p_network->communicator().size() > 1) {
+    p_network->communicator().sum(&qgen[0],p_ngen);
+  }
+}
+
+/**
+ * Export branch flows
+ * @param pflow real power flow on each element (MW)
+ * @param qflow reactive power flow on each element (MVAR)
+ * @param perf loading of each element relative to its rating,
+ *        (|S|/rating)^2, or zero for elements without a rating
+ * @param mask masks for branch values
+ * @param success false if the power flow calculation failed
+ */
+void gridpack::contingency_analysis::CAResults::exportBranches(
+    std::vector<double> &pflow, std::vector<double> &qflow,
+    std::vector<double> &perf, std::vector<int> &mask, bool success)
+{
+  pflow.resize(p_nelem);
+  qflow.resize(p_nelem);
+  perf.resize(p_nelem);
+  mask.resize(p_nelem);
+  std::fill(pflow.begin(),pflow.end(),0.0);
+  std::fill(qflow.begin(),qflow.end(),0.0);
+  std::fill(perf.begin(),perf.end(),0.0);
+  std::fill(mask.begin(),mask.end(),0);
+  if (!success) return;
+  int i, j;
+  for (i=0; i<p_branch_local.size(); i++) {
+    boost::shared_ptr<gridpack::powerflow::PFBranch>
+      branch = p_network->getBranch(p_branch_local[i]);
+    int row = p_branch_row[i];
+    int nelem = 0;
+    p_network->getBranchData(p_branch_local[i])->getValue(
+        BRANCH_NUM_ELEMENTS,&nelem);
+    for (j=0; j<nelem; j++) {
+      gridpack::ComplexType s
+        = branch->getComplexPower(p_ckt_names[row+j]);
+      double rating = p_rating[row+j];
+      pflow[row+j] = real(s);
+      qflow[row+j] = imag(s);
+      mask[row+j] = 1;
+      if (rating > 0.0) {
+        double load = abs(s)/rating;
+        perf[row+j] = load*load;
+        if (load > 1.0) mask[row+j] = 2;
+      }
+    }
+  }
+  reduce(pflow,mask);
+  if (p_nelem > 0 && p_network->communicator().size() > 1) {
+    p_network->communicator().sum(&qflow[0],p_nelem);
+    p_network->communicator().sum(&perf[0],p_nelem);
+  }
+}
+
+/**
+ * Sum buffers over the task communicator so that every process has the
+ * values of all network elements
+ * @param values buffer of values
+ * @param mask buffer of masks
+ */
+void gridpack::contingency_analysis::CAResults::reduce(
+    std::vector<double> &values, std::vector<int> &mask)
+{
+  const gridpack::parallel::Communicator &comm = p_network->communicator();
+  if (values.empty() || comm.size() == 1) return;
+  comm.sum(&values[0],values.size());
+  comm.sum(&mask[0],mask.size());
+}
+
+/**
+ * Encode a circuit or generator ID of up to two characters as an integer
+ * so that labels can be summed over processes
+ * @param tag ID string
+ * @return encoded ID
+ */
+int gridpack::contingency_analysis::CAResults::encodeTag(
+    const std::string &tag)
+{
+  gridpack::utility::StringUtils util;
+  std::string clean = util.clean2Char(tag);
+  int code = 0;
+  int i;
+  for (i=0; i<2; i++) {
+    code *= 256;
+    if (i < clean.size()) code += static_cast<unsigned char>(clean[i]);
+  }
+  return code;
+}
+
+/**
+ * Decode an ID encoded by encodeTag
+ * @param code encoded ID
+ * @return ID string
+ */
+std::string gridpack::contingency_analysis::CAResults::decodeTag(int code)
+{
+  std::string tag;
+  char c0 = static_cast<char>(code/256);
+  char c1 = static_cast<char>(code%256);
+  if (c0 != '\0') tag.push_back(c0);
+  if (c1 != '\0') tag.push_back(c1);
+  return tag;
+}
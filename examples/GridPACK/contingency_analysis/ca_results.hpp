@@ -0,0 +1,245 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_results.hpp
+ *
+ * @brief Typed export of the power flow results used by the contingency
+ *        statistics. Values are read directly from the network components
+ *        into preallocated numeric buffers instead of being written to
+ *        strings with writeBusString/writeBranchString and parsed again.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _ca_results_h_
+#define _ca_results_h_
+
+#include "gridpack/include/gridpack.hpp"
+#include "gridpack/applications/modules/powerflow/pf_app_module.hpp"
+
+namespace gridpack {
+namespace contingency_analysis {
+
+// Exports bus voltages, generator outputs and branch flows for the StatBlock
+// objects in CADriver. The row layout (buses, generators and branch
+// elements in global index order) is fixed from the base case when the
+// object is created, so every export fills buffers of the same size without
+// allocating. Each process writes the values of the network elements it
+// owns and the buffers are summed over the task communicator, so the
+// complete arrays are available on all processes of the task communicator.
+//
+// Masks follow the conventions of the string based statistics: 1 for a
+// valid value, 2 for a PV bus switched to PQ by the reactive power limits
+// or a branch flow that violates its rating and 0 for a failed calculation
+// (or a bus that became isolated). Voltage magnitudes outside Vmin and Vmax
+// have mask 3
+class CAResults
+{
+  public:
+    /**
+     * Basic constructor. Called after the base case has been solved
+     * @param network power flow network of the task communicator
+     * @param Vmin minimum allowed bus voltage magnitude
+     * @param Vmax maximum allowed bus voltage magnitude
+     */
+    CAResults(boost::shared_ptr<gridpack::powerflow::PFNetwork> network,
+        double Vmin, double Vmax);
+
+    /**
+     * Basic destructor
+     */
+    ~CAResults(void);
+
+    /**
+     * Number of rows in the voltage magnitude buffers (buses that are not
+     * isolated in the base case)
+     * @return number of voltage magnitudes
+     */
+    int numVoltageMagnitudes(void) const;
+
+    /**
+     * Number of rows in the voltage angle buffers (all buses)
+     * @return number of buses
+     */
+    int numBuses(void) const;
+
+    /**
+     * Number of rows in the generator buffers
+     * @return number of generators
+     */
+    int numGenerators(void) const;
+
+    /**
+     * Number of rows in the branch buffers (individual line elements)
+     * @return number of branch elements
+     */
+    int numBranchElements(void) const;
+
+    /**
+     * Get the StatBlock row labels for buses
+     * @param mag_ids IDs of buses in the voltage magnitude rows
+     * @param mag_tags dummy tags for voltage magnitude rows
+     * @param ids IDs of buses in the voltage angle rows
+     * @param tags dummy tags for voltage angle rows
+     */
+    void getBusLabels(std::vector<int> &mag_ids,
+        std::vector<std::string> &mag_tags, std::vector<int> &ids,
+        std::vector<std::string> &tags) const;
+
+    /**
+     * Get the StatBlock row labels for generators
+     * @param ids IDs of buses hosting the generators
+     * @param tags generator IDs
+     */
+    void getGeneratorLabels(std::vector<int> &ids,
+        std::vector<std::string> &tags) const;
+
+    /**
+     * Get the StatBlock row labels and flow limits for branch elements
+     * @param id1 IDs of the from buses
+     * @param id2 IDs of the to buses
+     * @param tags circuit IDs
+     * @param rating rating of each element (MVA)
+     */
+    void getBranchLabels(std::vector<int> &id1, std::vector<int> &id2,
+        std::vector<std::string> &tags, std::vector<double> &rating) const;
+
+    /**
+     * Get the bus types of the base case (3 for the swing bus) in the order
+     * of the voltage angle rows
+     * @param types bus types
+     */
+    void getBusTypes(std::vector<int> &types) const;
+
+    /**
+     * Get the series reactance and base case status of each branch element,
+     * in the order of the branch rows
+     * @param x series reactance (p.u.)
+     * @param status 1 if the element is in service, 0 otherwise
+     */
+    void getBranchParameters(std::vector<double> &x,
+        std::vector<int> &status) const;
+
+    /**
+     * Export bus voltages. The buffers are resized to numVoltageMagnitudes
+     * and numBuses, which only allocates on the first call. Voltage
+     * magnitudes of PV buses that were switched to PQ by the reactive power
+     * limits have mask 2 and other voltages outside Vmin and Vmax have
+     * mask 3
+     * @param vmag voltage magnitudes
+     * @param mag_mask masks for voltage magnitudes
+     * @param vang voltage angles (degrees)
+     * @param mask masks for voltage angles
+     * @param success false if the power flow calculation failed, in which
+     *        case all values and masks are set to zero
+     */
+    void exportBuses(std::vector<double> &vmag, std::vector<int> &mag_mask,
+        std::vector<double> &vang, std::vector<int> &mask, bool success);
+
+    /**
+     * Export generator outputs. PFAppModule::saveData must have been called
+     * for the current solution
+     * @param pgen generator real power
+     * @param qgen generator reactive power
+     * @param mask masks for generator values
+     * @param success false if the power flow calculation failed
+     */
+    void exportGenerators(std::vector<double> &pgen,
+        std::vector<double> &qgen, std::vector<int> &mask, bool success);
+
+    /**
+     * Export branch flows
+     * @param pflow real power flow on each element (MW)
+     * @param qflow reactive power flow on each element (MVAR)
+     * @param perf loading of each element relative to its rating,
+     *        (|S|/rating)^2, or zero for elements without a rating
+     * @param mask masks for branch values
+     * @param success false if the power flow calculation failed
+     */
+    void exportBranches(std::vector<double> &pflow,
+        std::vector<double> &qflow, std::vector<double> &perf,
+        std::vector<int> &mask, bool success);
+
+  private:
+
+    /**
+     * Sum buffers over the task communicator so that every process has the
+     * values of all network elements
+     * @param values buffer of values
+     * @param mask buffer of masks
+     */
+    void reduce(std::vector<double> &values, std::vector<int> &mask);
+
+    /**
+     * Check if a PV bus was switched to PQ because its generators reached
+     * their reactive power limits
+     * @param bus power flow bus
+     * @return true if the bus was switched to PQ
+     */
+    bool switchedToPQ(boost::shared_ptr<gridpack::powerflow::PFBus> bus);
+
+    /**
+     * Encode a circuit or generator ID of up to two characters as an integer
+     * so that labels can be summed over processes
+     * @param tag ID string
+     * @return encoded ID
+     */
+    static int encodeTag(const std::string &tag);
+
+    /**
+     * Decode an ID encoded by encodeTag
+     * @param code encoded ID
+     * @return ID string
+     */
+    static std::string decodeTag(int code);
+
+    boost::shared_ptr<gridpack::powerflow::PFNetwork> p_network;
+    double p_Vmin;
+    double p_Vmax;
+
+    // Total number of rows in each set of buffers
+    int p_nbus;
+    int p_nmag;
+    int p_ngen;
+    int p_nelem;
+
+    // Local indices of the active buses, their rows in the voltage angle
+    // and magnitude buffers (-1 if the bus was isolated in the base case)
+    // and the first row of their generators
+    std::vector<int> p_bus_local;
+    std::vector<int> p_bus_row;
+    std::vector<int> p_mag_row;
+    std::vector<int> p_gen_row;
+
+    // Local indices of the active branches and the first row of their
+    // elements
+    std::vector<int> p_branch_local;
+    std::vector<int> p_branch_row;
+
+    // Row labels, complete on all processes. Generator and circuit IDs are
+    // decoded once so that exports do not build strings
+    std::vector<int> p_mag_ids;
+    std::vector<int> p_bus_ids;
+    std::vector<int> p_gen_ids;
+    std::vector<int> p_gen_tags;
+    std::vector<std::string> p_gen_names;
+    std::vector<int> p_id1;
+    std::vector<int> p_id2;
+    std::vector<int> p_ckt_tags;
+    std::vector<std::string> p_ckt_names;
+    std::vector<double> p_rating;
+
+    // Parameters of the DC network model used for contingency screening
+    std::vector<int> p_bus_types;
+    std::vector<double> p_reactance;
+    std::vector<int> p_status;
+};
+
+} // contingency analysis
+} // gridpack
+#endif
@@ -0,0 +1,435 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_screen.cpp
+ *
+ * @brief Linear (DC) screening of contingencies with power transfer and
+ *        line outage distribution factors computed from the base case.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "ca_driver.hpp"
+#include "ca_screen.hpp"
+
+/**
+ * Basic constructor
+ * @param comm world communicator
+ */
+gridpack::contingency_analysis::CAScreen::CAScreen(
+    const gridpack::parallel::Communicator &comm)
+  : p_comm(comm)
+{
+  p_nred = 0;
+  p_setup_time = 0.0;
+  p_screen_time = 0.0;
+}
+
+/**
+ * Basic destructor
+ */
+gridpack::contingency_analysis::CAScreen::~CAScreen(void)
+{
+}
+
+/**
+ * Build and factor the DC network model from the base case solution.
+ * Collective on the task communicator of results
+ * @param results exporter for the base case solution
+ */
+void gridpack::contingency_analysis::CAScreen::setup(CAResults &results)
+{
+  gridpack::utility::CoarseTimer *timer =
+    gridpack::utility::CoarseTimer::instance();
+  double t_start = timer->currentTime();
+  int i, j, k;
+
+  // Bus rows and the swing bus, which is removed from the reduced system
+  std::vector<int> mag_ids, ids;
+  std::vector<std::string> mag_tags, tags;
+  std::vector<int> types;
+  results.getBusLabels(mag_ids, mag_tags, ids, tags);
+  results.getBusTypes(types);
+  int nbus = ids.size();
+  p_bus_row.clear();
+  for (i=0; i<nbus; i++) p_bus_row[ids[i]] = i;
+  int slack = 0;
+  for (i=0; i<nbus; i++) {
+    if (types[i] == 3) {
+      slack = i;
+      break;
+    }
+  }
+  p_column.assign(nbus,-1);
+  p_nred = 0;
+  for (i=0; i<nbus; i++) {
+    if (i != slack) {
+      p_column[i] = p_nred;
+      p_nred++;
+    }
+  }
+
+  // Branch elements and base case flows
+  std::vector<double> perf;
+  std::vector<int> mask;
+  results.getBranchLabels(p_id1, p_id2, p_tags, p_rating);
+  results.getBranchParameters(p_x, p_status);
+  results.exportBranches(p_pflow, p_qflow, perf, mask, true);
+  int nelem = p_x.size();
+  p_from.resize(nelem);
+  p_to.resize(nelem);
+  for (i=0; i<nelem; i++) {
+    p_from[i] = p_bus_row[p_id1[i]];
+    p_to[i] = p_bus_row[p_id2[i]];
+  }
+
+  // Generators and base case outputs
+  results.getGeneratorLabels(p_gen_ids, p_gen_tags);
+  results.exportGenerators(p_pgen, p_qgen, mask, true);
+  int ngen = p_gen_ids.size();
+  p_gen_bus.resize(ngen);
+  for (i=0; i<ngen; i++) p_gen_bus[i] = p_bus_row[p_gen_ids[i]];
+
+  // Reduced susceptance matrix of the in-service elements
+  int n = p_nred;
+  p_factor.assign(static_cast<size_t>(n)*n,0.0);
+  for (k=0; k<nelem; k++) {
+    if (p_status[k] == 0 || std::fabs(p_x[k]) < 1.0e-10) continue;
+    double b = 1.0/p_x[k];
+    int c1 = p_column[p_from[k]];
+    int c2 = p_column[p_to[k]];
+    if (c1 >= 0) p_factor[c1*n+c1] += b;
+    if (c2 >= 0) p_factor[c2*n+c2] += b;
+    if (c1 >= 0 && c2 >= 0) {
+      p_factor[c1*n+c2] -= b;
+      p_factor[c2*n+c1] -= b;
+    }
+  }
+  // Isolated buses have no entries, give them a unit diagonal so that the
+  // factorization stays defined
+  for (i=0; i<n; i++) {
+    if (p_factor[i*n+i] == 0.0) p_factor[i*n+i] = 1.0;
+  }
+
+  // Dense Cholesky factorization, the lower triangle of p_factor is
+  // overwritten by L with B = L L^T. Rows are stored contiguously, so the
+  // inner products run over contiguous memory
+  for (j=0; j<n; j++) {
+    double *lj = &p_factor[j*n];
+    double d = lj[j];
+    for (k=0; k<j; k++) d -= lj[k]*lj[k];
+    if (d <= 1.0e-12) d = 1.0;
+    lj[j] = sqrt(d);
+    for (i=j+1; i<n; i++) {
+      double *li = &p_factor[i*n];
+      double sum = li[j];
+      for (k=0; k<j; k++) sum -= li[k]*lj[k];
+      li[j] = sum/lj[j];
+    }
+  }
+  p_setup_time = timer->currentTime()-t_start;
+}
+
+/**
+ * Solve the reduced DC system B w = rhs with the Cholesky factors
+ * @param rhs right hand side indexed by bus row, the swing bus entry is
+ *        ignored
+ * @param w solution indexed by bus row, zero at the swing bus
+ */
+void gridpack::contingency_analysis::CAScreen::solve(
+    const std::vector<double> &rhs, std::vector<double> &w) const
+{
+  int n = p_nred;
+  int nbus = p_column.size();
+  int i, k;
+  std::vector<double> y(n,0.0);
+  for (i=0; i<nbus; i++) {
+    if (p_column[i] >= 0) y[p_column[i]] = rhs[i];
+  }
+  // Forward substitution L y = rhs
+  for (i=0; i<n; i++) {
+    const double *li = &p_factor[i*n];
+    double sum = y[i];
+    for (k=0; k<i; k++) sum -= li[k]*y[k];
+    y[i] = sum/li[i];
+  }
+  // Backward substitution L^T w = y, by rows of L
+  for (i=n-1; i>=0; i--) {
+    const double *li = &p_factor[i*n];
+    y[i] = y[i]/li[i];
+    for (k=0; k<i; k++) y[k] -= li[k]*y[i];
+  }
+  w.assign(nbus,0.0);
+  for (i=0; i<nbus; i++) {
+    if (p_column[i] >= 0) w[i] = y[p_column[i]];
+  }
+}
+
+/**
+ * Find the branch elements removed by a line contingency
+ * @param event contingency
+ * @param elems branch rows of the removed elements
+ * @return false if an element could not be found
+ */
+bool gridpack::contingency_analysis::CAScreen::findElements(
+    const gridpack::powerflow::Contingency &event,
+    std::vector<int> &elems) const
+{
+  gridpack::utility::StringUtils util;
+  elems.clear();
+  int i, k;
+  int nelem = p_x.size();
+  for (i=0; i<event.p_from.size(); i++) {
+    std::string tag = util.clean2Char(event.p_ckt[i]);
+    int found = -1;
+    for (k=0; k<nelem; k++) {
+      if (p_tags[k] != tag) continue;
+      if ((p_id1[k] == event.p_from[i] && p_id2[k] == event.p_to[i]) ||
+          (p_id1[k] == event.p_to[i] && p_id2[k] == event.p_from[i])) {
+        found = k;
+        break;
+      }
+    }
+    if (found < 0) return false;
+    elems.push_back(found);
+  }
+  return true;
+}
+
+/**
+ * Rank contingencies by their estimated severity and select the ones
+ * that are solved with the AC power flow. A contingency is selected if
+ * its severity is at least threshold, if it is one of the top_k most
+ * severe contingencies or if it splits the network
+ * @param events list of contingencies
+ * @param threshold minimum severity of selected contingencies, where a
+ *        severity of 1 corresponds to an element loaded to its rating
+ * @param top_k number of most severe contingencies that are always
+ *        selected
+ * @param q_weight weight of the removed reactive power (per MVAR) in
+ *        the severity
+ * @param selected true for contingencies that need an AC solution
+ */
+void gridpack::contingency_analysis::CAScreen::screen(
+    std::vector<gridpack::powerflow::Contingency> &events,
+    double threshold, int top_k, double q_weight,
+    std::vector<bool> &selected)
+{
+  gridpack::utility::CoarseTimer *timer =
+    gridpack::utility::CoarseTimer::instance();
+  double t_start = timer->currentTime();
+  gridpack::utility::StringUtils util;
+  int ntasks = events.size();
+  int nbus = p_column.size();
+  int nelem = p_x.size();
+  int ngen = p_gen_ids.size();
+  int i, j, k, l, q;
+  p_severity.assign(ntasks,0.0);
+  p_loading.assign(ntasks,0.0);
+  p_qloss.assign(ntasks,0.0);
+  p_worst.assign(ntasks,0);
+  p_island.assign(ntasks,0);
+
+  // Contingencies are divided round robin over all processes
+  std::vector<double> rhs(nbus);
+  std::vector<double> post(nelem);
+  std::vector<std::vector<double> > w;
+  std::vector<int> elems;
+  for (i=0; i<ntasks; i++) {
+    if (i%p_comm.size() != p_comm.rank()) continue;
+    gridpack::powerflow::Contingency &event = events[i];
+    for (l=0; l<nelem; l++) post[l] = p_pflow[l];
+    if (event.p_type == Branch) {
+      if (!findElements(event,elems)) {
+        p_island[i] = 1;
+        continue;
+      }
+      int m = elems.size();
+      // Flow change on every element per unit flow pushed between the end
+      // buses of each removed element
+      w.resize(m);
+      for (q=0; q<m; q++) {
+        std::fill(rhs.begin(),rhs.end(),0.0);
+        rhs[p_from[elems[q]]] += 1.0;
+        rhs[p_to[elems[q]]] -= 1.0;
+        solve(rhs,w[q]);
+      }
+      // Solve (I - PTDF_K,K) f = P_K for the flows that replace the
+      // removed elements
+      std::vector<double> a(m*m);
+      std::vector<double> f(m);
+      for (j=0; j<m; j++) {
+        int e = elems[j];
+        f[j] = p_status[e] ? p_pflow[e] : 0.0;
+        p_qloss[i] += std::fabs(p_qflow[e]);
+        for (q=0; q<m; q++) {
+          double h = (w[q][p_from[e]]-w[q][p_to[e]])/p_x[e];
+          a[j*m+q] = (j == q ? 1.0 : 0.0)-h;
+        }
+      }
+      bool split = false;
+      for (j=0; j<m && !split; j++) {
+        int piv = j;
+        for (k=j+1; k<m; k++) {
+          if (std::fabs(a[k*m+j]) > std::fabs(a[piv*m+j])) piv = k;
+        }
+        // A unit PTDF on a removed element means that it was the only path
+        // between its end buses
+        if (std::fabs(a[piv*m+j]) < 1.0e-6) {
+          split = true;
+          break;
+        }
+        if (piv != j) {
+          for (k=0; k<m; k++) std::swap(a[j*m+k],a[piv*m+k]);
+          std::swap(f[j],f[piv]);
+        }
+        for (k=j+1; k<m; k++) {
+          double r = a[k*m+j]/a[j*m+j];
+          for (q=j; q<m; q++) a[k*m+q] -= r*a[j*m+q];
+          f[k] -= r*f[j];
+        }
+      }
+      if (split) {
+        p_island[i] = 1;
+        continue;
+      }
+      for (j=m-1; j>=0; j--) {
+        for (k=j+1; k<m; k++) f[j] -= a[j*m+k]*f[k];
+        f[j] /= a[j*m+j];
+      }
+      for (l=0; l<nelem; l++) {
+        if (p_status[l] == 0 || std::fabs(p_x[l]) < 1.0e-10) continue;
+        for (q=0; q<m; q++) {
+          post[l] += (w[q][p_from[l]]-w[q][p_to[l]])/p_x[l]*f[q];
+        }
+      }
+      for (j=0; j<m; j++) post[elems[j]] = 0.0;
+    } else if (event.p_type == Generator) {
+      // The lost generation is picked up by the swing bus
+      std::fill(rhs.begin(),rhs.end(),0.0);
+      bool found = true;
+      for (j=0; j<event.p_busid.size(); j++) {
+        std::string tag = util.clean2Char(event.p_genid[j]);
+        int g = -1;
+        for (k=0; k<ngen; k++) {
+          if (p_gen_ids[k] == event.p_busid[j] && p_gen_tags[k] == tag) {
+            g = k;
+            break;
+          }
+        }
+        if (g < 0) {
+          found = false;
+          break;
+        }
+        rhs[p_gen_bus[g]] -= p_pgen[g];
+        p_qloss[i] += std::fabs(p_qgen[g]);
+      }
+      if (!found) {
+        p_island[i] = 1;
+        continue;
+      }
+      w.resize(1);
+      solve(rhs,w[0]);
+      for (l=0; l<nelem; l++) {
+        if (p_status[l] == 0 || std::fabs(p_x[l]) < 1.0e-10) continue;
+        post[l] += (w[0][p_from[l]]-w[0][p_to[l]])/p_x[l];
+      }
+    }
+    // Post contingency loading of the elements whose flow is increased by
+    // the contingency, so that elements already overloaded in the base case
+    // do not select every contingency
+    for (l=0; l<nelem; l++) {
+      if (p_rating[l] <= 0.0) continue;
+      if (std::fabs(post[l]) <= std::fabs(p_pflow[l])) continue;
+      double loading = std::fabs(post[l])/p_rating[l];
+      if (loading > p_loading[i]) {
+        p_loading[i] = loading;
+        p_worst[i] = l+1;
+      }
+    }
+    p_severity[i] = p_loading[i]+q_weight*p_qloss[i];
+  }
+  if (ntasks > 0) {
+    p_comm.sum(&p_severity[0],ntasks);
+    p_comm.sum(&p_loading[0],ntasks);
+    p_comm.sum(&p_qloss[0],ntasks);
+    p_comm.sum(&p_worst[0],ntasks);
+    p_comm.sum(&p_island[0],ntasks);
+  }
+
+  // Select contingencies above the threshold, the top_k most severe ones
+  // and the ones that could not be screened
+  std::vector<std::pair<double,int> > ranked(ntasks);
+  for (i=0; i<ntasks; i++) {
+    ranked[i] = std::pair<double,int>(-p_severity[i],i);
+  }
+  std::sort(ranked.begin(),ranked.end());
+  p_selected.assign(ntasks,false);
+  for (i=0; i<ntasks; i++) {
+    int idx = ranked[i].second;
+    if (p_island[idx] != 0 || p_severity[idx] >= threshold || i < top_k) {
+      p_selected[idx] = true;
+    }
+  }
+  selected = p_selected;
+  p_screen_time = timer->currentTime()-t_start;
+}
+
+/**
+ * Write the screening results of each contingency, most severe first,
+ * and print a summary. Only process 0 writes
+ * @param filename name of the output file
+ * @param events list of contingencies
+ */
+void gridpack::contingency_analysis::CAScreen::write(const char *filename,
+    std::vector<gridpack::powerflow::Contingency> &events)
+{
+  if (p_comm.rank() != 0) return;
+  int ntasks = p_severity.size();
+  int i;
+  std::vector<std::pair<double,int> > ranked(ntasks);
+  int nselected = 0;
+  int nisland = 0;
+  for (i=0; i<ntasks; i++) {
+    ranked[i] = std::pair<double,int>(-p_severity[i],i);
+    if (p_selected[i]) nselected++;
+    if (p_island[i] != 0) nisland++;
+  }
+  std::sort(ranked.begin(),ranked.end());
+  FILE *fout = fopen(filename,"w");
+  if (fout) {
+    fprintf(fout,"# contingency severity loading from to ckt qloss(MVAR)"
+        " ac_solve\n");
+    for (i=0; i<ntasks; i++) {
+      int idx = ranked[i].second;
+      int l = p_worst[idx]-1;
+      if (p_island[idx] != 0) {
+        fprintf(fout,"%s unscreened - - - - - ac\n",
+            events[idx].p_name.c_str());
+      } else if (l >= 0) {
+        fprintf(fout,"%s %12.6f %12.6f %8d %8d %s %12.4f %s\n",
+            events[idx].p_name.c_str(),p_severity[idx],p_loading[idx],
+            p_id1[l],p_id2[l],p_tags[l].c_str(),p_qloss[idx],
+            p_selected[idx] ? "ac" : "skip");
+      } else {
+        fprintf(fout,"%s %12.6f %12.6f - - - %12.4f %s\n",
+            events[idx].p_name.c_str(),p_severity[idx],p_loading[idx],
+            p_qloss[idx],p_selected[idx] ? "ac" : "skip");
+      }
+    }
+    fclose(fout);
+  }
+  printf("\nContingency screening: %d contingencies, %d selected for AC"
+      " solution (%d could not be screened), %d AC solutions avoided\n",
+      ntasks,nselected,nisland,ntasks-nselected);
+  printf("Contingency screening: DC model with %d buses factored in %f s,"
+      " screening time %f s\n",p_nred+1,p_setup_time,p_screen_time);
+}
@@ -0,0 +1,155 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_screen.hpp
+ *
+ * @brief Linear (DC) screening of contingencies with power transfer and
+ *        line outage distribution factors computed from the base case.
+ *        Only contingencies that are likely to cause violations are sent
+ *        to the full AC power flow.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _ca_screen_h_
+#define _ca_screen_h_
+
+#include <map>
+#include "gridpack/include/gridpack.hpp"
+#include "gridpack/applications/modules/powerflow/pf_app_module.hpp"
+#include "ca_results.hpp"
+
+namespace gridpack {
+namespace contingency_analysis {
+
+// The DC network model (series reactances of the in-service elements) is
+// assembled from the base case and the reduced susceptance matrix is
+// factored once with a dense Cholesky factorization. The complete model is
+// replicated on every process and the contingencies are divided over the
+// processes of the world communicator, so screening does not depend on the
+// task communicators.
+//
+// For a contingency that takes out the set of elements K, the post
+// contingency flow on element l is estimated as
+//   P_l' = P_l + sum_k PTDF_l,k f_k,  f = (I - PTDF_K,K)^-1 P_K
+// which reduces to the usual LODF for a single line. A generator outage is
+// modeled as its real power being picked up by the swing bus. Voltage
+// problems cannot be seen by a DC model, so the reactive power removed by
+// the contingency (base case Q flow of the lines or Q output of the
+// generators) is used as a voltage risk index.
+class CAScreen
+{
+  public:
+    /**
+     * Basic constructor
+     * @param comm world communicator
+     */
+    CAScreen(const gridpack::parallel::Communicator &comm);
+
+    /**
+     * Basic destructor
+     */
+    ~CAScreen(void);
+
+    /**
+     * Build and factor the DC network model from the base case solution.
+     * Collective on the task communicator of results
+     * @param results exporter for the base case solution
+     */
+    void setup(CAResults &results);
+
+    /**
+     * Rank contingencies by their estimated severity and select the ones
+     * that are solved with the AC power flow. A contingency is selected if
+     * its severity is at least threshold, if it is one of the top_k most
+     * severe contingencies or if it splits the network
+     * @param events list of contingencies
+     * @param threshold minimum severity of selected contingencies, where a
+     *        severity of 1 corresponds to an element loaded to its rating
+     * @param top_k number of most severe contingencies that are always
+     *        selected
+     * @param q_weight weight of the removed reactive power (per MVAR) in
+     *        the severity
+     * @param selected true for contingencies that need an AC solution
+     */
+    void screen(std::vector<gridpack::powerflow::Contingency> &events,
+        double threshold, int top_k, double q_weight,
+        std::vector<bool> &selected);
+
+    /**
+     * Write the screening results of each contingency, most severe first,
+     * and print a summary. Only process 0 writes
+     * @param filename name of the output file
+     * @param events list of contingencies
+     */
+    void write(const char *filename,
+        std::vector<gridpack::powerflow::Contingency> &events);
+
+  private:
+
+    /**
+     * Solve the reduced DC system B w = rhs with the Cholesky factors
+     * @param rhs right hand side indexed by bus row, the swing bus entry is
+     *        ignored
+     * @param w solution indexed by bus row, zero at the swing bus
+     */
+    void solve(const std::vector<double> &rhs, std::vector<double> &w) const;
+
+    /**
+     * Find the branch elements removed by a line contingency
+     * @param event contingency
+     * @param elems branch rows of the removed elements
+     * @return false if an element could not be found
+     */
+    bool findElements(const gridpack::powerflow::Contingency &event,
+        std::vector<int> &elems) const;
+
+    gridpack::parallel::Communicator p_comm;
+
+    // Bus rows in the DC model, keyed by original bus index, the column of
+    // each bus row in the reduced matrix (-1 for the swing bus) and the
+    // dense Cholesky factor of the reduced susceptance matrix
+    std::map<int,int> p_bus_row;
+    std::vector<int> p_column;
+    int p_nred;
+    std::vector<double> p_factor;
+
+    // Branch elements: end bus rows, circuit IDs, reactance, status,
+    // rating and base case flows
+    std::vector<int> p_from;
+    std::vector<int> p_to;
+    std::vector<int> p_id1;
+    std::vector<int> p_id2;
+    std::vector<std::string> p_tags;
+    std::vector<double> p_x;
+    std::vector<int> p_status;
+    std::vector<double> p_rating;
+    std::vector<double> p_pflow;
+    std::vector<double> p_qflow;
+
+    // Generators: bus row, bus ID, generator ID and base case output
+    std::vector<int> p_gen_bus;
+    std::vector<int> p_gen_ids;
+    std::vector<std::string> p_gen_tags;
+    std::vector<double> p_pgen;
+    std::vector<double> p_qgen;
+
+    // Screening results for each contingency
+    std::vector<double> p_severity;
+    std::vector<double> p_loading;
+    std::vector<double> p_qloss;
+    std::vector<int> p_worst;
+    std::vector<int> p_island;
+    std::vector<bool> p_selected;
+    double p_setup_time;
+    double p_screen_time;
+};
+
+} // contingency analysis
+} // gridpack
+#endif
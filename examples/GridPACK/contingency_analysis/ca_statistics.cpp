@@ -0,0 +1,405 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_statistics.cpp
+ *
+ * @brief Contingency statistics that are either stored in a StatBlock or
+ *        folded into running statistics as the contingencies finish.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include "ca_statistics.hpp"
+
+/**
+ * Basic constructor
+ * @param comm communicator on which statistics are collected
+ * @param nrows number of rows (network elements)
+ * @param ncols number of columns (base case and contingencies)
+ * @param streaming true to keep running statistics instead of all
+ *        values
+ * @param raw_file prefix of the binary files that hold the raw columns
+ *        in streaming mode (no raw output if empty)
+ * @param block_columns number of columns buffered before they are
+ *        written to the raw file
+ */
+gridpack::contingency_analysis::CAStatistics::CAStatistics(
+    const gridpack::parallel::Communicator &comm, int nrows, int ncols,
+    bool streaming, std::string raw_file, int block_columns)
+  : p_comm(comm)
+{
+  p_nrows = nrows;
+  p_ncols = ncols;
+  p_streaming = streaming;
+  p_reduced = false;
+  p_raw = NULL;
+  p_raw_file = raw_file;
+  p_block_columns = block_columns;
+  if (p_block_columns < 1) p_block_columns = 1;
+  if (!p_streaming) {
+    p_block.reset(new gridpack::analysis::StatBlock(comm,nrows,ncols));
+    return;
+  }
+  p_count.resize(NMASK*nrows,0);
+  p_sum.resize(NMASK*nrows,0.0);
+  p_sum2.resize(NMASK*nrows,0.0);
+  p_min.resize(NMASK*nrows,DBL_MAX);
+  p_max.resize(NMASK*nrows,-DBL_MAX);
+  p_min_col.resize(NMASK*nrows,INT_MAX);
+  p_max_col.resize(NMASK*nrows,INT_MAX);
+  p_col_sum.resize(NMASK*ncols,0.0);
+}
+
+/**
+ * Basic destructor. Writes any buffered raw columns
+ */
+gridpack::contingency_analysis::CAStatistics::~CAStatistics(void)
+{
+  if (p_raw) {
+    flush();
+    fclose(p_raw);
+  }
+}
+
+/**
+ * Add row labels for bus quantities
+ * @param ids bus IDs
+ * @param tags device tags
+ */
+void gridpack::contingency_analysis::CAStatistics::addRowLabels(
+    std::vector<int> &ids, std::vector<std::string> &tags)
+{
+  if (p_block) {
+    p_block->addRowLabels(ids,tags);
+    return;
+  }
+  p_id1 = ids;
+  p_id2.clear();
+  p_tags = tags;
+}
+
+/**
+ * Add row labels for branch quantities
+ * @param id1 IDs of from buses
+ * @param id2 IDs of to buses
+ * @param tags circuit IDs
+ */
+void gridpack::contingency_analysis::CAStatistics::addRowLabels(
+    std::vector<int> &id1, std::vector<int> &id2,
+    std::vector<std::string> &tags)
+{
+  if (p_block) {
+    p_block->addRowLabels(id1,id2,tags);
+    return;
+  }
+  p_id1 = id1;
+  p_id2 = id2;
+  p_tags = tags;
+}
+
+/**
+ * Add the values of one column
+ * @param idx column index
+ * @param values value for each row
+ * @param mask mask for each row
+ */
+void gridpack::contingency_analysis::CAStatistics::addColumnValues(int idx,
+    std::vector<double> &values, std::vector<int> &mask)
+{
+  if (p_block) {
+    p_block->addColumnValues(idx,values,mask);
+    return;
+  }
+  int i;
+  for (i=0; i<p_nrows; i++) {
+    int m = mask[i];
+    if (m <= 0) continue;
+    if (m >= NMASK) m = NMASK-1;
+    int k = m*p_nrows+i;
+    double v = values[i];
+    p_count[k]++;
+    p_sum[k] += v;
+    p_sum2[k] += v*v;
+    if (v < p_min[k]) {
+      p_min[k] = v;
+      p_min_col[k] = idx;
+    }
+    if (v > p_max[k]) {
+      p_max[k] = v;
+      p_max_col[k] = idx;
+    }
+    if (idx >= 0 && idx < p_ncols) p_col_sum[m*p_ncols+idx] += v;
+  }
+
+  if (p_raw_file.empty()) return;
+  if (!p_raw) {
+    char sbuf[256];
+    sprintf(sbuf,"%s.%d.bin",p_raw_file.c_str(),p_comm.rank());
+    p_raw = fopen(sbuf,"wb");
+    if (!p_raw) {
+      printf("Unable to open raw statistics file %s\n",sbuf);
+      p_raw_file.clear();
+      return;
+    }
+    int nrows = p_nrows;
+    fwrite("CASTAT01",1,8,p_raw);
+    fwrite(&nrows,sizeof(int),1,p_raw);
+    p_buf_values.reserve(p_block_columns*p_nrows);
+    p_buf_masks.reserve(p_block_columns*p_nrows);
+  }
+  p_buf_cols.push_back(idx);
+  p_buf_values.insert(p_buf_values.end(),values.begin(),
+      values.begin()+p_nrows);
+  for (i=0; i<p_nrows; i++) {
+    p_buf_masks.push_back(static_cast<char>(mask[i]));
+  }
+  if (p_buf_cols.size() >= p_block_columns) flush();
+}
+
+/**
+ * Add lower limits of each row
+ * @param min lower limit of each row
+ */
+void gridpack::contingency_analysis::CAStatistics::addRowMinValue(
+    std::vector<double> &min)
+{
+  if (p_block) {
+    p_block->addRowMinValue(min);
+    return;
+  }
+  p_min_limit = min;
+}
+
+/**
+ * Add upper limits of each row
+ * @param max upper limit of each row
+ */
+void gridpack::contingency_analysis::CAStatistics::addRowMaxValue(
+    std::vector<double> &max)
+{
+  if (p_block) {
+    p_block->addRowMaxValue(max);
+    return;
+  }
+  p_max_limit = max;
+}
+
+/**
+ * Write mean and RMS deviation of each row
+ * @param filename name of output file
+ * @param mask values with at least this mask are included
+ * @param flag write device tags
+ */
+void gridpack::contingency_analysis::CAStatistics::writeMeanAndRMS(
+    const char *filename, int mask, bool flag)
+{
+  if (p_block) {
+    p_block->writeMeanAndRMS(filename,mask,flag);
+    return;
+  }
+  reduce();
+  if (p_comm.rank() != 0) return;
+  FILE *fout = fopen(filename,"w");
+  if (!fout) return;
+  if (mask < 1) mask = 1;
+  int i, m;
+  for (i=0; i<p_nrows; i++) {
+    int n = 0;
+    double sum = 0.0;
+    double sum2 = 0.0;
+    for (m=mask; m<NMASK; m++) {
+      n += p_count[m*p_nrows+i];
+      sum += p_sum[m*p_nrows+i];
+      sum2 += p_sum2[m*p_nrows+i];
+    }
+    double mean = 0.0;
+    double rms = 0.0;
+    if (n > 0) {
+      mean = sum/static_cast<double>(n);
+      rms = sum2/static_cast<double>(n)-mean*mean;
+      rms = rms > 0.0 ? sqrt(rms) : 0.0;
+    }
+    writeLabel(fout,i,flag);
+    fprintf(fout," %16.8e %16.8e %8d\n",mean,rms,n);
+  }
+  fclose(fout);
+}
+
+/**
+ * Write minimum and maximum of each row
+ * @param filename name of output file
+ * @param mask values with at least this mask are included
+ * @param flag write device tags
+ */
+void gridpack::contingency_analysis::CAStatistics::writeMinAndMax(
+    const char *filename, int mask, bool flag)
+{
+  if (p_block) {
+    p_block->writeMinAndMax(filename,mask,flag);
+    return;
+  }
+  reduce();
+  if (p_comm.rank() != 0) return;
+  FILE *fout = fopen(filename,"w");
+  if (!fout) return;
+  if (mask < 1) mask = 1;
+  int i, m;
+  for (i=0; i<p_nrows; i++) {
+    double vmin = DBL_MAX;
+    double vmax = -DBL_MAX;
+    int cmin = -1;
+    int cmax = -1;
+    for (m=mask; m<NMASK; m++) {
+      int k = m*p_nrows+i;
+      if (p_count[k] == 0) continue;
+      if (p_min[k] < vmin || (p_min[k] == vmin && p_min_col[k] < cmin)) {
+        vmin = p_min[k];
+        cmin = p_min_col[k];
+      }
+      if (p_max[k] > vmax || (p_max[k] == vmax && p_max_col[k] < cmax)) {
+        vmax = p_max[k];
+        cmax = p_max_col[k];
+      }
+    }
+    if (cmin < 0) {
+      vmin = 0.0;
+      vmax = 0.0;
+    }
+    // Column indices start at 0 for the base case, so they are the
+    // contingency number of the extreme values
+    writeLabel(fout,i,flag);
+    fprintf(fout," %16.8e %8d %16.8e %8d",vmin,cmin,vmax,cmax);
+    if (i < p_min_limit.size()) fprintf(fout," %16.8e",p_min_limit[i]);
+    if (i < p_max_limit.size()) fprintf(fout," %16.8e",p_max_limit[i]);
+    fprintf(fout,"\n");
+  }
+  fclose(fout);
+}
+
+/**
+ * Write number of values in each row with a given mask
+ * @param filename name of output file
+ * @param mask mask value that is counted
+ * @param flag write device tags
+ */
+void gridpack::contingency_analysis::CAStatistics::writeMaskValueCount(
+    const char *filename, int mask, bool flag)
+{
+  if (p_block) {
+    p_block->writeMaskValueCount(filename,mask,flag);
+    return;
+  }
+  reduce();
+  if (p_comm.rank() != 0) return;
+  FILE *fout = fopen(filename,"w");
+  if (!fout) return;
+  if (mask < 1) mask = 1;
+  if (mask >= NMASK) mask = NMASK-1;
+  int i;
+  for (i=0; i<p_nrows; i++) {
+    writeLabel(fout,i,flag);
+    fprintf(fout," %8d\n",p_count[mask*p_nrows+i]);
+  }
+  fclose(fout);
+}
+
+/**
+ * Write the sum of the values in each column
+ * @param filename name of output file
+ * @param mask values with at least this mask are included
+ * @param flag write device tags (not used, columns have no tags)
+ */
+void gridpack::contingency_analysis::CAStatistics::sumColumnValues(
+    const char *filename, int mask, bool flag)
+{
+  if (p_block) {
+    p_block->sumColumnValues(filename,mask,flag);
+    return;
+  }
+  reduce();
+  if (p_comm.rank() != 0) return;
+  FILE *fout = fopen(filename,"w");
+  if (!fout) return;
+  if (mask < 1) mask = 1;
+  int j, m;
+  for (j=0; j<p_ncols; j++) {
+    double sum = 0.0;
+    for (m=mask; m<NMASK; m++) sum += p_col_sum[m*p_ncols+j];
+    fprintf(fout,"%8d %16.8e\n",j,sum);
+  }
+  fclose(fout);
+}
+
+/**
+ * Combine the running statistics of all processes onto process 0
+ * (all processes must call this)
+ */
+void gridpack::contingency_analysis::CAStatistics::reduce(void)
+{
+  if (p_reduced) return;
+  p_reduced = true;
+  int n = NMASK*p_nrows;
+  if (n > 0) {
+    p_comm.sum(&p_count[0],n);
+    p_comm.sum(&p_sum[0],n);
+    p_comm.sum(&p_sum2[0],n);
+    // Extreme values are reduced first, then the lowest column index among
+    // the processes that hold the extreme value
+    std::vector<double> vmin = p_min;
+    std::vector<double> vmax = p_max;
+    p_comm.min(&p_min[0],n);
+    p_comm.max(&p_max[0],n);
+    int i;
+    for (i=0; i<n; i++) {
+      if (vmin[i] != p_min[i]) p_min_col[i] = INT_MAX;
+      if (vmax[i] != p_max[i]) p_max_col[i] = INT_MAX;
+    }
+    p_comm.min(&p_min_col[0],n);
+    p_comm.min(&p_max_col[0],n);
+  }
+  if (p_col_sum.size() > 0) p_comm.sum(&p_col_sum[0],p_col_sum.size());
+}
+
+/**
+ * Write the label of a row
+ * @param fout output file
+ * @param row row index
+ * @param flag write device tags
+ */
+void gridpack::contingency_analysis::CAStatistics::writeLabel(FILE *fout,
+    int row, bool flag)
+{
+  if (row < p_id1.size()) {
+    fprintf(fout,"%8d",p_id1[row]);
+  } else {
+    fprintf(fout,"%8d",row);
+  }
+  if (row < p_id2.size()) fprintf(fout," %8d",p_id2[row]);
+  if (flag && row < p_tags.size()) fprintf(fout," %s",p_tags[row].c_str());
+}
+
+/**
+ * Write the buffered raw columns
+ */
+void gridpack::contingency_analysis::CAStatistics::flush(void)
+{
+  if (!p_raw || p_buf_cols.empty()) return;
+  int j;
+  for (j=0; j<p_buf_cols.size(); j++) {
+    fwrite(&p_buf_cols[j],sizeof(int),1,p_raw);
+    fwrite(&p_buf_values[j*p_nrows],sizeof(double),p_nrows,p_raw);
+    fwrite(&p_buf_masks[j*p_nrows],1,p_nrows,p_raw);
+  }
+  fflush(p_raw);
+  p_buf_cols.clear();
+  p_buf_values.clear();
+  p_buf_masks.clear();
+}
@@ -0,0 +1,206 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_statistics.hpp
+ *
+ * @brief Contingency statistics that are either stored in a StatBlock or
+ *        folded into running statistics as the contingencies finish, so
+ *        that memory does not grow with the number of contingencies.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _ca_statistics_h_
+#define _ca_statistics_h_
+
+#include <cstdio>
+#include "gridpack/include/gridpack.hpp"
+
+namespace gridpack {
+namespace contingency_analysis {
+
+// Drop-in replacement for the StatBlock objects of CADriver. Without
+// streaming all calls are forwarded to a StatBlock of nrows x ncols
+// values. With streaming each process that adds columns keeps, for every
+// row, the number of values, sum, sum of squares, minimum and maximum for
+// each mask value, so the row statistics are O(nrows) independent of the
+// number of columns. The only per-column data are the column sums written
+// by sumColumnValues, NMASK doubles per column on every process, which are
+// O(ncols) but do not depend on the number of rows. The running statistics
+// of all processes are combined when the results are written out.
+//
+// Statistics for a mask value m include all values whose mask is at least
+// m (a value that violates a limit, mask 2 or 3, is still a valid value)
+// and mask value counts count values with exactly that mask. Masks larger
+// than 3 are treated as 3.
+//
+// If a raw file name is given, every column is also appended to the binary
+// file <raw_file>.<rank>.bin of the process that added it, in blocks of
+// block_columns columns. The file starts with the tag "CASTAT01" and the
+// number of rows as a 32 bit integer. Each column is stored as its 32 bit
+// index, nrows doubles and nrows one byte masks.
+class CAStatistics
+{
+  public:
+    /**
+     * Basic constructor
+     * @param comm communicator on which statistics are collected
+     * @param nrows number of rows (network elements)
+     * @param ncols number of columns (base case and contingencies)
+     * @param streaming true to keep running statistics instead of all
+     *        values
+     * @param raw_file prefix of the binary files that hold the raw columns
+     *        in streaming mode (no raw output if empty)
+     * @param block_columns number of columns buffered before they are
+     *        written to the raw file
+     */
+    CAStatistics(const gridpack::parallel::Communicator &comm, int nrows,
+        int ncols, bool streaming, std::string raw_file = "",
+        int block_columns = 64);
+
+    /**
+     * Basic destructor. Writes any buffered raw columns
+     */
+    ~CAStatistics(void);
+
+    /**
+     * Add row labels for bus quantities
+     * @param ids bus IDs
+     * @param tags device tags
+     */
+    void addRowLabels(std::vector<int> &ids, std::vector<std::string> &tags);
+
+    /**
+     * Add row labels for branch quantities
+     * @param id1 IDs of from buses
+     * @param id2 IDs of to buses
+     * @param tags circuit IDs
+     */
+    void addRowLabels(std::vector<int> &id1, std::vector<int> &id2,
+        std::vector<std::string> &tags);
+
+    /**
+     * Add the values of one column
+     * @param idx column index
+     * @param values value for each row
+     * @param mask mask for each row
+     */
+    void addColumnValues(int idx, std::vector<double> &values,
+        std::vector<int> &mask);
+
+    /**
+     * Add lower limits of each row
+     * @param min lower limit of each row
+     */
+    void addRowMinValue(std::vector<double> &min);
+
+    /**
+     * Add upper limits of each row
+     * @param max upper limit of each row
+     */
+    void addRowMaxValue(std::vector<double> &max);
+
+    /**
+     * Write mean and RMS deviation of each row
+     * @param filename name of output file
+     * @param mask values with at least this mask are included
+     * @param flag write device tags
+     */
+    void writeMeanAndRMS(const char *filename, int mask = 1,
+        bool flag = true);
+
+    /**
+     * Write minimum and maximum of each row
+     * @param filename name of output file
+     * @param mask values with at least this mask are included
+     * @param flag write device tags
+     */
+    void writeMinAndMax(const char *filename, int mask = 1, bool flag = true);
+
+    /**
+     * Write number of values in each row with a given mask
+     * @param filename name of output file
+     * @param mask mask value that is counted
+     * @param flag write device tags
+     */
+    void writeMaskValueCount(const char *filename, int mask = 1,
+        bool flag = true);
+
+    /**
+     * Write the sum of the values in each column
+     * @param filename name of output file
+     * @param mask values with at least this mask are included
+     * @param flag write device tags (not used, columns have no tags)
+     */
+    void sumColumnValues(const char *filename, int mask = 1,
+        bool flag = true);
+
+  private:
+
+    // Number of distinct mask values kept by the running statistics
+    static const int NMASK = 4;
+
+    /**
+     * Combine the running statistics of all processes onto process 0
+     * (all processes must call this)
+     */
+    void reduce(void);
+
+    /**
+     * Write the label of a row
+     * @param fout output file
+     * @param row row index
+     * @param flag write device tags
+     */
+    void writeLabel(FILE *fout, int row, bool flag);
+
+    /**
+     * Write the buffered raw columns
+     */
+    void flush(void);
+
+    gridpack::parallel::Communicator p_comm;
+    int p_nrows;
+    int p_ncols;
+    bool p_streaming;
+    boost::shared_ptr<gridpack::analysis::StatBlock> p_block;
+
+    // Row labels and limits (process 0)
+    std::vector<int> p_id1;
+    std::vector<int> p_id2;
+    std::vector<std::string> p_tags;
+    std::vector<double> p_min_limit;
+    std::vector<double> p_max_limit;
+
+    // Running statistics for each mask value, indexed by
+    // mask*p_nrows+row, and the sum of each column for each mask value,
+    // indexed by mask*p_ncols+column. The column sums are the one array
+    // that grows with the number of columns (contingencies), and are
+    // summed over all processes in reduce
+    std::vector<int> p_count;
+    std::vector<double> p_sum;
+    std::vector<double> p_sum2;
+    std::vector<double> p_min;
+    std::vector<double> p_max;
+    std::vector<int> p_min_col;
+    std::vector<int> p_max_col;
+    std::vector<double> p_col_sum;
+    bool p_reduced;
+
+    // Raw column output
+    std::string p_raw_file;
+    FILE *p_raw;
+    int p_block_columns;
+    std::vector<int> p_buf_cols;
+    std::vector<double> p_buf_values;
+    std::vector<char> p_buf_masks;
+};
+
+} // contingency analysis
+} // gridpack
+#endif
@@ -0,0 +1,465 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_warm_start.cpp
+ *
+ * @brief Warm started contingency solves with chord iterations on the
+ *        factored base case Jacobian and a low rank correction for the
+ *        entries changed by the contingency.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "ca_driver.hpp"
+#include "ca_warm_start.hpp"
+
+/**
+ * Basic constructor. Called after the base case has been solved. Saves
+ * the base case voltages and factors the base case Jacobian
+ * @param network power flow network of the task communicator
+ * @param cursor Powerflow block of the input file (tolerance and
+ *        LinearSolver).
+ * @param use_similar true to start from solved contingencies that
+ *        remove one of the same elements, false to always start from
+ *        the base case
+ * @param max_chord maximum number of chord iterations, 0 to only warm
+ *        start the full Newton solve
+ * @param ratio chord iterations stop if the mismatch is not reduced by
+ *        at least this factor
+ * @param max_saved maximum number of contingency solutions kept as
+ *        starting points
+ * @param max_rank maximum number of changed Jacobian rows corrected for
+ *        in the chord iterations, 0 to use the base case Jacobian alone
+ */
+gridpack::contingency_analysis::CAWarmStart::CAWarmStart(
+    boost::shared_ptr<gridpack::powerflow::PFNetwork> network,
+    gridpack::utility::Configuration::CursorPtr cursor,
+    bool use_similar, int max_chord, double ratio, int max_saved,
+    int max_rank)
+{
+  p_network = network;
+  p_use_similar = use_similar;
+  p_max_chord = max_chord;
+  p_ratio = ratio;
+  p_max_saved = max_saved;
+  p_max_rank = max_rank;
+  p_tolerance = 1.0e-6;
+  if (cursor) p_tolerance = cursor->get("tolerance",p_tolerance);
+  p_seeded = 0;
+  p_similar = 0;
+  p_chord_solves = 0;
+  p_chord_converged = 0;
+  p_chord_iterations = 0;
+  p_corrected = 0;
+  getState(p_base);
+  p_start = &p_base;
+  if (p_max_chord <= 0) return;
+
+  // Factor the Jacobian at the base case solution. A separate factory on
+  // the same network is used so that the power flow module is not
+  // affected, apart from the mode of the network components which the
+  // module sets again before it uses them
+  p_factory.reset(new gridpack::powerflow::PFFactory(p_network));
+  p_vMap.reset(new gridpack::mapper::BusVectorMap<
+      gridpack::powerflow::PFNetwork>(p_network));
+  p_factory->setMode(RHS);
+  p_PQ = p_vMap->mapToVector();
+  p_X.reset(p_PQ->clone());
+  p_factory->setMode(Jacobian);
+  p_jMap.reset(new gridpack::mapper::FullMatrixMap<
+      gridpack::powerflow::PFNetwork>(p_network));
+  p_J = p_jMap->mapToMatrix();
+  p_solver.reset(new gridpack::math::LinearSolver(*p_J));
+  p_solver->configure(cursor);
+  // Contingency Jacobians have the same pattern, the entries of outaged
+  // branches are zero
+  if (p_max_rank > 0) p_Jc.reset(p_J->clone());
+}
+
+/**
+ * Basic destructor
+ */
+gridpack::contingency_analysis::CAWarmStart::~CAWarmStart(void)
+{
+}
+
+/**
+ * Set the bus voltages to the starting point of a contingency. Replaces
+ * PFAppModule::resetVoltages
+ * @param event contingency
+ */
+void gridpack::contingency_analysis::CAWarmStart::seed(
+    const gridpack::powerflow::Contingency &event)
+{
+  p_seeded++;
+  if (p_use_similar && !p_saved_states.empty()) {
+    // Most recently solved contingency that removes one of the same
+    // elements. The decision only depends on the contingency list, so all
+    // processes in the task communicator pick the same state
+    std::vector<Element> elems;
+    getElements(event,elems);
+    int i, j;
+    for (i=0; i<p_saved_elems.size(); i++) {
+      for (j=0; j<elems.size(); j++) {
+        if (std::find(p_saved_elems[i].begin(),p_saved_elems[i].end(),
+              elems[j]) != p_saved_elems[i].end()) break;
+      }
+      if (j < elems.size()) {
+        p_start = &p_saved_states[i];
+        setState(*p_start);
+        p_similar++;
+        return;
+      }
+    }
+  }
+  p_start = &p_base;
+  setState(p_base);
+}
+
+/**
+ * Solve the contingency with chord iterations. The contingency must
+ * already be set on the network and the voltages seeded. If the
+ * iterations do not converge, the voltages are reset to the starting
+ * point for a full Newton solve
+ * @return true if the iterations converged
+ */
+bool gridpack::contingency_analysis::CAWarmStart::solve(void)
+{
+  if (p_max_chord <= 0) return false;
+  p_chord_solves++;
+
+  // Admittances and injections of the contingency
+  p_factory->setYBus();
+  p_factory->setSBus();
+  setCorrection();
+  p_factory->setMode(RHS);
+  p_vMap->mapToVector(p_PQ);
+  double tol = real(p_PQ->normInfinity());
+  int iter = 0;
+  while (tol > p_tolerance && iter < p_max_chord) {
+    // Only a forward and back substitution, the factorization of the base
+    // case Jacobian is reused
+    p_X->zero();
+    p_solver->solve(*p_PQ, *p_X);
+    if (!p_rows.empty()) correct(*p_X);
+    p_factory->setMode(RHS);
+    p_vMap->mapToBus(p_X);
+    p_network->updateBuses();
+    p_vMap->mapToVector(p_PQ);
+    double next = real(p_PQ->normInfinity());
+    iter++;
+    bool stalled = (next > p_ratio*tol);
+    tol = next;
+    if (stalled && tol > p_tolerance) break;
+  }
+  p_chord_iterations += iter;
+  if (tol <= p_tolerance) {
+    p_chord_converged++;
+    return true;
+  }
+  setState(*p_start);
+  return false;
+}
+
+/**
+ * Save the current solution of a converged contingency as a starting
+ * point for later contingencies
+ * @param event contingency
+ */
+void gridpack::contingency_analysis::CAWarmStart::save(
+    const gridpack::powerflow::Contingency &event)
+{
+  if (!p_use_similar || p_max_saved <= 0) return;
+  std::vector<Element> elems;
+  getElements(event,elems);
+  if (p_saved_states.size() >= p_max_saved) {
+    // Reuse the storage of the oldest state
+    p_saved_states.push_front(std::vector<double>());
+    p_saved_states.front().swap(p_saved_states.back());
+    p_saved_states.pop_back();
+    p_saved_elems.pop_back();
+  } else {
+    p_saved_states.push_front(std::vector<double>());
+  }
+  getState(p_saved_states.front());
+  p_saved_elems.push_front(elems);
+}
+
+/**
+ * Print statistics on chord solves from process 0 of world
+ * @param world world communicator
+ */
+void gridpack::contingency_analysis::CAWarmStart::printStats(
+    const gridpack::parallel::Communicator &world)
+{
+  std::vector<int> stats(6,0);
+  if (p_network->communicator().rank() == 0) {
+    stats[0] = p_seeded;
+    stats[1] = p_similar;
+    stats[2] = p_chord_solves;
+    stats[3] = p_chord_converged;
+    stats[4] = p_chord_iterations;
+    stats[5] = p_corrected;
+  }
+  world.sum(&stats[0],stats.size());
+  if (world.rank() == 0) {
+    printf("\nWarm start: %d contingencies seeded, %d from a similar"
+        " contingency\n",stats[0],stats[1]);
+    printf("Warm start: %d chord solves, %d converged without refactoring"
+        " (%d iterations), %d fell back to Newton\n",stats[2],stats[3],
+        stats[4],stats[2]-stats[3]);
+    printf("Warm start: %d chord solves corrected for the changed Jacobian"
+        " entries\n",stats[5]);
+  }
+}
+
+/**
+ * Set up the low rank correction of the base case Jacobian for the
+ * contingency set on the network. Finds the changed rows, their
+ * entries and the solves of the base case Jacobian for them, and
+ * factors the capacitance matrix I + D E^T Z. Leaves p_rows empty if
+ * there is no correction
+ */
+void gridpack::contingency_analysis::CAWarmStart::setCorrection(void)
+{
+  p_rows.clear();
+  if (p_max_rank <= 0) return;
+  const gridpack::parallel::Communicator &comm = p_network->communicator();
+  int nprocs = comm.size();
+  int me = comm.rank();
+
+  // Contingency Jacobian at the base case voltages, the Y-bus of the
+  // contingency has already been set
+  setState(p_base);
+  p_factory->setMode(Jacobian);
+  p_jMap->mapToMatrix(p_Jc);
+  setState(*p_start);
+
+  // The changed rows are the nonzero entries of (Jc - J) r for a vector r
+  // without zero entries
+  int lo, hi, i, j, k;
+  boost::shared_ptr<gridpack::math::Vector> r(p_PQ->clone());
+  r->localIndexRange(lo,hi);
+  for (i=lo; i<hi; i++) {
+    r->setElement(i,gridpack::ComplexType(
+          1.0+0.5*sin(static_cast<double>(i)),0.0));
+  }
+  r->ready();
+  boost::shared_ptr<gridpack::math::Vector>
+    y(gridpack::math::multiply(*p_Jc,*r));
+  boost::shared_ptr<gridpack::math::Vector>
+    y0(gridpack::math::multiply(*p_J,*r));
+  double scale = real(y0->normInfinity());
+  y->add(*y0,-1.0);
+  std::vector<int> local;
+  for (i=lo; i<hi; i++) {
+    gridpack::ComplexType v;
+    y->getElement(i,v);
+    if (std::abs(real(v)) > 1.0e-12*scale) local.push_back(i);
+  }
+
+  // Collect the changed rows of all processes in increasing order. Each
+  // process fills its own slots and the others contribute zeros
+  std::vector<int> counts(nprocs,0);
+  counts[me] = local.size();
+  comm.sum(&counts[0],nprocs);
+  int offset = 0;
+  int nrows = 0;
+  for (i=0; i<nprocs; i++) {
+    if (i < me) offset += counts[i];
+    nrows += counts[i];
+  }
+  if (nrows == 0 || nrows > p_max_rank) return;
+  p_rows.assign(nrows,0);
+  for (i=0; i<local.size(); i++) p_rows[offset+i] = local[i];
+  comm.sum(&p_rows[0],nrows);
+
+  // Changed entries D = Jc - J on these rows and columns. The rows and
+  // columns of the Jacobian are the same bus variables, so the changes of
+  // an outage lie in the block of its buses
+  p_D.assign(nrows*nrows,0.0);
+  for (i=0; i<nrows; i++) {
+    if (p_rows[i] < lo || p_rows[i] >= hi) continue;
+    for (j=0; j<nrows; j++) {
+      gridpack::ComplexType jc, j0;
+      p_Jc->getElement(p_rows[i],p_rows[j],jc);
+      p_J->getElement(p_rows[i],p_rows[j],j0);
+      p_D[i*nrows+j] = real(jc-j0);
+    }
+  }
+  comm.sum(&p_D[0],nrows*nrows);
+
+  // Z = J^-1 E, one triangular solve on the base case factorization for
+  // each changed row
+  p_Z.resize(nrows);
+  std::vector<double> zrows(nrows*nrows);
+  std::vector<double> col;
+  for (j=0; j<nrows; j++) {
+    boost::shared_ptr<gridpack::math::Vector> e(p_PQ->clone());
+    e->zero();
+    if (p_rows[j] >= lo && p_rows[j] < hi) {
+      e->setElement(p_rows[j],gridpack::ComplexType(1.0,0.0));
+    }
+    e->ready();
+    if (!p_Z[j]) p_Z[j].reset(p_PQ->clone());
+    p_Z[j]->zero();
+    p_solver->solve(*e,*p_Z[j]);
+    getRows(*p_Z[j],col);
+    for (i=0; i<nrows; i++) zrows[i*nrows+j] = col[i];
+  }
+
+  // LU factorization with partial pivoting of I + D E^T Z
+  p_LU.assign(nrows*nrows,0.0);
+  for (i=0; i<nrows; i++) {
+    for (j=0; j<nrows; j++) {
+      double sum = (i == j) ? 1.0 : 0.0;
+      for (k=0; k<nrows; k++) sum += p_D[i*nrows+k]*zrows[k*nrows+j];
+      p_LU[i*nrows+j] = sum;
+    }
+  }
+  p_pivot.resize(nrows);
+  for (k=0; k<nrows; k++) {
+    int p = k;
+    for (i=k+1; i<nrows; i++) {
+      if (std::abs(p_LU[i*nrows+k]) > std::abs(p_LU[p*nrows+k])) p = i;
+    }
+    p_pivot[k] = p;
+    if (std::abs(p_LU[p*nrows+k]) < 1.0e-12) {
+      // The contingency Jacobian is singular, e.g. the outage islands a
+      // bus, so iterate on the base case Jacobian alone
+      p_rows.clear();
+      return;
+    }
+    if (p != k) {
+      for (j=0; j<nrows; j++) std::swap(p_LU[k*nrows+j],p_LU[p*nrows+j]);
+    }
+    for (i=k+1; i<nrows; i++) {
+      double f = p_LU[i*nrows+k]/p_LU[k*nrows+k];
+      p_LU[i*nrows+k] = f;
+      for (j=k+1; j<nrows; j++) p_LU[i*nrows+j] -= f*p_LU[k*nrows+j];
+    }
+  }
+  p_corrected++;
+}
+
+/**
+ * Correct a solution of the base case Jacobian to a solution of the
+ * contingency Jacobian
+ * @param x solution of the base case Jacobian, overwritten with the
+ *        corrected solution
+ */
+void gridpack::contingency_analysis::CAWarmStart::correct(
+    gridpack::math::Vector &x)
+{
+  int nrows = p_rows.size();
+  int i, j;
+  std::vector<double> xrows;
+  getRows(x,xrows);
+
+  // c = (I + D E^T Z)^-1 D E^T x
+  std::vector<double> c(nrows,0.0);
+  for (i=0; i<nrows; i++) {
+    for (j=0; j<nrows; j++) c[i] += p_D[i*nrows+j]*xrows[j];
+  }
+  for (i=0; i<nrows; i++) {
+    if (p_pivot[i] != i) std::swap(c[i],c[p_pivot[i]]);
+    for (j=0; j<i; j++) c[i] -= p_LU[i*nrows+j]*c[j];
+  }
+  for (i=nrows-1; i>=0; i--) {
+    for (j=i+1; j<nrows; j++) c[i] -= p_LU[i*nrows+j]*c[j];
+    c[i] /= p_LU[i*nrows+i];
+  }
+
+  // x - Z c
+  for (j=0; j<nrows; j++) {
+    x.add(*p_Z[j],gridpack::ComplexType(-c[j],0.0));
+  }
+}
+
+/**
+ * Entries of a vector at the changed rows, on all processes of the
+ * task communicator
+ * @param v distributed vector
+ * @param vals entries of v at p_rows
+ */
+void gridpack::contingency_analysis::CAWarmStart::getRows(
+    const gridpack::math::Vector &v, std::vector<double> &vals)
+{
+  int nrows = p_rows.size();
+  int lo, hi, i;
+  v.localIndexRange(lo,hi);
+  vals.assign(nrows,0.0);
+  for (i=0; i<nrows; i++) {
+    if (p_rows[i] < lo || p_rows[i] >= hi) continue;
+    gridpack::ComplexType x;
+    v.getElement(p_rows[i],x);
+    vals[i] = real(x);
+  }
+  p_network->communicator().sum(&vals[0],nrows);
+}
+
+/**
+ * Elements removed by a contingency, lines as pairs of bus IDs in
+ * increasing order and generators as (bus ID,-1)
+ * @param event contingency
+ * @param elems list of elements
+ */
+void gridpack::contingency_analysis::CAWarmStart::getElements(
+    const gridpack::powerflow::Contingency &event,
+    std::vector<Element> &elems) const
+{
+  elems.clear();
+  int i;
+  if (event.p_type == Branch) {
+    for (i=0; i<event.p_from.size(); i++) {
+      elems.push_back(Element(std::min(event.p_from[i],event.p_to[i]),
+            std::max(event.p_from[i],event.p_to[i])));
+    }
+  } else if (event.p_type == Generator) {
+    for (i=0; i<event.p_busid.size(); i++) {
+      elems.push_back(Element(event.p_busid[i],-1));
+    }
+  }
+}
+
+/**
+ * Copy voltages into the buses and update ghost buses
+ * @param state voltage magnitude and angle of each local bus
+ */
+void gridpack::contingency_analysis::CAWarmStart::setState(
+    const std::vector<double> &state)
+{
+  int nbus = p_network->numBuses();
+  int i;
+  for (i=0; i<nbus; i++) {
+    boost::shared_ptr<gridpack::powerflow::PFBus> bus = p_network->getBus(i);
+    bus->setVoltage(state[2*i]);
+    bus->setPhase(state[2*i+1]);
+  }
+  p_network->updateBuses();
+}
+
+/**
+ * Copy the voltages of all local buses
+ * @param state voltage magnitude and angle of each local bus
+ */
+void gridpack::contingency_analysis::CAWarmStart::getState(
+    std::vector<double> &state)
+{
+  int nbus = p_network->numBuses();
+  int i;
+  state.resize(2*nbus);
+  for (i=0; i<nbus; i++) {
+    boost::shared_ptr<gridpack::powerflow::PFBus> bus = p_network->getBus(i);
+    state[2*i] = bus->getVoltage();
+    state[2*i+1] = bus->getPhase();
+  }
+}
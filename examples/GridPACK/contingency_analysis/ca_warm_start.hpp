@@ -0,0 +1,206 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   ca_warm_start.hpp
+ *
+ * @brief Warm started contingency solves. Each contingency starts from the
+ *        base case solution, or from an already solved contingency that
+ *        removes one of the same elements, and is first solved with chord
+ *        (fixed Jacobian) iterations that reuse the factored base case
+ *        Jacobian, corrected for the entries changed by the contingency.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _ca_warm_start_h_
+#define _ca_warm_start_h_
+
+#include <deque>
+#include <utility>
+#include <vector>
+#include "gridpack/include/gridpack.hpp"
+#include "gridpack/applications/modules/powerflow/pf_app_module.hpp"
+#include "gridpack/applications/components/pf_matrix/pf_factory.hpp"
+
+namespace gridpack {
+namespace contingency_analysis {
+
+// An outage changes only a few entries of the Y-bus matrix, and so only
+// the Jacobian rows and columns of the buses it touches. The contingency
+// Jacobian at the base case voltages is the base case Jacobian plus a low
+// rank update on these rows, which the chord iterations apply with the
+// Sherman-Morrison-Woodbury formula on the base case factorization:
+//
+//   (J + E D E^T)^-1 b = y - Z (I + D E^T Z)^-1 D E^T y
+//
+// with y = J^-1 b, Z = J^-1 E, E the columns of the identity for the
+// changed rows and D the changed entries. Z costs one triangular solve per
+// changed row for each contingency, so the correction is skipped, and the
+// base case Jacobian used alone, if more rows than maxRank change. The
+// chord iterations stop as soon as the mismatch stops decreasing fast
+// enough, in which case the caller falls back to a full Newton solve from
+// the same starting point.
+class CAWarmStart
+{
+  public:
+    /**
+     * Basic constructor. Called after the base case has been solved. Saves
+     * the base case voltages and factors the base case Jacobian
+     * @param network power flow network of the task communicator
+     * @param cursor Powerflow block of the input file (tolerance and
+     *        LinearSolver).
+     * @param use_similar true to start from solved contingencies that
+     *        remove one of the same elements, false to always start from
+     *        the base case
+     * @param max_chord maximum number of chord iterations, 0 to only warm
+     *        start the full Newton solve
+     * @param ratio chord iterations stop if the mismatch is not reduced by
+     *        at least this factor
+     * @param max_saved maximum number of contingency solutions kept as
+     *        starting points
+     * @param max_rank maximum number of changed Jacobian rows corrected for
+     *        in the chord iterations, 0 to use the base case Jacobian alone
+     */
+    CAWarmStart(boost::shared_ptr<gridpack::powerflow::PFNetwork> network,
+        gridpack::utility::Configuration::CursorPtr cursor,
+        bool use_similar, int max_chord, double ratio, int max_saved,
+        int max_rank);
+
+    /**
+     * Basic destructor
+     */
+    ~CAWarmStart(void);
+
+    /**
+     * Set the bus voltages to the starting point of a contingency. Replaces
+     * PFAppModule::resetVoltages
+     * @param event contingency
+     */
+    void seed(const gridpack::powerflow::Contingency &event);
+
+    /**
+     * Solve the contingency with chord iterations. The contingency must
+     * already be set on the network and the voltages seeded. If the
+     * iterations do not converge, the voltages are reset to the starting
+     * point for a full Newton solve
+     * @return true if the iterations converged
+     */
+    bool solve(void);
+
+    /**
+     * Save the current solution of a converged contingency as a starting
+     * point for later contingencies
+     * @param event contingency
+     */
+    void save(const gridpack::powerflow::Contingency &event);
+
+    /**
+     * Print statistics on chord solves from process 0 of world
+     * @param world world communicator
+     */
+    void printStats(const gridpack::parallel::Communicator &world);
+
+  private:
+
+    typedef std::pair<int,int> Element;
+
+    /**
+     * Elements removed by a contingency, lines as pairs of bus IDs in
+     * increasing order and generators as (bus ID,-1)
+     * @param event contingency
+     * @param elems list of elements
+     */
+    void getElements(const gridpack::powerflow::Contingency &event,
+        std::vector<Element> &elems) const;
+
+    /**
+     * Set up the low rank correction of the base case Jacobian for the
+     * contingency set on the network. Finds the changed rows, their
+     * entries and the solves of the base case Jacobian for them, and
+     * factors the capacitance matrix I + D E^T Z. Leaves p_rows empty if
+     * there is no correction
+     */
+    void setCorrection(void);
+
+    /**
+     * Correct a solution of the base case Jacobian to a solution of the
+     * contingency Jacobian
+     * @param x solution of the base case Jacobian, overwritten with the
+     *        corrected solution
+     */
+    void correct(gridpack::math::Vector &x);
+
+    /**
+     * Entries of a vector at the changed rows, on all processes of the
+     * task communicator
+     * @param v distributed vector
+     * @param vals entries of v at p_rows
+     */
+    void getRows(const gridpack::math::Vector &v, std::vector<double> &vals);
+
+    /**
+     * Copy voltages into the buses and update ghost buses
+     * @param state voltage magnitude and angle of each local bus
+     */
+    void setState(const std::vector<double> &state);
+
+    /**
+     * Copy the voltages of all local buses
+     * @param state voltage magnitude and angle of each local bus
+     */
+    void getState(std::vector<double> &state);
+
+    boost::shared_ptr<gridpack::powerflow::PFNetwork> p_network;
+    boost::shared_ptr<gridpack::powerflow::PFFactory> p_factory;
+    boost::shared_ptr<gridpack::mapper::BusVectorMap<
+      gridpack::powerflow::PFNetwork> > p_vMap;
+    boost::shared_ptr<gridpack::math::Vector> p_PQ;
+    boost::shared_ptr<gridpack::math::Vector> p_X;
+    boost::shared_ptr<gridpack::mapper::FullMatrixMap<
+      gridpack::powerflow::PFNetwork> > p_jMap;
+    boost::shared_ptr<gridpack::math::Matrix> p_J;
+    boost::shared_ptr<gridpack::math::LinearSolver> p_solver;
+
+    // Low rank correction for the current contingency: changed rows of the
+    // Jacobian, base case solves for them, changed entries (row major) and
+    // LU factors of the capacitance matrix with their row pivots
+    boost::shared_ptr<gridpack::math::Matrix> p_Jc;
+    std::vector<int> p_rows;
+    std::vector<boost::shared_ptr<gridpack::math::Vector> > p_Z;
+    std::vector<double> p_D;
+    std::vector<double> p_LU;
+    std::vector<int> p_pivot;
+
+    bool p_use_similar;
+    int p_max_chord;
+    double p_ratio;
+    int p_max_saved;
+    int p_max_rank;
+    double p_tolerance;
+
+    // Base case solution and recently solved contingencies with the
+    // elements they remove
+    std::vector<double> p_base;
+    std::deque<std::vector<Element> > p_saved_elems;
+    std::deque<std::vector<double> > p_saved_states;
+
+    // Starting point of the current contingency
+    const std::vector<double> *p_start;
+
+    // Statistics
+    int p_seeded;
+    int p_similar;
+    int p_chord_solves;
+    int p_chord_converged;
+    int p_chord_iterations;
+    int p_corrected;
+};
+
+} // contingency analysis
+} // gridpack
+#endif
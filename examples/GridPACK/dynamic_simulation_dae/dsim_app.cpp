@@ -1,45 +1,113 @@
 #include <stdio.h>
+#include <string>
+#include <petscsys.h>
 #include <dsim.hpp>
 #include <gridpack/include/gridpack.hpp>
+#include <gridpack_runtime.hpp>
 
-int gridpack_initialize(int* argcp, char ***argvp)
+  
+// Pass the adaptive time step settings in the AdaptiveTimeStep block to
+// the PETSc TS used by the DAE solver. The step is controlled by the local
+// truncation error estimate and kept between minTimeStep and maxTimeStep,
+// so it grows during quiescent intervals. After each fault event the step
+// is reset to eventTimeStep. Every accepted step is logged to stepLog,
+// which is used for the step statistics
+bool set_adaptive_step(gridpack::utility::Configuration::CursorPtr cursor,
+    std::string &steplog)
 {
-  int  ierr;
-  // Initialize MPI library
-  ierr = MPI_Init(argcp,argvp);
-
-  // Initialize GA
-  GA_Initialize();
-  int stack = 200000, heap = 200000;
-  MA_init(C_DBL, stack, heap);
-
-  // Initialize math libraries
-  gridpack::math::Initialize(argcp,argvp);
-
-  return ierr;
+  gridpack::utility::Configuration::CursorPtr acursor;
+  acursor = cursor->getCursor("AdaptiveTimeStep");
+  bool adaptive = false;
+  if (acursor) adaptive = acursor->get("enable",adaptive);
+  if (!adaptive) return false;
+  std::string prefix;
+  cursor->get("DAESolver.PETScPrefix",&prefix);
+  gridpack::utility::StringUtils util;
+  util.trim(prefix);
+  double dt = cursor->get("timeStep",0.01);
+  std::string type = "basic";
+  acursor->get("type",&type);
+  util.trim(type);
+  double rtol = acursor->get("relativeTolerance",1.0e-4);
+  double atol = acursor->get("absoluteTolerance",1.0e-4);
+  double dtmin = acursor->get("minTimeStep",1.0e-2*dt);
+  double dtmax = acursor->get("maxTimeStep",100.0*dt);
+  double dtevent = acursor->get("eventTimeStep",dt);
+  // Limits on the change of the step size in a single step
+  double shrink = acursor->get("maxShrink",0.1);
+  double growth = acursor->get("maxGrowth",2.0);
+  steplog = "dsim_steps.log";
+  acursor->get("stepLog",&steplog);
+  util.trim(steplog);
+
+  char buf[1024];
+  const char *p = prefix.c_str();
+  sprintf(buf,"-%sts_adapt_type %s -%sts_rtol %g -%sts_atol %g"
+      " -%sts_adapt_dt_min %g -%sts_adapt_dt_max %g"
+      " -%sts_adapt_clip %g,%g -%sts_event_post_eventinterval_step %g"
+      " -%sts_max_reject -1 -%sts_exact_final_time matchstep"
+      " -%sts_monitor ascii:%s",
+      p,type.c_str(),p,rtol,p,atol,p,dtmin,p,dtmax,p,shrink,growth,
+      p,dtevent,p,p,p,steplog.c_str());
+  PetscOptionsInsertString(NULL,buf);
+  int me;
+  MPI_Comm_rank(MPI_COMM_WORLD,&me);
+  if (me == 0) {
+    printf("Adaptive time step: rtol %g atol %g dt [%g, %g] event dt %g\n",
+        rtol,atol,dtmin,dtmax,dtevent);
+  }
+  return true;
 }
 
-int gridpack_finalize()
+// Summarize the accepted steps in the TS monitor log. Each line has the
+// form "n TS dt <next dt> time <t>", so the step sizes are taken from the
+// differences of successive times
+void print_step_statistics(const std::string &steplog, double tend,
+    double dt, double t_solve)
 {
-  int ierr;
-  // Finalize Math libraries
-  gridpack::math::Finalize();
-
-  // Terminate GA
-  GA_Terminate();
-
-  // Clean up MPI libraries
-  ierr = MPI_Finalize();
-
-  return ierr;
+  FILE *fp = fopen(steplog.c_str(),"r");
+  if (!fp) {
+    printf("Unable to open step log %s\n",steplog.c_str());
+    return;
+  }
+  char line[256];
+  int nsteps = 0;
+  int n;
+  double next, t;
+  double t_last = 0.0;
+  double dtmin = 0.0, dtmax = 0.0;
+  bool first = true;
+  while (fgets(line,sizeof(line),fp)) {
+    if (sscanf(line,"%d TS dt %lf time %lf",&n,&next,&t) != 3) continue;
+    if (!first && t > t_last) {
+      double h = t-t_last;
+      if (nsteps == 0 || h < dtmin) dtmin = h;
+      if (nsteps == 0 || h > dtmax) dtmax = h;
+      nsteps++;
+    }
+    first = false;
+    t_last = t;
+  }
+  fclose(fp);
+  int nfixed = static_cast<int>(tend/dt+0.5);
+  printf("\nTime step statistics\n");
+  printf("  Accepted steps:      %d\n",nsteps);
+  printf("  Fixed steps:         %d (timeStep %g)\n",nfixed,dt);
+  if (nsteps > 0) {
+    printf("  Step reduction:      %8.2f\n",
+        static_cast<double>(nfixed)/static_cast<double>(nsteps));
+    printf("  Smallest step:       %g\n",dtmin);
+    printf("  Largest step:        %g\n",dtmax);
+    printf("  Mean step:           %g\n",t_last/static_cast<double>(nsteps));
+  }
+  printf("  Solve time:          %12.6f s\n",t_solve);
 }
 
-  
 int main(int argc, char **argv)
 {
-  int ierr;
-
-  ierr = gridpack_initialize(&argc,&argv);
+  // Initialize MPI and GA libraries. MA is sized from the network once the
+  // input has been read
+  gridpack::Runtime runtime(argc, argv);
     char inputfile[256];
   if (argc >= 2 && argv[1] != NULL) {
     sprintf(inputfile,"%s",argv[1]);
@@ -47,6 +115,29 @@ int main(int argc, char **argv)
     sprintf(inputfile,"input.xml",argv[1]);
   }
 
+  int me;
+  MPI_Comm_rank(MPI_COMM_WORLD,&me);
+  double tend, dt;
+  std::string steplog;
+  bool adaptive;
+  {
+    gridpack::parallel::Communicator world;
+    gridpack::utility::Configuration *config =
+      gridpack::utility::Configuration::configuration();
+    config->open(inputfile,world);
+    if (!runtime.setMemory(config,"Configuration.Dynamic_simulation")) {
+      return 1;
+    }
+    // PETSc must be running before the adaptive step options are inserted
+    runtime.startMath();
+    runtime.report("Dynamic simulation");
+    gridpack::utility::Configuration::CursorPtr cursor;
+    cursor = config->getCursor("Configuration.Dynamic_simulation");
+    tend = cursor->get("simulationTime",0.0);
+    dt = cursor->get("timeStep",0.01);
+    adaptive = set_adaptive_step(cursor,steplog);
+  }
+
   DSim *dsim = new DSim();
 
   // Set the configuration file
@@ -61,10 +152,20 @@ int main(int argc, char **argv)
   printf("start solving:\n");
 
   // Solve
+  double t_start = MPI_Wtime();
   dsim->solve();
+  double t_solve = MPI_Wtime()-t_start;
+  MPI_Allreduce(MPI_IN_PLACE,&t_solve,1,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
 
+  // The step log is complete once the TS has been destroyed
   delete(dsim);
-  ierr = gridpack_finalize();
-
+  if (me == 0) {
+    if (adaptive) {
+      print_step_statistics(steplog,tend,dt,t_solve);
+    } else {
+      printf("\nSolve time: %12.6f s (%d fixed steps)\n",t_solve,
+          static_cast<int>(tend/dt+0.5));
+    }
+  }
   return 0;
 }
@@ -13,13 +13,14 @@
 // -------------------------------------------------------------
 
 #include "mpi.h"
-#include <ga.h>
-#include <macdecls.h>
 #include "gridpack/parser/dictionary.hpp"
-#include "gridpack/environment/environment.hpp"
 #include "gridpack/math/math.hpp"
 #include "gridpack/applications/modules/powerflow/pf_app_module.hpp"
 #include "gridpack/applications/modules/dynamic_simulation_full_y/dsf_app_module.hpp"
+#include "dsf_snapshot.hpp"
+#include "dsf_watch_recorder.hpp"
+#include "network_state.hpp"
+#include "gridpack_runtime.hpp"
 #include <vector>
 
 
@@ -28,7 +29,9 @@
 int
 main(int argc, char **argv)
 {
-  gridpack::Environment env(argc, argv, NULL, 200000, 200000);
+  // Initialize MPI and GA libraries. MA is sized from the network once the
+  // input has been read
+  gridpack::Runtime runtime(argc, argv);
 
   gridpack::NoPrint *noprint_ins = gridpack::NoPrint::instance();
   noprint_ins->setStatus(false);
@@ -54,45 +57,102 @@ main(int argc, char **argv)
       config->open("input.xml",world);
     }
     timer->stop(t_config);
+    if (!runtime.setMemory(config,"Configuration.Powerflow")) {
+      return 1;
+    }
 
-    // setup and run powerflow calculation
+    // In batch mode all faults in the Events block are run. The processes
+    // are divided into groups of groupSize processes and each group sets up
+    // the power flow and dynamic simulation once and then runs the faults
+    // it gets from the task manager, starting each one from a snapshot of
+    // the initialized network. Otherwise only the first fault is run on all
+    // processes
     gridpack::utility::Configuration::CursorPtr cursor;
-    cursor = config->getCursor("Configuration.Powerflow");
-    bool useNonLinear = false;
-    useNonLinear = cursor->get("UseNonLinear", useNonLinear);
-
-    boost::shared_ptr<gridpack::powerflow::PFNetwork>
-      pf_network(new gridpack::powerflow::PFNetwork(world));
+    cursor = config->getCursor("Configuration.Dynamic_simulation");
+    bool batch = false;
+    batch = cursor->get("batchFaults", batch);
+    int grp_size = 1;
+    grp_size = cursor->get("groupSize", grp_size);
+    if (grp_size < 1 || grp_size > world.size()) grp_size = world.size();
+    gridpack::parallel::Communicator task_comm = world;
+    if (batch) task_comm = world.divide(grp_size);
+
+    // If a saved state of the initialized network exists the power flow
+    // and the generator and sequence data files are skipped
+    std::string state_file;
+    cursor->get("stateFile", &state_file);
+    runtime.startMath();
+    runtime.report("Dynamic simulation");
 
-    gridpack::powerflow::PFAppModule pf_app;
-    pf_app.readNetwork(pf_network, config);
-    pf_app.initialize();
-    if (useNonLinear) {
-      pf_app.nl_solve();
+    boost::shared_ptr<gridpack::dynamic_simulation::DSFullNetwork>
+      ds_network(new gridpack::dynamic_simulation::DSFullNetwork(task_comm));
+    gridpack::dynamic_simulation::DSFullApp ds_app(task_comm);
+    std::string network_file;
+    cursor = config->getCursor("Configuration.Powerflow");
+    cursor->get("networkConfiguration", &network_file);
+    gridpack::utility::StringUtils util;
+    util.trim(network_file);
+    if (!state_file.empty() &&
+        gridpack::powerflow::NetworkState<
+        gridpack::dynamic_simulation::DSFullNetwork>::read(state_file,
+          network_file, ds_network)) {
+      ds_network->partition();
+      ds_app.setNetwork(ds_network, config);
     } else {
-      pf_app.solve();
+      // setup and run powerflow calculation
+      bool useNonLinear = false;
+      useNonLinear = cursor->get("UseNonLinear", useNonLinear);
+
+      boost::shared_ptr<gridpack::powerflow::PFNetwork>
+        pf_network(new gridpack::powerflow::PFNetwork(task_comm));
+
+      gridpack::powerflow::PFAppModule pf_app;
+      pf_app.readNetwork(pf_network, config);
+      pf_app.initialize();
+      if (useNonLinear) {
+        pf_app.nl_solve();
+      } else {
+        pf_app.solve();
+      }
+      pf_app.write();
+      pf_app.saveData();
+
+      // setup dynamic simulation calculation
+      pf_network->clone<gridpack::dynamic_simulation::DSFullBus,
+        gridpack::dynamic_simulation::DSFullBranch>(ds_network);
+
+      // transfer results from PF calculation to DS calculation
+      ds_app.transferPFtoDS(pf_network, ds_network); 
+
+      ds_app.setNetwork(ds_network, config);
+      //ds_app.readNetwork(ds_network,config);
+      ds_app.readGenerators();
+      ds_app.readSequenceData();
+      // In batch mode every group sets up the same network, so only the
+      // group containing process 0 writes the state
+      if (!state_file.empty()) {
+        int writer = (world.rank() == 0) ? 1 : 0;
+        task_comm.sum(&writer,1);
+        if (writer) {
+          gridpack::powerflow::NetworkState<
+            gridpack::dynamic_simulation::DSFullNetwork>::write(state_file,
+                ds_network);
+        }
+      }
     }
-    pf_app.write();
-    pf_app.saveData();
-   
-    // setup and run dynamic simulation calculation
-    boost::shared_ptr<gridpack::dynamic_simulation::DSFullNetwork>
-      ds_network(new gridpack::dynamic_simulation::DSFullNetwork(world));
-    gridpack::dynamic_simulation::DSFullApp ds_app;
-    pf_network->clone<gridpack::dynamic_simulation::DSFullBus,
-      gridpack::dynamic_simulation::DSFullBranch>(ds_network);
-
-    // transfer results from PF calculation to DS calculation
-    ds_app.transferPFtoDS(pf_network, ds_network); 
-
-    // run dynamic simulation
-    ds_app.setNetwork(ds_network, config);
-    //ds_app.readNetwork(ds_network,config);
-    ds_app.readGenerators();
-    ds_app.readSequenceData();
     //printf("ds_app.initialize:\n");
     ds_app.initialize();
-    ds_app.setGeneratorWatch();
+    // All groups would write to the same generator watch file, so the
+    // watch is only used for single fault runs. If the watchRecorder block
+    // is enabled the observed generators are written by the buffered
+    // recorder instead of the generator watch
+    cursor = config->getCursor("Configuration.Dynamic_simulation");
+    gridpack::dynamic_simulation::DSFWatchRecorder recorder(task_comm);
+    bool recording = false;
+    if (!batch) {
+      recording = recorder.setup(cursor, ds_app);
+      if (!recording) ds_app.setGeneratorWatch();
+    }
     //printf("gen ID:	mac_ang_s0	mac_spd_s0	pmech	pelect\n");
     //printf("Step	time:	bus_id	mac_ang_s1	mac_spd_s1\n");
     //printf("ds_app.solve:\n");
@@ -104,17 +164,57 @@ main(int argc, char **argv)
     std::vector<gridpack::dynamic_simulation::Event> faults;
     faults = ds_app.getEvents(cursor);
 
-	
-    ds_app.solvePreInitialize(faults[0]);
-	
-    while(!ds_app.isDynSimuDone()){
-      ds_app.executeOneSimuStep( );
+    if (!batch) {
+      ds_app.solvePreInitialize(faults[0]);
+
+      while(!ds_app.isDynSimuDone()){
+        ds_app.executeOneSimuStep( );
+        if (recording) recorder.record(ds_app);
+      }
+      recorder.close();
+    } else {
+      int t_batch = timer->createCategory("Dynamic Simulation: Fault Runs");
+      gridpack::dynamic_simulation::DSFSnapshot snapshot;
+      snapshot.save(ds_network);
+      int nfaults = faults.size();
+      if (world.rank() == 0) {
+        printf("Running %d faults on %d groups of %d processes\n",
+            nfaults,world.size()/task_comm.size(),task_comm.size());
+      }
+      gridpack::parallel::TaskManager taskmgr(world);
+      taskmgr.set(nfaults);
+      int task_id;
+      bool first = true;
+      while (taskmgr.nextTask(task_comm, &task_id)) {
+        timer->start(t_batch);
+        double t_start = timer->currentTime();
+        // The first fault starts from the freshly initialized network, all
+        // others reload the components from the restored snapshot
+        if (!first) {
+          snapshot.restore(ds_network);
+          ds_app.reload();
+        }
+        first = false;
+        ds_app.solvePreInitialize(faults[task_id]);
+        int nsteps = 0;
+        while(!ds_app.isDynSimuDone()){
+          ds_app.executeOneSimuStep( );
+          nsteps++;
+        }
+        timer->stop(t_batch);
+        if (task_comm.rank() == 0) {
+          printf("p[%d] Fault %d (%s) %d steps in %f s\n",world.rank(),
+              task_id,faults[task_id].name.c_str(),nsteps,
+              timer->currentTime()-t_start);
+        }
+      }
+      taskmgr.printStats();
     }
 
     //ds_app.write();
     timer->stop(t_total);
     timer->dump();
   }
-
+  return 0;
 }
 
@@ -0,0 +1,137 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   dsf_snapshot.cpp
+ *
+ * @brief  In-memory snapshot of the initialized dynamic simulation network
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#include "dsf_snapshot.hpp"
+
+/**
+ * Basic constructor
+ */
+gridpack::dynamic_simulation::DSFSnapshot::DSFSnapshot(void)
+{
+}
+
+/**
+ * Basic destructor
+ */
+gridpack::dynamic_simulation::DSFSnapshot::~DSFSnapshot(void)
+{
+}
+
+/**
+ * Save the state of the network
+ * @param network initialized dynamic simulation network
+ */
+void gridpack::dynamic_simulation::DSFSnapshot::save(
+    boost::shared_ptr<DSFullNetwork> network)
+{
+  p_bus_values.clear();
+  p_bus_status.clear();
+  p_branch_status.clear();
+  int nbus = network->numBuses();
+  int nbranch = network->numBranches();
+  int i, j;
+  for (i=0; i<nbus; i++) {
+    gridpack::component::DataCollection *data =
+      network->getBusData(i).get();
+    double vmag = 1.0;
+    double vang = 0.0;
+    data->getValue(BUS_VOLTAGE_MAG,&vmag);
+    data->getValue(BUS_VOLTAGE_ANG,&vang);
+    p_bus_values.push_back(vmag);
+    p_bus_values.push_back(vang);
+    int ngen = 0;
+    int nload = 0;
+    data->getValue(GENERATOR_NUMBER,&ngen);
+    data->getValue(LOAD_NUMBER,&nload);
+    for (j=0; j<ngen; j++) {
+      double pg = 0.0;
+      double qg = 0.0;
+      int status = 1;
+      data->getValue(GENERATOR_PG,&pg,j);
+      data->getValue(GENERATOR_QG,&qg,j);
+      data->getValue(GENERATOR_STAT,&status,j);
+      p_bus_values.push_back(pg);
+      p_bus_values.push_back(qg);
+      p_bus_status.push_back(status);
+    }
+    for (j=0; j<nload; j++) {
+      double pl = 0.0;
+      double ql = 0.0;
+      int status = 1;
+      data->getValue(LOAD_PL,&pl,j);
+      data->getValue(LOAD_QL,&ql,j);
+      data->getValue(LOAD_STATUS,&status,j);
+      p_bus_values.push_back(pl);
+      p_bus_values.push_back(ql);
+      p_bus_status.push_back(status);
+    }
+  }
+  for (i=0; i<nbranch; i++) {
+    gridpack::component::DataCollection *data =
+      network->getBranchData(i).get();
+    int nelem = 0;
+    data->getValue(BRANCH_NUM_ELEMENTS,&nelem);
+    for (j=0; j<nelem; j++) {
+      int status = 1;
+      data->getValue(BRANCH_STATUS,&status,j);
+      p_branch_status.push_back(status);
+    }
+  }
+}
+
+/**
+ * Write the saved state back into the data collections of the network.
+ * The network must be the one passed to save
+ * @param network dynamic simulation network
+ */
+void gridpack::dynamic_simulation::DSFSnapshot::restore(
+    boost::shared_ptr<DSFullNetwork> network)
+{
+  int nbus = network->numBuses();
+  int nbranch = network->numBranches();
+  int i, j;
+  int iv = 0;
+  int is = 0;
+  for (i=0; i<nbus; i++) {
+    gridpack::component::DataCollection *data =
+      network->getBusData(i).get();
+    data->setValue(BUS_VOLTAGE_MAG,p_bus_values[iv++]);
+    data->setValue(BUS_VOLTAGE_ANG,p_bus_values[iv++]);
+    int ngen = 0;
+    int nload = 0;
+    data->getValue(GENERATOR_NUMBER,&ngen);
+    data->getValue(LOAD_NUMBER,&nload);
+    for (j=0; j<ngen; j++) {
+      data->setValue(GENERATOR_PG,p_bus_values[iv++],j);
+      data->setValue(GENERATOR_QG,p_bus_values[iv++],j);
+      data->setValue(GENERATOR_STAT,p_bus_status[is++],j);
+    }
+    for (j=0; j<nload; j++) {
+      data->setValue(LOAD_PL,p_bus_values[iv++],j);
+      data->setValue(LOAD_QL,p_bus_values[iv++],j);
+      data->setValue(LOAD_STATUS,p_bus_status[is++],j);
+    }
+  }
+  is = 0;
+  for (i=0; i<nbranch; i++) {
+    gridpack::component::DataCollection *data =
+      network->getBranchData(i).get();
+    int nelem = 0;
+    data->getValue(BRANCH_NUM_ELEMENTS,&nelem);
+    for (j=0; j<nelem; j++) {
+      data->setValue(BRANCH_STATUS,p_branch_status[is++],j);
+    }
+  }
+}
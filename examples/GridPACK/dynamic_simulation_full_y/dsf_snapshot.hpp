@@ -0,0 +1,72 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   dsf_snapshot.hpp
+ *
+ * @brief  In-memory snapshot of the initialized dynamic simulation network,
+ *         used to run several faults from the same starting point.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _dsf_snapshot_h_
+#define _dsf_snapshot_h_
+
+#include <vector>
+#include "gridpack/include/gridpack.hpp"
+#include "gridpack/applications/modules/dynamic_simulation_full_y/dsf_app_module.hpp"
+
+namespace gridpack {
+namespace dynamic_simulation {
+
+// The components of DSFullNetwork are initialized from their data
+// collections, which hold the power flow solution after transferPFtoDS. A
+// fault run can change the values that later runs start from (bus voltages,
+// generator, load and branch status and generator and load powers), so the
+// snapshot keeps a copy of these values for all local buses and branches
+// and writes them back before the next run.
+class DSFSnapshot
+{
+  public:
+    /**
+     * Basic constructor
+     */
+    DSFSnapshot(void);
+
+    /**
+     * Basic destructor
+     */
+    ~DSFSnapshot(void);
+
+    /**
+     * Save the state of the network
+     * @param network initialized dynamic simulation network
+     */
+    void save(boost::shared_ptr<DSFullNetwork> network);
+
+    /**
+     * Write the saved state back into the data collections of the network.
+     * The network must be the one passed to save
+     * @param network dynamic simulation network
+     */
+    void restore(boost::shared_ptr<DSFullNetwork> network);
+
+  private:
+
+    // Values of each local bus, in bus order: voltage magnitude and angle,
+    // then PG, QG of each generator and PL, QL of each load
+    std::vector<double> p_bus_values;
+    // Status of each generator and load of each local bus
+    std::vector<int> p_bus_status;
+    // Status of each element of each local branch
+    std::vector<int> p_branch_status;
+};
+
+} // dynamic_simulation
+} // gridpack
+#endif
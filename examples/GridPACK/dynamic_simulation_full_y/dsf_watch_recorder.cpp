@@ -0,0 +1,224 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   dsf_watch_recorder.cpp
+ *
+ * @brief  Buffered generator watch written with MPI-IO
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#include <cstdio>
+#include <cstring>
+#include "dsf_watch_recorder.hpp"
+
+#define DSF_WATCH_MAGIC "DSFWATCH"
+
+// Size of a column record in the file header
+#define DSF_WATCH_COLUMN_SIZE (2*sizeof(int)+2)
+
+/**
+ * Basic constructor
+ * @param comm communicator of the dynamic simulation
+ */
+gridpack::dynamic_simulation::DSFWatchRecorder::DSFWatchRecorder(
+    const gridpack::parallel::Communicator &comm)
+  : p_comm(comm)
+{
+  p_open = false;
+  p_ncols = 0;
+  p_lo = 0;
+  p_hi = 0;
+  p_block = 100;
+  p_frequency = 1;
+  p_dt = 0.0;
+  p_step = 0;
+  p_nrows = 0;
+  p_offset = 0;
+  p_nblocks = 0;
+  p_nsamples = 0;
+  p_t_write = 0.0;
+}
+
+/**
+ * Basic destructor. Writes any buffered steps and closes the file
+ */
+gridpack::dynamic_simulation::DSFWatchRecorder::~DSFWatchRecorder(void)
+{
+  close();
+}
+
+/**
+ * Set up the recorder from the watchRecorder block and the observed
+ * generators in the Observations block of the Dynamic_simulation
+ * block. Calls setObservations on the application
+ * @param cursor pointer to Dynamic_simulation block
+ * @param app initialized dynamic simulation application
+ * @return false if the recorder is not enabled or the file could not be
+ *         opened
+ */
+bool gridpack::dynamic_simulation::DSFWatchRecorder::setup(
+    gridpack::utility::Configuration::CursorPtr cursor, DSFullApp &app)
+{
+  gridpack::utility::Configuration::CursorPtr wcursor;
+  wcursor = cursor->getCursor("watchRecorder");
+  bool enable = false;
+  if (wcursor) enable = wcursor->get("enable",enable);
+  if (!enable) return false;
+  p_filename = "gen_watch.bin";
+  wcursor->get("fileName",&p_filename);
+  gridpack::utility::StringUtils util;
+  util.trim(p_filename);
+  p_block = wcursor->get("blockSize",p_block);
+  if (p_block < 1) p_block = 1;
+  p_frequency = wcursor->get("frequency",p_frequency);
+  if (p_frequency < 1) p_frequency = 1;
+  p_dt = cursor->get("timeStep",0.005);
+
+  app.setObservations(cursor);
+  std::vector<int> gen_buses, load_buses, buses;
+  std::vector<std::string> gen_ids, load_ids;
+  app.getObservationLists(gen_buses, gen_ids, load_buses, load_ids, buses);
+  int ngen = gen_buses.size();
+  p_ncols = 2*ngen;
+  if (p_ncols == 0) {
+    if (p_comm.rank() == 0) {
+      printf("No generators in Observations, watch recorder not used\n");
+    }
+    return false;
+  }
+  int me = p_comm.rank();
+  int nprocs = p_comm.size();
+  p_lo = static_cast<int>(static_cast<long>(p_ncols)*me/nprocs);
+  p_hi = static_cast<int>(static_cast<long>(p_ncols)*(me+1)/nprocs);
+  p_time.resize(p_block);
+  p_values.resize((p_hi-p_lo)*p_block);
+
+  MPI_Comm comm = p_comm.getCommunicator();
+  int ierr = MPI_File_open(comm, const_cast<char*>(p_filename.c_str()),
+      MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &p_file);
+  int ok = (ierr == MPI_SUCCESS) ? 0 : 1;
+  p_comm.sum(&ok,1);
+  if (ok != 0) {
+    if (ierr == MPI_SUCCESS) MPI_File_close(&p_file);
+    if (me == 0) {
+      printf("Unable to open generator watch file %s\n",p_filename.c_str());
+    }
+    return false;
+  }
+  MPI_File_set_size(p_file, 0);
+  p_open = true;
+
+  // The header is small, so process 0 packs and writes it independently
+  p_offset = 8+2*sizeof(int)+p_ncols*DSF_WATCH_COLUMN_SIZE;
+  if (me == 0) {
+    std::vector<char> header(p_offset);
+    char *ptr = &header[0];
+    memcpy(ptr,DSF_WATCH_MAGIC,8);
+    ptr += 8;
+    memcpy(ptr,&p_ncols,sizeof(int));
+    ptr += sizeof(int);
+    memcpy(ptr,&p_block,sizeof(int));
+    ptr += sizeof(int);
+    int i, k;
+    for (i=0; i<ngen; i++) {
+      std::string tag = gen_ids[i];
+      tag.resize(2,' ');
+      for (k=0; k<2; k++) {
+        memcpy(ptr,&gen_buses[i],sizeof(int));
+        ptr += sizeof(int);
+        memcpy(ptr,tag.c_str(),2);
+        ptr += 2;
+        memcpy(ptr,&k,sizeof(int));
+        ptr += sizeof(int);
+      }
+    }
+    MPI_Status status;
+    MPI_File_write_at(p_file, 0, &header[0], p_offset, MPI_CHAR, &status);
+    printf("Watching %d generators in %s, %d steps per block\n",ngen,
+        p_filename.c_str(),p_block);
+  }
+  return true;
+}
+
+/**
+ * Record the current step. Must be called on all processes after each
+ * step of the simulation
+ * @param app dynamic simulation application
+ */
+void gridpack::dynamic_simulation::DSFWatchRecorder::record(DSFullApp &app)
+{
+  if (!p_open) return;
+  p_step++;
+  if (p_step%p_frequency != 0) return;
+  std::vector<double> vmag, vang, rspd, rang, genp, genq, fonline;
+  app.getObservations(vmag, vang, rspd, rang, genp, genq, fonline);
+  p_time[p_nrows] = static_cast<double>(p_step)*p_dt;
+  int c;
+  for (c=p_lo; c<p_hi; c++) {
+    int gen = c/2;
+    p_values[(c-p_lo)*p_block+p_nrows] = (c%2 == 0) ? rspd[gen] : rang[gen];
+  }
+  p_nrows++;
+  p_nsamples++;
+  if (p_nrows == p_block) flush();
+}
+
+/**
+ * Write the buffered steps as one block
+ */
+void gridpack::dynamic_simulation::DSFWatchRecorder::flush(void)
+{
+  if (p_nrows == 0) return;
+  double t_start = MPI_Wtime();
+  // Pack the owned part of the block. Process 0 writes the row count and
+  // the time column in front of its columns
+  int me = p_comm.rank();
+  int nown = p_hi-p_lo;
+  p_buf.clear();
+  if (me == 0) {
+    p_buf.push_back(static_cast<double>(p_nrows));
+    p_buf.insert(p_buf.end(),p_time.begin(),p_time.begin()+p_nrows);
+  }
+  int c;
+  for (c=0; c<nown; c++) {
+    p_buf.insert(p_buf.end(),p_values.begin()+c*p_block,
+        p_values.begin()+c*p_block+p_nrows);
+  }
+  MPI_Offset offset = p_offset;
+  if (me != 0) {
+    offset += sizeof(double)*(1+static_cast<MPI_Offset>(p_nrows)*(1+p_lo));
+  }
+  MPI_Status status;
+  int count = p_buf.size();
+  double dummy = 0.0;
+  MPI_File_write_at_all(p_file, offset, count > 0 ? &p_buf[0] : &dummy,
+      count, MPI_DOUBLE, &status);
+  p_offset += sizeof(double)*(1+static_cast<MPI_Offset>(p_nrows)*(1+p_ncols));
+  p_nrows = 0;
+  p_nblocks++;
+  p_t_write += MPI_Wtime()-t_start;
+}
+
+/**
+ * Write any buffered steps and close the file
+ */
+void gridpack::dynamic_simulation::DSFWatchRecorder::close(void)
+{
+  if (!p_open) return;
+  flush();
+  MPI_File_close(&p_file);
+  p_open = false;
+  double t_write = p_t_write;
+  p_comm.max(&t_write,1);
+  if (p_comm.rank() == 0) {
+    printf("Generator watch: %d steps in %d blocks (%ld bytes) written"
+        " to %s in %f s\n",p_nsamples,p_nblocks,static_cast<long>(p_offset),
+        p_filename.c_str(),t_write);
+  }
+}
@@ -0,0 +1,113 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   dsf_watch_recorder.hpp
+ *
+ * @brief  Buffered generator watch. The rotor speed and angle of the
+ *         observed generators are collected in memory and written to a
+ *         binary file with MPI-IO every blockSize recorded steps.
+ *
+ *  File layout (native byte order):
+ *    char[8]   "DSFWATCH"
+ *    int       number of columns ncols
+ *    int       block size
+ *    ncols x   { int bus; char id[2]; int quantity (0 speed, 1 angle) }
+ *  followed by blocks of nrows <= block size recorded steps:
+ *    double    nrows
+ *    double    time[nrows]
+ *    double    column[nrows], for each of the ncols columns
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _dsf_watch_recorder_h_
+#define _dsf_watch_recorder_h_
+
+#include <string>
+#include <vector>
+#include "mpi.h"
+#include "gridpack/include/gridpack.hpp"
+#include "gridpack/applications/modules/dynamic_simulation_full_y/dsf_app_module.hpp"
+
+namespace gridpack {
+namespace dynamic_simulation {
+
+// Each process keeps a block of consecutive columns, so the buffer and the
+// work done each step are split across processes and every block is
+// written with a single collective call in which each process writes one
+// contiguous region. Process 0 also owns the time column.
+class DSFWatchRecorder
+{
+  public:
+    /**
+     * Basic constructor
+     * @param comm communicator of the dynamic simulation
+     */
+    DSFWatchRecorder(const gridpack::parallel::Communicator &comm);
+
+    /**
+     * Basic destructor. Writes any buffered steps and closes the file
+     */
+    ~DSFWatchRecorder(void);
+
+    /**
+     * Set up the recorder from the watchRecorder block and the observed
+     * generators in the Observations block of the Dynamic_simulation
+     * block. Calls setObservations on the application
+     * @param cursor pointer to Dynamic_simulation block
+     * @param app initialized dynamic simulation application
+     * @return false if the recorder is not enabled or the file could not be
+     *         opened
+     */
+    bool setup(gridpack::utility::Configuration::CursorPtr cursor,
+        DSFullApp &app);
+
+    /**
+     * Record the current step. Must be called on all processes after each
+     * step of the simulation
+     * @param app dynamic simulation application
+     */
+    void record(DSFullApp &app);
+
+    /**
+     * Write any buffered steps and close the file
+     */
+    void close(void);
+
+  private:
+
+    /**
+     * Write the buffered steps as one block
+     */
+    void flush(void);
+
+    gridpack::parallel::Communicator p_comm;
+    MPI_File p_file;
+    bool p_open;
+    // Columns p_lo to p_hi-1 are owned by this process
+    int p_ncols;
+    int p_lo, p_hi;
+    int p_block;
+    int p_frequency;
+    double p_dt;
+    int p_step;
+    int p_nrows;
+    // Time and owned columns of the current block, column by column
+    std::vector<double> p_time;
+    std::vector<double> p_values;
+    std::vector<double> p_buf;
+    MPI_Offset p_offset;
+    // Statistics
+    int p_nblocks;
+    int p_nsamples;
+    double p_t_write;
+    std::string p_filename;
+};
+
+} // dynamic_simulation
+} // gridpack
+#endif
@@ -16,24 +16,20 @@
 // -------------------------------------------------------------
 
 #include "mpi.h"
-#include <ga.h>
-#include <macdecls.h>
 #include "gridpack/include/gridpack.hpp"
+#include "gridpack_runtime.hpp"
 #include "gridpack/applications/modules/powerflow/pf_app_module.hpp"
 #include "gridpack/applications/modules/kalman_ds/kds_app_module.hpp"
+#include "kds_step_filter.hpp"
+#include "kds_measurement_feed.hpp"
 
 // Calling program for the state estimation applications
 
 int main(int argc, char **argv)
 {
-  // Initialize MPI libraries
-  int ierr = MPI_Init(&argc, &argv);
-  // Intialize Math libraries
-  GA_Initialize();
-  int stack = 200000, heap = 200000;
-  MA_init(C_DBL, stack, heap);
-
-  gridpack::math::Initialize(&argc,&argv);
+  // Initialize MPI and GA libraries. MA is sized from the network and the
+  // math libraries are started before the power flow is set up
+  gridpack::Runtime runtime(argc, argv);
 
   {
     gridpack::utility::CoarseTimer *timer =
@@ -46,10 +42,6 @@ int main(int argc, char **argv)
     timer->start(t_PF);
 
     gridpack::parallel::Communicator comm;
-    // Initialize Kalman filter calculation by first running a powerflow
-    // simulation
-    boost::shared_ptr<gridpack::powerflow::PFNetwork>
-      pf_network(new gridpack::powerflow::PFNetwork(comm));
 
     // Read configuration file
     gridpack::utility::Configuration *config =
@@ -61,33 +53,129 @@ int main(int argc, char **argv)
     } else {
       config->open("input.xml",comm);
     }
+    if (!runtime.setMemory(config,"Configuration.Powerflow")) {
+      return 1;
+    }
+
+    // Initialize Kalman filter calculation by first running a powerflow
+    // simulation
+    boost::shared_ptr<gridpack::powerflow::PFNetwork>
+      pf_network(new gridpack::powerflow::PFNetwork(comm));
 
     // run powerflow calculation and save data to data collection objects
     gridpack::powerflow::PFAppModule pf_app;
     pf_app.readNetwork(pf_network,config);
+    runtime.startMath();
+    runtime.report("Kalman filter");
     pf_app.initialize();
     pf_app.solve();
     pf_app.write();
     pf_app.saveData();
     timer->stop(t_PF);
 
-    boost::shared_ptr<gridpack::kalman_filter::KalmanNetwork>
-      kds_network(new gridpack::kalman_filter::KalmanNetwork(comm));
-    pf_network->clone<gridpack::kalman_filter::KalmanBus,
-          gridpack::kalman_filter::KalmanBranch>(kds_network);
-    gridpack::kalman_filter::KalmanApp kds_app;
-    kds_app.setNetwork(kds_network, config);
-    kds_app.initialize();
-    kds_app.solve();
+    // In real time mode the filter advances one step for each set of
+    // measurements from the source in the RealTime block, instead of
+    // processing the whole window of the input files in solve
+    gridpack::utility::Configuration::CursorPtr kcursor, dcursor, rcursor;
+    kcursor = config->getCursor("Configuration.Kalman_filter");
+    dcursor = config->getCursor("Configuration.Dynamic_simulation");
+    bool realtime = false;
+    if (kcursor) rcursor = kcursor->getCursor("RealTime");
+    if (rcursor) realtime = rcursor->get("enable",realtime);
+    if (!realtime) {
+      boost::shared_ptr<gridpack::kalman_filter::KalmanNetwork>
+        kds_network(new gridpack::kalman_filter::KalmanNetwork(comm));
+      pf_network->clone<gridpack::kalman_filter::KalmanBus,
+            gridpack::kalman_filter::KalmanBranch>(kds_network);
+      gridpack::kalman_filter::KalmanApp kds_app;
+      kds_app.setNetwork(kds_network, config);
+      kds_app.initialize();
+      kds_app.solve();
+    } else {
+      timer->start(t_In);
+      gridpack::kalman_filter::KDSStepFilter filter(comm);
+      gridpack::kalman_filter::KDSMeasurementFeed feed(comm);
+      bool ok = filter.setup(pf_network,kcursor,dcursor);
+      std::vector<int> buses;
+      filter.getBuses(buses);
+      if (ok) ok = feed.open(rcursor,kcursor,buses);
+      timer->stop(t_In);
+      if (ok) {
+        timer->start(t_KF);
+        std::vector<int> gen_buses;
+        std::vector<std::string> gen_tags;
+        filter.getGenerators(gen_buses,gen_tags);
+        int ngen = gen_buses.size();
+        std::string outfile;
+        rcursor->get("outputFile",&outfile);
+        gridpack::utility::StringUtils util;
+        util.trim(outfile);
+        FILE *fp = NULL;
+        if (comm.rank() == 0 && !outfile.empty()) {
+          fp = fopen(outfile.c_str(),"w");
+          if (fp) {
+            int i;
+            fprintf(fp,"time");
+            for (i=0; i<ngen; i++) {
+              fprintf(fp,",angle_%d_%s",gen_buses[i],gen_tags[i].c_str());
+            }
+            for (i=0; i<ngen; i++) {
+              fprintf(fp,",speed_%d_%s",gen_buses[i],gen_tags[i].c_str());
+            }
+            fprintf(fp,"\n");
+          }
+        }
+        int max_steps = kcursor->get("maxSteps",3000);
+        double sim_time = dcursor->get("simulationTime",3.0);
+        double dt = filter.getTimeStep();
+        std::vector<double> vmag, vang, angle, speed;
+        int nsteps = 0;
+        int nlate = 0;
+        double t_max = 0.0;
+        while (nsteps < max_steps && filter.getTime()+0.5*dt < sim_time) {
+          double t_start = MPI_Wtime();
+          double time = filter.getTime()+dt;
+          bool valid;
+          if (!feed.next(time,vmag,vang,valid)) break;
+          // Without new measurements the ensemble is only propagated
+          if (valid) {
+            filter.step(vmag,vang);
+          } else {
+            filter.predict();
+          }
+          filter.getEstimate(angle,speed);
+          feed.publish(angle,speed);
+          double t_step = MPI_Wtime()-t_start;
+          comm.max(&t_step,1);
+          if (t_step > t_max) t_max = t_step;
+          if (t_step > dt) nlate++;
+          nsteps++;
+          if (fp) {
+            int i;
+            fprintf(fp,"%g",filter.getTime());
+            for (i=0; i<ngen; i++) fprintf(fp,",%e",angle[i]);
+            for (i=0; i<ngen; i++) fprintf(fp,",%e",speed[i]);
+            fprintf(fp,"\n");
+          }
+        }
+        if (fp) fclose(fp);
+        feed.close();
+        timer->stop(t_KF);
+        double t_predict, t_update;
+        int nupdates;
+        filter.getTimings(t_predict,t_update,nupdates);
+        if (comm.rank() == 0 && nsteps > 0) {
+          printf("Kalman filter: %d steps (%d updates) to t = %g,"
+              " predict %f s update %f s\n",nsteps,nupdates,
+              filter.getTime(),t_predict,t_update);
+          printf("Step time: mean %e s max %e s, %d steps slower than"
+              " dt = %g\n",(t_predict+t_update)/nsteps,t_max,nlate,dt);
+        }
+      }
+    }
     timer->stop(t_Total);
     timer->dump();
   }
-
-  GA_Terminate();
-
-  // Terminate Math libraries
-  gridpack::math::Finalize();
-  // Clean up MPI libraries
-  ierr = MPI_Finalize();
+  return 0;
 }
 
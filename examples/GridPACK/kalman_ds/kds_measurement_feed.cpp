@@ -0,0 +1,343 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   kds_measurement_feed.cpp
+ *
+ * @brief  Bus voltage measurements for the step-wise Kalman filter
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include "kds_measurement_feed.hpp"
+
+/**
+ * Basic constructor
+ * @param comm communicator of the filter
+ */
+gridpack::kalman_filter::KDSMeasurementFeed::KDSMeasurementFeed(
+    const gridpack::parallel::Communicator &comm)
+  : p_comm(comm)
+{
+  p_nbus = 0;
+  p_end_time = 0.0;
+  p_open = false;
+#ifdef KDS_USE_HELICS
+  p_publish = false;
+#endif
+}
+
+/**
+ * Basic destructor
+ */
+gridpack::kalman_filter::KDSMeasurementFeed::~KDSMeasurementFeed(void)
+{
+  close();
+}
+
+/**
+ * Open the source described by the RealTime block
+ * @param rcursor pointer to RealTime block
+ * @param kcursor pointer to Kalman_filter block (input files)
+ * @param buses bus numbers in the order of the filter
+ * @return false if the source could not be opened
+ */
+bool gridpack::kalman_filter::KDSMeasurementFeed::open(
+    gridpack::utility::Configuration::CursorPtr rcursor,
+    gridpack::utility::Configuration::CursorPtr kcursor,
+    const std::vector<int> &buses)
+{
+  gridpack::utility::StringUtils util;
+  p_source = "file";
+  rcursor->get("source",&p_source);
+  util.trim(p_source);
+  p_end_time = rcursor->get("endTime",3600.0);
+  p_nbus = buses.size();
+  p_bus_index.clear();
+  int i;
+  for (i=0; i<p_nbus; i++) {
+    p_bus_index.insert(std::pair<int,int>(buses[i],i));
+  }
+  int ok = 1;
+  if (p_comm.rank() == 0) {
+    if (p_source == "file") {
+      std::string magfile, angfile;
+      kcursor->get("KalmanMagData",&magfile);
+      kcursor->get("KalmanAngData",&angfile);
+      util.trim(magfile);
+      util.trim(angfile);
+      p_mag.open(magfile.c_str());
+      p_ang.open(angfile.c_str());
+      if (!p_mag.is_open() || !p_ang.is_open() ||
+          !readHeader(p_mag,p_mag_columns) ||
+          !readHeader(p_ang,p_ang_columns)) {
+        printf("Unable to read Kalman input files %s and %s\n",
+            magfile.c_str(),angfile.c_str());
+        ok = 0;
+      }
+    } else if (p_source == "helics") {
+#ifdef KDS_USE_HELICS
+      std::string name = "gridpack_kds";
+      rcursor->get("federateName",&name);
+      std::string magkey, angkey, estkey, core_init;
+      rcursor->get("magnitudeKey",&magkey);
+      rcursor->get("angleKey",&angkey);
+      rcursor->get("estimateKey",&estkey);
+      rcursor->get("coreInit",&core_init);
+      util.trim(name);
+      util.trim(magkey);
+      util.trim(angkey);
+      util.trim(estkey);
+      double period = rcursor->get("period",0.01);
+      helics::FederateInfo fi;
+      fi.coreType = helics::CoreType::ZMQ;
+      fi.coreInitString = core_init;
+      const char* env_addr = std::getenv("HELICS_BROKER_ADDRESS");
+      if (env_addr && strlen(env_addr) > 0) {
+        fi.coreInitString += std::string(" --broker_address=") + env_addr;
+      }
+      fi.setProperty(HELICS_PROPERTY_TIME_PERIOD,period);
+      fi.setFlagOption(HELICS_FLAG_UNINTERRUPTIBLE, false);
+      fi.setFlagOption(HELICS_FLAG_TERMINATE_ON_ERROR, true);
+      p_fed.reset(new helics::ValueFederate(name,fi));
+      p_mag_input = p_fed->registerSubscription(magkey);
+      p_ang_input = p_fed->registerSubscription(angkey);
+      p_publish = !estkey.empty();
+      if (p_publish) {
+        p_estimate = p_fed->registerGlobalPublication(estkey,"vector");
+      }
+      p_fed->enterExecutingMode();
+      // Position in the filter order of the buses in increasing order
+      p_order.clear();
+      std::map<int,int>::const_iterator it;
+      for (it = p_bus_index.begin(); it != p_bus_index.end(); it++) {
+        p_order.push_back(it->second);
+      }
+      printf("Subscribed to voltages from %s and %s\n",magkey.c_str(),
+          angkey.c_str());
+#else
+      printf("HELICS measurement source requires KDS_USE_HELICS\n");
+      ok = 0;
+#endif
+    } else {
+      printf("Unknown measurement source %s\n",p_source.c_str());
+      ok = 0;
+    }
+  }
+  p_comm.sum(&ok,1);
+  p_open = (ok == p_comm.size());
+  return p_open;
+}
+
+/**
+ * Measurements at the given time. Collective
+ * @param time time of the filter after the prediction
+ * @param vmag voltage magnitudes, not a number if missing
+ * @param vang voltage angles in radians, not a number if missing
+ * @param valid true if any measurement is available at this time
+ * @return false if the source has ended
+ */
+bool gridpack::kalman_filter::KDSMeasurementFeed::next(double time,
+    std::vector<double> &vmag, std::vector<double> &vang, bool &valid)
+{
+  valid = false;
+  if (!p_open) return false;
+  // The values are broadcast from process 0 with a mask of the available
+  // values. The first entry is -1 at the end of the source
+  std::vector<double> values(2*p_nbus,0.0);
+  std::vector<int> mask(2*p_nbus+1,0);
+  if (p_comm.rank() == 0) {
+    std::vector<double> mag, ang;
+    std::vector<int> m;
+    if (read(time,mag,ang,m)) {
+      int i;
+      for (i=0; i<p_nbus; i++) {
+        values[i] = mag[i];
+        values[p_nbus+i] = ang[i];
+      }
+      for (i=0; i<2*p_nbus; i++) mask[i+1] = m[i];
+    } else {
+      mask[0] = -1;
+    }
+  }
+  p_comm.sum(&values[0],2*p_nbus);
+  p_comm.sum(&mask[0],2*p_nbus+1);
+  if (mask[0] < 0) return false;
+  double nan = std::numeric_limits<double>::quiet_NaN();
+  vmag.resize(p_nbus);
+  vang.resize(p_nbus);
+  int i;
+  for (i=0; i<p_nbus; i++) {
+    vmag[i] = mask[i+1] ? values[i] : nan;
+    vang[i] = mask[p_nbus+i+1] ? values[p_nbus+i] : nan;
+    if (mask[i+1] || mask[p_nbus+i+1]) valid = true;
+  }
+  return true;
+}
+
+/**
+ * Publish the filter estimate, if a publication is configured
+ * @param angle rotor angles of the generators
+ * @param speed rotor speeds of the generators
+ */
+void gridpack::kalman_filter::KDSMeasurementFeed::publish(
+    const std::vector<double> &angle, const std::vector<double> &speed)
+{
+#ifdef KDS_USE_HELICS
+  if (p_comm.rank() != 0 || !p_fed || !p_publish) return;
+  std::vector<double> value(angle);
+  value.insert(value.end(),speed.begin(),speed.end());
+  p_estimate.publish(value);
+#else
+  (void)angle;
+  (void)speed;
+#endif
+}
+
+/**
+ * Close the source
+ */
+void gridpack::kalman_filter::KDSMeasurementFeed::close(void)
+{
+  if (p_mag.is_open()) p_mag.close();
+  if (p_ang.is_open()) p_ang.close();
+#ifdef KDS_USE_HELICS
+  if (p_fed) {
+    p_fed->finalize();
+    p_fed.reset();
+  }
+#endif
+  p_open = false;
+}
+
+/**
+ * Read the header of an input file and map its columns to the buses
+ * @param in input file
+ * @param columns position in the filter order of each column
+ * @return false if the header could not be read
+ */
+bool gridpack::kalman_filter::KDSMeasurementFeed::readHeader(
+    std::ifstream &in, std::vector<int> &columns)
+{
+  std::string line;
+  if (!std::getline(in,line)) return false;
+  gridpack::utility::StringUtils util;
+  std::vector<std::string> fields = util.charTokenizer(line,",");
+  columns.clear();
+  int i;
+  // The first column is the time. Columns of unknown buses are skipped
+  for (i=1; i<fields.size(); i++) {
+    util.trim(fields[i]);
+    int bus = -1;
+    std::map<int,int>::const_iterator it = p_bus_index.end();
+    if (sscanf(fields[i].c_str(),"Bus-%d",&bus) == 1) {
+      it = p_bus_index.find(bus);
+    }
+    columns.push_back(it != p_bus_index.end() ? it->second : -1);
+  }
+  return true;
+}
+
+/**
+ * Read the next row of an input file on process 0
+ * @param in input file
+ * @param columns position in the filter order of each column
+ * @param time time of the row
+ * @param values values in the filter order
+ * @return false at the end of the file
+ */
+bool gridpack::kalman_filter::KDSMeasurementFeed::readRow(std::ifstream &in,
+    const std::vector<int> &columns, double &time,
+    std::vector<double> &values)
+{
+  std::string line;
+  if (!std::getline(in,line)) return false;
+  values.assign(p_nbus,std::numeric_limits<double>::quiet_NaN());
+  char *ptr = const_cast<char*>(line.c_str());
+  char *end;
+  time = strtod(ptr,&end);
+  if (end == ptr) return false;
+  int i;
+  for (i=0; i<columns.size(); i++) {
+    if (*end != ',') break;
+    ptr = end+1;
+    double v = strtod(ptr,&end);
+    if (end == ptr) break;
+    if (columns[i] >= 0) values[columns[i]] = v;
+  }
+  return true;
+}
+
+/**
+ * Read the measurements at the given time on process 0
+ * @param time time of the filter
+ * @param vmag voltage magnitudes
+ * @param vang voltage angles
+ * @param mask 1 for each available value
+ * @return false if the source has ended
+ */
+bool gridpack::kalman_filter::KDSMeasurementFeed::read(double time,
+    std::vector<double> &vmag, std::vector<double> &vang,
+    std::vector<int> &mask)
+{
+  if (time > p_end_time) return false;
+  mask.assign(2*p_nbus,0);
+  vmag.assign(p_nbus,0.0);
+  vang.assign(p_nbus,0.0);
+  int i;
+  if (p_source == "file") {
+    // Rows before the filter time are skipped, so the files can have a
+    // finer time step than the filter
+    double tol = 1.0e-9*(1.0+fabs(time));
+    double tmag = -1.0;
+    double tang = -1.0;
+    std::vector<double> mag, ang;
+    while (tmag < time-tol) {
+      if (!readRow(p_mag,p_mag_columns,tmag,mag)) return false;
+    }
+    while (tang < time-tol) {
+      if (!readRow(p_ang,p_ang_columns,tang,ang)) return false;
+    }
+    for (i=0; i<p_nbus; i++) {
+      if (!std::isnan(mag[i])) {
+        vmag[i] = mag[i];
+        mask[i] = 1;
+      }
+      if (!std::isnan(ang[i])) {
+        vang[i] = ang[i];
+        mask[p_nbus+i] = 1;
+      }
+    }
+    return true;
+  }
+#ifdef KDS_USE_HELICS
+  double granted = p_fed->requestTime(time);
+  if (granted > p_end_time) return false;
+  if (p_mag_input.isUpdated()) {
+    std::vector<double> v = p_mag_input.getValue<std::vector<double> >();
+    for (i=0; i<v.size() && i<p_order.size(); i++) {
+      vmag[p_order[i]] = v[i];
+      mask[p_order[i]] = 1;
+    }
+  }
+  if (p_ang_input.isUpdated()) {
+    std::vector<double> v = p_ang_input.getValue<std::vector<double> >();
+    for (i=0; i<v.size() && i<p_order.size(); i++) {
+      vang[p_order[i]] = v[i];
+      mask[p_nbus+p_order[i]] = 1;
+    }
+  }
+  return true;
+#else
+  return false;
+#endif
+}
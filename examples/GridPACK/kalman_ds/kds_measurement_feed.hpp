@@ -0,0 +1,144 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   kds_measurement_feed.hpp
+ *
+ * @brief  Bus voltage measurements for the step-wise Kalman filter, replayed
+ *         from the Kalman input files or received from a HELICS federation.
+ *
+ *  The input files have one row per time, with the time in the first column
+ *  and one column per bus, labelled Bus-N in the header. HELICS inputs are
+ *  vectors with one value per bus, in increasing order of the bus numbers,
+ *  on the magnitudeKey and angleKey subscriptions. The filter estimate
+ *  can be published as a vector of the generator angles followed by the
+ *  speeds.
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _kds_measurement_feed_h_
+#define _kds_measurement_feed_h_
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include "boost/smart_ptr/shared_ptr.hpp"
+#include "gridpack/include/gridpack.hpp"
+#ifdef KDS_USE_HELICS
+#include <helics/application_api/ValueFederate.hpp>
+#endif
+
+namespace gridpack {
+namespace kalman_filter {
+
+// Only process 0 reads from the source. The measurements are broadcast to
+// all processes in the bus order of the filter
+class KDSMeasurementFeed
+{
+  public:
+    /**
+     * Basic constructor
+     * @param comm communicator of the filter
+     */
+    KDSMeasurementFeed(const gridpack::parallel::Communicator &comm);
+
+    /**
+     * Basic destructor
+     */
+    ~KDSMeasurementFeed(void);
+
+    /**
+     * Open the source described by the RealTime block
+     * @param rcursor pointer to RealTime block
+     * @param kcursor pointer to Kalman_filter block (input files)
+     * @param buses bus numbers in the order of the filter
+     * @return false if the source could not be opened
+     */
+    bool open(gridpack::utility::Configuration::CursorPtr rcursor,
+        gridpack::utility::Configuration::CursorPtr kcursor,
+        const std::vector<int> &buses);
+
+    /**
+     * Measurements at the given time. Collective
+     * @param time time of the filter after the prediction
+     * @param vmag voltage magnitudes, not a number if missing
+     * @param vang voltage angles in radians, not a number if missing
+     * @param valid true if any measurement is available at this time
+     * @return false if the source has ended
+     */
+    bool next(double time, std::vector<double> &vmag,
+        std::vector<double> &vang, bool &valid);
+
+    /**
+     * Publish the filter estimate, if a publication is configured
+     * @param angle rotor angles of the generators
+     * @param speed rotor speeds of the generators
+     */
+    void publish(const std::vector<double> &angle,
+        const std::vector<double> &speed);
+
+    /**
+     * Close the source
+     */
+    void close(void);
+
+  private:
+
+    /**
+     * Read the header of an input file and map its columns to the buses
+     * @param in input file
+     * @param columns position in the filter order of each column
+     * @return false if the header could not be read
+     */
+    bool readHeader(std::ifstream &in, std::vector<int> &columns);
+
+    /**
+     * Read the next row of an input file on process 0
+     * @param in input file
+     * @param columns position in the filter order of each column
+     * @param time time of the row
+     * @param values values in the filter order
+     * @return false at the end of the file
+     */
+    bool readRow(std::ifstream &in, const std::vector<int> &columns,
+        double &time, std::vector<double> &values);
+
+    /**
+     * Read the measurements at the given time on process 0
+     * @param time time of the filter
+     * @param vmag voltage magnitudes
+     * @param vang voltage angles
+     * @param mask 1 for each available value
+     * @return false if the source has ended
+     */
+    bool read(double time, std::vector<double> &vmag,
+        std::vector<double> &vang, std::vector<int> &mask);
+
+    gridpack::parallel::Communicator p_comm;
+    std::string p_source;
+    int p_nbus;
+    std::map<int,int> p_bus_index;
+    std::ifstream p_mag;
+    std::ifstream p_ang;
+    std::vector<int> p_mag_columns;
+    std::vector<int> p_ang_columns;
+    double p_end_time;
+    bool p_open;
+#ifdef KDS_USE_HELICS
+    boost::shared_ptr<helics::ValueFederate> p_fed;
+    helics::Input p_mag_input;
+    helics::Input p_ang_input;
+    helics::Publication p_estimate;
+    bool p_publish;
+    std::vector<int> p_order;
+#endif
+};
+
+} // kalman_filter
+} // gridpack
+#endif
@@ -0,0 +1,805 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   kds_step_filter.cpp
+ *
+ * @brief  Step-wise ensemble Kalman filter for classical generators
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#include "mpi.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "kds_step_filter.hpp"
+
+namespace {
+
+// Cholesky factorization of the symmetric positive definite n x n matrix
+// a in place. Only the lower triangle is used
+void choleskyFactor(double *a, int n)
+{
+  int i, j, k;
+  for (j=0; j<n; j++) {
+    double d = a[j*n+j];
+    for (k=0; k<j; k++) d -= a[j*n+k]*a[j*n+k];
+    d = sqrt(d > 0.0 ? d : 1.0e-300);
+    a[j*n+j] = d;
+    for (i=j+1; i<n; i++) {
+      double s = a[i*n+j];
+      for (k=0; k<j; k++) s -= a[i*n+k]*a[j*n+k];
+      a[i*n+j] = s/d;
+    }
+  }
+}
+
+// Solve L*Lt*x = b with the factor from choleskyFactor. b is overwritten
+// with x
+void choleskySolve(const double *a, int n, double *b)
+{
+  int i, k;
+  for (i=0; i<n; i++) {
+    double s = b[i];
+    for (k=0; k<i; k++) s -= a[i*n+k]*b[k];
+    b[i] = s/a[i*n+i];
+  }
+  for (i=n-1; i>=0; i--) {
+    double s = b[i];
+    for (k=i+1; k<n; k++) s -= a[k*n+i]*b[k];
+    b[i] = s/a[i*n+i];
+  }
+}
+
+// Angle difference wrapped into [-pi, pi)
+double wrapAngle(double a)
+{
+  return a-2.0*M_PI*floor((a+M_PI)/(2.0*M_PI));
+}
+
+}
+
+/**
+ * Basic constructor
+ * @param comm communicator of the power flow network
+ */
+gridpack::kalman_filter::KDSStepFilter::KDSStepFilter(
+    const gridpack::parallel::Communicator &comm)
+  : p_comm(comm), p_normal(0.0,1.0)
+{
+  p_nbus = 0;
+  p_ngen = 0;
+  p_known_fault = false;
+  p_fault_on = 0.0;
+  p_fault_off = 0.0;
+  p_nens = 0;
+  p_klo = 0;
+  p_khi = 0;
+  p_nstate = 0;
+  p_nmeas = 0;
+  p_time = 0.0;
+  p_dt = 0.01;
+  p_noise = 0.0;
+  p_omega_s = 2.0*M_PI*60.0;
+  p_mag_deviation = 1.0e-3;
+  p_ang_deviation = 1.0e-3;
+  p_t_predict = 0.0;
+  p_t_update = 0.0;
+  p_nsteps = 0;
+}
+
+/**
+ * Basic destructor
+ */
+gridpack::kalman_filter::KDSStepFilter::~KDSStepFilter(void)
+{
+}
+
+/**
+ * Set up the generator models, the voltage response matrices and the
+ * ensemble from a solved power flow. Collective
+ * @param network power flow network after PFAppModule::saveData
+ * @param kcursor pointer to Kalman_filter block
+ * @param dcursor pointer to Dynamic_simulation block
+ * @return false if the generator parameters could not be read
+ */
+bool gridpack::kalman_filter::KDSStepFilter::setup(
+    boost::shared_ptr<gridpack::powerflow::PFNetwork> network,
+    gridpack::utility::Configuration::CursorPtr kcursor,
+    gridpack::utility::Configuration::CursorPtr dcursor)
+{
+  gridpack::utility::StringUtils util;
+  int me = p_comm.rank();
+  int nprocs = p_comm.size();
+  p_dt = dcursor->get("timeStep",0.01);
+  p_nens = kcursor->get("ensembleSize",21);
+  if (p_nens < 2) p_nens = 2;
+  double width = kcursor->get("gaussianWidth",1.0e-2);
+  p_noise = kcursor->get("noiseScale",1.0e-4);
+  int seed = kcursor->get("randomSeed",931316785);
+  gridpack::utility::Configuration::CursorPtr rcursor;
+  rcursor = kcursor->getCursor("RealTime");
+  if (rcursor) {
+    p_mag_deviation = rcursor->get("magnitudeDeviation",p_mag_deviation);
+    p_ang_deviation = rcursor->get("angleDeviation",p_ang_deviation);
+    double freq = rcursor->get("frequency",60.0);
+    p_omega_s = 2.0*M_PI*freq;
+  }
+  p_random.seed(static_cast<unsigned int>(seed+me));
+
+  // Known fault, applied as a bolted fault at the from bus of the branch
+  p_known_fault = (dcursor->get("KnownFault",1) == 1);
+  int fault_from = -1;
+  if (p_known_fault) {
+    p_fault_on = dcursor->get("Events.faultEvent.beginFault",0.0);
+    p_fault_off = dcursor->get("Events.faultEvent.endFault",0.0);
+    std::string branch;
+    dcursor->get("Events.faultEvent.faultBranch",&branch);
+    int to;
+    if (sscanf(branch.c_str(),"%d %d",&fault_from,&to) != 2) {
+      p_known_fault = false;
+    }
+  }
+
+  std::string filename;
+  kcursor->get("generatorParameters",&filename);
+  util.trim(filename);
+  std::map<std::string,std::pair<double,double> > params;
+  if (!readParameters(filename,params)) return false;
+
+  // Bus numbering and the rows of the admittance matrix on this process
+  int nbus = network->numBuses();
+  p_nbus = network->totalBuses();
+  p_bus_ids.assign(p_nbus,0);
+  int i, j, k;
+  double sbase = 0.0;
+  for (i=0; i<nbus; i++) {
+    gridpack::component::DataCollection *data =
+      network->getBusData(i).get();
+    data->getValue(CASE_SBASE,&sbase);
+    if (network->getActiveBus(i)) {
+      p_bus_ids[network->getGlobalBusIndex(i)] =
+        network->getOriginalBusIndex(i);
+    }
+  }
+  p_comm.sum(&p_bus_ids[0],p_nbus);
+  p_comm.max(&sbase,1);
+  if (sbase <= 0.0) sbase = 100.0;
+  p_bus_index.clear();
+  for (i=0; i<p_nbus; i++) {
+    p_bus_index.insert(std::pair<int,int>(p_bus_ids[i],i));
+  }
+  int lo = static_cast<int>(static_cast<long>(p_nbus)*me/nprocs);
+  int hi = static_cast<int>(static_cast<long>(p_nbus)*(me+1)/nprocs);
+  gridpack::math::Matrix Y(p_comm, hi-lo, hi-lo);
+
+  // Shunts, loads as constant admittances and generators as Norton
+  // equivalents at the active buses. The generators of this process are
+  // collected and combined with the other processes below
+  std::vector<int> gbus;
+  std::vector<std::string> gtags;
+  std::vector<double> gvals;
+  for (i=0; i<nbus; i++) {
+    if (!network->getActiveBus(i)) continue;
+    gridpack::component::DataCollection *data =
+      network->getBusData(i).get();
+    int g = network->getGlobalBusIndex(i);
+    double vm = 1.0;
+    double va = 0.0;
+    data->getValue("BUS_PF_VMAG",&vm);
+    data->getValue("BUS_PF_VANG",&va);
+    gridpack::ComplexType v = std::polar(vm,va*M_PI/180.0);
+    double gl = 0.0;
+    double bl = 0.0;
+    data->getValue(BUS_SHUNT_GL,&gl);
+    data->getValue(BUS_SHUNT_BL,&bl);
+    gridpack::ComplexType y(gl/sbase,bl/sbase);
+    int nload = 0;
+    data->getValue(LOAD_NUMBER,&nload);
+    for (j=0; j<nload; j++) {
+      int status = 1;
+      double pl = 0.0;
+      double ql = 0.0;
+      data->getValue(LOAD_STATUS,&status,j);
+      data->getValue(LOAD_PL,&pl,j);
+      data->getValue(LOAD_QL,&ql,j);
+      if (status != 1) continue;
+      y += gridpack::ComplexType(pl/sbase,-ql/sbase)/(vm*vm);
+    }
+    int ngen = 0;
+    data->getValue(GENERATOR_NUMBER,&ngen);
+    for (j=0; j<ngen; j++) {
+      int status = 1;
+      double pg = 0.0;
+      double qg = 0.0;
+      double mbase = sbase;
+      double zx = 0.0;
+      std::string tag;
+      data->getValue(GENERATOR_STAT,&status,j);
+      data->getValue("GENERATOR_PF_PGEN",&pg,j);
+      data->getValue("GENERATOR_PF_QGEN",&qg,j);
+      data->getValue(GENERATOR_MBASE,&mbase,j);
+      data->getValue(GENERATOR_ZX,&zx,j);
+      data->getValue(GENERATOR_ID,&tag,j);
+      util.trim(tag);
+      if (status != 1) continue;
+      char key[64];
+      sprintf(key,"%d:%s",p_bus_ids[g],tag.c_str());
+      std::map<std::string,std::pair<double,double> >::const_iterator it =
+        params.find(key);
+      if (it == params.end() || zx <= 0.0) {
+        printf("No classical model for generator %s on bus %d\n",
+            tag.c_str(),p_bus_ids[g]);
+        continue;
+      }
+      // Reactance, inertia and damping are converted from the machine
+      // base to the system base
+      double xd = zx*sbase/mbase;
+      gridpack::ComplexType s(pg/sbase,qg/sbase);
+      gridpack::ComplexType e = v+gridpack::ComplexType(0.0,xd)*conj(s/v);
+      y += 1.0/gridpack::ComplexType(0.0,xd);
+      gbus.push_back(g);
+      gtags.push_back(tag);
+      gvals.push_back(xd);
+      gvals.push_back(abs(e));
+      gvals.push_back(arg(e));
+      gvals.push_back(pg/sbase);
+      gvals.push_back(it->second.first*mbase/sbase);
+      gvals.push_back(it->second.second*mbase/sbase);
+    }
+    Y.addElement(g,g,y);
+  }
+
+  // Pi model of the in-service elements of the active branches
+  int nbranch = network->numBranches();
+  for (i=0; i<nbranch; i++) {
+    if (!network->getActiveBranch(i)) continue;
+    gridpack::component::DataCollection *data =
+      network->getBranchData(i).get();
+    int l1, l2;
+    network->getBranchEndpoints(i,&l1,&l2);
+    int f = network->getGlobalBusIndex(l1);
+    int t = network->getGlobalBusIndex(l2);
+    int nelem = 0;
+    data->getValue(BRANCH_NUM_ELEMENTS,&nelem);
+    for (j=0; j<nelem; j++) {
+      int status = 1;
+      double r = 0.0;
+      double x = 0.0;
+      double b = 0.0;
+      double tap = 0.0;
+      double shift = 0.0;
+      data->getValue(BRANCH_STATUS,&status,j);
+      data->getValue(BRANCH_R,&r,j);
+      data->getValue(BRANCH_X,&x,j);
+      data->getValue(BRANCH_B,&b,j);
+      data->getValue(BRANCH_TAP,&tap,j);
+      data->getValue(BRANCH_SHIFT,&shift,j);
+      if (status != 1 || (r == 0.0 && x == 0.0)) continue;
+      if (tap == 0.0) tap = 1.0;
+      gridpack::ComplexType ys = 1.0/gridpack::ComplexType(r,x);
+      gridpack::ComplexType ysh(0.0,0.5*b);
+      gridpack::ComplexType tps = std::polar(tap,shift*M_PI/180.0);
+      Y.addElement(f,f,(ys+ysh)/(tap*tap));
+      Y.addElement(f,t,-ys/std::conj(tps));
+      Y.addElement(t,f,-ys/tps);
+      Y.addElement(t,t,ys+ysh);
+    }
+  }
+  Y.ready();
+
+  // Generators of all processes, in the order of the processes
+  std::vector<int> counts(nprocs,0);
+  counts[me] = gbus.size();
+  p_comm.sum(&counts[0],nprocs);
+  int offset = 0;
+  p_ngen = 0;
+  for (i=0; i<nprocs; i++) {
+    if (i < me) offset += counts[i];
+    p_ngen += counts[i];
+  }
+  if (p_ngen == 0) {
+    if (me == 0) printf("No generators with classical models found\n");
+    return false;
+  }
+  std::vector<int> ibuf(3*p_ngen,0);
+  std::vector<double> dbuf(6*p_ngen,0.0);
+  for (i=0; i<gbus.size(); i++) {
+    std::string tag = gtags[i];
+    tag.resize(2,' ');
+    ibuf[3*(offset+i)] = gbus[i];
+    ibuf[3*(offset+i)+1] = tag[0];
+    ibuf[3*(offset+i)+2] = tag[1];
+    for (k=0; k<6; k++) dbuf[6*(offset+i)+k] = gvals[6*i+k];
+  }
+  p_comm.sum(&ibuf[0],3*p_ngen);
+  p_comm.sum(&dbuf[0],6*p_ngen);
+  p_gen_bus.resize(p_ngen);
+  p_gen_tags.resize(p_ngen);
+  p_xd.resize(p_ngen);
+  p_emf.resize(p_ngen);
+  p_pm.resize(p_ngen);
+  p_inertia.resize(p_ngen);
+  p_damping.resize(p_ngen);
+  std::vector<double> angle0(p_ngen);
+  for (i=0; i<p_ngen; i++) {
+    p_gen_bus[i] = ibuf[3*i];
+    std::string tag;
+    tag.push_back(static_cast<char>(ibuf[3*i+1]));
+    tag.push_back(static_cast<char>(ibuf[3*i+2]));
+    util.trim(tag);
+    p_gen_tags[i] = tag;
+    p_xd[i] = dbuf[6*i];
+    p_emf[i] = dbuf[6*i+1];
+    angle0[i] = dbuf[6*i+2];
+    p_pm[i] = dbuf[6*i+3];
+    p_inertia[i] = dbuf[6*i+4];
+    p_damping[i] = dbuf[6*i+5];
+  }
+
+  // Voltage response before and during the fault. The network after the
+  // fault is the same as before it
+  response(Y,kcursor,p_zg_pre);
+  if (p_known_fault) {
+    std::map<int,int>::const_iterator it = p_bus_index.find(fault_from);
+    if (it == p_bus_index.end()) {
+      if (me == 0) printf("Fault bus %d not found\n",fault_from);
+      p_known_fault = false;
+    } else {
+      boost::shared_ptr<gridpack::math::Matrix> Yf(Y.clone());
+      if (me == 0) {
+        Yf->addElement(it->second,it->second,
+            gridpack::ComplexType(0.0,-1.0e6));
+      }
+      Yf->ready();
+      response(*Yf,kcursor,p_zg_fault);
+    }
+  }
+
+  // Storage for the ensemble and the analysis, which is reused by every
+  // step
+  p_nstate = 2*p_ngen;
+  p_nmeas = 2*p_nbus;
+  p_klo = static_cast<int>(static_cast<long>(p_nens)*me/nprocs);
+  p_khi = static_cast<int>(static_cast<long>(p_nens)*(me+1)/nprocs);
+  p_X.assign(p_nstate*p_nens,0.0);
+  p_HX.assign(p_nmeas*p_nens,0.0);
+  p_buf.assign((p_nstate+p_nmeas)*p_nens,0.0);
+  p_A.assign(p_nstate*p_nens,0.0);
+  p_xmean.assign(p_nstate,0.0);
+  p_hmean.assign(p_nmeas,0.0);
+  p_rinv.assign(p_nmeas,0.0);
+  p_C.assign(p_nens*p_nens,0.0);
+  p_u.assign(p_nens,0.0);
+  p_pe.assign(p_ngen,0.0);
+  p_k1.assign(p_nstate,0.0);
+  p_xt.assign(p_nstate,0.0);
+  p_v.assign(p_nbus,gridpack::ComplexType(0.0,0.0));
+
+  // Initial ensemble around the power flow solution
+  for (k=p_klo; k<p_khi; k++) {
+    double *x = &p_X[k*p_nstate];
+    for (i=0; i<p_ngen; i++) {
+      x[2*i] = angle0[i]+width*gaussian();
+      x[2*i+1] = 1.0+width*gaussian();
+    }
+    evaluate(x,p_zg_pre,p_pe,&p_HX[k*p_nmeas]);
+  }
+  p_time = 0.0;
+  p_t_predict = 0.0;
+  p_t_update = 0.0;
+  p_nsteps = 0;
+  if (me == 0) {
+    printf("Kalman filter: %d generators, %d buses, %d ensemble members"
+        " on %d processes\n",p_ngen,p_nbus,p_nens,nprocs);
+  }
+  return true;
+}
+
+/**
+ * Advance every ensemble member by one time step
+ */
+void gridpack::kalman_filter::KDSStepFilter::predict(void)
+{
+  double t_start = MPI_Wtime();
+  const std::vector<gridpack::ComplexType> &zg = currentResponse();
+  int i, k;
+  // Heun's method for the swing equations of each member, followed by the
+  // process noise
+  for (k=p_klo; k<p_khi; k++) {
+    double *x = &p_X[k*p_nstate];
+    evaluate(x,zg,p_pe,NULL);
+    for (i=0; i<p_ngen; i++) {
+      double dw = x[2*i+1]-1.0;
+      p_k1[2*i] = p_omega_s*dw;
+      p_k1[2*i+1] = (p_pm[i]-p_pe[i]-p_damping[i]*dw)/(2.0*p_inertia[i]);
+    }
+    for (i=0; i<p_nstate; i++) p_xt[i] = x[i]+p_dt*p_k1[i];
+    evaluate(&p_xt[0],zg,p_pe,NULL);
+    for (i=0; i<p_ngen; i++) {
+      double dw = p_xt[2*i+1]-1.0;
+      double k2a = p_omega_s*dw;
+      double k2w = (p_pm[i]-p_pe[i]-p_damping[i]*dw)/(2.0*p_inertia[i]);
+      x[2*i] += 0.5*p_dt*(p_k1[2*i]+k2a)+p_noise*gaussian();
+      x[2*i+1] += 0.5*p_dt*(p_k1[2*i+1]+k2w)+p_noise*gaussian();
+    }
+  }
+  p_time += p_dt;
+  // Measurement predictions in the network at the new time
+  const std::vector<gridpack::ComplexType> &zn = currentResponse();
+  for (k=p_klo; k<p_khi; k++) {
+    evaluate(&p_X[k*p_nstate],zn,p_pe,&p_HX[k*p_nmeas]);
+  }
+  p_t_predict += MPI_Wtime()-t_start;
+}
+
+/**
+ * Correct the ensemble with one set of measurements. Values that are
+ * not a number are treated as missing. Collective
+ * @param vmag measured voltage magnitudes, in the order of getBuses
+ * @param vang measured voltage angles in radians
+ */
+void gridpack::kalman_filter::KDSStepFilter::update(
+    const std::vector<double> &vmag, const std::vector<double> &vang)
+{
+  double t_start = MPI_Wtime();
+  int n = p_nstate;
+  int m = p_nmeas;
+  int N = p_nens;
+  int i, j, k, l;
+
+  // Combine the members of all processes
+  p_buf.assign(p_buf.size(),0.0);
+  for (k=p_klo; k<p_khi; k++) {
+    for (i=0; i<n; i++) p_buf[k*n+i] = p_X[k*n+i];
+    for (i=0; i<m; i++) p_buf[N*n+k*m+i] = p_HX[k*m+i];
+  }
+  p_comm.sum(&p_buf[0],p_buf.size());
+  for (i=0; i<N*n; i++) p_X[i] = p_buf[i];
+  for (i=0; i<N*m; i++) p_HX[i] = p_buf[N*n+i];
+
+  // Scaled anomalies A = (X-xmean)/sqrt(N-1) and S = (HX-hmean)/sqrt(N-1),
+  // S is stored in place of HX after the innovations have been formed
+  double scale = 1.0/sqrt(static_cast<double>(N-1));
+  p_xmean.assign(n,0.0);
+  p_hmean.assign(m,0.0);
+  for (k=0; k<N; k++) {
+    for (i=0; i<n; i++) p_xmean[i] += p_X[k*n+i]/N;
+    for (i=0; i<m; i++) p_hmean[i] += p_HX[k*m+i]/N;
+  }
+  for (k=0; k<N; k++) {
+    for (i=0; i<n; i++) p_A[k*n+i] = (p_X[k*n+i]-p_xmean[i])*scale;
+  }
+  for (i=0; i<m; i++) {
+    double z = (i < p_nbus) ? vmag[i] : vang[i-p_nbus];
+    double dev = (i < p_nbus) ? p_mag_deviation : p_ang_deviation;
+    p_rinv[i] = std::isnan(z) ? 0.0 : 1.0/(dev*dev);
+  }
+
+  // Innovations of the own members with perturbed observations, kept in
+  // p_buf, which is no longer needed
+  double *d = &p_buf[0];
+  for (k=p_klo; k<p_khi; k++) {
+    for (i=0; i<m; i++) {
+      if (p_rinv[i] == 0.0) {
+        d[k*m+i] = 0.0;
+        continue;
+      }
+      double z, dev;
+      if (i < p_nbus) {
+        z = vmag[i];
+        dev = p_mag_deviation;
+        d[k*m+i] = z+dev*gaussian()-p_HX[k*m+i];
+      } else {
+        z = vang[i-p_nbus];
+        dev = p_ang_deviation;
+        d[k*m+i] = wrapAngle(z+dev*gaussian()-p_HX[k*m+i]);
+      }
+    }
+  }
+  for (k=0; k<N; k++) {
+    for (i=0; i<m; i++) {
+      double s = p_HX[k*m+i]-p_hmean[i];
+      if (i >= p_nbus) s = wrapAngle(s);
+      p_HX[k*m+i] = s*scale;
+    }
+  }
+
+  // With R diagonal the gain in ensemble space is
+  // St*(S*St+R)^-1 = (I+St*R^-1*S)^-1*St*R^-1, so only the N x N matrix
+  // C = I+St*R^-1*S is factored
+  for (k=0; k<N; k++) {
+    for (l=0; l<=k; l++) {
+      double c = (k == l) ? 1.0 : 0.0;
+      for (i=0; i<m; i++) c += p_HX[k*m+i]*p_rinv[i]*p_HX[l*m+i];
+      p_C[k*N+l] = c;
+      p_C[l*N+k] = c;
+    }
+  }
+  choleskyFactor(&p_C[0],N);
+  for (k=p_klo; k<p_khi; k++) {
+    for (l=0; l<N; l++) {
+      double u = 0.0;
+      for (i=0; i<m; i++) u += p_HX[l*m+i]*p_rinv[i]*d[k*m+i];
+      p_u[l] = u;
+    }
+    choleskySolve(&p_C[0],N,&p_u[0]);
+    double *x = &p_X[k*n];
+    for (l=0; l<N; l++) {
+      for (j=0; j<n; j++) x[j] += p_A[l*n+j]*p_u[l];
+    }
+  }
+  p_nsteps++;
+  p_t_update += MPI_Wtime()-t_start;
+}
+
+/**
+ * One predict and update
+ * @param vmag measured voltage magnitudes, in the order of getBuses
+ * @param vang measured voltage angles in radians
+ */
+void gridpack::kalman_filter::KDSStepFilter::step(
+    const std::vector<double> &vmag, const std::vector<double> &vang)
+{
+  predict();
+  update(vmag,vang);
+}
+
+/**
+ * Buses in the order of the measurement vectors
+ * @param buses original bus indices, in the order of the global bus
+ *        indices
+ */
+void gridpack::kalman_filter::KDSStepFilter::getBuses(
+    std::vector<int> &buses) const
+{
+  buses = p_bus_ids;
+}
+
+/**
+ * Generators in the order of the estimates
+ * @param buses original bus indices
+ * @param tags generator IDs
+ */
+void gridpack::kalman_filter::KDSStepFilter::getGenerators(
+    std::vector<int> &buses, std::vector<std::string> &tags) const
+{
+  buses.resize(p_ngen);
+  int i;
+  for (i=0; i<p_ngen; i++) buses[i] = p_bus_ids[p_gen_bus[i]];
+  tags = p_gen_tags;
+}
+
+/**
+ * Ensemble mean of the generator states. Collective
+ * @param angle rotor angles in radians
+ * @param speed rotor speeds in per unit
+ */
+void gridpack::kalman_filter::KDSStepFilter::getEstimate(
+    std::vector<double> &angle, std::vector<double> &speed) const
+{
+  std::vector<double> mean(p_nstate,0.0);
+  int i, k;
+  for (k=p_klo; k<p_khi; k++) {
+    for (i=0; i<p_nstate; i++) mean[i] += p_X[k*p_nstate+i];
+  }
+  p_comm.sum(&mean[0],p_nstate);
+  angle.resize(p_ngen);
+  speed.resize(p_ngen);
+  for (i=0; i<p_ngen; i++) {
+    angle[i] = mean[2*i]/p_nens;
+    speed[i] = mean[2*i+1]/p_nens;
+  }
+}
+
+/**
+ * Time of the current estimate
+ * @return time in seconds
+ */
+double gridpack::kalman_filter::KDSStepFilter::getTime(void) const
+{
+  return p_time;
+}
+
+/**
+ * Time step of the filter
+ * @return time step in seconds
+ */
+double gridpack::kalman_filter::KDSStepFilter::getTimeStep(void) const
+{
+  return p_dt;
+}
+
+/**
+ * Accumulated time in predict and update, maximum over processes
+ * @param t_predict time spent propagating the ensemble
+ * @param t_update time spent in the analysis
+ * @param nsteps number of updates
+ */
+void gridpack::kalman_filter::KDSStepFilter::getTimings(double &t_predict,
+    double &t_update, int &nsteps) const
+{
+  t_predict = p_t_predict;
+  t_update = p_t_update;
+  p_comm.max(&t_predict,1);
+  p_comm.max(&t_update,1);
+  nsteps = p_nsteps;
+}
+
+/**
+ * Read the GENCLS records of the generator parameter file on process 0
+ * and broadcast them
+ * @param filename name of the file
+ * @param params inertia and damping of each generator, indexed by bus
+ *        and ID
+ * @return false if the file could not be read
+ */
+bool gridpack::kalman_filter::KDSStepFilter::readParameters(
+    const std::string &filename,
+    std::map<std::string,std::pair<double,double> > &params)
+{
+  // Records are packed as bus, two ID characters, H and D
+  std::vector<int> ibuf;
+  std::vector<double> dbuf;
+  int nrec = 0;
+  int ok = 0;
+  if (p_comm.rank() == 0) {
+    FILE *fp = fopen(filename.c_str(),"r");
+    if (fp) {
+      ok = 1;
+      gridpack::utility::StringUtils util;
+      char line[1024];
+      while (fgets(line,sizeof(line),fp)) {
+        std::vector<std::string> fields = util.charTokenizer(line,",/");
+        if (fields.size() < 5) continue;
+        int i;
+        for (i=0; i<fields.size(); i++) {
+          util.trim(fields[i]);
+          std::string::size_type q;
+          while ((q = fields[i].find('\'')) != std::string::npos) {
+            fields[i].erase(q,1);
+          }
+          util.trim(fields[i]);
+        }
+        if (fields[1] != "GENCLS") continue;
+        std::string tag = fields[2];
+        tag.resize(2,' ');
+        ibuf.push_back(atoi(fields[0].c_str()));
+        ibuf.push_back(tag[0]);
+        ibuf.push_back(tag[1]);
+        dbuf.push_back(atof(fields[3].c_str()));
+        dbuf.push_back(atof(fields[4].c_str()));
+        nrec++;
+      }
+      fclose(fp);
+    } else {
+      printf("Unable to open generator parameters %s\n",filename.c_str());
+    }
+  }
+  p_comm.sum(&ok,1);
+  if (ok == 0) return false;
+  p_comm.sum(&nrec,1);
+  if (nrec == 0) return true;
+  ibuf.resize(3*nrec,0);
+  dbuf.resize(2*nrec,0.0);
+  p_comm.sum(&ibuf[0],3*nrec);
+  p_comm.sum(&dbuf[0],2*nrec);
+  gridpack::utility::StringUtils util;
+  int i;
+  for (i=0; i<nrec; i++) {
+    std::string tag;
+    tag.push_back(static_cast<char>(ibuf[3*i+1]));
+    tag.push_back(static_cast<char>(ibuf[3*i+2]));
+    util.trim(tag);
+    char key[64];
+    sprintf(key,"%d:%s",ibuf[3*i],tag.c_str());
+    params[key] = std::pair<double,double>(dbuf[2*i],dbuf[2*i+1]);
+  }
+  return true;
+}
+
+/**
+ * Compute the voltage response of the network to the generator
+ * currents, with one solve for each generator
+ * @param Y admittance matrix with the generator and load admittances
+ * @param cursor pointer to block with the LinearSolver settings
+ * @param zg response, nbus x ngen, stored by bus
+ */
+void gridpack::kalman_filter::KDSStepFilter::response(
+    const gridpack::math::Matrix &Y,
+    gridpack::utility::Configuration::CursorPtr cursor,
+    std::vector<gridpack::ComplexType> &zg)
+{
+  // Y is factored once and column j of Zg is the voltage for a unit
+  // current injected at the bus of generator j
+  gridpack::math::LinearSolver solver(Y);
+  solver.configure(cursor);
+  int lo, hi;
+  Y.localRowRange(lo,hi);
+  gridpack::math::Vector rhs(p_comm, hi-lo);
+  gridpack::math::Vector v(p_comm, hi-lo);
+  std::vector<double> zr(p_nbus*p_ngen,0.0);
+  std::vector<double> zi(p_nbus*p_ngen,0.0);
+  int i, j;
+  for (j=0; j<p_ngen; j++) {
+    rhs.zero();
+    int g = p_gen_bus[j];
+    if (g >= lo && g < hi) rhs.setElement(g,gridpack::ComplexType(1.0,0.0));
+    rhs.ready();
+    v.zero();
+    solver.solve(rhs,v);
+    for (i=lo; i<hi; i++) {
+      gridpack::ComplexType z;
+      v.getElement(i,z);
+      zr[i*p_ngen+j] = real(z);
+      zi[i*p_ngen+j] = imag(z);
+    }
+  }
+  p_comm.sum(&zr[0],p_nbus*p_ngen);
+  p_comm.sum(&zi[0],p_nbus*p_ngen);
+  zg.resize(p_nbus*p_ngen);
+  for (i=0; i<p_nbus*p_ngen; i++) {
+    zg[i] = gridpack::ComplexType(zr[i],zi[i]);
+  }
+}
+
+/**
+ * Bus voltages and electrical power of one ensemble member
+ * @param x state of the member
+ * @param zg voltage response
+ * @param pe electrical power of each generator
+ * @param h predicted measurements, magnitudes then angles
+ */
+void gridpack::kalman_filter::KDSStepFilter::evaluate(const double *x,
+    const std::vector<gridpack::ComplexType> &zg, std::vector<double> &pe,
+    double *h)
+{
+  int i, j;
+  p_v.assign(p_nbus,gridpack::ComplexType(0.0,0.0));
+  for (j=0; j<p_ngen; j++) {
+    gridpack::ComplexType e = std::polar(p_emf[j],x[2*j]);
+    gridpack::ComplexType cur = e/gridpack::ComplexType(0.0,p_xd[j]);
+    for (i=0; i<p_nbus; i++) p_v[i] += zg[i*p_ngen+j]*cur;
+  }
+  for (j=0; j<p_ngen; j++) {
+    gridpack::ComplexType e = std::polar(p_emf[j],x[2*j]);
+    gridpack::ComplexType cur = (e-p_v[p_gen_bus[j]])/
+      gridpack::ComplexType(0.0,p_xd[j]);
+    pe[j] = real(e*conj(cur));
+  }
+  if (h == NULL) return;
+  for (i=0; i<p_nbus; i++) {
+    h[i] = abs(p_v[i]);
+    h[p_nbus+i] = arg(p_v[i]);
+  }
+}
+
+/**
+ * Voltage response at the current time
+ * @return response for the known fault state
+ */
+const std::vector<gridpack::ComplexType>&
+gridpack::kalman_filter::KDSStepFilter::currentResponse(void) const
+{
+  // The fault is on during [beginFault, endFault), with a small margin so
+  // that steps that land on the switching times are not missed
+  double eps = 1.0e-6*p_dt;
+  if (p_known_fault && p_time >= p_fault_on-eps && p_time < p_fault_off-eps) {
+    return p_zg_fault;
+  }
+  return p_zg_pre;
+}
+
+/**
+ * Sample of the standard normal distribution
+ * @return random number
+ */
+double gridpack::kalman_filter::KDSStepFilter::gaussian(void)
+{
+  return p_normal(p_random);
+}
@@ -0,0 +1,238 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   kds_step_filter.hpp
+ *
+ * @brief  Ensemble Kalman filter for the dynamic states of classical
+ *         generators that advances one time step per call, so it can be
+ *         driven by live voltage measurements.
+ *
+ *  The state of each generator is its rotor angle and speed. Generators
+ *  are represented by a constant internal voltage behind the reactance ZX
+ *  and loads by constant admittances, so the bus voltages are linear in the
+ *  internal voltages, V = Zg*I. Zg is computed once for the network before,
+ *  during and after the known fault and the ensemble, the measurement
+ *  predictions and all work arrays are allocated once in setup.
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _kds_step_filter_h_
+#define _kds_step_filter_h_
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "boost/smart_ptr/shared_ptr.hpp"
+#include "gridpack/include/gridpack.hpp"
+#include "gridpack/applications/modules/powerflow/pf_app_module.hpp"
+
+namespace gridpack {
+namespace kalman_filter {
+
+// The ensemble members are divided between the processes. Each process
+// propagates its own members and the members are combined by a sum, after
+// which the analysis in ensemble space is repeated on every process
+class KDSStepFilter
+{
+  public:
+    /**
+     * Basic constructor
+     * @param comm communicator of the power flow network
+     */
+    KDSStepFilter(const gridpack::parallel::Communicator &comm);
+
+    /**
+     * Basic destructor
+     */
+    ~KDSStepFilter(void);
+
+    /**
+     * Set up the generator models, the voltage response matrices and the
+     * ensemble from a solved power flow. Collective
+     * @param network power flow network after PFAppModule::saveData
+     * @param kcursor pointer to Kalman_filter block
+     * @param dcursor pointer to Dynamic_simulation block
+     * @return false if the generator parameters could not be read
+     */
+    bool setup(boost::shared_ptr<gridpack::powerflow::PFNetwork> network,
+        gridpack::utility::Configuration::CursorPtr kcursor,
+        gridpack::utility::Configuration::CursorPtr dcursor);
+
+    /**
+     * Advance every ensemble member by one time step
+     */
+    void predict(void);
+
+    /**
+     * Correct the ensemble with one set of measurements. Values that are
+     * not a number are treated as missing. Collective
+     * @param vmag measured voltage magnitudes, in the order of getBuses
+     * @param vang measured voltage angles in radians
+     */
+    void update(const std::vector<double> &vmag,
+        const std::vector<double> &vang);
+
+    /**
+     * One predict and update
+     * @param vmag measured voltage magnitudes, in the order of getBuses
+     * @param vang measured voltage angles in radians
+     */
+    void step(const std::vector<double> &vmag,
+        const std::vector<double> &vang);
+
+    /**
+     * Buses in the order of the measurement vectors
+     * @param buses original bus indices, in the order of the global bus
+     *        indices
+     */
+    void getBuses(std::vector<int> &buses) const;
+
+    /**
+     * Generators in the order of the estimates
+     * @param buses original bus indices
+     * @param tags generator IDs
+     */
+    void getGenerators(std::vector<int> &buses,
+        std::vector<std::string> &tags) const;
+
+    /**
+     * Ensemble mean of the generator states. Collective
+     * @param angle rotor angles in radians
+     * @param speed rotor speeds in per unit
+     */
+    void getEstimate(std::vector<double> &angle,
+        std::vector<double> &speed) const;
+
+    /**
+     * Time of the current estimate
+     * @return time in seconds
+     */
+    double getTime(void) const;
+
+    /**
+     * Time step of the filter
+     * @return time step in seconds
+     */
+    double getTimeStep(void) const;
+
+    /**
+     * Accumulated time in predict and update, maximum over processes
+     * @param t_predict time spent propagating the ensemble
+     * @param t_update time spent in the analysis
+     * @param nsteps number of updates
+     */
+    void getTimings(double &t_predict, double &t_update, int &nsteps) const;
+
+  private:
+
+    /**
+     * Read the GENCLS records of the generator parameter file on process 0
+     * and broadcast them
+     * @param filename name of the file
+     * @param params inertia and damping of each generator, indexed by bus
+     *        and ID
+     * @return false if the file could not be read
+     */
+    bool readParameters(const std::string &filename,
+        std::map<std::string,std::pair<double,double> > &params);
+
+    /**
+     * Compute the voltage response of the network to the generator
+     * currents, with one solve for each generator
+     * @param Y admittance matrix with the generator and load admittances
+     * @param cursor pointer to block with the LinearSolver settings
+     * @param zg response, nbus x ngen, stored by bus
+     */
+    void response(const gridpack::math::Matrix &Y,
+        gridpack::utility::Configuration::CursorPtr cursor,
+        std::vector<gridpack::ComplexType> &zg);
+
+    /**
+     * Bus voltages and electrical power of one ensemble member
+     * @param x state of the member
+     * @param zg voltage response
+     * @param pe electrical power of each generator
+     * @param h predicted measurements, magnitudes then angles
+     */
+    void evaluate(const double *x,
+        const std::vector<gridpack::ComplexType> &zg,
+        std::vector<double> &pe, double *h);
+
+    /**
+     * Voltage response at the current time
+     * @return response for the known fault state
+     */
+    const std::vector<gridpack::ComplexType>& currentResponse(void) const;
+
+    /**
+     * Sample of the standard normal distribution
+     * @return random number
+     */
+    double gaussian(void);
+
+    gridpack::parallel::Communicator p_comm;
+
+    // Network
+    int p_nbus;
+    std::vector<int> p_bus_ids;
+    std::map<int,int> p_bus_index;
+    std::vector<gridpack::ComplexType> p_zg_pre;
+    std::vector<gridpack::ComplexType> p_zg_fault;
+    bool p_known_fault;
+    double p_fault_on, p_fault_off;
+
+    // Generators
+    int p_ngen;
+    std::vector<int> p_gen_bus;
+    std::vector<std::string> p_gen_tags;
+    std::vector<double> p_xd;
+    std::vector<double> p_emf;
+    std::vector<double> p_pm;
+    std::vector<double> p_inertia;
+    std::vector<double> p_damping;
+
+    // Ensemble, stored by member. Rows of p_X are the angle and speed of
+    // each generator and rows of p_HX the predicted magnitudes and angles
+    // of each bus
+    int p_nens, p_klo, p_khi;
+    int p_nstate, p_nmeas;
+    std::vector<double> p_X;
+    std::vector<double> p_HX;
+    std::vector<double> p_buf;
+
+    // Work arrays of the analysis
+    std::vector<double> p_A;
+    std::vector<double> p_xmean;
+    std::vector<double> p_hmean;
+    std::vector<double> p_rinv;
+    std::vector<double> p_C;
+    std::vector<double> p_u;
+    std::vector<double> p_pe;
+    std::vector<double> p_k1;
+    std::vector<double> p_xt;
+    std::vector<gridpack::ComplexType> p_v;
+
+    // Settings
+    double p_time;
+    double p_dt;
+    double p_noise;
+    double p_omega_s;
+    double p_mag_deviation;
+    double p_ang_deviation;
+    std::mt19937 p_random;
+    std::normal_distribution<double> p_normal;
+
+    // Statistics
+    double p_t_predict, p_t_update;
+    int p_nsteps;
+};
+
+} // kalman_filter
+} // gridpack
+#endif
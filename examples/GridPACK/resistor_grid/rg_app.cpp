@@ -18,6 +18,7 @@
 #include <iostream>
 #include "rg_app.hpp"
 #include "rg_factory.hpp"
+#include "rg_generator.hpp"
 
 
 // Calling program for resistor grid application
@@ -51,14 +52,37 @@ void gridpack::resistor_grid::RGApp::execute(int argc, char** argv)
   gridpack::utility::Configuration::CursorPtr cursor;
   cursor = config->getCursor("Configuration.ResistorGrid");
 
-  // create network and read in external PTI file with network configuration
+  // create network. If gridColumns and gridRows are set, a synthetic grid is
+  // built in memory, otherwise the network configuration is read from an
+  // external PTI file
   boost::shared_ptr<RGNetwork> network(new RGNetwork(world));
-  gridpack::parser::PTI23_parser<RGNetwork> parser(network);
-  std::string filename;
-  if (!cursor->get("networkConfiguration",&filename)) {
-    filename = "small.raw";
+  int ncols, nrows;
+  if (!cursor->get("gridColumns",&ncols)) {
+    ncols = 0;
+  }
+  if (!cursor->get("gridRows",&nrows)) {
+    nrows = 0;
+  }
+  if (ncols > 0 && nrows > 0) {
+    double resistance;
+    if (!cursor->get("gridResistance",&resistance)) {
+      resistance = 0.05;
+    }
+    gridpack::resistor_grid::RGGridGenerator generator(ncols,nrows,
+        resistance);
+    if (world.rank() == 0) {
+      printf("Generating %d x %d grid (%ld buses, %ld branches)\n",
+          ncols,nrows,generator.numBuses(),generator.numBranches());
+    }
+    generator.build(network);
+  } else {
+    gridpack::parser::PTI23_parser<RGNetwork> parser(network);
+    std::string filename;
+    if (!cursor->get("networkConfiguration",&filename)) {
+      filename = "small.raw";
+    }
+    parser.parse(filename.c_str());
   }
-  parser.parse(filename.c_str());
 
   // partition network
   network->partition();
@@ -73,6 +97,9 @@ void gridpack::resistor_grid::RGApp::execute(int argc, char** argv)
   factory.setExchange();
   network->initBusUpdate();
 
+  // cache neighbors and conductances used to build the matrix and vector
+  factory.setNeighborCache();
+
   // create mapper to generate voltage matrix
   gridpack::mapper::FullMatrixMap<RGNetwork> vMap(network);
   boost::shared_ptr<gridpack::math::Matrix> V = vMap.mapToMatrix();
@@ -0,0 +1,189 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   rg_bench.cpp
+ *
+ * @brief  Scaling benchmark for the resistor grid. Builds a synthetic grid
+ *         in memory and times partitioning, matrix and vector assembly, the
+ *         linear solve and the bus update.
+ *
+ *   rg_bench.x [-weak] [-repeat n] [-out file] ncols nrows
+ *
+ * With -weak, nrows is the number of rows per process, so the problem
+ * grows with the number of processes. Otherwise the grid has a fixed size
+ * (strong scaling). Each phase is timed as the maximum over all processes,
+ * the assembly, solve and update phases are averaged over the repeats. One
+ * line with the results is appended to the output file (default
+ * rg_scaling.csv). The linear solver is configured from the ResistorGrid
+ * block of input.xml.
+ *
+ */
+// -------------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "gridpack/include/gridpack.hpp"
+#include "rg_factory.hpp"
+#include "rg_generator.hpp"
+
+namespace {
+
+// Time since start, as the maximum over all processes
+double elapsed(const gridpack::parallel::Communicator &world,
+    gridpack::utility::CoarseTimer *timer, double start)
+{
+  double t = timer->currentTime()-start;
+  world.max(&t,1);
+  return t;
+}
+
+}
+
+int
+main(int argc, char **argv)
+{
+  gridpack::Environment env(argc, argv);
+  gridpack::parallel::Communicator world;
+  gridpack::utility::CoarseTimer *timer =
+    gridpack::utility::CoarseTimer::instance();
+
+  bool weak = false;
+  int repeat = 5;
+  std::string outfile = "rg_scaling.csv";
+  int ncols = 0;
+  int nrows = 0;
+  int arg = 1;
+  while (arg < argc && argv[arg][0] == '-') {
+    if (strcmp(argv[arg],"-weak") == 0) {
+      weak = true;
+    } else if (strcmp(argv[arg],"-repeat") == 0 && arg+1 < argc) {
+      repeat = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg],"-out") == 0 && arg+1 < argc) {
+      outfile = argv[++arg];
+    }
+    arg++;
+  }
+  if (arg+1 < argc) {
+    ncols = atoi(argv[arg]);
+    nrows = atoi(argv[arg+1]);
+  }
+  if (ncols < 2 || nrows < 1 || repeat < 1) {
+    if (world.rank() == 0) {
+      printf("Usage: %s [-weak] [-repeat n] [-out file] ncols nrows\n",
+          argv[0]);
+    }
+    return 1;
+  }
+  if (weak) nrows *= world.size();
+
+  gridpack::utility::Configuration *config =
+    gridpack::utility::Configuration::configuration();
+  config->open("input.xml",world);
+  gridpack::utility::Configuration::CursorPtr cursor;
+  cursor = config->getCursor("Configuration.ResistorGrid");
+
+  // Build and partition the grid
+  double t_build, t_partition, t_setup;
+  double t_matrix = 0.0;
+  double t_vector = 0.0;
+  double t_solve = 0.0;
+  double t_update = 0.0;
+  boost::shared_ptr<gridpack::resistor_grid::RGNetwork>
+    network(new gridpack::resistor_grid::RGNetwork(world));
+  gridpack::resistor_grid::RGGridGenerator generator(ncols,nrows);
+  world.barrier();
+  double t0 = timer->currentTime();
+  generator.build(network);
+  t_build = elapsed(world,timer,t0);
+
+  world.barrier();
+  t0 = timer->currentTime();
+  network->partition();
+  t_partition = elapsed(world,timer,t0);
+
+  world.barrier();
+  t0 = timer->currentTime();
+  gridpack::resistor_grid::RGFactory factory(network);
+  factory.load();
+  factory.setComponents();
+  factory.setExchange();
+  network->initBusUpdate();
+  factory.setNeighborCache();
+  t_setup = elapsed(world,timer,t0);
+
+  // The first assembly creates the matrix and vector, later ones overwrite
+  // them in place
+  gridpack::mapper::FullMatrixMap<gridpack::resistor_grid::RGNetwork>
+    vMap(network);
+  gridpack::mapper::BusVectorMap<gridpack::resistor_grid::RGNetwork>
+    rMap(network);
+  boost::shared_ptr<gridpack::math::Matrix> V = vMap.mapToMatrix();
+  boost::shared_ptr<gridpack::math::Vector> R = rMap.mapToVector();
+  boost::shared_ptr<gridpack::math::Vector> X(R->clone());
+  gridpack::math::LinearSolver solver(*V);
+  solver.configure(cursor);
+
+  int iter;
+  for (iter=0; iter<repeat; iter++) {
+    world.barrier();
+    t0 = timer->currentTime();
+    vMap.mapToMatrix(V);
+    t_matrix += elapsed(world,timer,t0);
+
+    world.barrier();
+    t0 = timer->currentTime();
+    rMap.mapToVector(R);
+    t_vector += elapsed(world,timer,t0);
+
+    world.barrier();
+    t0 = timer->currentTime();
+    X->zero();
+    solver.solve(*R, *X);
+    t_solve += elapsed(world,timer,t0);
+
+    world.barrier();
+    t0 = timer->currentTime();
+    rMap.mapToBus(X);
+    network->updateBuses();
+    t_update += elapsed(world,timer,t0);
+  }
+  t_matrix /= static_cast<double>(repeat);
+  t_vector /= static_cast<double>(repeat);
+  t_solve /= static_cast<double>(repeat);
+  t_update /= static_cast<double>(repeat);
+
+  if (world.rank() == 0) {
+    printf("\nResistor grid benchmark (%s scaling)\n",weak ? "weak" : "strong");
+    printf("  Processes:         %d\n",world.size());
+    printf("  Grid:              %d x %d (%ld buses, %ld branches)\n",
+        ncols,nrows,generator.numBuses(),generator.numBranches());
+    printf("  Build:             %12.6f s\n",t_build);
+    printf("  Partition:         %12.6f s\n",t_partition);
+    printf("  Components:        %12.6f s\n",t_setup);
+    printf("  mapToMatrix:       %12.6f s\n",t_matrix);
+    printf("  mapToVector:       %12.6f s\n",t_vector);
+    printf("  LinearSolver:      %12.6f s\n",t_solve);
+    printf("  updateBuses:       %12.6f s\n",t_update);
+    FILE *fp = fopen(outfile.c_str(),"r");
+    bool header = (fp == NULL);
+    if (fp) fclose(fp);
+    fp = fopen(outfile.c_str(),"a");
+    if (fp) {
+      if (header) {
+        fprintf(fp,"mode,nprocs,ncols,nrows,nbus,build,partition,"
+            "components,matrix,vector,solve,update\n");
+      }
+      fprintf(fp,"%s,%d,%d,%d,%ld,%e,%e,%e,%e,%e,%e,%e\n",
+          weak ? "weak" : "strong",world.size(),ncols,nrows,
+          generator.numBuses(),t_build,t_partition,t_setup,t_matrix,
+          t_vector,t_solve,t_update);
+      fclose(fp);
+    }
+  }
+  return 0;
+}
@@ -27,6 +27,8 @@ gridpack::resistor_grid::RGBus::RGBus(void)
 {
   p_lead = false;
   p_v = 0.0;
+  p_voltage = NULL;
+  p_diag = 0.0;
 }
 
 /**
@@ -73,6 +75,33 @@ double gridpack::resistor_grid::RGBus::voltage() const
   return *p_voltage;
 }
 
+/**
+ * Build the typed list of neighbors used by matrix and vector assembly.
+ * Must be called after setNeighborCache has been called on the attached
+ * branches
+ */
+void gridpack::resistor_grid::RGBus::setNeighborCache(void)
+{
+  p_diag = 0.0;
+  p_lead_buses.clear();
+  p_lead_conductance.clear();
+  std::vector<boost::shared_ptr<BaseComponent> > branches;
+  getNeighborBranches(branches);
+  int size = branches.size();
+  int i;
+  for (i=0; i<size; i++) {
+    gridpack::resistor_grid::RGBranch *branch
+      = dynamic_cast<gridpack::resistor_grid::RGBranch*>(branches[i].get());
+    double g = 1.0/branch->resistance();
+    p_diag += g;
+    const gridpack::resistor_grid::RGBus *bus = branch->otherBus(this);
+    if (bus && bus->isLead()) {
+      p_lead_buses.push_back(bus);
+      p_lead_conductance.push_back(g);
+    }
+  }
+}
+
 /**
  * Return size of matrix block on the diagonal contributed by component
  * @param isize, jsize: number of rows and columns of matrix block
@@ -100,17 +129,7 @@ bool gridpack::resistor_grid::RGBus::matrixDiagSize(int *isize, int *jsize) cons
 bool gridpack::resistor_grid::RGBus::matrixDiagValues(ComplexType *values)
 {
   if (!p_lead) {
-    gridpack::ComplexType ret(0.0,0.0);
-    std::vector<boost::shared_ptr<BaseComponent> > branches;
-    getNeighborBranches(branches);
-    int size = branches.size();
-    int i;
-    for (i=0; i<size; i++) {
-      gridpack::resistor_grid::RGBranch *branch
-        = dynamic_cast<gridpack::resistor_grid::RGBranch*>(branches[i].get());
-      ret += 1.0/branch->resistance();
-    }
-    values[0] = ret;
+    values[0] = gridpack::ComplexType(p_diag,0.0);
     return true;
   } else {
     return false;
@@ -142,25 +161,13 @@ bool gridpack::resistor_grid::RGBus::vectorSize(int *isize) const
 bool gridpack::resistor_grid::RGBus::vectorValues(ComplexType *values)
 {
   if (!p_lead) {
-    std::vector<boost::shared_ptr<BaseComponent> > branches;
-    getNeighborBranches(branches);
-    int size = branches.size();
+    int size = p_lead_buses.size();
     int i;
-    gridpack::ComplexType ret(0.0,0.0);
+    double ret = 0.0;
     for (i=0; i<size; i++) {
-      gridpack::resistor_grid::RGBranch *branch
-        = dynamic_cast<gridpack::resistor_grid::RGBranch*>(branches[i].get());
-      gridpack::resistor_grid::RGBus *bus1
-        = dynamic_cast<gridpack::resistor_grid::RGBus*>(branch->getBus1().get());
-      gridpack::resistor_grid::RGBus *bus2
-        = dynamic_cast<gridpack::resistor_grid::RGBus*>(branch->getBus2().get());
-      if (bus1 != this && bus1->isLead()) {
-        ret += bus1->voltage()/branch->resistance();
-      } else if (bus2 != this && bus2->isLead()) {
-        ret += bus2->voltage()/branch->resistance();
-      }
+      ret += p_lead_buses[i]->voltage()*p_lead_conductance[i];
     }
-    values[0] = ret;
+    values[0] = gridpack::ComplexType(ret,0.0);
     return true;
   } else {
     return false;
@@ -223,6 +230,10 @@ void gridpack::resistor_grid::RGBus::setXCBuf(void *buf)
 gridpack::resistor_grid::RGBranch::RGBranch(void)
 {
   p_resistance = 0.0;
+  p_conductance = 0.0;
+  p_bus1 = NULL;
+  p_bus2 = NULL;
+  p_active = false;
 }
 
 /**
@@ -255,6 +266,39 @@ double gridpack::resistor_grid::RGBranch::resistance(void) const
   return p_resistance;
 }
 
+/**
+ * Return conductance (1/R) of this branch
+ * @return conductance
+ */
+double gridpack::resistor_grid::RGBranch::conductance(void) const
+{
+  return p_conductance;
+}
+
+/**
+ * Cache typed pointers to the buses at both ends of the branch. Must be
+ * called after the factory has set the components
+ */
+void gridpack::resistor_grid::RGBranch::setNeighborCache(void)
+{
+  p_bus1 = dynamic_cast<gridpack::resistor_grid::RGBus*>(getBus1().get());
+  p_bus2 = dynamic_cast<gridpack::resistor_grid::RGBus*>(getBus2().get());
+  p_conductance = 1.0/p_resistance;
+  p_active = !p_bus1->isLead() && !p_bus2->isLead();
+}
+
+/**
+ * Return the bus at the other end of the branch. Requires that
+ * setNeighborCache has been called on the branch
+ * @param bus bus at one end of the branch
+ * @return bus at the other end
+ */
+const gridpack::resistor_grid::RGBus*
+  gridpack::resistor_grid::RGBranch::otherBus(const RGBus *bus) const
+{
+  return p_bus1 != bus ? p_bus1 : p_bus2;
+}
+
 /**
  * Return size of off-diagonal matrix block contributed by the component
  * for the forward/reverse directions
@@ -263,11 +307,7 @@ double gridpack::resistor_grid::RGBranch::resistance(void) const
  */
 bool gridpack::resistor_grid::RGBranch::matrixForwardSize(int *isize, int *jsize) const
 {
-  gridpack::resistor_grid::RGBus *bus1
-    = dynamic_cast<gridpack::resistor_grid::RGBus*>(getBus1().get());
-  gridpack::resistor_grid::RGBus *bus2
-    = dynamic_cast<gridpack::resistor_grid::RGBus*>(getBus2().get());
-  if (!bus1->isLead() && !bus2->isLead()) {
+  if (p_active) {
     *isize = 1;
     *jsize = 1;
     return true;
@@ -278,11 +318,7 @@ bool gridpack::resistor_grid::RGBranch::matrixForwardSize(int *isize, int *jsize
 
 bool gridpack::resistor_grid::RGBranch::matrixReverseSize(int *isize, int *jsize) const
 {
-  gridpack::resistor_grid::RGBus *bus1
-    = dynamic_cast<gridpack::resistor_grid::RGBus*>(getBus1().get());
-  gridpack::resistor_grid::RGBus *bus2
-    = dynamic_cast<gridpack::resistor_grid::RGBus*>(getBus2().get());
-  if (!bus1->isLead() && !bus2->isLead()) {
+  if (p_active) {
     *isize = 1;
     *jsize = 1;
     return true;
@@ -299,12 +335,8 @@ bool gridpack::resistor_grid::RGBranch::matrixReverseSize(int *isize, int *jsize
  */
 bool gridpack::resistor_grid::RGBranch::matrixForwardValues(ComplexType *values)
 {
-  gridpack::resistor_grid::RGBus *bus1
-    = dynamic_cast<gridpack::resistor_grid::RGBus*>(getBus1().get());
-  gridpack::resistor_grid::RGBus *bus2
-    = dynamic_cast<gridpack::resistor_grid::RGBus*>(getBus2().get());
-  if (!bus1->isLead() && !bus2->isLead()) {
-    values[0] = -1.0/p_resistance;
+  if (p_active) {
+    values[0] = -p_conductance;
     return true;
   } else {
     return false;
@@ -313,12 +345,8 @@ bool gridpack::resistor_grid::RGBranch::matrixForwardValues(ComplexType *values)
 
 bool gridpack::resistor_grid::RGBranch::matrixReverseValues(ComplexType *values)
 {
-  gridpack::resistor_grid::RGBus *bus1
-    = dynamic_cast<gridpack::resistor_grid::RGBus*>(getBus1().get());
-  gridpack::resistor_grid::RGBus *bus2
-    = dynamic_cast<gridpack::resistor_grid::RGBus*>(getBus2().get());
-  if (!bus1->isLead() && !bus2->isLead()) {
-    values[0] = -1.0/p_resistance;
+  if (p_active) {
+    values[0] = -p_conductance;
     return true;
   } else {
     return false;
@@ -336,15 +364,10 @@ bool gridpack::resistor_grid::RGBranch::matrixReverseValues(ComplexType *values)
 bool gridpack::resistor_grid::RGBranch::serialWrite(char *string, const int
     bufsize,  const char *signal)
 {
-
-  gridpack::resistor_grid::RGBus *bus1
-    = dynamic_cast<gridpack::resistor_grid::RGBus*>(getBus1().get());
-  gridpack::resistor_grid::RGBus *bus2
-    = dynamic_cast<gridpack::resistor_grid::RGBus*>(getBus2().get());
-  double v1 = bus1->voltage();
-  double v2 = bus2->voltage();
-  double icur = (v1 - v2)/p_resistance;
+  double v1 = p_bus1->voltage();
+  double v2 = p_bus2->voltage();
+  double icur = (v1 - v2)*p_conductance;
   sprintf(string,"Current on line from bus %d to %d is: %12.6f\n",
-      bus1->getOriginalIndex(),bus2->getOriginalIndex(),icur);
+      p_bus1->getOriginalIndex(),p_bus2->getOriginalIndex(),icur);
   return true;
 }
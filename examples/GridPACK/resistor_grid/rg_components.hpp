@@ -24,6 +24,8 @@
 namespace gridpack {
 namespace resistor_grid {
 
+class RGBranch;
+
 class RGBus
   : public gridpack::component::BaseBusComponent {
   public:
@@ -58,6 +60,13 @@ class RGBus
      */
     double voltage() const;
 
+    /**
+     * Build the typed list of neighbors used by matrix and vector assembly.
+     * Must be called after setNeighborCache has been called on the attached
+     * branches
+     */
+    void setNeighborCache(void);
+
     /**
      * Return size of matrix block on the diagonal contributed by component
      * @param isize, jsize: number of rows and columns of matrix block
@@ -123,6 +132,14 @@ class RGBus
     double *p_voltage;
     double p_v;
 
+    // Cached adjacency: sum of the conductances of all attached branches
+    // and the lead buses attached to this bus with the conductance of the
+    // connecting branch. These are not serialized and are rebuilt by
+    // setNeighborCache
+    double p_diag;
+    std::vector<const RGBus*> p_lead_buses;
+    std::vector<double> p_lead_conductance;
+
   friend class boost::serialization::access;
 
   template<class Archive>
@@ -162,6 +179,26 @@ class RGBranch
      */
     double resistance(void) const;
 
+    /**
+     * Return conductance (1/R) of this branch
+     * @return conductance
+     */
+    double conductance(void) const;
+
+    /**
+     * Cache typed pointers to the buses at both ends of the branch. Must be
+     * called after the factory has set the components
+     */
+    void setNeighborCache(void);
+
+    /**
+     * Return the bus at the other end of the branch. Requires that
+     * setNeighborCache has been called on the branch
+     * @param bus bus at one end of the branch
+     * @return bus at the other end
+     */
+    const RGBus* otherBus(const RGBus *bus) const;
+
     /**
      * Return size of off-diagonal matrix block contributed by the component
      * for the forward/reverse directions
@@ -193,6 +230,12 @@ class RGBranch
   private:
     double p_resistance;
 
+    // Cached values, rebuilt by setNeighborCache
+    double p_conductance;
+    const RGBus *p_bus1;
+    const RGBus *p_bus2;
+    bool p_active;
+
   friend class boost::serialization::access;
 
   template<class Archive>
@@ -23,7 +23,8 @@
 namespace gridpack {
 namespace resistor_grid {
 
-// This example only needs the functionality in the base factory class
+// Apart from the cached adjacency, this example only needs the
+// functionality in the base factory class
 
 class RGFactory
   : public gridpack::factory::BaseFactory<RGNetwork> {
@@ -41,6 +42,25 @@ class RGFactory
      * Basic destructor
      */
     ~RGFactory() {}
+
+    /**
+     * Cache the typed neighbors and conductances of all components so that
+     * matrix and vector assembly do not allocate or cast. Call after
+     * setComponents
+     */
+    void setNeighborCache(void)
+    {
+      int nbranch = p_network->numBranches();
+      int nbus = p_network->numBuses();
+      int i;
+      // Buses use the cached end points of the branches
+      for (i=0; i<nbranch; i++) {
+        p_network->getBranch(i)->setNeighborCache();
+      }
+      for (i=0; i<nbus; i++) {
+        p_network->getBus(i)->setNeighborCache();
+      }
+    }
 };
 
 } // resistor_grid
@@ -0,0 +1,155 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   rg_generator.hpp
+ *
+ * @brief  Synthetic N x M resistor grids built directly in memory, without
+ *         writing and parsing a PTI file.
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _rg_generator_h_
+#define _rg_generator_h_
+
+#include "rg_components.hpp"
+
+namespace gridpack {
+namespace resistor_grid {
+
+// Builds the same grid as rg_grid.F90: buses are numbered row by row
+// starting at 1, the first and last bus are leads at +1 and -1 V and every
+// neighboring pair of buses in a row or column is connected by a resistor.
+// Each process adds a block of rows, together with the branches inside the
+// rows and the branches that connect them to the previous row, so no
+// process ever holds the complete grid before the network is partitioned.
+class RGGridGenerator
+{
+  public:
+    /**
+     * Basic constructor
+     * @param ncols number of buses in each row
+     * @param nrows number of rows
+     * @param resistance resistance of each branch
+     */
+    RGGridGenerator(int ncols, int nrows, double resistance = 0.05)
+    {
+      p_ncols = ncols;
+      p_nrows = nrows;
+      p_resistance = resistance;
+    }
+
+    /**
+     * Basic destructor
+     */
+    ~RGGridGenerator() {}
+
+    /**
+     * Total number of buses in the grid
+     * @return number of buses
+     */
+    long numBuses(void) const
+    {
+      return static_cast<long>(p_ncols)*static_cast<long>(p_nrows);
+    }
+
+    /**
+     * Total number of branches in the grid
+     * @return number of branches
+     */
+    long numBranches(void) const
+    {
+      return static_cast<long>(p_ncols-1)*p_nrows
+        + static_cast<long>(p_ncols)*(p_nrows-1);
+    }
+
+    /**
+     * Add the buses and branches of this process to an empty network. The
+     * network still needs to be partitioned
+     * @param network network that is filled
+     */
+    void build(boost::shared_ptr<RGNetwork> network)
+    {
+      const gridpack::parallel::Communicator &comm = network->communicator();
+      int nprocs = comm.size();
+      int me = comm.rank();
+      // Block of rows owned by this process
+      int jlo = static_cast<int>(static_cast<long>(p_nrows)*me/nprocs);
+      int jhi = static_cast<int>(static_cast<long>(p_nrows)*(me+1)/nprocs);
+      int nbus = p_ncols*p_nrows;
+      int i, j;
+      int nlocal = 0;
+      for (j=jlo; j<jhi; j++) {
+        for (i=0; i<p_ncols; i++) {
+          int n = j*p_ncols+i+1;
+          network->addBus(n);
+          network->setGlobalBusIndex(nlocal,n-1);
+          boost::shared_ptr<gridpack::component::DataCollection>
+            data = network->getBusData(nlocal);
+          data->addValue(BUS_NUMBER,n);
+          double kv = 0.0;
+          if (n == 1) kv = 1.0;
+          if (n == nbus) kv = -1.0;
+          data->addValue(BUS_TYPE,(n == 1 || n == nbus) ? 2 : 1);
+          data->addValue(BUS_BASEKV,kv);
+          nlocal++;
+        }
+      }
+      // Branches in a row are numbered first, then the branches between
+      // rows, in the same order as rg_grid.F90
+      int nhoriz = (p_ncols-1)*p_nrows;
+      nlocal = 0;
+      for (j=jlo; j<jhi; j++) {
+        for (i=1; i<p_ncols; i++) {
+          addBranch(network, nlocal, j*(p_ncols-1)+i-1, j*p_ncols+i,
+              j*p_ncols+i+1);
+          nlocal++;
+        }
+      }
+      for (j=jlo; j<jhi; j++) {
+        if (j == 0) continue;
+        for (i=0; i<p_ncols; i++) {
+          addBranch(network, nlocal, nhoriz+(j-1)*p_ncols+i,
+              (j-1)*p_ncols+i+1, j*p_ncols+i+1);
+          nlocal++;
+        }
+      }
+    }
+
+  private:
+
+    /**
+     * Add a single branch
+     * @param network network that is filled
+     * @param lidx local index of branch
+     * @param gidx global index of branch
+     * @param from original index of from bus
+     * @param to original index of to bus
+     */
+    void addBranch(boost::shared_ptr<RGNetwork> network, int lidx, int gidx,
+        int from, int to)
+    {
+      network->addBranch(from,to);
+      network->setGlobalBranchIndex(lidx,gidx);
+      boost::shared_ptr<gridpack::component::DataCollection>
+        data = network->getBranchData(lidx);
+      data->addValue(BRANCH_FROMBUS,from);
+      data->addValue(BRANCH_TOBUS,to);
+      data->addValue(BRANCH_NUM_ELEMENTS,1);
+      data->addValue(BRANCH_R,p_resistance,0);
+      data->addValue(BRANCH_CKT,std::string("BL"),0);
+    }
+
+    int p_ncols;
+    int p_nrows;
+    double p_resistance;
+};
+
+} // resistor_grid
+} // gridpack
+#endif
@@ -0,0 +1,34 @@
+#!/bin/sh
+#
+#     Copyright (c) 2013 Battelle Memorial Institute
+#     Licensed under modified BSD License. A copy of this license can be
+#     found
+#     in the LICENSE file in the top level directory of this distribution.
+#
+# -------------------------------------------------------------
+# file: rg_scaling.sh
+# -------------------------------------------------------------
+# Strong and weak scaling runs of rg_bench.x. Results are appended to
+# rg_scaling.csv, one line per run.
+#
+#   rg_scaling.sh [ncols] [nrows] [weak_rows]
+#
+# The strong scaling runs use an ncols x nrows grid (default 1000 x 1000),
+# the weak scaling runs use weak_rows rows per process (default 250). The
+# process counts are taken from RG_PROCS (default "1 2 4 8") and the MPI
+# launcher from MPIEXEC (default mpiexec).
+# -------------------------------------------------------------
+
+ncols=${1:-1000}
+nrows=${2:-1000}
+weak_rows=${3:-250}
+procs=${RG_PROCS:-"1 2 4 8"}
+mpiexec=${MPIEXEC:-mpiexec}
+bench=${RG_BENCH:-./rg_bench.x}
+
+for np in $procs; do
+  $mpiexec -n $np $bench $ncols $nrows || exit 1
+done
+for np in $procs; do
+  $mpiexec -n $np $bench -weak $ncols $weak_rows || exit 1
+done
@@ -14,24 +14,92 @@
 // -------------------------------------------------------------
 
 #include "mpi.h"
-#include <ga.h>
-#include <macdecls.h>
+#include <cmath>
 #include "gridpack/include/gridpack.hpp"
+#include "gridpack_runtime.hpp"
+#include "se_measurement_stream.hpp"
+#include "se_stream_estimator.hpp"
+
+// Compare the ways of finding the Gauss-Newton correction in the
+// streaming estimator, on the first scan of the stream, with the state
+// estimation module on the measurement list. Every method starts from the
+// voltages in the network configuration file
+void run_benchmark(
+    boost::shared_ptr<gridpack::state_estimation::SENetwork> network,
+    gridpack::state_estimation::SEAppModule &se_app,
+    gridpack::utility::Configuration::CursorPtr cursor,
+    gridpack::utility::Configuration::CursorPtr scursor)
+{
+  gridpack::parallel::Communicator comm = network->communicator();
+  gridpack::state_estimation::SEMeasurementStream stream(comm);
+  std::vector<gridpack::state_estimation::SEStreamRecord> scan;
+  double time = 0.0;
+  bool ok = stream.open(scursor);
+  if (ok) ok = stream.nextScan(scan,time);
+  stream.close();
+  if (!ok) {
+    if (comm.rank() == 0) printf("No scan available for the benchmark\n");
+    return;
+  }
+  const char *names[3] = {"product","direct","orthogonal"};
+  std::vector<double> x0, x;
+  if (comm.rank() == 0) {
+    printf("\nGain matrix benchmark, %d measurements on %d processes\n",
+        static_cast<int>(scan.size()),comm.size());
+    printf("   Method        Iterations   Objective     Assemble (s)"
+        "  Solve (s)     Total (s)     Max diff\n");
+  }
+  int m;
+  for (m=0; m<3; m++) {
+    gridpack::state_estimation::SEStreamEstimator estimator(network,
+        cursor, scursor);
+    estimator.setMethod(m);
+    comm.barrier();
+    double t_start = MPI_Wtime();
+    estimator.update(scan);
+    bool converged = estimator.solve();
+    double t_total = MPI_Wtime()-t_start;
+    comm.max(&t_total,1);
+    int nmeas, nupdated, nadded, nremoved, iterations;
+    double objective, t_assemble, t_solve;
+    estimator.getStats(nmeas,nupdated,nadded,nremoved,iterations,objective);
+    estimator.getTimings(t_assemble,t_solve);
+    // Difference from the estimate of the product method
+    estimator.getState(x);
+    if (m == 0) x0 = x;
+    double dmax = 0.0;
+    int i;
+    for (i=0; i<x.size(); i++) {
+      if (fabs(x[i]-x0[i]) > dmax) dmax = fabs(x[i]-x0[i]);
+    }
+    if (comm.rank() == 0) {
+      printf("   %-12s  %4d%s      %12.5e  %12.5e  %12.5e  %12.5e  %12.5e\n",
+          names[m],iterations,converged ? " " : "*",objective,t_assemble,
+          t_solve,t_total,dmax);
+    }
+  }
+  comm.barrier();
+  double t_start = MPI_Wtime();
+  se_app.initialize();
+  se_app.readMeasurements();
+  se_app.solve();
+  double t_total = MPI_Wtime()-t_start;
+  comm.max(&t_total,1);
+  if (comm.rank() == 0) {
+    printf("   %-12s                                                "
+        "          %12.5e\n","module",t_total);
+    printf("   * not converged\n");
+  }
+}
 
 // Calling program for the state estimation application
 
 int
 main(int argc, char **argv)
 {
-  // Initialize MPI libraries
-  int ierr = MPI_Init(&argc, &argv);
-
-  GA_Initialize();
-  int stack = 200000, heap = 200000;
-  MA_init(C_DBL, stack, heap);
-
-  // Intialize Math libraries
-  gridpack::math::Initialize(&argc,&argv);
+  // Initialize MPI and GA libraries. MA is sized from the network and the
+  // math libraries are started before the first solver is set up
+  gridpack::Runtime runtime(argc, argv);
 
   if (1) {
     gridpack::parallel::Communicator world;
@@ -46,6 +114,9 @@ main(int argc, char **argv)
     } else {
       config->open("input.xml",world);
     }
+    if (!runtime.setMemory(config,"Configuration.State_estimation")) {
+      return 1;
+    }
 
     // setup and run state estimation calculation
     boost::shared_ptr<gridpack::state_estimation::SENetwork>
@@ -53,17 +124,75 @@ main(int argc, char **argv)
 
     gridpack::state_estimation::SEAppModule se_app;
     se_app.readNetwork(se_network,config);
-    se_app.initialize();
-    se_app.readMeasurements();
-    se_app.solve();
-    se_app.write();
-  }
-
-  GA_Terminate();
+    runtime.startMath();
+    runtime.report("State estimation");
 
-  // Terminate Math libraries
-  gridpack::math::Finalize();
-  // Clean up MPI libraries
-  ierr = MPI_Finalize();
+    // In streaming mode the measurements arrive in scans from the source in
+    // the Streaming block and the state is estimated after every scan,
+    // starting from the previous estimate
+    gridpack::utility::Configuration::CursorPtr cursor, scursor;
+    cursor = config->getCursor("Configuration.State_estimation");
+    scursor = cursor->getCursor("Streaming");
+    bool streaming = false;
+    bool benchmark = false;
+    if (scursor) {
+      streaming = scursor->get("enable",streaming);
+      benchmark = scursor->get("benchmark",benchmark);
+    }
+    if (benchmark) {
+      run_benchmark(se_network,se_app,cursor,scursor);
+    } else if (!streaming) {
+      se_app.initialize();
+      se_app.readMeasurements();
+      se_app.solve();
+      se_app.write();
+    } else {
+      gridpack::state_estimation::SEStreamEstimator estimator(se_network,
+          cursor, scursor);
+      gridpack::state_estimation::SEMeasurementStream stream(world);
+      std::string stats_file;
+      scursor->get("statisticsFile",&stats_file);
+      FILE *fp = NULL;
+      if (world.rank() == 0 && !stats_file.empty()) {
+        gridpack::utility::StringUtils util;
+        util.trim(stats_file);
+        fp = fopen(stats_file.c_str(),"w");
+        if (fp) {
+          fprintf(fp,"time,measurements,updated,added,removed,iterations,"
+              "objective,converged,seconds\n");
+        }
+      }
+      if (stream.open(scursor)) {
+        std::vector<gridpack::state_estimation::SEStreamRecord> scan;
+        double time;
+        while (stream.nextScan(scan,time)) {
+          double t_start = MPI_Wtime();
+          estimator.update(scan);
+          bool converged = estimator.solve();
+          double t_scan = MPI_Wtime()-t_start;
+          world.max(&t_scan,1);
+          int nmeas, nupdated, nadded, nremoved, iterations;
+          double objective;
+          estimator.getStats(nmeas,nupdated,nadded,nremoved,iterations,
+              objective);
+          if (world.rank() == 0) {
+            printf("Scan at %g: %d measurements (%d updated, %d added,"
+                " %d removed) %d iterations J = %g %s %f s\n",time,nmeas,
+                nupdated,nadded,nremoved,iterations,objective,
+                converged ? "converged" : "not converged",t_scan);
+            if (fp) {
+              fprintf(fp,"%g,%d,%d,%d,%d,%d,%e,%d,%e\n",time,nmeas,nupdated,
+                  nadded,nremoved,iterations,objective,converged ? 1 : 0,
+                  t_scan);
+            }
+          }
+        }
+        stream.close();
+      }
+      if (fp) fclose(fp);
+      estimator.write();
+    }
+  }
+  return 0;
 }
 
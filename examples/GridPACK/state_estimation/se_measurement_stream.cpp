@@ -0,0 +1,401 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   se_measurement_stream.cpp
+ *
+ * @brief  Measurement scans for streaming state estimation
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "se_measurement_stream.hpp"
+
+namespace {
+
+// Measurement types in the packed scans
+const char *se_types[] = {"VM","VA","PI","QI","PIJ","QIJ"};
+const int se_ntypes = 6;
+
+int typeCode(const std::string &type)
+{
+  int i;
+  for (i=0; i<se_ntypes; i++) {
+    if (type == se_types[i]) return i;
+  }
+  return -1;
+}
+
+}
+
+/**
+ * Basic constructor
+ * @param comm communicator of the state estimation network
+ */
+gridpack::state_estimation::SEMeasurementStream::SEMeasurementStream(
+    const gridpack::parallel::Communicator &comm)
+  : p_comm(comm)
+{
+  p_file = NULL;
+  p_listen = -1;
+  p_socket = -1;
+  p_nscans = 0;
+#ifdef SE_USE_HELICS
+  p_time = 0.0;
+  p_period = 1.0;
+  p_end_time = 3600.0;
+#endif
+}
+
+/**
+ * Basic destructor
+ */
+gridpack::state_estimation::SEMeasurementStream::~SEMeasurementStream(void)
+{
+  close();
+}
+
+/**
+ * Open the source described by the Streaming block
+ * @param cursor pointer to Streaming block
+ * @return false if the source could not be opened
+ */
+bool gridpack::state_estimation::SEMeasurementStream::open(
+    gridpack::utility::Configuration::CursorPtr cursor)
+{
+  gridpack::utility::StringUtils util;
+  p_source = "file";
+  cursor->get("source",&p_source);
+  util.trim(p_source);
+  util.toLower(p_source);
+  // Only process 0 opens the source, all other processes contribute zero
+  int ok = 0;
+  if (p_comm.rank() == 0) {
+    ok = 1;
+    if (p_source == "file") {
+      std::string filename;
+      cursor->get("scanFile",&filename);
+      util.trim(filename);
+      p_file = fopen(filename.c_str(),"r");
+      if (!p_file) {
+        printf("Unable to open scan file %s\n",filename.c_str());
+        ok = 0;
+      }
+    } else if (p_source == "socket") {
+      // Wait for a single client. The client pushes scans until it closes
+      // the connection
+      int port = cursor->get("port",5555);
+      p_listen = socket(AF_INET, SOCK_STREAM, 0);
+      int on = 1;
+      struct sockaddr_in addr;
+      memset(&addr,0,sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      addr.sin_port = htons(port);
+      if (p_listen < 0 ||
+          setsockopt(p_listen,SOL_SOCKET,SO_REUSEADDR,&on,sizeof(on)) != 0 ||
+          bind(p_listen,(struct sockaddr*)&addr,sizeof(addr)) != 0 ||
+          listen(p_listen,1) != 0) {
+        printf("Unable to listen on port %d: %s\n",port,strerror(errno));
+        ok = 0;
+      } else {
+        printf("Waiting for measurements on port %d\n",port);
+        p_socket = accept(p_listen,NULL,NULL);
+        if (p_socket < 0) {
+          printf("Unable to accept connection: %s\n",strerror(errno));
+          ok = 0;
+        }
+      }
+    } else if (p_source == "helics") {
+#ifdef SE_USE_HELICS
+      std::string name = "gridpack_se";
+      cursor->get("federateName",&name);
+      std::string key;
+      cursor->get("subscription",&key);
+      std::string core_init;
+      cursor->get("coreInit",&core_init);
+      util.trim(name);
+      util.trim(key);
+      p_period = cursor->get("period",p_period);
+      p_end_time = cursor->get("endTime",p_end_time);
+      helics::FederateInfo fi;
+      fi.coreType = helics::CoreType::ZMQ;
+      fi.coreInitString = core_init;
+      const char* env_addr = std::getenv("HELICS_BROKER_ADDRESS");
+      if (env_addr && strlen(env_addr) > 0) {
+        fi.coreInitString += std::string(" --broker_address=") + env_addr;
+      }
+      fi.setProperty(HELICS_PROPERTY_TIME_PERIOD,p_period);
+      fi.setFlagOption(HELICS_FLAG_UNINTERRUPTIBLE, false);
+      fi.setFlagOption(HELICS_FLAG_TERMINATE_ON_ERROR, true);
+      p_fed.reset(new helics::ValueFederate(name,fi));
+      p_input = p_fed->registerSubscription(key);
+      p_fed->enterExecutingMode();
+      printf("Subscribed to measurements from %s\n",key.c_str());
+#else
+      printf("HELICS measurement source requires SE_USE_HELICS\n");
+      ok = 0;
+#endif
+    } else {
+      printf("Unknown measurement source %s\n",p_source.c_str());
+      ok = 0;
+    }
+  }
+  p_comm.sum(&ok,1);
+  return (ok > 0);
+}
+
+/**
+ * Wait for the next scan. Collective on the communicator
+ * @param scan measurements in the scan
+ * @param time time of the scan
+ * @return false if the stream has ended
+ */
+bool gridpack::state_estimation::SEMeasurementStream::nextScan(
+    std::vector<SEStreamRecord> &scan, double &time)
+{
+  std::vector<int> ibuf;
+  std::vector<double> dbuf;
+  // Sizes of the packed scan and scan time, the sizes are -1 at the end of
+  // the stream
+  int sizes[2] = {0, 0};
+  double t = 0.0;
+  if (p_comm.rank() == 0) {
+    if (readScan(scan, t)) {
+      pack(scan, ibuf, dbuf);
+      sizes[0] = ibuf.size();
+      sizes[1] = dbuf.size();
+    } else {
+      sizes[0] = -1;
+      sizes[1] = -1;
+    }
+  }
+  // Broadcast from process 0, all other processes contribute zeros
+  p_comm.sum(sizes,2);
+  p_comm.sum(&t,1);
+  if (sizes[0] < 0) return false;
+  if (p_comm.rank() != 0) {
+    ibuf.resize(sizes[0],0);
+    dbuf.resize(sizes[1],0.0);
+  }
+  if (sizes[0] > 0) p_comm.sum(&ibuf[0],sizes[0]);
+  if (sizes[1] > 0) p_comm.sum(&dbuf[0],sizes[1]);
+  if (p_comm.rank() != 0) unpack(ibuf, dbuf, scan);
+  time = t;
+  p_nscans++;
+  return true;
+}
+
+/**
+ * Close the source
+ */
+void gridpack::state_estimation::SEMeasurementStream::close(void)
+{
+  if (p_file) fclose(p_file);
+  p_file = NULL;
+  if (p_socket >= 0) ::close(p_socket);
+  if (p_listen >= 0) ::close(p_listen);
+  p_socket = -1;
+  p_listen = -1;
+#ifdef SE_USE_HELICS
+  if (p_fed) {
+    p_fed->finalize();
+    p_fed.reset();
+  }
+#endif
+}
+
+/**
+ * Parse a single measurement
+ * @param line comma separated fields
+ * @param record parsed measurement
+ * @return false if the line is not a valid measurement
+ */
+bool gridpack::state_estimation::SEMeasurementStream::parse(
+    const std::string &line, SEStreamRecord &record)
+{
+  gridpack::utility::StringUtils util;
+  std::vector<std::string> tokens = util.charTokenizer(line,",");
+  int i;
+  for (i=0; i<tokens.size(); i++) util.trim(tokens[i]);
+  if (tokens.size() < 4) return false;
+  record.p_type = tokens[0];
+  int code = typeCode(record.p_type);
+  if (code < 0) return false;
+  bool branch = (record.p_type == "PIJ" || record.p_type == "QIJ");
+  if (branch) {
+    if (tokens.size() != 6) return false;
+    record.p_bus = atoi(tokens[1].c_str());
+    record.p_tbus = atoi(tokens[2].c_str());
+    record.p_ckt = util.clean2Char(tokens[3]);
+    record.p_value = atof(tokens[4].c_str());
+    record.p_deviation = atof(tokens[5].c_str());
+  } else {
+    if (tokens.size() != 4) return false;
+    record.p_bus = atoi(tokens[1].c_str());
+    record.p_tbus = -1;
+    record.p_ckt = "";
+    record.p_value = atof(tokens[2].c_str());
+    record.p_deviation = atof(tokens[3].c_str());
+  }
+  return true;
+}
+
+/**
+ * Read the next scan from the source on process 0
+ * @param scan measurements in the scan
+ * @param time time of the scan
+ * @return false if the stream has ended
+ */
+bool gridpack::state_estimation::SEMeasurementStream::readScan(
+    std::vector<SEStreamRecord> &scan, double &time)
+{
+  scan.clear();
+  time = static_cast<double>(p_nscans);
+  std::vector<std::string> lines;
+  if (p_source == "helics") {
+#ifdef SE_USE_HELICS
+    // Advance until a new scan has been published
+    while (p_time < p_end_time) {
+      p_time = p_fed->requestTime(p_time+p_period);
+      if (p_input.isUpdated()) break;
+    }
+    if (!p_input.isUpdated()) return false;
+    std::string value = p_input.getValue<std::string>();
+    time = p_time;
+    gridpack::utility::StringUtils util;
+    size_t i;
+    for (i=0; i<value.size(); i++) {
+      if (value[i] == ';') value[i] = '\n';
+    }
+    lines = util.charTokenizer(value,"\n");
+#else
+    return false;
+#endif
+  } else {
+    std::string line;
+    bool end = false;
+    while (readLine(line)) {
+      if (line.compare(0,3,"END") == 0) {
+        if (line.size() > 3) time = atof(line.c_str()+3);
+        end = true;
+        break;
+      }
+      lines.push_back(line);
+    }
+    // An incomplete scan at the end of the input is ignored
+    if (!end) return false;
+  }
+  int i;
+  for (i=0; i<lines.size(); i++) {
+    gridpack::utility::StringUtils util;
+    util.trim(lines[i]);
+    if (lines[i].empty() || lines[i][0] == '#') continue;
+    SEStreamRecord record;
+    if (parse(lines[i], record)) {
+      scan.push_back(record);
+    } else {
+      printf("Skipping malformed measurement: %s\n",lines[i].c_str());
+    }
+  }
+  return true;
+}
+
+/**
+ * Read a line from the file or socket
+ * @param line next line without the line terminator
+ * @return false at the end of the input
+ */
+bool gridpack::state_estimation::SEMeasurementStream::readLine(
+    std::string &line)
+{
+  if (p_file) {
+    char buf[1024];
+    if (!fgets(buf,sizeof(buf),p_file)) return false;
+    line = buf;
+  } else if (p_socket >= 0) {
+    // Lines may arrive split over several reads
+    size_t pos;
+    while ((pos = p_pending.find('\n')) == std::string::npos) {
+      char buf[4096];
+      ssize_t n = recv(p_socket,buf,sizeof(buf),0);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      p_pending.append(buf,n);
+    }
+    line = p_pending.substr(0,pos);
+    p_pending.erase(0,pos+1);
+  } else {
+    return false;
+  }
+  while (!line.empty() && (line[line.size()-1] == '\n' ||
+        line[line.size()-1] == '\r')) {
+    line.erase(line.size()-1);
+  }
+  return true;
+}
+
+/**
+ * Pack a scan into integer and double buffers
+ * @param scan measurements in the scan
+ * @param ibuf type, bus and circuit fields
+ * @param dbuf values and deviations
+ */
+void gridpack::state_estimation::SEMeasurementStream::pack(
+    const std::vector<SEStreamRecord> &scan, std::vector<int> &ibuf,
+    std::vector<double> &dbuf)
+{
+  ibuf.clear();
+  dbuf.clear();
+  ibuf.push_back(scan.size());
+  int i, j;
+  for (i=0; i<scan.size(); i++) {
+    const SEStreamRecord &record = scan[i];
+    ibuf.push_back(typeCode(record.p_type));
+    ibuf.push_back(record.p_bus);
+    ibuf.push_back(record.p_tbus);
+    ibuf.push_back(record.p_ckt.size());
+    for (j=0; j<record.p_ckt.size(); j++) ibuf.push_back(record.p_ckt[j]);
+    dbuf.push_back(record.p_value);
+    dbuf.push_back(record.p_deviation);
+  }
+}
+
+/**
+ * Unpack a scan
+ * @param ibuf type, bus and circuit fields
+ * @param dbuf values and deviations
+ * @param scan measurements in the scan
+ */
+void gridpack::state_estimation::SEMeasurementStream::unpack(
+    const std::vector<int> &ibuf, const std::vector<double> &dbuf,
+    std::vector<SEStreamRecord> &scan)
+{
+  scan.clear();
+  int pos = 0;
+  int n = ibuf[pos++];
+  scan.resize(n);
+  int i, j;
+  for (i=0; i<n; i++) {
+    SEStreamRecord &record = scan[i];
+    record.p_type = se_types[ibuf[pos++]];
+    record.p_bus = ibuf[pos++];
+    record.p_tbus = ibuf[pos++];
+    int len = ibuf[pos++];
+    record.p_ckt.resize(len);
+    for (j=0; j<len; j++) record.p_ckt[j] = static_cast<char>(ibuf[pos++]);
+    record.p_value = dbuf[2*i];
+    record.p_deviation = dbuf[2*i+1];
+  }
+}
@@ -0,0 +1,151 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   se_measurement_stream.hpp
+ *
+ * @brief  Measurement scans for streaming state estimation, read from a
+ *         file, a TCP socket or a HELICS subscription.
+ *
+ *  Each measurement is one line of comma separated fields
+ *
+ *    VM,bus,value,deviation
+ *    PI,bus,value,deviation      (also VA, QI)
+ *    PIJ,from,to,ckt,value,deviation  (also QIJ)
+ *
+ *  in the same units as the measurement XML files, with VA in degrees. A
+ *  deviation of zero or less removes the measurement from the estimator.
+ *  In files and on the socket a scan ends with a line "END [time]" and
+ *  lines starting with # are ignored. A HELICS value holds a
+ *  complete scan, with the measurements separated by newlines or
+ *  semicolons, and the scan time is the granted time.
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _se_measurement_stream_h_
+#define _se_measurement_stream_h_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "boost/smart_ptr/shared_ptr.hpp"
+#include "gridpack/include/gridpack.hpp"
+#ifdef SE_USE_HELICS
+#include <helics/application_api/ValueFederate.hpp>
+#endif
+
+namespace gridpack {
+namespace state_estimation {
+
+// A single value in a measurement scan
+struct SEStreamRecord {
+  std::string p_type;
+  int p_bus;     // bus ID of bus measurements, from bus of branch flows
+  int p_tbus;    // to bus of branch flows
+  std::string p_ckt;
+  double p_value;
+  double p_deviation;
+};
+
+// Only process 0 reads from the source. Each scan is packed and broadcast
+// to all processes, so every process sees the same sequence of scans.
+class SEMeasurementStream
+{
+  public:
+    /**
+     * Basic constructor
+     * @param comm communicator of the state estimation network
+     */
+    SEMeasurementStream(const gridpack::parallel::Communicator &comm);
+
+    /**
+     * Basic destructor
+     */
+    ~SEMeasurementStream(void);
+
+    /**
+     * Open the source described by the Streaming block
+     * @param cursor pointer to Streaming block
+     * @return false if the source could not be opened
+     */
+    bool open(gridpack::utility::Configuration::CursorPtr cursor);
+
+    /**
+     * Wait for the next scan. Collective on the communicator
+     * @param scan measurements in the scan
+     * @param time time of the scan
+     * @return false if the stream has ended
+     */
+    bool nextScan(std::vector<SEStreamRecord> &scan, double &time);
+
+    /**
+     * Close the source
+     */
+    void close(void);
+
+    /**
+     * Parse a single measurement
+     * @param line comma separated fields
+     * @param record parsed measurement
+     * @return false if the line is not a valid measurement
+     */
+    static bool parse(const std::string &line, SEStreamRecord &record);
+
+  private:
+
+    /**
+     * Read the next scan from the source on process 0
+     * @param scan measurements in the scan
+     * @param time time of the scan
+     * @return false if the stream has ended
+     */
+    bool readScan(std::vector<SEStreamRecord> &scan, double &time);
+
+    /**
+     * Read a line from the file or socket
+     * @param line next line without the line terminator
+     * @return false at the end of the input
+     */
+    bool readLine(std::string &line);
+
+    /**
+     * Pack a scan into integer and double buffers
+     * @param scan measurements in the scan
+     * @param ibuf type, bus and circuit fields
+     * @param dbuf values and deviations
+     */
+    void pack(const std::vector<SEStreamRecord> &scan, std::vector<int> &ibuf,
+        std::vector<double> &dbuf);
+
+    /**
+     * Unpack a scan
+     * @param ibuf type, bus and circuit fields
+     * @param dbuf values and deviations
+     * @param scan measurements in the scan
+     */
+    void unpack(const std::vector<int> &ibuf, const std::vector<double> &dbuf,
+        std::vector<SEStreamRecord> &scan);
+
+    gridpack::parallel::Communicator p_comm;
+    std::string p_source;
+    FILE *p_file;
+    int p_listen;
+    int p_socket;
+    std::string p_pending;
+    int p_nscans;
+#ifdef SE_USE_HELICS
+    boost::shared_ptr<helics::ValueFederate> p_fed;
+    helics::Input p_input;
+    double p_time;
+    double p_period;
+    double p_end_time;
+#endif
+};
+
+} // state_estimation
+} // gridpack
+#endif
@@ -0,0 +1,749 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   se_stream_estimator.cpp
+ *
+ * @brief  Weighted least squares state estimation on a stream of
+ *         measurement scans
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#include "mpi.h"
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include "se_stream_estimator.hpp"
+
+/**
+ * Basic constructor. The network must have been read and partitioned
+ * @param network state estimation network
+ * @param cursor pointer to State_estimation block (LinearSolver and
+ *        GainSolvers)
+ * @param scursor pointer to Streaming block
+ */
+gridpack::state_estimation::SEStreamEstimator::SEStreamEstimator(
+    boost::shared_ptr<SENetwork> network,
+    gridpack::utility::Configuration::CursorPtr cursor,
+    gridpack::utility::Configuration::CursorPtr scursor)
+  : p_comm(network->communicator())
+{
+  p_network = network;
+  p_max_iterations = scursor->get("maxIterations",10);
+  p_tolerance = scursor->get("tolerance",1.0e-5);
+  p_warm_start = scursor->get("warmStart",true);
+  p_ref_deviation = scursor->get("referenceDeviation",1.0e-4);
+  gridpack::utility::StringUtils util;
+  std::string method = "product";
+  scursor->get("gainMatrix",&method);
+  util.trim(method);
+  if (method == "direct") {
+    p_method = DIRECT;
+  } else if (method == "orthogonal") {
+    p_method = ORTHOGONAL;
+  } else {
+    p_method = PRODUCT;
+  }
+  // The product method uses the LinearSolver block of State_estimation,
+  // like the state estimation module. The other methods use the named
+  // presets in GainSolvers, if they exist
+  p_cursor = cursor;
+  std::string preset = "Cholesky";
+  scursor->get("gainSolver",&preset);
+  util.trim(preset);
+  p_gain_cursor = cursor->getCursor("GainSolvers."+preset);
+  if (!p_gain_cursor) p_gain_cursor = cursor;
+  preset = "LSQR";
+  scursor->get("orthogonalSolver",&preset);
+  util.trim(preset);
+  p_orthogonal_cursor = cursor->getCursor("GainSolvers."+preset);
+  if (!p_orthogonal_cursor) p_orthogonal_cursor = cursor;
+  p_t_assemble = 0.0;
+  p_t_solve = 0.0;
+  p_row_offset = 0;
+  p_total_rows = 0;
+  p_nupdated = 0;
+  p_nadded = 0;
+  p_nremoved = 0;
+  p_iterations = 0;
+  p_objective = 0.0;
+
+  // Starting state from the voltages in the network configuration file,
+  // broadcast by summing the contributions of the active buses
+  int nbus = p_network->numBuses();
+  p_nbus = p_network->totalBuses();
+  p_x0.assign(2*p_nbus,0.0);
+  p_orig.assign(p_nbus,0);
+  p_ref = -1;
+  double sbase = 0.0;
+  p_shunt.assign(2*nbus,0.0);
+  int i, j;
+  for (i=0; i<nbus; i++) {
+    gridpack::component::DataCollection *data =
+      p_network->getBusData(i).get();
+    data->getValue(CASE_SBASE,&sbase);
+    if (!p_network->getActiveBus(i)) continue;
+    int g = p_network->getGlobalBusIndex(i);
+    double vm = 1.0;
+    double va = 0.0;
+    int type = 1;
+    data->getValue(BUS_VOLTAGE_MAG,&vm);
+    data->getValue(BUS_VOLTAGE_ANG,&va);
+    data->getValue(BUS_TYPE,&type);
+    p_x0[2*g] = va*M_PI/180.0;
+    p_x0[2*g+1] = vm;
+    p_orig[g] = p_network->getOriginalBusIndex(i);
+    if (type == 3) p_ref = g;
+    p_local_bus.insert(std::pair<int,int>(p_orig[g],i));
+  }
+  p_comm.sum(&p_x0[0],2*p_nbus);
+  p_comm.sum(&p_orig[0],p_nbus);
+  p_comm.max(&sbase,1);
+  if (sbase <= 0.0) sbase = 100.0;
+  int ref = p_ref+1;
+  p_comm.max(&ref,1);
+  p_ref = ref-1;
+  p_x = p_x0;
+
+  // Bus shunts in per unit
+  for (i=0; i<nbus; i++) {
+    gridpack::component::DataCollection *data =
+      p_network->getBusData(i).get();
+    double gl = 0.0;
+    double bl = 0.0;
+    data->getValue(BUS_SHUNT_GL,&gl);
+    data->getValue(BUS_SHUNT_BL,&bl);
+    p_shunt[2*i] = gl/sbase;
+    p_shunt[2*i+1] = bl/sbase;
+  }
+
+  // Pi model of every in-service element of the local branches. Ghost
+  // branches are included because they are needed for the injections at
+  // the active buses
+  p_bus_elements.resize(nbus);
+  int nbranch = p_network->numBranches();
+  for (i=0; i<nbranch; i++) {
+    gridpack::component::DataCollection *data =
+      p_network->getBranchData(i).get();
+    int l1, l2;
+    p_network->getBranchEndpoints(i,&l1,&l2);
+    int nelem = 0;
+    data->getValue(BRANCH_NUM_ELEMENTS,&nelem);
+    for (j=0; j<nelem; j++) {
+      int status = 1;
+      double r = 0.0;
+      double x = 0.0;
+      double b = 0.0;
+      double tap = 0.0;
+      double shift = 0.0;
+      std::string ckt;
+      data->getValue(BRANCH_STATUS,&status,j);
+      data->getValue(BRANCH_R,&r,j);
+      data->getValue(BRANCH_X,&x,j);
+      data->getValue(BRANCH_B,&b,j);
+      data->getValue(BRANCH_TAP,&tap,j);
+      data->getValue(BRANCH_SHIFT,&shift,j);
+      data->getValue(BRANCH_CKT,&ckt,j);
+      if (status != 1 || (r == 0.0 && x == 0.0)) continue;
+      if (tap == 0.0) tap = 1.0;
+      std::complex<double> ys = 1.0/std::complex<double>(r,x);
+      std::complex<double> ysh(0.0,0.5*b);
+      std::complex<double> tps = std::polar(tap,shift*M_PI/180.0);
+      std::complex<double> yff = (ys+ysh)/(tap*tap);
+      std::complex<double> yft = -ys/std::conj(tps);
+      std::complex<double> ytf = -ys/tps;
+      std::complex<double> ytt = ys+ysh;
+      Element elem;
+      elem.p_from = p_network->getGlobalBusIndex(l1);
+      elem.p_to = p_network->getGlobalBusIndex(l2);
+      elem.p_y[0] = real(yff);
+      elem.p_y[1] = imag(yff);
+      elem.p_y[2] = real(yft);
+      elem.p_y[3] = imag(yft);
+      elem.p_y[4] = real(ytt);
+      elem.p_y[5] = imag(ytt);
+      elem.p_y[6] = real(ytf);
+      elem.p_y[7] = imag(ytf);
+      int e = p_elements.size();
+      p_elements.push_back(elem);
+      p_bus_elements[l1].push_back(std::pair<int,bool>(e,false));
+      p_bus_elements[l2].push_back(std::pair<int,bool>(e,true));
+      // Flows are evaluated on the process that owns the branch. Reverse
+      // flows are stored as the negative element index
+      if (p_network->getActiveBranch(i)) {
+        SEStreamRecord flow;
+        flow.p_type = "PIJ";
+        flow.p_bus = p_orig[elem.p_from];
+        flow.p_tbus = p_orig[elem.p_to];
+        flow.p_ckt = util.clean2Char(ckt);
+        p_flow_elements.insert(std::pair<std::string,int>(key(flow),e+1));
+        flow.p_bus = p_orig[elem.p_to];
+        flow.p_tbus = p_orig[elem.p_from];
+        p_flow_elements.insert(std::pair<std::string,int>(key(flow),-(e+1)));
+      }
+    }
+  }
+  int me = p_comm.rank();
+  int nprocs = p_comm.size();
+  p_state_lo = static_cast<int>(static_cast<long>(2*p_nbus)*me/nprocs);
+  p_state_hi = static_cast<int>(static_cast<long>(2*p_nbus)*(me+1)/nprocs);
+
+  // The reference angle is fixed by a pseudo-measurement
+  if (p_ref >= 0) {
+    std::map<int,int>::const_iterator it = p_local_bus.find(p_orig[p_ref]);
+    if (it != p_local_bus.end()) {
+      Row row;
+      row.p_meas = -1;
+      row.p_kind = REF;
+      row.p_bus = it->second;
+      row.p_element = -1;
+      row.p_reverse = false;
+      p_rows.push_back(row);
+    }
+  }
+}
+
+/**
+ * Basic destructor
+ */
+gridpack::state_estimation::SEStreamEstimator::~SEStreamEstimator(void)
+{
+}
+
+/**
+ * Merge a scan into the measurement set. Collective
+ * @param scan measurements in the scan
+ */
+void gridpack::state_estimation::SEStreamEstimator::update(
+    const std::vector<SEStreamRecord> &scan)
+{
+  p_nupdated = 0;
+  p_nadded = 0;
+  p_nremoved = 0;
+  std::vector<bool> removed(p_meas.size(),false);
+  int i;
+  for (i=0; i<scan.size(); i++) {
+    SEStreamRecord record = scan[i];
+    // Angles are given in degrees
+    if (record.p_type == "VA") {
+      record.p_value *= M_PI/180.0;
+      record.p_deviation *= M_PI/180.0;
+    }
+    std::string k = key(record);
+    std::map<std::string,int>::iterator it = p_keys.find(k);
+    if (record.p_deviation <= 0.0) {
+      if (it != p_keys.end() && !removed[it->second]) {
+        removed[it->second] = true;
+        p_nremoved++;
+      }
+    } else if (it != p_keys.end()) {
+      // Only the value changes, the row of H is kept
+      p_meas[it->second].p_value = record.p_value;
+      p_meas[it->second].p_deviation = record.p_deviation;
+      if (removed[it->second]) {
+        removed[it->second] = false;
+        p_nremoved--;
+      }
+      p_nupdated++;
+    } else {
+      int m = p_meas.size();
+      p_meas.push_back(record);
+      removed.push_back(false);
+      p_keys.insert(std::pair<std::string,int>(k,m));
+      Row row;
+      if (resolve(m,row)) p_rows.push_back(row);
+      p_nadded++;
+    }
+  }
+  if (p_nremoved > 0) {
+    // Compact the measurement set and renumber the rows
+    std::vector<int> newidx(p_meas.size(),-1);
+    std::vector<SEStreamRecord> meas;
+    p_keys.clear();
+    for (i=0; i<p_meas.size(); i++) {
+      if (removed[i]) continue;
+      newidx[i] = meas.size();
+      p_keys.insert(std::pair<std::string,int>(key(p_meas[i]),meas.size()));
+      meas.push_back(p_meas[i]);
+    }
+    p_meas.swap(meas);
+    std::vector<Row> rows;
+    for (i=0; i<p_rows.size(); i++) {
+      if (p_rows[i].p_meas >= 0) {
+        if (newidx[p_rows[i].p_meas] < 0) continue;
+        p_rows[i].p_meas = newidx[p_rows[i].p_meas];
+      }
+      rows.push_back(p_rows[i]);
+    }
+    p_rows.swap(rows);
+  }
+  // All processes see the same scans, so they agree on whether the layout
+  // has changed
+  if (p_nadded > 0 || p_nremoved > 0 || (!p_H && !p_G)) setLayout();
+}
+
+/**
+ * Estimate the state from the current measurement set, starting from
+ * the previous estimate. Collective
+ * @return true if the iterations converged
+ */
+bool gridpack::state_estimation::SEStreamEstimator::solve(void)
+{
+  if (!p_warm_start) p_x = p_x0;
+  p_iterations = 0;
+  p_t_assemble = 0.0;
+  p_t_solve = 0.0;
+  bool converged = false;
+  std::vector<int> cols;
+  std::vector<double> vals;
+  std::vector<double> dx_all(2*p_nbus);
+  boost::shared_ptr<gridpack::math::RealVector> dx;
+  int i, j, k;
+  while (!converged && p_iterations < p_max_iterations) {
+    double t_start = MPI_Wtime();
+    // Evaluate the weighted rows at the current state and add them to H
+    // and r, or directly to G and b. Zeroing G keeps its nonzero structure
+    if (p_method == DIRECT) {
+      p_G->zero();
+      p_b->zero();
+    } else {
+      p_H->zero();
+      p_r->zero();
+    }
+    double objective = 0.0;
+    for (i=0; i<p_rows.size(); i++) {
+      const Row &row = p_rows[i];
+      double z, sigma;
+      if (row.p_kind == REF) {
+        z = p_x0[2*p_ref];
+        sigma = p_ref_deviation;
+      } else {
+        z = p_meas[row.p_meas].p_value;
+        sigma = p_meas[row.p_meas].p_deviation;
+      }
+      double h;
+      evaluate(row,h,cols,vals);
+      double res = (z-h)/sigma;
+      objective += res*res;
+      int ncols = cols.size();
+      for (j=0; j<ncols; j++) vals[j] /= sigma;
+      if (p_method == DIRECT) {
+        for (j=0; j<ncols; j++) {
+          for (k=0; k<ncols; k++) {
+            p_G->addElement(cols[j],cols[k],vals[j]*vals[k]);
+          }
+          p_b->addElement(cols[j],vals[j]*res);
+        }
+      } else {
+        int idx = p_row_offset+i;
+        for (j=0; j<ncols; j++) {
+          p_H->addElement(idx,cols[j],vals[j]);
+        }
+        p_r->setElement(idx,res);
+      }
+    }
+    if (p_method == DIRECT) {
+      p_G->ready();
+      p_b->ready();
+    } else {
+      p_H->ready();
+      p_r->ready();
+    }
+    p_comm.sum(&objective,1);
+    p_objective = objective;
+    p_t_assemble += MPI_Wtime()-t_start;
+
+    solveNormal(dx);
+    p_iterations++;
+
+    // Apply the correction to the replicated state
+    dx_all.assign(2*p_nbus,0.0);
+    int lo, hi;
+    dx->localIndexRange(lo,hi);
+    for (i=lo; i<hi; i++) dx->getElement(i,dx_all[i]);
+    p_comm.sum(&dx_all[0],2*p_nbus);
+    double dmax = 0.0;
+    for (i=0; i<2*p_nbus; i++) {
+      p_x[i] += dx_all[i];
+      if (fabs(dx_all[i]) > dmax) dmax = fabs(dx_all[i]);
+    }
+    converged = (dmax < p_tolerance);
+  }
+  p_comm.max(&p_t_assemble,1);
+  p_comm.max(&p_t_solve,1);
+  return converged;
+}
+
+/**
+ * Write the current estimate from process 0
+ */
+void gridpack::state_estimation::SEStreamEstimator::write(void)
+{
+  if (p_comm.rank() != 0) return;
+  printf("\n   State Estimation Output (streaming)\n\n");
+  printf("   Bus Number      Phase Angle      Voltage Magnitude\n");
+  int i;
+  for (i=0; i<p_nbus; i++) {
+    printf("     %6d      %12.6f         %12.6f\n",p_orig[i],
+        p_x[2*i]*180.0/M_PI,p_x[2*i+1]);
+  }
+}
+
+/**
+ * Change the way the Gauss-Newton correction is found. The storage is
+ * set up again on the next update
+ * @param method one of PRODUCT, DIRECT or ORTHOGONAL
+ */
+void gridpack::state_estimation::SEStreamEstimator::setMethod(int method)
+{
+  if (method == p_method) return;
+  p_method = method;
+  p_H.reset();
+  p_r.reset();
+  p_G.reset();
+  p_b.reset();
+  p_solver.reset();
+}
+
+/**
+ * Current estimate
+ * @param x angle and magnitude of every bus, in the order of the global
+ *        bus indices
+ */
+void gridpack::state_estimation::SEStreamEstimator::getState(
+    std::vector<double> &x) const
+{
+  x = p_x;
+}
+
+/**
+ * Time spent in the last solve, maximum over processes
+ * @param t_assemble evaluating the measurements and forming the system
+ * @param t_solve solving the linear systems
+ */
+void gridpack::state_estimation::SEStreamEstimator::getTimings(
+    double &t_assemble, double &t_solve) const
+{
+  t_assemble = p_t_assemble;
+  t_solve = p_t_solve;
+}
+
+/**
+ * Statistics of the last update and solve
+ * @param nmeas number of measurements in the set
+ * @param nupdated number of measurements whose values were updated
+ * @param nadded number of measurements added
+ * @param nremoved number of measurements removed
+ * @param iterations number of Gauss-Newton iterations
+ * @param objective weighted sum of squared residuals
+ */
+void gridpack::state_estimation::SEStreamEstimator::getStats(int &nmeas,
+    int &nupdated, int &nadded, int &nremoved, int &iterations,
+    double &objective) const
+{
+  nmeas = p_meas.size();
+  nupdated = p_nupdated;
+  nadded = p_nadded;
+  nremoved = p_nremoved;
+  iterations = p_iterations;
+  objective = p_objective;
+}
+
+/**
+ * Key of a measurement in the measurement set
+ * @param record measurement
+ * @return key
+ */
+std::string gridpack::state_estimation::SEStreamEstimator::key(
+    const SEStreamRecord &record)
+{
+  char buf[128];
+  if (record.p_type == "PIJ" || record.p_type == "QIJ") {
+    sprintf(buf,"%s:%d:%d:%s",record.p_type.c_str(),record.p_bus,
+        record.p_tbus,record.p_ckt.c_str());
+  } else {
+    sprintf(buf,"%s:%d",record.p_type.c_str(),record.p_bus);
+  }
+  return std::string(buf);
+}
+
+/**
+ * Find the row of a measurement if it belongs to this process
+ * @param meas index of measurement
+ * @param row row of the Jacobian
+ * @return false if the measurement is evaluated on another process
+ */
+bool gridpack::state_estimation::SEStreamEstimator::resolve(int meas,
+    Row &row) const
+{
+  const SEStreamRecord &record = p_meas[meas];
+  row.p_meas = meas;
+  row.p_bus = -1;
+  row.p_element = -1;
+  row.p_reverse = false;
+  if (record.p_type == "PIJ" || record.p_type == "QIJ") {
+    row.p_kind = (record.p_type == "PIJ") ? PIJ : QIJ;
+    SEStreamRecord flow = record;
+    flow.p_type = "PIJ";
+    std::map<std::string,int>::const_iterator it =
+      p_flow_elements.find(key(flow));
+    if (it == p_flow_elements.end()) return false;
+    row.p_element = abs(it->second)-1;
+    row.p_reverse = (it->second < 0);
+    return true;
+  }
+  std::map<int,int>::const_iterator it = p_local_bus.find(record.p_bus);
+  if (it == p_local_bus.end()) return false;
+  row.p_bus = it->second;
+  if (record.p_type == "VM") {
+    row.p_kind = VM;
+  } else if (record.p_type == "VA") {
+    row.p_kind = VA;
+  } else if (record.p_type == "PI") {
+    row.p_kind = PI;
+  } else {
+    row.p_kind = QI;
+  }
+  return true;
+}
+
+/**
+ * Row offsets of all processes and layout of H after the rows changed
+ */
+void gridpack::state_estimation::SEStreamEstimator::setLayout(void)
+{
+  int me = p_comm.rank();
+  int nprocs = p_comm.size();
+  std::vector<int> nrows(nprocs,0);
+  nrows[me] = p_rows.size();
+  p_comm.sum(&nrows[0],nprocs);
+  int i;
+  p_row_offset = 0;
+  p_total_rows = 0;
+  for (i=0; i<nprocs; i++) {
+    if (i < me) p_row_offset += nrows[i];
+    p_total_rows += nrows[i];
+  }
+  int nowned = p_total_rows-(p_ref >= 0 ? 1 : 0);
+  if (me == 0 && nowned != static_cast<int>(p_meas.size())) {
+    printf("Warning: %d of %d measurements do not match a bus or branch\n",
+        static_cast<int>(p_meas.size())-nowned,
+        static_cast<int>(p_meas.size()));
+  }
+  // The solver holds on to the matrix it was created with, so it is
+  // created again with the storage
+  p_solver.reset();
+  int nstate = p_state_hi-p_state_lo;
+  if (p_method == DIRECT) {
+    p_H.reset();
+    p_r.reset();
+    p_G.reset(new gridpack::math::RealMatrix(p_comm, nstate, nstate,
+          gainNonzeros()));
+    p_b.reset(new gridpack::math::RealVector(p_comm, nstate));
+  } else {
+    p_G.reset();
+    p_b.reset();
+    p_H.reset(new gridpack::math::RealMatrix(p_comm, p_rows.size(),
+          nstate));
+    p_r.reset(new gridpack::math::RealVector(p_comm, p_rows.size()));
+  }
+}
+
+/**
+ * Upper bound on the number of nonzeros in a row of G, from the
+ * columns of the rows of H on all processes
+ * @return maximum number of nonzeros per row
+ */
+int gridpack::state_estimation::SEStreamEstimator::gainNonzeros(void) const
+{
+  // Row c of G has a nonzero in every column that appears together with c
+  // in a row of H. The counts of the processes are added, which can only
+  // overestimate the count if rows on different processes overlap
+  std::map<int,std::set<int> > pattern;
+  std::vector<int> cols;
+  std::vector<double> vals;
+  double h;
+  int i, j, k;
+  for (i=0; i<p_rows.size(); i++) {
+    evaluate(p_rows[i],h,cols,vals);
+    for (j=0; j<cols.size(); j++) {
+      std::set<int> &row = pattern[cols[j]];
+      for (k=0; k<cols.size(); k++) row.insert(cols[k]);
+    }
+  }
+  std::vector<int> count(2*p_nbus,0);
+  std::map<int,std::set<int> >::const_iterator it;
+  for (it = pattern.begin(); it != pattern.end(); it++) {
+    count[it->first] = it->second.size();
+  }
+  p_comm.sum(&count[0],2*p_nbus);
+  int nmax = 1;
+  for (i=p_state_lo; i<p_state_hi; i++) {
+    if (count[i] > nmax) nmax = count[i];
+  }
+  if (nmax > 2*p_nbus) nmax = 2*p_nbus;
+  return nmax;
+}
+
+/**
+ * Evaluate a measurement function and its derivatives
+ * @param row row of the Jacobian
+ * @param h value of the measurement function
+ * @param cols state indices of the derivatives
+ * @param vals derivatives
+ */
+void gridpack::state_estimation::SEStreamEstimator::evaluate(const Row &row,
+    double &h, std::vector<int> &cols, std::vector<double> &vals) const
+{
+  cols.clear();
+  vals.clear();
+  double d[4];
+  if (row.p_kind == PIJ || row.p_kind == QIJ) {
+    const Element &elem = p_elements[row.p_element];
+    int s = row.p_reverse ? elem.p_to : elem.p_from;
+    int t = row.p_reverse ? elem.p_from : elem.p_to;
+    flow(elem.p_y+(row.p_reverse ? 4 : 0),s,t,row.p_kind == QIJ,h,d);
+    cols.push_back(2*s);
+    cols.push_back(2*s+1);
+    cols.push_back(2*t);
+    cols.push_back(2*t+1);
+    vals.assign(d,d+4);
+    return;
+  }
+  int g = p_network->getGlobalBusIndex(row.p_bus);
+  if (row.p_kind == VM) {
+    h = p_x[2*g+1];
+    cols.push_back(2*g+1);
+    vals.push_back(1.0);
+  } else if (row.p_kind == VA || row.p_kind == REF) {
+    h = p_x[2*g];
+    cols.push_back(2*g);
+    vals.push_back(1.0);
+  } else {
+    // Injection is the shunt load plus the flows out of the bus on every
+    // connected element. Derivatives with respect to the bus itself are
+    // accumulated in the first two entries
+    bool reactive = (row.p_kind == QI);
+    double v = p_x[2*g+1];
+    double gsh = p_shunt[2*row.p_bus];
+    double bsh = p_shunt[2*row.p_bus+1];
+    h = reactive ? -v*v*bsh : v*v*gsh;
+    cols.push_back(2*g);
+    cols.push_back(2*g+1);
+    vals.push_back(0.0);
+    vals.push_back(reactive ? -2.0*v*bsh : 2.0*v*gsh);
+    const std::vector<std::pair<int,bool> > &elems = p_bus_elements[row.p_bus];
+    int i;
+    for (i=0; i<elems.size(); i++) {
+      const Element &elem = p_elements[elems[i].first];
+      bool reverse = elems[i].second;
+      int t = reverse ? elem.p_from : elem.p_to;
+      double f;
+      flow(elem.p_y+(reverse ? 4 : 0),g,t,reactive,f,d);
+      h += f;
+      vals[0] += d[0];
+      vals[1] += d[1];
+      cols.push_back(2*t);
+      cols.push_back(2*t+1);
+      vals.push_back(d[2]);
+      vals.push_back(d[3]);
+    }
+  }
+}
+
+/**
+ * Power flow out of one end of a branch element
+ * @param y admittances (g_ss, b_ss, g_st, b_st) of the element
+ * @param s global index of the bus at the measured end
+ * @param t global index of the bus at the other end
+ * @param reactive true for reactive power
+ * @param h flow
+ * @param d derivatives with respect to angle and magnitude at s and t
+ */
+void gridpack::state_estimation::SEStreamEstimator::flow(const double *y,
+    int s, int t, bool reactive, double &h, double *d) const
+{
+  double vs = p_x[2*s+1];
+  double vt = p_x[2*t+1];
+  double theta = p_x[2*s]-p_x[2*t];
+  double c = cos(theta);
+  double sn = sin(theta);
+  double gss = y[0];
+  double bss = y[1];
+  double g = y[2];
+  double b = y[3];
+  // S = Vs conj(Yss Vs + Yst Vt)
+  double a = g*c+b*sn;
+  double q = g*sn-b*c;
+  if (!reactive) {
+    h = vs*vs*gss+vs*vt*a;
+    d[0] = -vs*vt*q;
+    d[1] = 2.0*vs*gss+vt*a;
+    d[2] = vs*vt*q;
+    d[3] = vs*a;
+  } else {
+    h = -vs*vs*bss+vs*vt*q;
+    d[0] = vs*vt*a;
+    d[1] = -2.0*vs*bss+vt*q;
+    d[2] = -vs*vt*a;
+    d[3] = vs*q;
+  }
+}
+
+/**
+ * Solve for the state correction with the system assembled for the
+ * current method
+ * @param dx state correction, structured like the columns of H
+ */
+void gridpack::state_estimation::SEStreamEstimator::solveNormal(
+    boost::shared_ptr<gridpack::math::RealVector> &dx)
+{
+  double t_start = MPI_Wtime();
+  if (p_method == DIRECT) {
+    // G and b were assembled directly. The solver is kept while the layout
+    // is unchanged, so a direct solver only repeats the numerical
+    // factorization
+    if (!p_solver) {
+      p_solver.reset(new gridpack::math::RealLinearSolver(*p_G));
+      p_solver->configure(p_gain_cursor);
+    }
+    dx.reset(p_b->clone());
+    dx->zero();
+    p_solver->solve(*p_b,*dx);
+  } else if (p_method == ORTHOGONAL) {
+    // Least squares solution of H dx = r, for a solver such as LSQR that
+    // works on the rectangular matrix
+    if (!p_solver) {
+      p_solver.reset(new gridpack::math::RealLinearSolver(*p_H));
+      p_solver->configure(p_orthogonal_cursor);
+    }
+    dx.reset(new gridpack::math::RealVector(p_comm, p_state_hi-p_state_lo));
+    dx->zero();
+    p_solver->solve(*p_r,*dx);
+  } else {
+    // G = Ht*H and b = Ht*r, formed with the same matrix products as the
+    // state estimation module
+    boost::shared_ptr<gridpack::math::RealMatrix>
+      Ht(gridpack::math::transpose(*p_H));
+    boost::shared_ptr<gridpack::math::RealMatrix>
+      G(gridpack::math::multiply(*Ht,*p_H));
+    boost::shared_ptr<gridpack::math::RealVector>
+      b(gridpack::math::multiply(*Ht,*p_r));
+    double t_product = MPI_Wtime();
+    p_t_assemble += t_product-t_start;
+    t_start = t_product;
+    dx.reset(b->clone());
+    dx->zero();
+    gridpack::math::RealLinearSolver solver(*G);
+    solver.configure(p_cursor);
+    solver.solve(*b,*dx);
+  }
+  p_t_solve += MPI_Wtime()-t_start;
+}
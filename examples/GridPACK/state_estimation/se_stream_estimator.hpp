@@ -0,0 +1,256 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   se_stream_estimator.hpp
+ *
+ * @brief  Weighted least squares state estimation on a stream of
+ *         measurement scans. The network, the measurement set and the
+ *         Jacobian storage persist between scans and each scan starts from
+ *         the previous estimate.
+ *
+ *  The Gauss-Newton correction is found in one of three ways
+ *
+ *    product     form H and G = Ht*H with matrix products, as the state
+ *                estimation module does
+ *    direct      add the contributions of each row of H to G = Ht*W*H and
+ *                Ht*W*r directly, without forming H. The nonzero structure
+ *                of G only changes with the measurement set
+ *    orthogonal  solve the weighted least squares problem H dx = r with an
+ *                orthogonal (LSQR) method, without forming G
+ *
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _se_stream_estimator_h_
+#define _se_stream_estimator_h_
+
+#include <map>
+#include <string>
+#include <vector>
+#include "boost/smart_ptr/shared_ptr.hpp"
+#include "gridpack/include/gridpack.hpp"
+#include "gridpack/applications/modules/state_estimation/se_app_module.hpp"
+#include "se_measurement_stream.hpp"
+
+namespace gridpack {
+namespace state_estimation {
+
+// The state is the voltage angle and magnitude of every bus, in the order
+// of the global bus indices, and is replicated on all processes. Each
+// process evaluates the measurements at its active buses and branches,
+// which only need the admittances of the local branches and the
+// replicated state. The rows of the Jacobian H are kept with the
+// measurement set, so a scan that only changes measured values reuses
+// them unchanged and only added or removed measurements change the rows
+// and the layout of H.
+class SEStreamEstimator
+{
+  public:
+
+    // Ways of finding the Gauss-Newton correction
+    enum Method {PRODUCT, DIRECT, ORTHOGONAL};
+    /**
+     * Basic constructor. The network must have been read and partitioned
+     * @param network state estimation network
+     * @param cursor pointer to State_estimation block (LinearSolver and
+     *        GainSolvers)
+     * @param scursor pointer to Streaming block
+     */
+    SEStreamEstimator(boost::shared_ptr<SENetwork> network,
+        gridpack::utility::Configuration::CursorPtr cursor,
+        gridpack::utility::Configuration::CursorPtr scursor);
+
+    /**
+     * Basic destructor
+     */
+    ~SEStreamEstimator(void);
+
+    /**
+     * Merge a scan into the measurement set. Collective
+     * @param scan measurements in the scan
+     */
+    void update(const std::vector<SEStreamRecord> &scan);
+
+    /**
+     * Estimate the state from the current measurement set, starting from
+     * the previous estimate. Collective
+     * @return true if the iterations converged
+     */
+    bool solve(void);
+
+    /**
+     * Write the current estimate from process 0
+     */
+    void write(void);
+
+    /**
+     * Change the way the Gauss-Newton correction is found. The storage is
+     * set up again on the next update
+     * @param method one of PRODUCT, DIRECT or ORTHOGONAL
+     */
+    void setMethod(int method);
+
+    /**
+     * Current estimate
+     * @param x angle and magnitude of every bus, in the order of the global
+     *        bus indices
+     */
+    void getState(std::vector<double> &x) const;
+
+    /**
+     * Time spent in the last solve, maximum over processes
+     * @param t_assemble evaluating the measurements and forming the system
+     * @param t_solve solving the linear systems
+     */
+    void getTimings(double &t_assemble, double &t_solve) const;
+
+    /**
+     * Statistics of the last update and solve
+     * @param nmeas number of measurements in the set
+     * @param nupdated number of measurements whose values were updated
+     * @param nadded number of measurements added
+     * @param nremoved number of measurements removed
+     * @param iterations number of Gauss-Newton iterations
+     * @param objective weighted sum of squared residuals
+     */
+    void getStats(int &nmeas, int &nupdated, int &nadded, int &nremoved,
+        int &iterations, double &objective) const;
+
+  private:
+
+    // Admittances of a branch element seen from each end, as
+    // (g_ss, b_ss, g_st, b_st) for the from end and then the to end
+    struct Element {
+      int p_from, p_to;  // global bus indices
+      double p_y[8];
+    };
+
+    // Measurement types, as in the stream
+    enum Kind {VM, VA, PI, QI, PIJ, QIJ, REF};
+
+    // A row of the Jacobian evaluated by this process
+    struct Row {
+      int p_meas;     // index in p_meas, -1 for the reference angle
+      int p_kind;
+      int p_bus;      // local bus of bus measurements
+      int p_element;  // element of branch flows
+      bool p_reverse; // flow measured from the to end
+    };
+
+    /**
+     * Key of a measurement in the measurement set
+     * @param record measurement
+     * @return key
+     */
+    static std::string key(const SEStreamRecord &record);
+
+    /**
+     * Find the row of a measurement if it belongs to this process
+     * @param meas index of measurement
+     * @param row row of the Jacobian
+     * @return false if the measurement is evaluated on another process
+     */
+    bool resolve(int meas, Row &row) const;
+
+    /**
+     * Row offsets of all processes and layout of H or G after the rows
+     * changed
+     */
+    void setLayout(void);
+
+    /**
+     * Upper bound on the number of nonzeros in a row of G, from the
+     * columns of the rows of H on all processes
+     * @return maximum number of nonzeros per row
+     */
+    int gainNonzeros(void) const;
+
+    /**
+     * Evaluate a measurement function and its derivatives
+     * @param row row of the Jacobian
+     * @param h value of the measurement function
+     * @param cols state indices of the derivatives
+     * @param vals derivatives
+     */
+    void evaluate(const Row &row, double &h, std::vector<int> &cols,
+        std::vector<double> &vals) const;
+
+    /**
+     * Power flow out of one end of a branch element
+     * @param y admittances (g_ss, b_ss, g_st, b_st) of the element
+     * @param s global index of the bus at the measured end
+     * @param t global index of the bus at the other end
+     * @param reactive true for reactive power
+     * @param h flow
+     * @param d derivatives with respect to angle and magnitude at s and t
+     */
+    void flow(const double *y, int s, int t, bool reactive, double &h,
+        double *d) const;
+
+    /**
+     * Solve for the state correction with the system assembled for the
+     * current method
+     * @param dx state correction, structured like the columns of H
+     */
+    void solveNormal(boost::shared_ptr<gridpack::math::RealVector> &dx);
+
+    boost::shared_ptr<SENetwork> p_network;
+    gridpack::parallel::Communicator p_comm;
+    gridpack::utility::Configuration::CursorPtr p_cursor;
+
+    // Replicated state and starting state
+    int p_nbus;
+    std::vector<double> p_x;
+    std::vector<double> p_x0;
+    std::vector<int> p_orig;
+    int p_ref;
+
+    // Local network model
+    std::map<int,int> p_local_bus;
+    std::vector<Element> p_elements;
+    std::map<std::string,int> p_flow_elements;
+    std::vector<std::vector<std::pair<int,bool> > > p_bus_elements;
+    std::vector<double> p_shunt;
+
+    // Measurement set and the rows evaluated by this process
+    std::vector<SEStreamRecord> p_meas;
+    std::map<std::string,int> p_keys;
+    std::vector<Row> p_rows;
+    int p_row_offset;
+    int p_total_rows;
+    int p_state_lo, p_state_hi;
+
+    // Weighted Jacobian and residuals
+    boost::shared_ptr<gridpack::math::RealMatrix> p_H;
+    boost::shared_ptr<gridpack::math::RealVector> p_r;
+
+    // Gain matrix and right hand side assembled directly, and the solver
+    // kept with them while the layout is unchanged
+    boost::shared_ptr<gridpack::math::RealMatrix> p_G;
+    boost::shared_ptr<gridpack::math::RealVector> p_b;
+    boost::shared_ptr<gridpack::math::RealLinearSolver> p_solver;
+    gridpack::utility::Configuration::CursorPtr p_gain_cursor;
+    gridpack::utility::Configuration::CursorPtr p_orthogonal_cursor;
+
+    // Settings
+    int p_method;
+    int p_max_iterations;
+    double p_tolerance;
+    bool p_warm_start;
+    double p_ref_deviation;
+
+    // Statistics
+    int p_nupdated, p_nadded, p_nremoved;
+    int p_iterations;
+    double p_objective;
+    double p_t_assemble, p_t_solve;
+};
+
+} // state_estimation
+} // gridpack
+#endif
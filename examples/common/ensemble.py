@@ -0,0 +1,401 @@
+#!/usr/bin/env python3
+"""
+Ensemble runner for the GridPACK co-simulation examples.
+
+Runs many independent members of a federation at once, for instance to
+study how sensitive an attack is to the loading of the grid. The federation
+is described by the same runner file that is used to launch it by hand,
+e.g.
+
+    python3 ../common/ensemble.py gpk-gld-cosim.json --members 200 \
+        --load-sigma 0.1 --bus A:3 --output ensemble
+
+from examples/2bus-13bus, or with pf-cosim/gpk-gld-cosim.json.
+
+Each member runs in its own directory (<output>/member_NNNN), which holds
+a copy of the directory of the runner file, so that the outputs of the
+federates stay apart. Build directories and earlier ensembles are not
+copied; executables given by a path are run from the original tree. The
+files that change between members are:
+
+  - HELICS configuration files (JSON files with coreInit, coreType or
+    brokerAddress) point to the broker of the member. Every member has its
+    own broker on port base-port + member * port-stride. The broker
+    assigns the federate ports from the same range, so federations do not
+    collide.
+  - The GridPACK input.xml of each federate directory that has a Federate
+    block gets a perturbationFile with random load scale factors for each
+    boundary and each --bus, plus the batch given with --scenario (see
+    2bus-13bus/perturbation_schedule.hpp). Its networkConfiguration points
+    to the original file and networkSnapshot is switched on, so the network
+    is parsed once and every other member memory-maps the binary snapshot.
+
+Members run --jobs at a time. The default fills the cores with one core per
+federate. The signals recorded by the GridPACK federate (signalFile, text
+or binary) are collected into <output>/ensemble.db, an SQLite database with
+the tables
+
+  members(member, seed, broker_port, directory, status, returncode,
+          wall_time, perturbations)
+  signals(member, time, name, value)
+
+Running again with the same output replaces the members that are run.
+"""
+
+import argparse
+import concurrent.futures
+import json
+import os
+import random
+import re
+import shlex
+import shutil
+import signal
+import sqlite3
+import struct
+import subprocess
+import sys
+import time
+import xml.etree.ElementTree as ET
+
+
+def copy_tree(src, dst, exclude):
+    '''
+    Copy the inputs under src to dst. Directories in exclude, CMake build
+    directories and ensemble outputs are skipped.
+    '''
+    for root, dirs, files in os.walk(src):
+        dirs[:] = [d for d in dirs
+                   if os.path.realpath(os.path.join(root, d)) not in exclude
+                   and not os.path.exists(os.path.join(root, d, 'CMakeCache.txt'))
+                   and not os.path.exists(os.path.join(root, d, 'ensemble.db'))]
+        target = os.path.join(dst, os.path.relpath(root, src))
+        os.makedirs(target, exist_ok=True)
+        for f in files:
+            shutil.copy2(os.path.join(root, f), os.path.join(target, f))
+
+
+def replace_file(path, text):
+    with open(path, 'w') as f:
+        f.write(text)
+
+
+def point_to_broker(mdir, address):
+    '''
+    Set the broker address in the HELICS configuration files of a member.
+    '''
+    for root, dirs, files in os.walk(mdir):
+        for f in files:
+            path = os.path.join(root, f)
+            if not f.endswith('.json'):
+                continue
+            try:
+                with open(path) as fp:
+                    config = json.load(fp)
+            except (OSError, ValueError):
+                continue
+            if not isinstance(config, dict) or not (
+                    'coreInit' in config or 'coreType' in config or
+                    'brokerAddress' in config):
+                continue
+            init = re.sub(r'\s*--broker_?address[= ]\S+', '',
+                          config.get('coreInit', '--federates=1'))
+            config['coreInit'] = f'{init} --broker_address={address}'
+            if 'brokerAddress' in config:
+                config['brokerAddress'] = address
+            replace_file(path, json.dumps(config, indent=4) + '\n')
+
+
+def read_xml(path):
+    parser = ET.XMLParser(target=ET.TreeBuilder(insert_comments=True))
+    return ET.parse(path, parser)
+
+
+def set_child(parent, tag, text):
+    node = parent.find(tag)
+    if node is None:
+        node = ET.SubElement(parent, tag)
+    node.text = text
+
+
+def gridpack_inputs(mdir, federates):
+    '''
+    GridPACK input files of the federates, with the directory each is read
+    from.
+    '''
+    inputs = []
+    for fed in federates:
+        cwd = os.path.join(mdir, fed.get('directory', '.'))
+        args = shlex.split(fed['exec'])
+        xml = args[1] if len(args) > 1 and args[1].endswith('.xml') \
+            else 'input.xml'
+        path = os.path.join(cwd, xml)
+        if (cwd, path) in inputs:
+            continue
+        if os.path.exists(path) and \
+                read_xml(path).getroot().find('Federate') is not None:
+            inputs.append((cwd, path))
+    return inputs
+
+
+def perturb(args, rng, cwd, source_cwd, path, mfile, shared_network):
+    '''
+    Write the perturbations of a member for one GridPACK federate and point
+    its input file to them. Returns the perturbations.
+    '''
+    tree = read_xml(path)
+    federate = tree.getroot().find('Federate')
+
+    perturbations = []
+    mapping = federate.findtext('mapping', 'gpk-mapping.json').strip()
+    with open(os.path.join(cwd, mapping)) as fp:
+        cases = json.load(fp).get('cases', [])
+    for case in cases:
+        for bnd in case.get('boundaries', []):
+            perturbations.append({
+                'time': 0.0, 'type': 'load', 'boundary': bnd['name'],
+                'mode': 'scale', 'value': 1.0 + args.load_sigma * rng.gauss(0, 1)})
+    for bus in args.bus:
+        name, _, number = bus.rpartition(':')
+        entry = {'time': 0.0, 'type': 'load', 'bus': int(number),
+                 'mode': 'scale', 'value': 1.0 + args.load_sigma * rng.gauss(0, 1)}
+        if name:
+            entry['case'] = name
+        perturbations.append(entry)
+    if args.scenario:
+        with open(args.scenario) as fp:
+            perturbations += json.load(fp).get('perturbations', [])
+    replace_file(mfile, json.dumps({'perturbations': perturbations}, indent=2))
+    set_child(federate, 'perturbationFile', mfile)
+
+    # All members read the network from the original file, so they share
+    # its binary snapshot. Signals copied from an earlier run are removed
+    for parent in tree.getroot().iter():
+        node = parent.find('networkConfiguration')
+        if node is None:
+            continue
+        source = os.path.realpath(os.path.join(source_cwd, node.text.strip()))
+        node.text = source
+        if shared_network:
+            set_child(parent, 'networkSnapshot', 'true')
+    sfile = federate.findtext('signalFile', '').strip()
+    if sfile and os.path.exists(os.path.join(cwd, sfile)):
+        os.remove(os.path.join(cwd, sfile))
+    tree.write(path)
+    return perturbations
+
+
+def read_signals(path):
+    '''
+    Rows of a signal file written by the GridPACK federate, as a list of
+    column names and a list of rows.
+    '''
+    with open(path, 'rb') as f:
+        data = f.read()
+    if not data.startswith(b'GPKSIG01'):
+        lines = data.decode().splitlines()
+        if not lines:
+            return [], []
+        names = lines[0].split(',')
+        return names, [[float(v) for v in line.split(',')]
+                       for line in lines[1:] if line]
+    pos = 8
+    ncol, = struct.unpack_from('<I', data, pos)
+    pos += 4
+    names = []
+    for i in range(ncol):
+        n, = struct.unpack_from('<I', data, pos)
+        names.append(data[pos + 4:pos + 4 + n].decode())
+        pos += 4 + n
+    rows = []
+    while pos + 4 <= len(data):
+        nrow, = struct.unpack_from('<I', data, pos)
+        pos += 4
+        if pos + 8 * nrow * ncol > len(data):
+            break
+        values = struct.unpack_from(f'<{nrow * ncol}d', data, pos)
+        pos += 8 * nrow * ncol
+        rows += [[values[c * nrow + r] for c in range(ncol)]
+                 for r in range(nrow)]
+    return names, rows
+
+
+def run_member(args, member, federates, root, out):
+    seed = args.seed + member
+    rng = random.Random(seed)
+    port = args.base_port + member * args.port_stride
+    address = f'tcp://127.0.0.1:{port}'
+    mdir = os.path.join(out, f'member_{member:04d}')
+    record = {'member': member, 'seed': seed, 'broker_port': port,
+              'directory': mdir, 'status': 'failed', 'returncode': None,
+              'wall_time': 0.0, 'perturbations': [], 'signals': []}
+
+    if os.path.lexists(mdir):
+        shutil.rmtree(mdir)
+    copy_tree(root, mdir, {out})
+    point_to_broker(mdir, address)
+    inputs = gridpack_inputs(mdir, federates)
+    for n, (cwd, path) in enumerate(inputs):
+        mfile = os.path.join(mdir, f'perturbations_{n}.json')
+        source_cwd = os.path.join(root, os.path.relpath(cwd, mdir))
+        record['perturbations'] += perturb(args, rng, cwd, source_cwd, path,
+                                           mfile, not args.no_shared_network)
+
+    env = dict(os.environ)
+    env['HELICS_BROKER_ADDRESS'] = address
+    env['HELICS_BROKER_PORT'] = str(port)
+    procs = []
+    logs = []
+    start = time.time()
+    try:
+        cmd = ['helics_broker', f'--type={args.core}',
+               f'--federates={len(federates)}', f'--port={port}',
+               f'--portstart={port + 2}', f'--name=ensemble_{member}']
+        logs.append(open(os.path.join(mdir, 'broker.log'), 'w'))
+        procs.append(subprocess.Popen(cmd, cwd=mdir, env=env, stdout=logs[-1],
+                                      stderr=subprocess.STDOUT,
+                                      start_new_session=True))
+        for fed in federates:
+            directory = fed.get('directory', '.')
+            cmd = shlex.split(fed['exec'])
+            # Executables given by a path are run from the original tree
+            if os.sep in cmd[0]:
+                cmd[0] = os.path.realpath(os.path.join(root, directory, cmd[0]))
+            logs.append(open(os.path.join(mdir, f"{fed['name']}.log"), 'w'))
+            procs.append(subprocess.Popen(cmd, cwd=os.path.join(mdir, directory),
+                                          env=env, stdout=logs[-1],
+                                          stderr=subprocess.STDOUT,
+                                          start_new_session=True))
+
+        deadline = start + args.timeout
+        codes = []
+        for p in procs:
+            try:
+                codes.append(p.wait(timeout=max(0.0, deadline - time.time())))
+            except subprocess.TimeoutExpired:
+                codes.append(None)
+        record['returncode'] = max((abs(c) for c in codes if c is not None),
+                                   default=None)
+        if None in codes:
+            record['status'] = 'timeout'
+        elif record['returncode'] == 0:
+            record['status'] = 'ok'
+    finally:
+        for p in procs:
+            if p.poll() is None:
+                os.killpg(p.pid, signal.SIGKILL)
+                p.wait()
+        for f in logs:
+            f.close()
+    record['wall_time'] = time.time() - start
+
+    for cwd, path in inputs:
+        federate = read_xml(path).getroot().find('Federate')
+        sfile = federate.findtext('signalFile', '').strip()
+        if not sfile or not os.path.exists(os.path.join(cwd, sfile)):
+            continue
+        names, rows = read_signals(os.path.join(cwd, sfile))
+        for row in rows:
+            record['signals'] += [(member, row[0], names[c], row[c])
+                                  for c in range(1, len(names))]
+    if record['status'] == 'ok' and not record['signals']:
+        record['status'] = 'no_signals'
+    return record
+
+
+def open_store(path):
+    db = sqlite3.connect(path)
+    db.execute('''CREATE TABLE IF NOT EXISTS members (
+        member INTEGER PRIMARY KEY, seed INTEGER, broker_port INTEGER,
+        directory TEXT, status TEXT, returncode INTEGER, wall_time REAL,
+        perturbations TEXT)''')
+    db.execute('''CREATE TABLE IF NOT EXISTS signals (
+        member INTEGER, time REAL, name TEXT, value REAL)''')
+    db.execute('''CREATE INDEX IF NOT EXISTS signals_member
+        ON signals (member, name)''')
+    return db
+
+
+def store(db, record):
+    db.execute('DELETE FROM signals WHERE member = ?', (record['member'],))
+    db.execute('INSERT OR REPLACE INTO members VALUES (?,?,?,?,?,?,?,?)',
+               (record['member'], record['seed'], record['broker_port'],
+                record['directory'], record['status'], record['returncode'],
+                record['wall_time'], json.dumps(record['perturbations'])))
+    db.executemany('INSERT INTO signals VALUES (?,?,?,?)', record['signals'])
+    db.commit()
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Run an ensemble of independent co-simulation members')
+    parser.add_argument('runner', help='federation runner file, e.g. '
+                        'gpk-gld-cosim.json')
+    parser.add_argument('--members', type=int, default=10)
+    parser.add_argument('--first', type=int, default=0,
+                        help='index of the first member to run')
+    parser.add_argument('--jobs', type=int, default=0,
+                        help='members run at once (default: cores divided '
+                        'by the federates of a member)')
+    parser.add_argument('--seed', type=int, default=1,
+                        help='seed of the first member, incremented by member')
+    parser.add_argument('--load-sigma', type=float, default=0.1,
+                        help='standard deviation of the load scale factors')
+    parser.add_argument('--bus', action='append', default=[],
+                        help='[CASE:]BUS of a GridPACK load to perturb, '
+                        'may be repeated')
+    parser.add_argument('--scenario', help='batch of perturbations added to '
+                        'every member')
+    parser.add_argument('--base-port', type=int, default=24000)
+    parser.add_argument('--port-stride', type=int, default=100,
+                        help='ports reserved for the broker and federates '
+                        'of each member')
+    parser.add_argument('--core', default='zmq')
+    parser.add_argument('--timeout', type=float, default=600.0,
+                        help='seconds before a member is stopped')
+    parser.add_argument('--no-shared-network', action='store_true',
+                        help='do not share the parsed network snapshot')
+    parser.add_argument('--output', default='ensemble')
+    args = parser.parse_args()
+
+    runner = os.path.realpath(args.runner)
+    root = os.path.dirname(runner)
+    with open(runner) as fp:
+        federates = json.load(fp)['federates']
+    out = os.path.realpath(args.output)
+    os.makedirs(out, exist_ok=True)
+    jobs = args.jobs or max(1, (os.cpu_count() or 1) // len(federates))
+    db = open_store(os.path.join(out, 'ensemble.db'))
+
+    members = range(args.first, args.first + args.members)
+    print(f'Running {len(members)} members of {runner}, {jobs} at a time')
+    start = time.time()
+    count = {}
+    with concurrent.futures.ThreadPoolExecutor(max_workers=jobs) as pool:
+        futures = {pool.submit(run_member, args, m, federates, root, out): m
+                   for m in members}
+        for future in concurrent.futures.as_completed(futures):
+            try:
+                record = future.result()
+            except Exception as e:
+                m = futures[future]
+                print(f'member {m:4d} could not be run: {e}')
+                record = {'member': m, 'seed': args.seed + m,
+                          'broker_port': args.base_port + m * args.port_stride,
+                          'directory': os.path.join(out, f'member_{m:04d}'),
+                          'status': 'error', 'returncode': None,
+                          'wall_time': 0.0, 'perturbations': [], 'signals': []}
+            store(db, record)
+            count[record['status']] = count.get(record['status'], 0) + 1
+            print(f"member {record['member']:4d} {record['status']:10s} "
+                  f"{record['wall_time']:8.2f} s")
+    db.close()
+    elapsed = time.time() - start
+    print(f'{len(members)} members in {elapsed:.1f} s '
+          f'({60.0 * len(members) / max(elapsed, 1e-9):.1f} per minute): ' +
+          ', '.join(f'{n} {s}' for s, n in sorted(count.items())))
+    return 0 if count.get('ok', 0) == len(members) else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,79 @@
+#!/bin/sh
+# -------------------------------------------------------------
+# file: gpk_bench.sh
+# -------------------------------------------------------------
+# Run one benchmark of a bench target and append its wall clock time to a
+# CSV file, so that builds with different profiles can be compared.
+#
+#   gpk_bench.sh name input command [arguments]
+#
+# The LU solver package of the active (not commented out) LinearSolver
+# blocks of the input file is set to GPK_LU_SOLVER for the run, and the
+# input file is restored when the script exits. If no active block selects
+# an LU solver package, the solver is recorded as "none". The command is
+# run with MPIEXEC (default mpiexec) on GPK_BENCH_PROCS processes (default
+# 1) and its output is kept in bench-<name>.log. Each run adds the line
+#
+#   benchmark,profile,solver,nprocs,seconds
+#
+# to GPK_BENCH_RESULTS (default bench.csv).
+# -------------------------------------------------------------
+
+name=$1
+input=$2
+shift 2
+mpiexec=${MPIEXEC:-mpiexec}
+nprocs=${GPK_BENCH_PROCS:-1}
+profile=${GPK_PROFILE:-unknown}
+solver=${GPK_LU_SOLVER:-superlu_dist}
+results=${GPK_BENCH_RESULTS:-bench.csv}
+
+# Keep the original input and put it back on exit, also if interrupted
+backup=$input.bench-orig
+cp "$input" "$backup" || exit 1
+trap 'mv -f "$backup" "$input"' EXIT
+trap 'exit 130' INT TERM
+
+# Substitute the solver package only outside XML comments and inside
+# LinearSolver blocks. Exits with status 3 if nothing was substituted
+awk -v solver="$solver" '
+  {
+    line = $0
+    if (comment) {
+      if (index(line, "-->")) comment = 0
+      print line
+      next
+    }
+    if (line ~ /<LinearSolver>/) block = 1
+    if (block && line ~ /-pc_factor_mat_solver_type/) {
+      sub(/-pc_factor_mat_solver_type *[a-z_]*/,
+          "-pc_factor_mat_solver_type " solver, line)
+      n++
+    }
+    if (line ~ /<\/LinearSolver>/) block = 0
+    start = index(line, "<!--")
+    if (start && !index(substr(line, start), "-->")) comment = 1
+    print line
+  }
+  END { exit (n > 0) ? 0 : 3 }' "$backup" > "$input"
+case $? in
+  0) ;;
+  3) solver=none ;;
+  *) exit 1 ;;
+esac
+
+start=$(date +%s.%N)
+$mpiexec -n $nprocs "$@" > bench-$name.log 2>&1
+status=$?
+end=$(date +%s.%N)
+if [ $status -ne 0 ]; then
+  echo "Benchmark $name failed, see bench-$name.log"
+  exit $status
+fi
+
+if [ ! -f $results ]; then
+  echo "benchmark,profile,solver,nprocs,seconds" > $results
+fi
+seconds=$(echo "$start $end" | awk '{printf "%.6f", $2-$1}')
+echo "$name,$profile,$solver,$nprocs,$seconds" >> $results
+echo "$name ($profile, $solver, $nprocs processes): $seconds s"
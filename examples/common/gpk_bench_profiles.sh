@@ -0,0 +1,50 @@
+#!/bin/sh
+# -------------------------------------------------------------
+# file: gpk_bench_profiles.sh
+# -------------------------------------------------------------
+# Build the power flow, contingency analysis, resistor grid and 2bus-13bus
+# benchmarks with several build profiles and LU solvers, and collect the
+# times of their bench targets into one CSV file.
+#
+#   gpk_bench_profiles.sh [results]
+#
+# results defaults to bench-profiles.csv in the current directory. Each
+# profile in GPK_PROFILES (default "debug release release-native") is
+# built in build-<profile> of each example:
+#
+#   debug           -DCMAKE_BUILD_TYPE=Debug
+#   release         -DCMAKE_BUILD_TYPE=Release (with link time optimization)
+#   release-native  the same with -DGPK_MARCH=native
+#
+# The benchmarks are run for each solver in GPK_SOLVERS (default
+# "superlu_dist") on GPK_BENCH_PROCS processes (default 1), e.g.
+#
+#   GPK_SOLVERS="superlu_dist mumps" GPK_BENCH_PROCS=4 gpk_bench_profiles.sh
+# -------------------------------------------------------------
+
+results=$(realpath -m ${1:-bench-profiles.csv})
+profiles=${GPK_PROFILES:-"debug release release-native"}
+solvers=${GPK_SOLVERS:-superlu_dist}
+nprocs=${GPK_BENCH_PROCS:-1}
+examples=$(cd $(dirname $0)/.. && pwd)
+
+for profile in $profiles; do
+  case $profile in
+    debug) options="-DCMAKE_BUILD_TYPE=Debug" ;;
+    release) options="-DCMAKE_BUILD_TYPE=Release" ;;
+    release-native) options="-DCMAKE_BUILD_TYPE=Release -DGPK_MARCH=native" ;;
+    *) echo "Unknown profile $profile"; exit 1 ;;
+  esac
+  for solver in $solvers; do
+    for example in GridPACK/powerflow GridPACK/contingency_analysis \
+        GridPACK/resistor_grid 2bus-13bus; do
+      build=$examples/$example/build-$profile
+      cmake -S $examples/$example -B $build $options \
+        -DGPK_LU_SOLVER=$solver -DGPK_BENCH_PROCS=$nprocs \
+        -DGPK_BENCH_RESULTS=$results || exit 1
+      cmake --build $build -j || exit 1
+      cmake --build $build --target bench || exit 1
+    done
+  done
+done
+echo "Benchmark times written to $results"
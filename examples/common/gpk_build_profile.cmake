@@ -0,0 +1,120 @@
+# -*- mode: cmake -*-
+# -------------------------------------------------------------
+# file: gpk_build_profile.cmake
+# -------------------------------------------------------------
+# Build profile shared by the GridPACK federates and benchmarks. Include
+# it after project() and call gpk_build_profile() on each target.
+#
+#   CMAKE_BUILD_TYPE  Release unless given
+#   GPK_LTO           link time optimization of the targets (ON), ignored
+#                     for Debug builds or if the compiler does not support it
+#   GPK_MARCH         value for -march, e.g. native (empty: no -march)
+#   GPK_LU_SOLVER     PETSc LU solver package used by the bench targets,
+#                     superlu_dist or mumps. PETSc must have been configured
+#                     with it (see containers/docker/Dockerfile)
+#   MPIEXEC, GPK_BENCH_PROCS
+#                     MPI launcher and process count of the bench targets
+#   GPK_BENCH_RESULTS CSV file the bench targets append their times to. Use
+#                     the same file for builds with different profiles to
+#                     compare them
+#
+# gpk_find_libraries() finds the GridPACK, GA, PETSc, Boost, MPI and
+# HELICS libraries under the installation prefixes of the container.
+#
+# Include it with NO_POLICY_SCOPE so that link time optimization is also
+# honoured by the example projects that require an older CMake.
+# -------------------------------------------------------------
+
+if(POLICY CMP0069)
+  cmake_policy(SET CMP0069 NEW)
+endif()
+
+if(NOT CMAKE_BUILD_TYPE AND NOT CMAKE_CONFIGURATION_TYPES)
+  set(CMAKE_BUILD_TYPE Release CACHE STRING
+    "Build type (Debug, Release, RelWithDebInfo, MinSizeRel)" FORCE)
+endif()
+
+option(GPK_LTO "Link time optimization of the federates" ON)
+set(GPK_MARCH "" CACHE STRING "Target architecture for -march, e.g. native")
+set(GPK_LU_SOLVER superlu_dist CACHE STRING
+  "PETSc LU solver package used by the benchmarks")
+set_property(CACHE GPK_LU_SOLVER PROPERTY STRINGS superlu_dist mumps)
+set(MPIEXEC mpiexec CACHE STRING "MPI launcher used by the benchmarks")
+set(GPK_BENCH_PROCS 1 CACHE STRING "Processes used by the benchmarks")
+set(GPK_BENCH_RESULTS "${CMAKE_BINARY_DIR}/bench.csv" CACHE FILEPATH
+  "CSV file the benchmark times are appended to")
+
+set(GPK_COMMON_DIR "${CMAKE_CURRENT_LIST_DIR}")
+
+set(GPK_USE_LTO OFF)
+if(GPK_LTO AND NOT CMAKE_BUILD_TYPE STREQUAL "Debug")
+  include(CheckIPOSupported)
+  check_ipo_supported(RESULT GPK_USE_LTO OUTPUT GPK_LTO_ERROR LANGUAGES CXX)
+  if(NOT GPK_USE_LTO)
+    message(STATUS "Link time optimization is not supported: ${GPK_LTO_ERROR}")
+  endif()
+endif()
+
+# Name of the profile, recorded with the benchmark times
+set(GPK_PROFILE "${CMAKE_BUILD_TYPE}")
+if(GPK_USE_LTO)
+  string(APPEND GPK_PROFILE "-lto")
+endif()
+if(GPK_MARCH)
+  string(APPEND GPK_PROFILE "-${GPK_MARCH}")
+endif()
+message(STATUS "Build profile: ${GPK_PROFILE}, LU solver ${GPK_LU_SOLVER}")
+
+# Apply the build profile to a target
+function(gpk_build_profile TARGET_NAME)
+  if(GPK_USE_LTO)
+    set_property(TARGET ${TARGET_NAME} PROPERTY INTERPROCEDURAL_OPTIMIZATION ON)
+  endif()
+  if(GPK_MARCH)
+    target_compile_options(${TARGET_NAME} PRIVATE -march=${GPK_MARCH})
+  endif()
+endfunction()
+
+# Add a bench target that runs a benchmark through gpk_bench.sh. The
+# arguments after the name are the input file, whose LU solver is set to
+# GPK_LU_SOLVER, and the benchmark command. Several benchmarks of one
+# project are run by the single bench target
+function(gpk_add_bench NAME INPUT)
+  if(NOT TARGET bench)
+    add_custom_target(bench)
+  endif()
+  add_custom_target(bench-${NAME}
+    COMMAND ${CMAKE_COMMAND} -E env
+      MPIEXEC=${MPIEXEC} GPK_BENCH_PROCS=${GPK_BENCH_PROCS}
+      GPK_PROFILE=${GPK_PROFILE} GPK_LU_SOLVER=${GPK_LU_SOLVER}
+      GPK_BENCH_RESULTS=${GPK_BENCH_RESULTS}
+      sh ${GPK_COMMON_DIR}/gpk_bench.sh ${NAME} ${INPUT} ${ARGN}
+    WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}
+    USES_TERMINAL
+    )
+  add_dependencies(bench bench-${NAME})
+endfunction()
+
+# Find the libraries in LIBRARY_NAMES and return their paths in VAR
+function(gpk_find_libraries VAR)
+  set(found)
+  foreach(LIBRARY_NAME IN LISTS ARGN)
+    find_library(LIBRARY_PATH NAMES ${LIBRARY_NAME}
+      PATHS /usr/local/GridPACK/lib
+      /usr/local/ga-5.8/lib
+      /usr/local/petsc-3.16.4/lib
+      /usr/local/boost-1.78.0/lib
+      /usr/lib/x86_64-linux-gnu/openmpi/lib
+      /usr/local/helics/lib
+      NO_CACHE
+      NO_DEFAULT_PATH
+      )
+    if(NOT LIBRARY_PATH)
+      message(FATAL_ERROR "Library '${LIBRARY_NAME}' could not be found.")
+    endif()
+    list(INSERT found 0 ${LIBRARY_PATH})
+    unset(LIBRARY_PATH)
+  endforeach()
+  message(STATUS "All Libraries found: ${found}")
+  set(${VAR} ${found} PARENT_SCOPE)
+endfunction()
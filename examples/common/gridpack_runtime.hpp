@@ -0,0 +1,217 @@
+/*
+ *     Copyright (c) 2013 Battelle Memorial Institute
+ *     Licensed under modified BSD License. A copy of this license can be found
+ *     in the LICENSE file in the top level directory of this distribution.
+ */
+// -------------------------------------------------------------
+/**
+ * @file   gridpack_runtime.hpp
+ *
+ * @brief  Start up and shut down of the libraries used by the GridPACK
+ *         examples.
+ *
+ *  The constructor initializes MPI and GA. The MA stack and heap are sized
+ *  in setMemory from the size of the network configuration file named in
+ *  the input, once it has been read. Unless overridden they are never less
+ *  than the 200000 words that gridpack::Environment and the examples used
+ *  before, which the shipped inputs are known to fit. PETSc and the
+ *  GridPACK math libraries are only initialized when startMath is first
+ *  called. Each phase is timed and report prints the startup times,
+ *  maximum over processes. The optional Configuration.Runtime block can
+ *  override the MA sizes
+ *
+ *    <Runtime>
+ *      <maStack>...</maStack>         words, overrides the estimate
+ *      <maHeap>...</maHeap>           words, overrides the estimate
+ *      <maWordsPerRecord>16</maWordsPerRecord>
+ *      <maMinimum>200000</maMinimum>  smallest estimated stack and heap
+ *    </Runtime>
+ *
+ *  The network file is counted as one record per 80 bytes, divided over
+ *  the processes, and the estimate is maMinimum plus maWordsPerRecord
+ *  words for each record.
+ *
+ */
+// -------------------------------------------------------------
+
+#ifndef _gridpack_runtime_h_
+#define _gridpack_runtime_h_
+
+#include "mpi.h"
+#include <ga.h>
+#include <macdecls.h>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <sys/stat.h>
+#include "gridpack/include/gridpack.hpp"
+
+// Estimated size of a record in a network configuration file
+#define GRIDPACK_RUNTIME_RECORD_BYTES 80
+// Fixed MA stack and heap (words) used before the sizes were estimated
+#define GRIDPACK_RUNTIME_MA_MINIMUM 200000
+
+namespace gridpack {
+
+class Runtime {
+  public:
+    /**
+     * Initialize MPI and GA
+     * @param argc number of command line arguments
+     * @param argv command line arguments
+     */
+    Runtime(int &argc, char **&argv)
+      : p_argc(&argc), p_argv(&argv)
+    {
+      p_ma = false;
+      p_math = false;
+      p_stack = 0;
+      p_heap = 0;
+      p_t_config = 0.0;
+      p_t_ma = 0.0;
+      p_t_math = 0.0;
+      double t_start = now();
+      MPI_Init(&argc, &argv);
+      p_t_mpi = now()-t_start;
+      t_start = now();
+      GA_Initialize();
+      p_t_ga = now()-t_start;
+      p_t_mark = now();
+    }
+
+    /**
+     * Finalize the math libraries, if they were started, GA and MPI. All
+     * GridPACK objects must have been destroyed
+     */
+    ~Runtime(void)
+    {
+      if (p_math) gridpack::math::Finalize();
+      GA_Terminate();
+      MPI_Finalize();
+    }
+
+    /**
+     * Initialize MA with a stack and heap sized for the network named in
+     * the configuration. Must be called before the network is read.
+     * Collective on the world communicator
+     * @param config configuration, already opened
+     * @param block path of the block with the networkConfiguration field,
+     *        e.g. "Configuration.Powerflow"
+     * @return false if MA could not be initialized
+     */
+    bool setMemory(gridpack::utility::Configuration *config,
+        const std::string &block)
+    {
+      if (p_ma) return true;
+      // Time since the libraries were initialized
+      p_t_config = now()-p_t_mark;
+      double t_start = now();
+      int me, nprocs;
+      MPI_Comm_rank(MPI_COMM_WORLD, &me);
+      MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+      // The size of the network file is found on process 0 and broadcast
+      double bytes = 0.0;
+      if (me == 0) {
+        gridpack::utility::Configuration::CursorPtr cursor;
+        cursor = config->getCursor(block);
+        std::string filename;
+        const char *keys[] = {"networkConfiguration",
+          "networkConfiguration_v33", "networkConfiguration_v34",
+          "networkConfiguration_v35", "networkConfiguration_v36"};
+        int i;
+        for (i=0; cursor && i<5 && filename.empty(); i++) {
+          cursor->get(keys[i],&filename);
+        }
+        gridpack::utility::StringUtils util;
+        util.trim(filename);
+        struct stat buf;
+        if (!filename.empty() && stat(filename.c_str(),&buf) == 0) {
+          bytes = static_cast<double>(buf.st_size);
+        }
+      }
+      MPI_Bcast(&bytes, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+      long words = 16;
+      long minimum = GRIDPACK_RUNTIME_MA_MINIMUM;
+      long stack = 0;
+      long heap = 0;
+      gridpack::utility::Configuration::CursorPtr rcursor;
+      rcursor = config->getCursor("Configuration.Runtime");
+      if (rcursor) {
+        words = rcursor->get("maWordsPerRecord",static_cast<int>(words));
+        minimum = rcursor->get("maMinimum",static_cast<int>(minimum));
+        stack = rcursor->get("maStack",0);
+        heap = rcursor->get("maHeap",0);
+      }
+      double records = bytes/GRIDPACK_RUNTIME_RECORD_BYTES;
+      long estimate = minimum+static_cast<long>(words*records/nprocs);
+      p_stack = (stack > 0) ? stack : estimate;
+      p_heap = (heap > 0) ? heap : estimate;
+      int ok = MA_init(C_DBL, p_stack, p_heap) ? 1 : 0;
+      MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+      p_ma = true;
+      p_t_ma = now()-t_start;
+      p_t_mark = now();
+      if (!ok && me == 0) {
+        printf("Unable to initialize MA with stack %ld and heap %ld words\n",
+            p_stack,p_heap);
+      }
+      return ok != 0;
+    }
+
+    /**
+     * Initialize PETSc and the GridPACK math libraries if they have not
+     * been initialized already. Must be called on all processes before
+     * the first math object is created
+     */
+    void startMath(void)
+    {
+      if (p_math) return;
+      double t_start = now();
+      gridpack::math::Initialize(p_argc,p_argv);
+      p_math = true;
+      p_t_math = now()-t_start;
+    }
+
+    /**
+     * Print the startup times on process 0. Collective on the world
+     * communicator
+     * @param name name of the application
+     */
+    void report(const char *name)
+    {
+      double t[5] = {p_t_mpi, p_t_ga, p_t_config, p_t_ma, p_t_math};
+      MPI_Allreduce(MPI_IN_PLACE, t, 5, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+      int me;
+      MPI_Comm_rank(MPI_COMM_WORLD, &me);
+      if (me != 0) return;
+      printf("%s startup: MPI %f s GA %f s configuration %f s MA %f s"
+          " (stack %ld heap %ld words) math %f s%s\n",name,t[0],t[1],t[2],
+          t[3],p_stack,p_heap,t[4],p_math ? "" : " (not started)");
+    }
+
+  private:
+
+    /**
+     * Wall clock time, also available before MPI is initialized
+     * @return time in seconds
+     */
+    static double now(void)
+    {
+      return std::chrono::duration<double>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    int *p_argc;
+    char ***p_argv;
+    bool p_ma;
+    bool p_math;
+    long p_stack;
+    long p_heap;
+    double p_t_mark;
+    double p_t_mpi, p_t_ga, p_t_config, p_t_ma, p_t_math;
+};
+
+} // gridpack
+#endif
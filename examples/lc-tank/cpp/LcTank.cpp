@@ -0,0 +1,37 @@
+#include <iostream>
+#include <thread>
+#include <helics/application_api/BrokerApp.hpp>
+#include "LcTankElement.hpp"
+
+// Runs the broker, the capacitor and the inductor in one process. With the
+// default inproc core the federates exchange values through memory without
+// any sockets; --core ipc uses the shared memory core instead. Takes the
+// same options as the Capacitor and Inductor federates
+int main(int argc, char** argv) {
+  RunOptions options = parseOptions(argc, argv);
+  bool core_set = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "--core") core_set = true;
+  }
+  if (!core_set) options.core = "inproc";
+
+  // Broker for the two federates of this process. Each federate creates
+  // its own core, which connects to this broker
+  helics::BrokerApp broker(coreType(options.core), "--federates=2");
+  if (!broker.isConnected()) {
+    std::cerr << "Unable to start " << options.core << " broker" << std::endl;
+    return 1;
+  }
+
+  int status[2] = {0, 0};
+  std::thread inductor([&] {
+    status[0] = runElement(inductorSpec(), options);
+  });
+  std::thread capacitor([&] {
+    status[1] = runElement(capacitorSpec(), options);
+  });
+  inductor.join();
+  capacitor.join();
+  broker.waitForDisconnect();
+  return (status[0] != 0 || status[1] != 0) ? 1 : 0;
+}
@@ -0,0 +1,221 @@
+#ifndef LC_TANK_ELEMENT_HPP
+#define LC_TANK_ELEMENT_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <helics/application_api/ValueFederate.hpp>
+#include "SampleWriter.hpp"
+#include "LocalIntegrator.hpp"
+
+// One element of the LC tank run as a HELICS federate. The capacitor and
+// the inductor only differ in their names, units, initial state and the
+// sign of the gain, so both are described by an ElementSpec and run by
+// runElement, either as separate executables (Capacitor, Inductor) or as
+// two threads of one process (LcTank).
+
+struct ElementSpec {
+  std::string name;
+  // Published state and subscribed input of the other element
+  std::string publication;
+  std::string publication_unit;
+  std::string subscription;
+  std::string subscription_unit;
+  // dx/dt = gain * u
+  double initial_value;
+  double gain;
+  bool wait_for_current_time_update;
+  // Results file (without extension) and column label
+  std::string output;
+  std::string column;
+};
+
+inline ElementSpec capacitorSpec() {
+  double c_value = 0.159;
+  return ElementSpec{"Capacitor", "Vc", "V", "Inductor/Il", "A", 0.0,
+                     -1.0 / c_value, true, "Capacitor_Voltage",
+                     "Capacitor Voltage (V)"};
+}
+
+inline ElementSpec inductorSpec() {
+  double l_value = 0.159;
+  return ElementSpec{"Inductor", "Il", "A", "Capacitor/Vc", "V", 1.0,
+                     1.0 / l_value, false, "Inductor_Current",
+                     "Inductor Current (A)"};
+}
+
+// Core type for the --core option. zmq and tcp talk to the broker over
+// sockets, ipc uses shared memory between processes on one host and inproc
+// only works for federates in the same process as the broker
+inline helics::CoreType coreType(const std::string& name) {
+  if (name == "tcp") return helics::CoreType::TCP;
+  if (name == "ipc") return helics::CoreType::IPC;
+  if (name == "inproc") return helics::CoreType::INPROC;
+  if (name != "zmq") {
+    std::cerr << "Unknown core type " << name << ", using zmq" << std::endl;
+  }
+  return helics::CoreType::ZMQ;
+}
+
+// Run one element until the end of the co-simulation. The wall clock time
+// of each exchange (time request, reading the input and publishing the
+// state) is measured separately from the local integration and summarized
+// on exit. Returns the process exit code
+inline int runElement(const ElementSpec& spec, const RunOptions& options) {
+  // Create a FederateInfo object
+  helics::FederateInfo fi;
+
+  // Select the core type, set one core per federate
+  fi.coreType = coreType(options.core);
+  fi.coreInitString = "--federates=1";
+
+  // Logging in debug mode
+  fi.setProperty(HELICS_PROPERTY_INT_LOG_LEVEL,HELICS_LOG_LEVEL_DEBUG);
+
+  // Set Simulator resolution. Values are exchanged every substeps local
+  // integration steps
+  double period = 100e-6;
+  double exchange = period * options.substeps;
+  fi.setProperty(HELICS_PROPERTY_TIME_PERIOD,exchange);
+
+  // Set some flags
+  fi.setFlagOption(HELICS_FLAG_UNINTERRUPTIBLE, false);
+  fi.setFlagOption(HELICS_FLAG_TERMINATE_ON_ERROR, true);
+  fi.setFlagOption(HELICS_FLAG_WAIT_FOR_CURRENT_TIME_UPDATE,
+                   spec.wait_for_current_time_update);
+
+  // Create Value Federate
+  helics::ValueFederate fed(spec.name,fi);
+  std::cout << "HELICS " << spec.name << " Federate created successfully."
+            << std::endl;
+
+  // Registering Publications and subscriptions
+  auto pub_id = fed.registerPublication(spec.publication, "double",
+                                        spec.publication_unit);
+  auto sub_id = fed.registerSubscription(spec.subscription,
+                                         spec.subscription_unit);
+
+  // Publish the initial state in initialization mode, so that each element
+  // starts with the initial state of the other one
+  double state = spec.initial_value;
+  fed.enterInitializingMode();
+  pub_id.publish(state);
+
+  // Enter execution mode (this transitions the federate from initialization to execution)
+  fed.enterExecutingMode();
+  std::cout << "Federate has entered execution mode." << std::endl;
+
+  // Simulation Initialization
+  double total_interval = options.end_time;
+  double grantedtime = 0.0;
+  CouplingInput input;
+  input.add(grantedtime, sub_id.getDouble());
+
+  // Results are streamed to disk while the federate runs, so memory use
+  // does not depend on the length of the run
+  SampleWriter writer(spec.output + (options.binary ? ".bin" : ".csv"),
+                      {"Time (s)", spec.column}, options.binary);
+  if (!writer.is_open()) {
+    std::cerr << "Unable to open results file" << std::endl;
+  }
+  double row[2] = {grantedtime, state};
+  writer.write(row);
+
+  // Exchange times (s), preallocated so that timing does not allocate
+  std::vector<double> exchange_time;
+  exchange_time.reserve(static_cast<size_t>(total_interval / exchange) + 2);
+  typedef std::chrono::steady_clock clock;
+
+  // A federate that does not wait for the current time update is granted
+  // each time before the other element has published its state for it, so
+  // the value it receives is the one for the start of the interval and the
+  // input is extrapolated over the interval. With the trapezoidal rule and
+  // RK4, the previous interval is integrated again from its start state once
+  // the value for its end has been received, and the states of the
+  // corrected interval are recorded; only the published state is
+  // extrapolated. Euler keeps the original scheme
+  bool extrapolated = !spec.wait_for_current_time_update;
+  bool correct = extrapolated && options.method != Integrator::Euler;
+  double base_time = grantedtime;
+  double base_state = state;
+
+  // Integrate the state over [t0, t1] in substeps local steps, recording
+  // each step if requested
+  auto integrate = [&](double t0, double t1, bool record) {
+    double h = (t1 - t0) / options.substeps;
+    for (int k = 0; k < options.substeps; ++k) {
+      double t = t0 + k * h;
+      state = advance(state, spec.gain, input, t, h, options.method);
+
+      // Store updates
+      if (record) {
+        row[0] = t + h;
+        row[1] = state;
+        writer.write(row);
+      }
+    }
+  };
+
+  // Entering simulation loop
+  clock::time_point t_start = clock::now();
+  while (grantedtime < total_interval) {
+    // Request time
+    double start_time = grantedtime;
+    grantedtime = fed.requestTime(grantedtime+exchange);
+
+    // Get the state of the other element and integrate over the exchange
+    // interval
+    double input_value = sub_id.getDouble();
+    double t_exchange =
+      std::chrono::duration<double>(clock::now() - t_start).count();
+    input.add(extrapolated ? start_time : grantedtime, input_value);
+    if (correct && start_time > base_time) {
+      state = base_state;
+      integrate(base_time, start_time, true);
+    }
+    base_time = start_time;
+    base_state = state;
+    integrate(start_time, grantedtime, !correct);
+
+    // Publish new state
+    t_start = clock::now();
+    pub_id.publish(state);
+    t_exchange +=
+      std::chrono::duration<double>(clock::now() - t_start).count();
+    exchange_time.push_back(t_exchange);
+    t_start = clock::now();
+  }
+
+  // The last interval is not corrected, record its extrapolated states
+  if (correct && grantedtime > base_time) {
+    state = base_state;
+    integrate(base_time, grantedtime, true);
+  }
+
+  // Write the last buffered results
+  writer.close();
+
+  // Exchange time summary, in a fixed format read by lc-tank-bench.sh
+  size_t nsteps = exchange_time.size();
+  if (nsteps > 0) {
+    double total = 0.0;
+    for (double t : exchange_time) total += t;
+    std::sort(exchange_time.begin(), exchange_time.end());
+    std::printf("%s exchange time (us) core %s steps %zu mean %.3f "
+                "p50 %.3f p99 %.3f\n", spec.name.c_str(),
+                options.core.c_str(), nsteps, 1.0e6 * total / nsteps,
+                1.0e6 * exchange_time[nsteps / 2],
+                1.0e6 * exchange_time[(nsteps * 99) / 100]);
+  }
+
+  // Finalize the federate to clean up and disconnect from the HELICS core
+  fed.finalize();
+  std::cout << "Federate finalized." << std::endl;
+
+  return 0;
+}
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef LC_TANK_LOCAL_INTEGRATOR_HPP
+#define LC_TANK_LOCAL_INTEGRATOR_HPP
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Local integration of one lc-tank state between HELICS exchanges. Each
+// federate integrates dx/dt = gain * u(t), where u is the value received
+// from the other federate. The exchange interval is split into substeps
+// local steps, and u is reconstructed from the values received over the
+// last exchanges, so the exchange interval can be widened without a loss of
+// accuracy from holding u constant.
+
+enum class Integrator { Euler, Trapezoidal, RK4 };
+
+struct RunOptions {
+  // Write results as binary doubles instead of CSV
+  bool binary = false;
+  // Local steps per HELICS exchange
+  int substeps = 1;
+  Integrator method = Integrator::Euler;
+  // HELICS core type and end of the co-simulation (s)
+  std::string core = "zmq";
+  double end_time = 10.0;
+};
+
+// Options: --binary, --substeps N, --integrator euler|trapezoidal|rk4,
+// --core zmq|tcp|ipc|inproc and --end-time T. The defaults (one forward
+// Euler step per exchange over a ZMQ core) reproduce the original federates
+inline RunOptions parseOptions(int argc, char** argv) {
+  RunOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg == "--binary") {
+      options.binary = true;
+    } else if (arg == "--substeps" && i + 1 < argc) {
+      options.substeps = std::atoi(argv[++i]);
+      if (options.substeps < 1) options.substeps = 1;
+    } else if (arg == "--integrator" && i + 1 < argc) {
+      std::string name(argv[++i]);
+      if (name == "trapezoidal") {
+        options.method = Integrator::Trapezoidal;
+      } else if (name == "rk4") {
+        options.method = Integrator::RK4;
+      } else {
+        if (name != "euler") {
+          std::cerr << "Unknown integrator " << name << ", using euler"
+                    << std::endl;
+        }
+        options.method = Integrator::Euler;
+      }
+    } else if (arg == "--core" && i + 1 < argc) {
+      options.core = argv[++i];
+    } else if (arg == "--end-time" && i + 1 < argc) {
+      options.end_time = std::atof(argv[++i]);
+    } else {
+      std::cerr << "Ignoring unknown option " << arg << std::endl;
+    }
+  }
+  return options;
+}
+
+// Coupling input of one federate, reconstructed from the last three values
+// received from the other federate and the times they belong to. The
+// input is the polynomial through these samples, so it is interpolated
+// inside the exchange interval when the samples cover it and extrapolated
+// over the interval when the newest sample is from its start
+class CouplingInput {
+public:
+  CouplingInput() : n_(0) {}
+
+  // Add the value received for time t. A value for the time of the newest
+  // sample replaces it
+  void add(double t, double u) {
+    if (n_ > 0 && t <= t_[n_ - 1]) {
+      u_[n_ - 1] = u;
+      return;
+    }
+    if (n_ == 3) {
+      for (int i = 0; i < 2; ++i) {
+        t_[i] = t_[i + 1];
+        u_[i] = u_[i + 1];
+      }
+      n_ = 2;
+    }
+    t_[n_] = t;
+    u_[n_] = u;
+    ++n_;
+  }
+
+  // Time of the newest sample
+  double latest() const { return n_ > 0 ? t_[n_ - 1] : 0.0; }
+
+  double operator()(double t) const {
+    double value = 0.0;
+    for (int i = 0; i < n_; ++i) {
+      double l = 1.0;
+      for (int j = 0; j < n_; ++j) {
+        if (j != i) l *= (t - t_[j]) / (t_[i] - t_[j]);
+      }
+      value += l * u_[i];
+    }
+    return value;
+  }
+
+private:
+  double t_[3];
+  double u_[3];
+  int n_;
+};
+
+// Advance x by one local step of size h from time t. Forward Euler uses the
+// newest input available at the end of the step, without extrapolation,
+// which is the value the original federates used for the whole exchange
+// interval. The trapezoidal rule is exact for a linear input and RK4 for a
+// quadratic one
+inline double advance(double x, double gain, const CouplingInput& u,
+                      double t, double h, Integrator method) {
+  switch (method) {
+  case Integrator::Trapezoidal:
+    return x + 0.5 * h * gain * (u(t) + u(t + h));
+  case Integrator::RK4: {
+    double k1 = gain * u(t);
+    double k2 = gain * u(t + 0.5 * h);
+    double k4 = gain * u(t + h);
+    // The right hand side does not depend on x, so k3 equals k2
+    return x + h * (k1 + 4.0 * k2 + k4) / 6.0;
+  }
+  case Integrator::Euler:
+  default:
+    return x + h * gain * u(std::min(t + h, u.latest()));
+  }
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef LC_TANK_SAMPLE_WRITER_HPP
+#define LC_TANK_SAMPLE_WRITER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Streams fixed width rows of samples to disk from a background thread.
+// Rows are collected in blocks; full blocks are handed to the writer thread
+// through a bounded queue, so memory use does not grow with the length of
+// the run and the federate only waits on the disk if it gets more than
+// max_blocks blocks ahead of it.
+//
+// CSV files have a header line followed by one line per row. Binary files
+// start with the 8 character tag "LCTANK01", a 32 bit column count and, for
+// each column, a 32 bit name length followed by the name. The rest of the
+// file holds the rows as native doubles, one row after another.
+class SampleWriter {
+public:
+  SampleWriter(const std::string& filename,
+               const std::vector<std::string>& columns, bool binary,
+               size_t block_rows = 4096, size_t max_blocks = 4)
+    : ncol_(columns.size()), block_size_(block_rows * columns.size()),
+      max_blocks_(max_blocks), binary_(binary), done_(false)
+  {
+    file_ = std::fopen(filename.c_str(), binary_ ? "wb" : "w");
+    if (file_ == nullptr) return;
+    if (binary_) {
+      std::fwrite("LCTANK01", 1, 8, file_);
+      uint32_t len = ncol_;
+      std::fwrite(&len, sizeof(len), 1, file_);
+      for (const auto& name : columns) {
+        len = name.size();
+        std::fwrite(&len, sizeof(len), 1, file_);
+        std::fwrite(name.data(), 1, len, file_);
+      }
+    } else {
+      for (size_t i = 0; i < ncol_; ++i) {
+        std::fprintf(file_, "%s%s", columns[i].c_str(),
+                     i + 1 < ncol_ ? ", " : "\n");
+      }
+    }
+    current_.reserve(block_size_);
+    writer_ = std::thread(&SampleWriter::run, this);
+  }
+
+  ~SampleWriter() { close(); }
+
+  SampleWriter(const SampleWriter&) = delete;
+  SampleWriter& operator=(const SampleWriter&) = delete;
+
+  bool is_open() const { return file_ != nullptr; }
+
+  // Append one row with a value for each column
+  void write(const double* row) {
+    if (file_ == nullptr) return;
+    current_.insert(current_.end(), row, row + ncol_);
+    if (current_.size() >= block_size_) submit();
+  }
+
+  // Write any buffered rows, wait for the writer thread and close the file
+  void close() {
+    if (file_ == nullptr) return;
+    if (!current_.empty()) submit();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    ready_.notify_one();
+    writer_.join();
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+
+private:
+  // Hand the current block to the writer thread, waiting for space in the
+  // queue, and start a new block with recycled storage
+  void submit() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    space_.wait(lock, [this] { return queue_.size() < max_blocks_; });
+    queue_.push_back(std::move(current_));
+    if (!spare_.empty()) {
+      current_ = std::move(spare_.back());
+      spare_.pop_back();
+    } else {
+      current_ = std::vector<double>();
+    }
+    lock.unlock();
+    ready_.notify_one();
+    current_.clear();
+    current_.reserve(block_size_);
+  }
+
+  void run() {
+    std::vector<char> text;
+    for (;;) {
+      std::vector<double> block;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [this] { return done_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+        block = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      space_.notify_one();
+      if (binary_) {
+        std::fwrite(block.data(), sizeof(double), block.size(), file_);
+      } else {
+        // Format the whole block before writing it with a single call
+        const size_t field = 32;
+        text.resize(block.size() * field + 1);
+        char* ptr = text.data();
+        for (size_t i = 0; i < block.size(); ++i) {
+          ptr += std::snprintf(ptr, field, "%.10g%s", block[i],
+                               (i + 1) % ncol_ == 0 ? "\n" : ", ");
+        }
+        std::fwrite(text.data(), 1, ptr - text.data(), file_);
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      spare_.push_back(std::move(block));
+    }
+  }
+
+  size_t ncol_;
+  size_t block_size_;
+  size_t max_blocks_;
+  bool binary_;
+  std::FILE* file_;
+
+  // Block being filled by the federate
+  std::vector<double> current_;
+
+  // Full blocks waiting to be written, and written blocks whose storage is
+  // reused
+  std::deque<std::vector<double> > queue_;
+  std::vector<std::vector<double> > spare_;
+  bool done_;
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::condition_variable space_;
+  std::thread writer_;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#!/bin/bash
+# Compare the per-step exchange time of the lc-tank federates on ZMQ, IPC
+# and INPROC cores. Each federate prints the mean, median and 99th
+# percentile time of its exchanges with the broker, which is collected
+# into a table. Extra arguments are passed to the federates, e.g.
+#
+#   ./lc-tank-bench.sh 1.0 --substeps 10 --integrator rk4
+#
+# runs 1 s of simulated time with 10 local steps per exchange
+END_TIME=${1:-1.0}
+shift
+OPTIONS="--end-time $END_TIME $*"
+
+for CORE in zmq ipc; do
+  helics_broker --type=$CORE --federates=2 > bench_${CORE}_broker.log 2>&1 &
+  ./Inductor --core $CORE $OPTIONS > bench_${CORE}_inductor.log 2>&1 &
+  ./Capacitor --core $CORE $OPTIONS > bench_${CORE}_capacitor.log 2>&1
+  wait
+done
+./LcTank --core inproc $OPTIONS > bench_inproc.log 2>&1
+
+printf "%-10s %-8s %10s %10s %10s %10s\n" federate core steps mean_us \
+  p50_us p99_us
+grep -h "exchange time" bench_zmq_*.log bench_ipc_*.log bench_inproc.log |
+  awk '{printf "%-10s %-8s %10s %10s %10s %10s\n", $1, $6, $8, $10, $12, $14}'
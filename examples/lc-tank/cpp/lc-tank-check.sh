@@ -0,0 +1,33 @@
+#!/bin/bash
+# Compare the lc-tank results of each local integrator with the analytic
+# solution of the LC tank, Il(t) = cos(w t) and Vc(t) = -sqrt(L/C) sin(w t)
+# with w = 1/sqrt(L C), and print the largest error of each. With one
+# local step per exchange the error falls from euler (first order) to
+# trapezoidal (second order) to rk4 (third order, limited by the quadratic
+# reconstruction of the coupling input). Extra arguments are passed to the
+# federates, e.g.
+#
+#   ./lc-tank-check.sh 1.0 --substeps 10
+#
+# checks 1 s of simulated time with 10 local steps per exchange. Over wider
+# exchange intervals the error of trapezoidal and rk4 is that of the
+# coupling, which is the same for both
+END_TIME=${1:-1.0}
+shift
+OPTIONS="--end-time $END_TIME $*"
+
+# Element values of capacitorSpec and inductorSpec in LcTankElement.hpp
+L=0.159
+C=0.159
+
+printf "%-12s %14s %14s\n" integrator max_err_Il max_err_Vc
+for METHOD in euler trapezoidal rk4; do
+  ./LcTank --integrator $METHOD $OPTIONS > check_$METHOD.log 2>&1 || exit 1
+  IL=$(awk -F, -v L=$L -v C=$C 'NR > 1 {
+         e = $2 - cos($1 / sqrt(L * C)); if (e < 0) e = -e
+         if (e > m) m = e } END { printf "%.3e", m }' Inductor_Current.csv)
+  VC=$(awk -F, -v L=$L -v C=$C 'NR > 1 {
+         e = $2 + sqrt(L / C) * sin($1 / sqrt(L * C)); if (e < 0) e = -e
+         if (e > m) m = e } END { printf "%.3e", m }' Capacitor_Voltage.csv)
+  printf "%-12s %14s %14s\n" $METHOD $IL $VC
+done
@@ -1,66 +1,230 @@
-#include <helics/cpp98/Federate.hpp>
-#include <helics/cpp98/ValueFederate.hpp>
-#include <helics/cpp98/Publication.hpp>
-#include <helics/cpp98/Input.hpp>
-#include <helics/cpp98/helicsExceptions.hpp>
 #include <iostream>
+#include <vector>
+#include <cmath>
 #include <complex>
+#include <string>
+#include <helics/application_api/ValueFederate.hpp>
 
-int main(int argc, char *argv[]) {
+// GridPACK inludes
+#include "mpi.h"
+#include "gridpack/include/gridpack.hpp"
+#include "gridpack_runtime.hpp"
+#include "pf_app.hpp"
+#include "signal_recorder.hpp"
+
+// Transmission federate for the switch T-D co-simulation. Every time step
+// the phase A current drawn by the GridLAB-D feeder is converted to a
+// balanced three phase load on the boundary bus of the 2-bus network, the
+// power flow is solved with the persistent GridPACK application from the
+// 2bus-13bus example and the three phase voltages at the boundary bus are
+// published back to the feeder head. The HELICS interfaces are declared in
+// the JSON file named by the configFile parameter of the Federate block
+
+int main(int argc, char **argv) {
+  // Prepare GridPACK runtime. MA is sized from the network once the input
+  // has been read
+  gridpack::Runtime runtime(argc, argv);
+  gridpack::parallel::Communicator world;
+  int i;
+
+  // The co-simulation runner starts the federate without arguments, so
+  // fall back to the input file for this example
+  char default_input[] = "gridpack_input_2_bus.xml";
+  char *input_argv[2];
+  input_argv[0] = argv[0];
+  input_argv[1] = default_input;
+  if (argc < 2) {
+    argc = 2;
+    argv = input_argv;
+  }
+
+  // Read the Powerflow block once
+  gridpack::powerflow::PFSettings settings;
+  bool ok = gridpack::powerflow::PFApp::readSettings(argc, argv, world,
+      settings);
+  if (ok) ok = runtime.setMemory(
+      gridpack::utility::Configuration::configuration(),
+      "Configuration.Powerflow");
+  runtime.startMath();
+  runtime.report("GridPACK federate");
+
+  // Run control parameters. Defaults correspond to the 10 steps of 60 s
+  // used by the other federates
+  //   configFile: HELICS configuration with the three voltage
+  //     publications and the load current subscription, in that order
+  //   endTime: end of the co-simulation (s)
+  //   voltageBase: line to neutral voltage (V) of 1 per unit voltage at the
+  //     feeder head
+  //   powerBase: system base of the network (VA)
+  //   signalFile: boundary signal and solve time output
+  std::string config_file = "gridpack_fed.json";
+  double end_time = 600.0;
+  double voltage_base = 7200.0;
+  double power_base = 1.0e8;
+  std::string signal_file = "gridpack_federate.csv";
+  gridpack::utility::Configuration::CursorPtr cursor;
+  cursor = gridpack::utility::Configuration::configuration()->getCursor(
+      "Configuration.Federate");
+  if (cursor) {
+    cursor->get("configFile",&config_file);
+    end_time = cursor->get("endTime",end_time);
+    voltage_base = cursor->get("voltageBase",voltage_base);
+    power_base = cursor->get("powerBase",power_base);
+    cursor->get("signalFile",&signal_file);
+  }
+
+  // Build the network, mappers and solvers once. Each time step only
+  // updates the boundary load and reruns the Newton-Raphson iterations
+  boost::shared_ptr<gridpack::powerflow::PFApp> app;
+  if (ok) {
+    app.reset(new gridpack::powerflow::PFApp);
+    ok = app->initialize(settings, world);
+  }
+  int nfail = ok ? 0 : 1;
+  world.sum(&nfail,1);
+  if (nfail > 0) {
+    if (world.rank() == 0) {
+      std::cerr << "Unable to initialize GridPACK power flow" << std::endl;
+    }
+    app.reset();
+    return 1;
+  }
+
+  // Only process 0 joins the federation. The load is broadcast to the
+  // other processes, which all get the boundary voltage from solve
+  bool io_rank = (world.rank() == 0);
+  boost::shared_ptr<helics::ValueFederate> gpk_fed;
+  std::vector<helics::Publication> V_id;
+  helics::Input I_id;
+  if (io_rank) {
     try {
-        // Create FederateInfo object for initializing the federate
-        helicscpp::FederateInfo fi;
-        fi.setCoreInit("--federates=1");  // Set initialization string
-        fi.setCoreType(HELICS_CORE_TYPE_ZMQ);  // Set core type (ZMQ)
-
-        // Create a ValueFederate instance
-        helicscpp::ValueFederate fed("gridpack", fi);
-
-        // Register publications (voltages)
-        std::cout << "Registering publications..." << std::endl;
-        helicscpp::Publication voltage_pub_A = fed.registerGlobalPublication("gridpack/voltage_A", "complex", "");
-        helicscpp::Publication voltage_pub_B = fed.registerGlobalPublication("gridpack/voltage_B", "complex", "");
-        helicscpp::Publication voltage_pub_C = fed.registerGlobalPublication("gridpack/voltage_C", "complex", "");
-        std::cout << "Publications registered successfully." << std::endl;
-
-        // Register subscription (load current)
-        std::cout << "Registering subscription..." << std::endl;
-        helicscpp::Input load_current_sub = fed.registerSubscription("load_meter/current");
-        std::cout << "Subscription registered successfully." << std::endl;
-
-        // Enter the execution state
-        fed.enterExecutingMode();
-        std::cout << "Federate entered execution mode." << std::endl;
-
-        // Simulation loop for 10 time steps
-        for (int t = 0; t < 10; ++t) {
-            // Request time advancement
-            std::cout << "Requesting time advancement to: " << t + 1 << std::endl;
-            fed.requestTime(t + 1.0);
-
-            // Retrieve load current from subscription
-            std::complex<double> load_current = load_current_sub.getComplex();
-            std::cout << "Received load current: " << load_current << " at time step " << t << std::endl;
-
-            // For demonstration purposes, we assume a simple computation here
-            std::complex<double> voltage_A = std::complex<double>(load_current.real() * 1.1, load_current.imag() * 1.1);
-            std::complex<double> voltage_B = std::complex<double>(load_current.real() * 1.2, load_current.imag() * 1.2);
-            std::complex<double> voltage_C = std::complex<double>(load_current.real() * 1.3, load_current.imag() * 1.3);
-
-            // Publish voltages
-            voltage_pub_A.publish(voltage_A);
-            voltage_pub_B.publish(voltage_B);
-            voltage_pub_C.publish(voltage_C);
-            std::cout << "Published voltages at time step " << t << std::endl;
-        }
-
-        // Finalize the federate
-        fed.finalize();
-        std::cout << "Federate finalized successfully." << std::endl;
-    } catch (const helicscpp::HelicsException& e) {
-        std::cerr << "HELICS Error: " << e.what() << std::endl;
-        return -1;
+      gpk_fed.reset(new helics::ValueFederate(config_file));
+      for (i=0; i<3; i++) V_id.push_back(gpk_fed->getPublication(i));
+      I_id = gpk_fed->getInput(0);
+    } catch (const std::exception &e) {
+      std::cerr << "Unable to create HELICS federate from " << config_file
+                << ": " << e.what() << std::endl;
+      ok = false;
     }
+  }
+  nfail = ok ? 0 : 1;
+  world.sum(&nfail,1);
+  if (nfail > 0) {
+    app.reset();
+    return 1;
+  }
+
+  // Phase rotations of the published voltages
+  std::vector<std::complex<double> > rotation(3);
+  rotation[0] = std::complex<double>(1.0,0.0);
+  rotation[1] = std::polar(1.0,-2.0*M_PI/3.0);
+  rotation[2] = std::polar(1.0,2.0*M_PI/3.0);
+
+  // Recorder for the boundary signals and the wall clock time of each
+  // solve (s)
+  std::vector<std::string> columns;
+  columns.push_back("time");
+  columns.push_back("I_re");
+  columns.push_back("I_im");
+  columns.push_back("S_re");
+  columns.push_back("S_im");
+  columns.push_back("V_re");
+  columns.push_back("V_im");
+  columns.push_back("iterations");
+  columns.push_back("t_solve");
+  gridpack::powerflow::SignalRecorder recorder(columns,4096,false);
+  if (io_rank && !recorder.open(signal_file)) {
+    std::cerr << "Unable to open signal file " << signal_file << std::endl;
+  }
+  std::vector<double> signals(columns.size());
+
+  if (io_rank) {
+    gpk_fed->enterExecutingMode();
+    std::cout << "GridPACK Federate has entered execution mode." << std::endl;
+  }
+
+  // Publish the nominal voltage so that the feeder can compute its first
+  // current
+  std::complex<double> V(1.0,0.0);
+  if (io_rank) {
+    for (i=0; i<3; i++) V_id[i].publish(V*rotation[i]*voltage_base);
+  }
+
+  double grantedtime = 0.0;
+  double t_solve = 0.0;
+  double total_solve = 0.0;
+  double max_solve = 0.0;
+  int nsteps = 0;
+  std::vector<double> sbuf(5);
+  while (grantedtime < end_time) {
+    std::complex<double> I(0.0,0.0);
+    for (i=0; i<sbuf.size(); i++) sbuf[i] = 0.0;
+    if (io_rank) {
+      // The period in the HELICS configuration rounds the request up to
+      // the next co-simulation step
+      grantedtime = gpk_fed->requestTime(grantedtime+1.0);
+      // The feeder head is balanced, so the three phase load is three
+      // times the phase A power at the last published voltage
+      I = I_id.getValue<std::complex<double> >();
+      std::complex<double> S = 3.0*V*voltage_base*std::conj(I)/power_base;
+      sbuf[0] = S.real();
+      sbuf[1] = S.imag();
+      sbuf[2] = grantedtime;
+      sbuf[3] = I.real();
+      sbuf[4] = I.imag();
+    }
+    world.sum(&sbuf[0],sbuf.size());
+    std::complex<double> S(sbuf[0],sbuf[1]);
+    grantedtime = sbuf[2];
+    I = std::complex<double>(sbuf[3],sbuf[4]);
+
+    // Solve the power flow for the new load
+    double t_start = MPI_Wtime();
+    app->solve(V,S);
+    t_solve = MPI_Wtime()-t_start;
+
+    if (io_rank) {
+      for (i=0; i<3; i++) V_id[i].publish(V*rotation[i]*voltage_base);
+      std::cout << "Time " << grantedtime << " s load: " << S*power_base
+                << " VA voltage: " << std::abs(V) << " pu iterations: "
+                << app->getIterationCount() << " solve: " << t_solve
+                << " s" << std::endl;
+      signals[0] = grantedtime;
+      signals[1] = I.real();
+      signals[2] = I.imag();
+      signals[3] = S.real()*power_base;
+      signals[4] = S.imag()*power_base;
+      signals[5] = V.real()*voltage_base;
+      signals[6] = V.imag()*voltage_base;
+      signals[7] = app->getIterationCount();
+      signals[8] = t_solve;
+      recorder.record(&signals[0]);
+    }
+    total_solve += t_solve;
+    if (t_solve > max_solve) max_solve = t_solve;
+    nsteps++;
+  }
+
+  if (io_rank) {
+    printf("Steps: %d power flow solve time total: %f s mean: %f s max: %f s\n",
+        nsteps,total_solve,nsteps > 0 ? total_solve/nsteps : 0.0,max_solve);
+    printf("Jacobian factorizations/linear solves: %d/%d\n",
+        app->getFactorizationCount(),app->getLinearSolveCount());
+  }
+  recorder.close();
+
+  // Cumulative time spent in each stage of the power flow over all steps
+  gridpack::utility::CoarseTimer::instance()->dump();
+
+  // Release the power flow application. The math libraries are terminated
+  // when the runtime goes out of scope
+  app.reset();
+
+  // Finalize the federate to clean up and disconnect from the HELICS core
+  if (io_rank) {
+    gpk_fed->finalize();
+    std::cout << "Federate finalized." << std::endl;
+  }
 
-    return 0;
+  return 0;
 }
@@ -24,7 +24,8 @@ class AttackEngine:
             'inject_load': self._inject_load,
             'reconnaissance': self._reconnaissance,
             'block_command': self._block_command,
-            'toggle_device': self._toggle_device
+            'toggle_device': self._toggle_device,
+            'schedule_perturbations': self._schedule_perturbations
         }
         
         # Attack parameters and constraints
@@ -189,6 +190,25 @@ class AttackEngine:
             logger.error(f"Error in inject_load attack: {e}")
             return {'success': False, 'error': str(e)}
     
+    def _schedule_perturbations(self, params):
+        """Schedule a batch of load and voltage perturbations in GridPACK"""
+        try:
+            perturbations = params.get('perturbations', [])
+            replace = params.get('replace', False)
+            
+            success = self.federate.schedule_perturbations(perturbations, replace)
+            
+            return {
+                'success': success,
+                'attack_type': 'scheduled_perturbation',
+                'perturbation_count': len(perturbations),
+                'replace': replace
+            }
+            
+        except Exception as e:
+            logger.error(f"Error in schedule_perturbations attack: {e}")
+            return {'success': False, 'error': str(e)}
+    
     def _reconnaissance(self, params):
         """Perform grid reconnaissance"""
         try:
@@ -12,6 +12,8 @@ import threading
 from datetime import datetime
 import numpy as np
 
+from monitor.telemetry_ring import TelemetryRing
+
 logger = logging.getLogger(__name__)
 
 class GridAttackFederate:
@@ -28,11 +30,22 @@ class GridAttackFederate:
         # Subscriptions (grid monitoring)
         self.subscriptions = {}
         
+        # Endpoint for batches of scheduled perturbations sent to the
+        # GridPACK federate
+        self.perturbation_endpoint = None
+        
         # State tracking
         self.current_time = 0.0
         self.grid_state = {}
         self.attack_history = []
         
+        # Shared memory telemetry written by the GridPACK federate. When it
+        # is configured, the GridPACK voltages and boundary loads are read
+        # from the ring instead of HELICS subscriptions
+        self.telemetry = None
+        if config.get('telemetry_ring'):
+            self.telemetry = TelemetryRing(config['telemetry_ring'])
+        
         # Synchronization
         self.state_lock = threading.Lock()
         
@@ -100,6 +113,13 @@ class GridAttackFederate:
                 self.federate, "mcp_attack/block_commands", h.helics_data_type_boolean, ""
             )
             
+            # Scheduled perturbations are sent to GridPACK as one message
+            # per batch instead of one publication per value
+            if self.config.get('gridpack_perturbation_endpoint'):
+                self.perturbation_endpoint = h.helicsFederateRegisterEndpoint(
+                    self.federate, "perturbations", ""
+                )
+            
             logger.info(f"Setup {len(self.publications)} attack publications")
             
         except Exception as e:
@@ -120,6 +140,13 @@ class GridAttackFederate:
                 self.federate, "IEEE13bus_fed/gld_hlc_conn/Vc", ""
             )
             
+            # The boundary loads and GridPACK voltages come from the
+            # telemetry ring if one is configured
+            if self.telemetry is not None:
+                logger.info(f"Setup {len(self.subscriptions)} monitoring subscriptions, "
+                            f"GridPACK state from telemetry ring {self.telemetry.name}")
+                return
+            
             # Monitor GridLAB-D power flows at Node650
             self.subscriptions['gld_power_Sa'] = h.helicsFederateRegisterSubscription(
                 self.federate, "IEEE13bus_fed/gld_hlc_conn/Sa", ""
@@ -186,6 +213,9 @@ class GridAttackFederate:
                     except Exception as e:
                         logger.warning(f"Error reading subscription {name}: {e}")
                 
+                # Read the GridPACK federate telemetry
+                self._read_telemetry(grid_data)
+                
                 # Calculate system health indicators
                 grid_data['system_health'] = self._assess_system_health(grid_data)
                 
@@ -194,6 +224,59 @@ class GridAttackFederate:
         except Exception as e:
             logger.error(f"Error updating grid state: {e}")
     
+    def _read_telemetry(self, grid_data):
+        """Add the latest GridPACK federate telemetry to grid data"""
+        if self.telemetry is None:
+            return False
+        if not self.telemetry.is_open() and not self.telemetry.open():
+            return False
+        
+        # Records are consumed in order so that the steps between two
+        # reads are counted, but only the latest one is reported
+        records = self.telemetry.read_new()
+        if not records:
+            return False
+        record = records[-1]
+        
+        # Boundaries are named by the Va_re, Va_im (voltage) and Sa_re,
+        # Sa_im (load) columns
+        for column, value in record.items():
+            if not column.endswith('_re'):
+                continue
+            label = column[:-3]
+            complex_val = complex(value, record.get(label + '_im', 0.0))
+            if label.startswith('V'):
+                grid_data['voltages'][f'gpk_voltage_{label}'] = {
+                    'real': complex_val.real,
+                    'imag': complex_val.imag,
+                    'magnitude': abs(complex_val),
+                    'angle': np.angle(complex_val, deg=True)
+                }
+            elif label.startswith('S'):
+                grid_data['powers'][f'gld_power_{label}'] = {
+                    'real': complex_val.real,
+                    'imag': complex_val.imag,
+                    'magnitude': abs(complex_val),
+                    'power_factor': complex_val.real / abs(complex_val) if abs(complex_val) > 0 else 0
+                }
+        
+        grid_data['gridpack'] = {
+            'time': record['time'],
+            'iterations': {c[len('iterations_'):]: int(v) for c, v in record.items()
+                           if c.startswith('iterations_')},
+            'converged': {c[len('converged_'):]: bool(v) for c, v in record.items()
+                          if c.startswith('converged_')},
+            'coupling_iterations': int(record.get('coupling_iterations', 0)),
+            'tie_iterations': int(record.get('tie_iterations', 0)),
+            'voltage_change': record.get('dv', 0.0),
+            't_blocked': record.get('t_blocked', 0.0),
+            't_compute': record.get('t_compute', 0.0),
+            'steps_read': len(records),
+            'steps_dropped': self.telemetry.dropped,
+            'writer_active': self.telemetry.writer_active()
+        }
+        return True
+    
     def _assess_system_health(self, grid_data):
         """Assess overall system health based on grid data"""
         try:
@@ -336,6 +419,44 @@ class GridAttackFederate:
             logger.error(f"Error blocking commands: {e}")
             return False
     
+    def schedule_perturbations(self, perturbations, replace=False):
+        """Send a batch of time-indexed perturbations to the GridPACK federate
+        
+        Each perturbation is a dict with 'time', optional 'duration', 'type'
+        ('load' or 'voltage'), 'mode' ('add', 'set' or 'scale'), 'value' (a
+        number or a [real, imag] pair) and either 'boundary' or 'case' and
+        'bus'. See examples/2bus-13bus/perturbation_schedule.hpp. GridPACK
+        rejects the whole batch if any entry is not valid.
+        """
+        try:
+            if self.perturbation_endpoint is None:
+                logger.error("No GridPACK perturbation endpoint configured")
+                return False
+            
+            batch = json.dumps({'replace': replace, 'perturbations': perturbations})
+            h.helicsEndpointSendBytesTo(
+                self.perturbation_endpoint, batch,
+                self.config['gridpack_perturbation_endpoint']
+            )
+            
+            # Record attack
+            attack_record = {
+                'timestamp': self.current_time,
+                'type': 'scheduled_perturbation',
+                'target': 'gridpack',
+                'value': perturbations,
+                'replace': replace,
+                'technique': 'schedule_perturbations'
+            }
+            self.attack_history.append(attack_record)
+            
+            logger.info(f"Scheduled {len(perturbations)} perturbations on GridPACK")
+            return True
+            
+        except Exception as e:
+            logger.error(f"Error scheduling perturbations: {e}")
+            return False
+    
     def advance_time(self, time_step=None):
         """Advance simulation time"""
         try:
@@ -357,6 +478,10 @@ class GridAttackFederate:
     def get_current_state(self):
         """Get current grid state"""
         with self.state_lock:
+            # The telemetry ring can be polled without advancing time
+            if self.telemetry is not None and self.grid_state:
+                if self._read_telemetry(self.grid_state):
+                    self.grid_state['system_health'] = self._assess_system_health(self.grid_state)
             return self.grid_state.copy()
     
     def get_attack_history(self):
@@ -386,6 +511,7 @@ class GridAttackFederate:
                 'publications': len(self.publications),
                 'subscriptions': len(self.subscriptions),
                 'attack_count': len(self.attack_history),
+                'telemetry_ring': self.telemetry.name if self.telemetry is not None else None,
                 'is_initialized': self.federate is not None
             }
         except Exception as e:
@@ -404,6 +530,9 @@ class GridAttackFederate:
                 h.helicsFederateInfoFree(self.federate_info)
                 self.federate_info = None
             
+            if self.telemetry is not None:
+                self.telemetry.close()
+            
             logger.info("HELICS federate finalized")
             
         except Exception as e:
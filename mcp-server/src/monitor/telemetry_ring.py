@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+Telemetry Ring - Lock-free reader for the shared memory telemetry ring
+written by the GridPACK federate (examples/2bus-13bus/telemetry_ring.hpp)
+"""
+
+import logging
+import mmap
+import os
+import struct
+
+logger = logging.getLogger(__name__)
+
+TELEMETRY_TAG = b"GPKTEL01"
+TELEMETRY_HEADER_BYTES = 64
+
+
+class TelemetryRing:
+    """Reader for the per-step telemetry of a GridPACK federate
+
+    The writer never waits for readers. A slot is only accepted if its
+    sequence number matches the record both before and after it is copied,
+    so records overwritten while they are read are dropped instead of
+    returned torn.
+
+    Each run of the federate creates a new segment under the same name.
+    The reader follows it by reopening the ring when the file was replaced
+    or the record count went backwards.
+    """
+
+    def __init__(self, name, shm_dir='/dev/shm'):
+        self.name = name
+        self.path = os.path.join(shm_dir, name)
+        self.columns = []
+        self.nslots = 0
+        self.next_record = 0
+        self.dropped = 0
+        self._map = None
+        self._inode = None
+        self._offset = 0
+        self._slot_bytes = 0
+        self._values = None
+
+    def open(self):
+        """Map the ring. Returns False if the federate has not created it"""
+        try:
+            with open(self.path, 'rb') as f:
+                self._map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+                self._inode = os.fstat(f.fileno()).st_ino
+        except (OSError, ValueError) as e:
+            logger.debug(f"Telemetry ring {self.path} not available: {e}")
+            return False
+
+        if self._map[0:8] != TELEMETRY_TAG:
+            logger.error(f"{self.path} is not a telemetry ring")
+            self.close()
+            return False
+        ncol, self.nslots, self._offset, self._slot_bytes = struct.unpack_from(
+            '<4I', self._map, 8)
+        names = self._map[TELEMETRY_HEADER_BYTES:self._offset].split(b'\0')
+        self.columns = [n.decode() for n in names[:ncol]]
+        self._values = struct.Struct(f'<{ncol}d')
+        # Start with the records still held in the ring
+        self.next_record = max(0, self._head() - self.nslots)
+        logger.info(f"Opened telemetry ring {self.path} with {ncol} columns "
+                    f"and {self.nslots} slots")
+        return True
+
+    def is_open(self):
+        return self._map is not None
+
+    def writer_active(self):
+        """True while the federate is writing to the ring"""
+        if self._map is None:
+            return False
+        return struct.unpack_from('<I', self._map, 32)[0] == 1
+
+    def _head(self):
+        return struct.unpack_from('<Q', self._map, 24)[0]
+
+    def _follow_new_run(self):
+        """Reopen the ring if a new run of the federate replaced it"""
+        try:
+            replaced = os.stat(self.path).st_ino != self._inode
+        except OSError:
+            replaced = False
+        if not replaced and self._head() >= self.next_record:
+            return
+        logger.info(f"Telemetry ring {self.path} was recreated, reopening")
+        self.close()
+        self.open()
+
+    def _read_slot(self, record):
+        pos = self._offset + (record % self.nslots) * self._slot_bytes
+        expected = 2 * record + 2
+        if struct.unpack_from('<Q', self._map, pos)[0] != expected:
+            return None
+        values = self._values.unpack_from(self._map, pos + 8)
+        if struct.unpack_from('<Q', self._map, pos)[0] != expected:
+            return None
+        return dict(zip(self.columns, values))
+
+    def read_new(self):
+        """Records written since the last call, oldest first"""
+        if self._map is None:
+            return []
+        self._follow_new_run()
+        if self._map is None:
+            return []
+        head = self._head()
+        if head - self.next_record > self.nslots:
+            self.dropped += head - self.nslots - self.next_record
+            self.next_record = head - self.nslots
+        records = []
+        while self.next_record < head:
+            record = self._read_slot(self.next_record)
+            if record is None:
+                self.dropped += 1
+            else:
+                records.append(record)
+            self.next_record += 1
+        return records
+
+    def latest(self):
+        """Most recent complete record, or None"""
+        if self._map is None:
+            return None
+        self._follow_new_run()
+        if self._map is None:
+            return None
+        head = self._head()
+        record = head - 1
+        while record >= 0 and record >= head - self.nslots:
+            values = self._read_slot(record)
+            if values is not None:
+                return values
+            record -= 1
+        return None
+
+    def close(self):
+        if self._map is not None:
+            self._map.close()
+            self._map = None
+            self._inode = None
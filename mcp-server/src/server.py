@@ -68,7 +68,9 @@ class MCPServer:
                 'broker_address': 'tcp://127.0.0.1:23404',
                 'federate_name': 'mcp_attacker',
                 'time_delta': 1.0,
-                'period': 1.0
+                'period': 1.0,
+                'telemetry_ring': '',
+                'gridpack_perturbation_endpoint': ''
             },
             'attacks': {
                 'max_concurrent': 5,
@@ -35,7 +35,8 @@ class ThreatModelValidator:
                 'spoof_data',
                 'inject_load',
                 'reconnaissance',
-                'block_command'
+                'block_command',
+                'schedule_perturbations'
             ],
             'restricted_targets': [
                 'safety_systems',
@@ -88,6 +89,8 @@ class ThreatModelValidator:
                 validation_result = self._validate_inject_load(params, validation_result)
             elif technique == 'block_command':
                 validation_result = self._validate_block_command(params, validation_result)
+            elif technique == 'schedule_perturbations':
+                validation_result = self._validate_schedule_perturbations(params, validation_result)
             elif technique == 'reconnaissance':
                 # Reconnaissance is generally safe
                 pass
@@ -175,6 +178,43 @@ class ThreatModelValidator:
         
         return validation_result
     
+    def _validate_schedule_perturbations(self, params, validation_result):
+        """Validate a batch of scheduled perturbations
+        
+        GridPACK treats a missing or zero duration as lasting until the end
+        of the run, so each perturbation needs an explicit duration within
+        the limit. Load values are checked against the injection limit.
+        Any bad entry rejects the batch, since GridPACK applies it whole.
+        """
+        perturbations = params.get('perturbations', [])
+        if not isinstance(perturbations, list) or not perturbations:
+            validation_result['valid'] = False
+            validation_result['reason'] = 'No perturbations provided'
+            return validation_result
+        
+        timing_limits = self.constraints.get('timing_limits', {})
+        max_duration = timing_limits.get('max_duration', 300)
+        power_limits = self.constraints.get('power_limits', {})
+        max_injection = power_limits.get('max_injection', 5000000)
+        
+        for n, p in enumerate(perturbations):
+            duration = p.get('duration', 0)
+            if duration <= 0 or duration > max_duration:
+                validation_result['valid'] = False
+                validation_result['reason'] = f'Perturbation {n} duration {duration}s not in (0, {max_duration}]s'
+                return validation_result
+            
+            value = p.get('value', 0)
+            if isinstance(value, (list, tuple)):
+                value = complex(*value[:2])
+            if p.get('type', 'load') == 'load' and p.get('mode', 'add') != 'scale' \
+                    and abs(value) > max_injection:
+                validation_result['valid'] = False
+                validation_result['reason'] = f'Perturbation {n} load {abs(value)}VA exceeds limit {max_injection}VA'
+                return validation_result
+        
+        return validation_result
+    
     def get_constraints(self):
         """Get current threat model constraints"""
         return self.constraints.copy()